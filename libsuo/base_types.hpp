@@ -21,6 +21,7 @@ typedef float SoftSymbol;
 
 // Fixed-point I/Q samples
 typedef uint8_t cu8_t[2];
+typedef int8_t cs8_t[2];
 typedef int16_t cs16_t[2];
 
 // Data type to represent single bits. Contains a value 0 or 1.
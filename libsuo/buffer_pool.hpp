@@ -0,0 +1,259 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+#include <new>
+
+namespace suo {
+
+/*
+ * Default alignment of the sample and symbol buffers.
+ * 64 bytes covers AVX-512 loads and a full cache line.
+ */
+constexpr size_t buffer_alignment = 64;
+
+
+/*
+ * Minimal allocator returning memory aligned for SIMD loads.
+ */
+template <typename T, size_t Alignment = buffer_alignment>
+class AlignedAllocator
+{
+public:
+	typedef T value_type;
+
+	template <typename U>
+	struct rebind { typedef AlignedAllocator<U, Alignment> other; };
+
+	AlignedAllocator() noexcept = default;
+
+	template <typename U>
+	AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept { }
+
+	T* allocate(size_t n) {
+		return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Alignment)));
+	}
+
+	void deallocate(T* p, size_t /*n*/) noexcept {
+		::operator delete(p, std::align_val_t(Alignment));
+	}
+
+	template <typename U>
+	bool operator==(const AlignedAllocator<U, Alignment>&) const noexcept { return true; }
+
+	template <typename U>
+	bool operator!=(const AlignedAllocator<U, Alignment>&) const noexcept { return false; }
+};
+
+
+template <typename T> class BufferPool;
+
+namespace detail {
+
+template <typename T> struct PoolCore;
+
+template <typename T>
+struct PoolNode {
+	T value;
+	std::atomic<unsigned int> refs{ 0 };
+	PoolCore<T>* core;
+};
+
+/*
+ * Shared state of a pool. Outlives the BufferPool object if there are
+ * still buffers in use when the pool is destroyed.
+ */
+template <typename T>
+struct PoolCore {
+	std::mutex mutex;
+	std::vector<PoolNode<T>*> free_nodes;
+	size_t max_pooled;
+	bool closed = false;
+
+	uint64_t hits = 0;
+	uint64_t misses = 0;
+	size_t outstanding = 0;
+	size_t high_water = 0;
+
+	void release(PoolNode<T>* node) {
+		std::unique_lock<std::mutex> lock(mutex);
+		outstanding--;
+		if (closed == false && free_nodes.size() < max_pooled) {
+			free_nodes.push_back(node);
+			return;
+		}
+
+		delete node;
+		if (closed && outstanding == 0) {
+			lock.unlock();
+			delete this;
+		}
+	}
+};
+
+}; // namespace detail
+
+
+/*
+ * Reference counted handle to a buffer borrowed from a BufferPool.
+ * Copying the handle shares the same buffer. The buffer is returned
+ * to the pool when the last handle is destroyed.
+ */
+template <typename T>
+class Pooled
+{
+public:
+	Pooled() : node(nullptr) { }
+
+	Pooled(const Pooled& other) : node(other.node) {
+		if (node)
+			node->refs.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	Pooled(Pooled&& other) noexcept : node(other.node) {
+		other.node = nullptr;
+	}
+
+	~Pooled() {
+		reset();
+	}
+
+	Pooled& operator=(const Pooled& other) {
+		if (this != &other) {
+			reset();
+			node = other.node;
+			if (node)
+				node->refs.fetch_add(1, std::memory_order_relaxed);
+		}
+		return *this;
+	}
+
+	Pooled& operator=(Pooled&& other) noexcept {
+		if (this != &other) {
+			reset();
+			node = other.node;
+			other.node = nullptr;
+		}
+		return *this;
+	}
+
+	/* Drop the reference to the buffer */
+	void reset() {
+		if (node && node->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			node->core->release(node);
+		node = nullptr;
+	}
+
+	T* get() const { return &node->value; }
+	T& operator*() const { return node->value; }
+	T* operator->() const { return &node->value; }
+	explicit operator bool() const { return node != nullptr; }
+
+	unsigned int use_count() const {
+		return node ? node->refs.load(std::memory_order_relaxed) : 0;
+	}
+
+private:
+	explicit Pooled(detail::PoolNode<T>* node) : node(node) { }
+
+	detail::PoolNode<T>* node;
+	friend class BufferPool<T>;
+};
+
+
+/*
+ * Pool of recycled buffers (SampleVector, SymbolVector, Frame, ...).
+ *
+ * acquire() hands out a cleared buffer which has kept the capacity it had
+ * when it was returned, so after a warm-up the hot paths don't touch the heap.
+ * The pool can be shared between threads.
+ */
+template <typename T>
+class BufferPool
+{
+public:
+
+	struct Statistics {
+		uint64_t hits;          // Buffer was recycled from the pool
+		uint64_t misses;        // New buffer had to be allocated
+		size_t outstanding;     // Buffers currently in use
+		size_t high_water;      // Maximum number of buffers in use at the same time
+		size_t pooled;          // Free buffers waiting in the pool
+	};
+
+	/* max_pooled: Maximum number of free buffers kept in the pool */
+	explicit BufferPool(size_t max_pooled = 64) :
+		core(new detail::PoolCore<T>())
+	{
+		core->max_pooled = max_pooled;
+	}
+
+	~BufferPool() {
+		std::unique_lock<std::mutex> lock(core->mutex);
+		core->closed = true;
+		for (detail::PoolNode<T>* node: core->free_nodes)
+			delete node;
+		core->free_nodes.clear();
+		if (core->outstanding == 0) {
+			lock.unlock();
+			delete core;
+		}
+	}
+
+	BufferPool(const BufferPool&) = delete;
+	BufferPool& operator=(const BufferPool&) = delete;
+
+	/*
+	 * Get a cleared buffer from the pool.
+	 * If min_capacity is given, the buffer has room for at least that many items.
+	 */
+	Pooled<T> acquire(size_t min_capacity = 0) {
+		detail::PoolNode<T>* node = nullptr;
+		{
+			std::lock_guard<std::mutex> lock(core->mutex);
+			if (core->free_nodes.empty() == false) {
+				node = core->free_nodes.back();
+				core->free_nodes.pop_back();
+				core->hits++;
+			}
+			else {
+				core->misses++;
+			}
+			core->outstanding++;
+			if (core->outstanding > core->high_water)
+				core->high_water = core->outstanding;
+		}
+
+		if (node == nullptr) {
+			node = new detail::PoolNode<T>();
+			node->core = core;
+		}
+
+		node->refs.store(1, std::memory_order_relaxed);
+		node->value.clear();
+		if constexpr (requires (T& t) { t.reserve(min_capacity); }) {
+			if (min_capacity > 0)
+				node->value.reserve(min_capacity);
+		}
+
+		return Pooled<T>(node);
+	}
+
+	Statistics getStatistics() const {
+		std::lock_guard<std::mutex> lock(core->mutex);
+		Statistics stats;
+		stats.hits = core->hits;
+		stats.misses = core->misses;
+		stats.outstanding = core->outstanding;
+		stats.high_water = core->high_water;
+		stats.pooled = core->free_nodes.size();
+		return stats;
+	}
+
+private:
+	detail::PoolCore<T>* core;
+};
+
+}; // namespace suo
@@ -0,0 +1,142 @@
+#include <iostream>
+
+#include "burst_renderer.hpp"
+
+using namespace suo;
+using namespace std;
+
+
+BurstRenderer::Config::Config() {
+	capacity = 4;
+	chunk_size = 8192;
+	max_burst_length = 1 << 22;
+}
+
+
+BurstRenderer::BurstRenderer(const Config& conf) :
+	conf(conf),
+	ring(conf.capacity),
+	current_time(0),
+	burst_due(0),
+	rendered(0),
+	transmitted(0),
+	truncated(0)
+{
+	if (conf.chunk_size == 0)
+		throw SuoError("BurstRenderer: Zero chunk size");
+	if (conf.max_burst_length == 0)
+		throw SuoError("BurstRenderer: Zero maximum burst length");
+}
+
+
+void BurstRenderer::tick(Timestamp now)
+{
+	current_time.store(now, std::memory_order_relaxed);
+	notify();
+}
+
+
+size_t BurstRenderer::process(size_t max_items)
+{
+	size_t n = 0;
+	while (n < max_items) {
+
+		Slot* slot = ring.acquire();
+		if (slot == nullptr)
+			break;
+
+		const Timestamp now = current_time.load(std::memory_order_relaxed);
+		burst_due = 0;
+		SampleGenerator gen = generateBurst.emit(now);
+		if (gen.running() == false)
+			break;
+
+		SUO_PROFILE(profile_render, 0);
+
+		/* Render the whole burst. The slot's buffer keeps its capacity between the bursts. */
+		SampleVector& samples = slot->samples;
+		samples.clear();
+		while (gen.running()) {
+			const size_t len = samples.size();
+			if (len >= conf.max_burst_length) {
+				/* The burst might end exactly at the maximum length */
+				Sample extra;
+				VectorFlags extra_flags = none;
+				if (gen.sourceSamples(SampleSpan{ &extra, 1 }, extra_flags) > 0) {
+					cerr << "Warning: TX burst longer than " << conf.max_burst_length << " samples truncated!" << endl;
+					truncated.fetch_add(1, std::memory_order_relaxed);
+				}
+				break;
+			}
+
+			/* The last chunk is clamped to the room left in the burst */
+			const size_t chunk = min<size_t>(conf.chunk_size, conf.max_burst_length - len);
+			samples.resize(len + chunk);
+			VectorFlags flags = none;
+			const size_t written = gen.sourceSamples(SampleSpan{ samples.data() + len, chunk }, flags);
+			samples.resize(len + written);
+
+			if (flags & end_of_burst)
+				break;
+		}
+
+		SUO_PROFILE_ITEMS(samples.size());
+
+		/* Nothing to transmit. Wait for the next tick instead of polling the upstream again. */
+		if (samples.empty())
+			break;
+
+		slot->due = burst_due;
+		ring.commit();
+		rendered.fetch_add(1, std::memory_order_relaxed);
+		n++;
+	}
+	return n;
+}
+
+
+SampleGenerator BurstRenderer::generateSamples(Timestamp now)
+{
+	Slot* slot = ring.front();
+	if (slot == nullptr)
+		return SampleGenerator();
+
+	/* A burst is held until the SDR reaches its frame's TX time */
+	if (slot->due > now)
+		return SampleGenerator();
+	return burstGenerator(*slot);
+}
+
+
+void BurstRenderer::sourceFrame(Frame& frame, Timestamp now)
+{
+	sourceUpstreamFrame.emit(frame, now);
+	if (frame.empty() == false && (frame.flags & Frame::Flags::has_timestamp) != Frame::Flags::none)
+		burst_due = frame.timestamp;
+}
+
+
+SampleGenerator BurstRenderer::burstGenerator(Slot& slot)
+{
+	/* Release the slot also if the SDR abandons the burst */
+	struct Release {
+		BurstRenderer* self;
+		~Release() {
+			self->ring.pop();
+			self->transmitted.fetch_add(1, std::memory_order_relaxed);
+			self->notify();
+		}
+	} release{ this };
+
+	co_yield slot.samples;
+}
+
+
+BurstRenderer::Statistics BurstRenderer::getStatistics() const
+{
+	Statistics stats;
+	stats.rendered = rendered.load(std::memory_order_relaxed);
+	stats.transmitted = transmitted.load(std::memory_order_relaxed);
+	stats.truncated = truncated.load(std::memory_order_relaxed);
+	return stats;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <atomic>
+
+#include "suo.hpp"
+#include "executor.hpp"
+
+namespace suo {
+
+/*
+ * Look-ahead TX burst renderer.
+ *
+ * Pulls complete bursts from the modulator (which in turn pulls the frames
+ * through the framer and encoders) on an executor thread and keeps up to
+ * `capacity` rendered bursts ready. The SDR loop then only copies
+ * the ready samples to the TX stream, so no framing, coding or modulation
+ * happens on the SDR thread between a frame becoming due and the first
+ * writeStream call.
+ *
+ * The upstream (e.g. ZMQSubscriber or AMQPInterface) is polled each time
+ * a tick arrives, so the renderer should be connected to the SDR's sinkTicks.
+ * Every block upstream of the renderer runs on the executor thread.
+ *
+ * The samples don't carry the frame's TX time, so the frames can be passed
+ * through the renderer. A burst rendered from a frame with a timestamp is then
+ * held until the SDR asks for samples starting at or after that time.
+ *
+ * Example:
+ *   BurstRenderer renderer;
+ *   renderer.generateBurst.connect_member(&mod, &GMSKModulator::generateSamples);
+ *   sdr.generateSamples.connect_member(&renderer, &BurstRenderer::generateSamples);
+ *   sdr.sinkTicks.connect_member(&renderer, &BurstRenderer::tick);
+ *   renderer.sourceUpstreamFrame.connect_member(&zmq, &ZMQSubscriber::sourceFrame);
+ *   framer.sourceFrame.connect_member(&renderer, &BurstRenderer::sourceFrame);
+ *   executor.addStage(renderer);
+ */
+class BurstRenderer : public Block, public ThreadedStage
+{
+public:
+
+	struct Config {
+		Config();
+
+		/* Number of rendered bursts kept ready */
+		unsigned int capacity;
+
+		/* Number of samples rendered at once */
+		unsigned int chunk_size;
+
+		/* Maximum length of one burst [samples]. Longer bursts are truncated. */
+		unsigned int max_burst_length;
+	};
+
+	struct Statistics {
+		uint64_t rendered;      // Bursts rendered
+		uint64_t transmitted;   // Bursts handed to the SDR
+		uint64_t truncated;     // Bursts cut to max_burst_length
+	};
+
+	explicit BurstRenderer(const Config& conf = Config());
+
+	/* SDR thread: Update the time and wake up the renderer to poll for new bursts */
+	void tick(Timestamp now);
+
+	/* SDR thread: Source the next rendered burst starting at time now. Returns an invalid
+	 * generator if none is ready or the next burst's frame is due after now. */
+	SampleGenerator generateSamples(Timestamp now);
+
+	/* Executor thread: Source a frame from the upstream and record its TX time */
+	void sourceFrame(Frame& frame, Timestamp now);
+
+	/* Executor thread: Render new bursts while there is free space */
+	size_t process(size_t max_items);
+
+	Statistics getStatistics() const;
+
+	/* Number of bursts ready for transmission */
+	size_t size() const { return ring.size(); }
+
+	/* Upstream burst source, usually the modulator's generateSamples */
+	SourcePort<SampleGenerator, Timestamp> generateBurst;
+
+	/* Optional upstream frame source, e.g. ZMQSubscriber's sourceFrame */
+	Port<Frame&, Timestamp> sourceUpstreamFrame;
+
+private:
+
+	struct Slot {
+		SampleVector samples;
+		Timestamp due;          // Frame's TX time or 0 if the burst can be sent immediately
+	};
+
+	SampleGenerator burstGenerator(Slot& slot);
+
+	Config conf;
+	SPSCRing<Slot> ring;
+	std::atomic<Timestamp> current_time;
+	Timestamp burst_due;
+
+	std::atomic<uint64_t> rendered, transmitted, truncated;
+
+	/* Profiling */
+	SUO_PROFILE_POINT(profile_render, "BurstRenderer", "render");
+};
+
+}; // namespace suo
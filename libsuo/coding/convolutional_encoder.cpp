@@ -20,7 +20,7 @@ void ConvolutionalConfig::validate() const {
 
 		size_t s = puncturing[0].size();
 		for (auto& c : puncturing) {
-			if (puncturing.size() == s)
+			if (c.size() != s || s == 0)
 				throw SuoError("Inconsistent puncturing vector size");
 		}
 	}
@@ -58,29 +58,39 @@ double ConvolutionalEncoder::real_rate() const
 				output_bits += (i != 0);
 		}
 
-		return (double)conf.rate / (double)output_bits;
+		// One input bit per puncturing column
+		return (double)conf.puncturing[0].size() / (double)output_bits;
 	}
 }
 
 
 void ConvolutionalEncoder::sourceSymbols(SymbolVector& symbols, Timestamp now)
 {
-	if (output_gen.running())
-		output_gen.sourceSymbols(symbols);
-	else {
+	if (output_gen.running() == false) {
+		input.clear();
 		sourceUncodedSymbols.emit(input, now);
-		if (input.empty() == false) {
-			//if (conf.puncturing.empty())
-			//	output_gen = generateSymbols();
-			//else
-			//	output_gen = generatePuncturedSymbols();
+		if (input.empty()) {
+			symbols.clear();
+			return;
 		}
+		input_gen = generator_from_vector(input);
+		output_gen = generateSymbols(input_gen);
 	}
-	
+
+	output_gen.sourceSymbols(symbols);
+}
+
+
+SymbolGenerator ConvolutionalEncoder::generateSymbols(SymbolGenerator& input)
+{
+	if (conf.puncturing.empty())
+		return generateUnpuncturedSymbols(input);
+	else
+		return generatePuncturedSymbols(input);
 }
 
 
-SymbolGenerator ConvolutionalEncoder::generateSymbols(SymbolGenerator& symbol_input)
+SymbolGenerator ConvolutionalEncoder::generateUnpuncturedSymbols(SymbolGenerator& symbol_input)
 {
 	for (Symbol s: symbol_input)
 	{
@@ -106,12 +116,13 @@ SymbolGenerator ConvolutionalEncoder::generatePuncturedSymbols(SymbolGenerator&
 	{
 		shift_register = (shift_register << 1) | (s & 1);
 
-		const std::vector<unsigned int>& c = conf.puncturing[puncturing_index];
-		if (++puncturing_index >= conf.puncturing.size())
+		// Puncturing vectors are per generator, columns advance with the input bits
+		const unsigned int column = puncturing_index;
+		if (++puncturing_index >= conf.puncturing[0].size())
 			puncturing_index = 0;
 
 		for (unsigned int j = 0; j < conf.rate; j++) {
-			if (c[j] == 0) continue;
+			if (conf.puncturing[j][column] == 0) continue;
 
 			// Calculate generator output
 			Bit g_out = bit_parity(shift_register & abs(conf.polys[j]));
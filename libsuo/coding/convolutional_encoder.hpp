@@ -48,6 +48,13 @@ public:
 
 	void sourceSymbols(SymbolVector& symbols, Timestamp now);
 
+	/*
+	 * Encode the symbols from the input generator.
+	 * Can be yielded from another generator (e.g. a framer) to write
+	 * the coded symbols directly to its output.
+	 */
+	SymbolGenerator generateSymbols(SymbolGenerator& input);
+
 	Port<SymbolVector&, Timestamp> sourceUncodedSymbols;
 
 private:
@@ -56,7 +63,7 @@ private:
 	/*
 	 * Generator for non-punctured convolutional codings
 	 */
-	SymbolGenerator generateSymbols(SymbolGenerator& gen);
+	SymbolGenerator generateUnpuncturedSymbols(SymbolGenerator& gen);
 
 	/*
 	 * Generator for punctured convolutional coding
@@ -64,13 +71,14 @@ private:
 	SymbolGenerator generatePuncturedSymbols(SymbolGenerator& gen);
 
 	/* Config */
-	const ConvolutionalConfig& conf;
+	ConvolutionalConfig conf;
 
 	/* State */
 	unsigned int puncturing_index;
 	uint32_t shift_register;
 	SymbolVector input;
 	SymbolVector encoderOutput;
+	SymbolGenerator input_gen;
 	SymbolGenerator output_gen;
 };
 
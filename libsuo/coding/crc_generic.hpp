@@ -5,6 +5,7 @@
 #include "framing/utils.hpp"
 
 #include <array>
+#include <mutex>
 #include <iomanip>
 
 namespace suo
@@ -119,6 +120,10 @@ private:
 		assert(sizeof(TableType) >= Width);
 		assert(algo.width == Width);
 
+		/* Blocks on different executor threads may create CRCs simultaneously */
+		static std::mutex cache_mutex;
+		std::lock_guard<std::mutex> lock(cache_mutex);
+
 		/* Try to find the lookup table from the cache */
 		auto iter = cache.find(&algo);
 		if (iter != cache.end())
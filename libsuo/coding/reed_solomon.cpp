@@ -96,9 +96,12 @@ void ReedSolomon::encode(std::vector<DataType>& msg) const
 	if (msg.size() > cfg.coded_bytes)
 		throw SuoError("Too long message to be coded with Reed Solomon");
 
-	std::vector<DataType> parity(cfg.num_roots, 0);
+	/* The parity is calculated in place after the message */
+	const size_t msg_len = msg.size();
+	msg.resize(msg_len + cfg.num_roots, 0);
+	DataType* parity = &msg[msg_len];
 
-	const unsigned int pad = cfg.coded_bytes - msg.size();
+	const unsigned int pad = cfg.coded_bytes - msg_len;
 	const unsigned int m = symbol_count - cfg.num_roots - pad;
 	for (unsigned int i = 0; i < m; i++) {
 
@@ -121,8 +124,6 @@ void ReedSolomon::encode(std::vector<DataType>& msg) const
 		else
 			parity[cfg.num_roots - 1] = 0;
 	}
-
-	msg.insert(msg.end(), parity.begin(), parity.end());
 }
 
 
@@ -0,0 +1,457 @@
+#include <algorithm>
+#include <cstring>
+
+#include "coding/viterbi_decoder.hpp"
+#include "framing/utils.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SUO_VITERBI_X86
+#endif
+
+
+using namespace std;
+using namespace suo;
+
+
+/* Soft bit value used for the punctured positions */
+static const softbit_t erasure = 128;
+
+/* Path metrics are renormalized at least every this many steps to keep them in 16 bits */
+static const size_t renormalize_interval = 8;
+
+
+/*
+ * Branch metric contribution of a soft bit if the branch's expected bit is '1'.
+ * Expected '0' contributes nothing. Dropping the common term keeps the erasure (128)
+ * at exactly zero and the metrics of the competing branches comparable.
+ */
+static inline int16_t branch_weight(softbit_t s)
+{
+	return 256 - 2 * (int)s;
+}
+
+
+static inline void renormalize_scalar(int16_t* metrics, unsigned int num_states)
+{
+	int16_t m = *min_element(metrics, metrics + num_states);
+	for (unsigned int i = 0; i < num_states; i++)
+		metrics[i] -= m;
+}
+
+
+static void viterbi_scalar(const ViterbiDecoder::Trellis& t, const softbit_t* symbols, size_t steps, int16_t* metrics, uint64_t* decisions)
+{
+	const unsigned int num_states = t.num_states, half = num_states / 2;
+	const unsigned int num_codes = 1 << t.rate;
+
+	int16_t buffer[64];
+	int16_t* old_metrics = metrics;
+	int16_t* new_metrics = buffer;
+	int16_t branch[16];
+
+	for (size_t s = 0; s < steps; s++) {
+		const softbit_t* sym = &symbols[s * t.rate];
+
+		// Branch metrics for each encoder output combination
+		for (unsigned int c = 0; c < num_codes; c++) {
+			int16_t bm = 0;
+			for (unsigned int j = 0; j < t.rate; j++)
+				if (c & (1 << j))
+					bm += branch_weight(sym[j]);
+			branch[c] = bm;
+		}
+
+		// Add-compare-select
+		uint64_t decision = 0;
+		for (unsigned int j = 0; j < num_states; j++) {
+			int16_t a = old_metrics[j >> 1] + branch[t.outputs[j]];
+			int16_t b = old_metrics[(j >> 1) + half] + branch[t.outputs[j + num_states]];
+			if (a > b) {
+				decision |= 1ULL << j;
+				new_metrics[j] = b;
+			}
+			else {
+				new_metrics[j] = a;
+			}
+		}
+		decisions[s] = decision;
+
+		swap(old_metrics, new_metrics);
+		if (s % renormalize_interval == renormalize_interval - 1)
+			renormalize_scalar(old_metrics, num_states);
+	}
+
+	renormalize_scalar(old_metrics, num_states);
+	if (old_metrics != metrics)
+		memcpy(metrics, old_metrics, num_states * sizeof(int16_t));
+}
+
+
+#ifdef SUO_VITERBI_X86
+
+/* Subtract the smallest metric from all the metrics. */
+__attribute__((target("sse4.1")))
+static inline __m128i min_metric_sse4(__m128i m)
+{
+	// minpos works on unsigned values so flip the sign bits
+	const __m128i bias = _mm_set1_epi16(-32768);
+	__m128i pos = _mm_minpos_epu16(_mm_xor_si128(m, bias));
+	return _mm_set1_epi16((int16_t)(_mm_extract_epi16(pos, 0) ^ 0x8000));
+}
+
+
+__attribute__((target("sse4.1")))
+static void viterbi_sse4(const ViterbiDecoder::Trellis& t, const softbit_t* symbols, size_t steps, int16_t* metrics, uint64_t* decisions)
+{
+	const unsigned int rate = t.rate;
+	const int16_t* masks = t.masks.data();
+
+	__m128i m[8], n[8], w[4];
+	for (unsigned int i = 0; i < 8; i++)
+		m[i] = _mm_loadu_si128((const __m128i*)(metrics + 8 * i));
+
+	for (size_t s = 0; s < steps; s++) {
+		const softbit_t* sym = &symbols[s * rate];
+		for (unsigned int j = 0; j < rate; j++)
+			w[j] = _mm_set1_epi16(branch_weight(sym[j]));
+
+		uint64_t decision = 0;
+		for (unsigned int g = 0; g < 4; g++) {
+
+			// Branch metrics for the 8 butterflies
+			__m128i bm[4];
+			for (unsigned int br = 0; br < 4; br++) {
+				bm[br] = _mm_setzero_si128();
+				for (unsigned int j = 0; j < rate; j++) {
+					__m128i mask = _mm_loadu_si128((const __m128i*)(masks + (br * rate + j) * 32 + 8 * g));
+					bm[br] = _mm_add_epi16(bm[br], _mm_and_si128(mask, w[j]));
+				}
+			}
+
+			__m128i a_even = _mm_add_epi16(m[g], bm[0]);
+			__m128i b_even = _mm_add_epi16(m[g + 4], bm[1]);
+			__m128i a_odd = _mm_add_epi16(m[g], bm[2]);
+			__m128i b_odd = _mm_add_epi16(m[g + 4], bm[3]);
+
+			__m128i even = _mm_min_epi16(a_even, b_even);
+			__m128i odd = _mm_min_epi16(a_odd, b_odd);
+			__m128i d_even = _mm_cmpgt_epi16(a_even, b_even);
+			__m128i d_odd = _mm_cmpgt_epi16(a_odd, b_odd);
+
+			// Interleave to states 16g...16g+15
+			n[2 * g] = _mm_unpacklo_epi16(even, odd);
+			n[2 * g + 1] = _mm_unpackhi_epi16(even, odd);
+
+			__m128i d = _mm_packs_epi16(_mm_unpacklo_epi16(d_even, d_odd), _mm_unpackhi_epi16(d_even, d_odd));
+			decision |= (uint64_t)(uint16_t)_mm_movemask_epi8(d) << (16 * g);
+		}
+		decisions[s] = decision;
+
+		for (unsigned int i = 0; i < 8; i++)
+			m[i] = n[i];
+
+		if (s % renormalize_interval == renormalize_interval - 1 || s + 1 == steps) {
+			__m128i mn = m[0];
+			for (unsigned int i = 1; i < 8; i++)
+				mn = _mm_min_epi16(mn, m[i]);
+			mn = min_metric_sse4(mn);
+			for (unsigned int i = 0; i < 8; i++)
+				m[i] = _mm_sub_epi16(m[i], mn);
+		}
+	}
+
+	for (unsigned int i = 0; i < 8; i++)
+		_mm_storeu_si128((__m128i*)(metrics + 8 * i), m[i]);
+}
+
+
+__attribute__((target("avx2")))
+static void viterbi_avx2(const ViterbiDecoder::Trellis& t, const softbit_t* symbols, size_t steps, int16_t* metrics, uint64_t* decisions)
+{
+	const unsigned int rate = t.rate;
+	const int16_t* masks = t.masks.data();
+
+	__m256i m[4], n[4], w[4];
+	for (unsigned int i = 0; i < 4; i++)
+		m[i] = _mm256_loadu_si256((const __m256i*)(metrics + 16 * i));
+
+	for (size_t s = 0; s < steps; s++) {
+		const softbit_t* sym = &symbols[s * rate];
+		for (unsigned int j = 0; j < rate; j++)
+			w[j] = _mm256_set1_epi16(branch_weight(sym[j]));
+
+		uint64_t decision = 0;
+		for (unsigned int g = 0; g < 2; g++) {
+
+			// Branch metrics for the 16 butterflies
+			__m256i bm[4];
+			for (unsigned int br = 0; br < 4; br++) {
+				bm[br] = _mm256_setzero_si256();
+				for (unsigned int j = 0; j < rate; j++) {
+					__m256i mask = _mm256_loadu_si256((const __m256i*)(masks + (br * rate + j) * 32 + 16 * g));
+					bm[br] = _mm256_add_epi16(bm[br], _mm256_and_si256(mask, w[j]));
+				}
+			}
+
+			__m256i a_even = _mm256_add_epi16(m[g], bm[0]);
+			__m256i b_even = _mm256_add_epi16(m[g + 2], bm[1]);
+			__m256i a_odd = _mm256_add_epi16(m[g], bm[2]);
+			__m256i b_odd = _mm256_add_epi16(m[g + 2], bm[3]);
+
+			__m256i even = _mm256_min_epi16(a_even, b_even);
+			__m256i odd = _mm256_min_epi16(a_odd, b_odd);
+			__m256i d_even = _mm256_cmpgt_epi16(a_even, b_even);
+			__m256i d_odd = _mm256_cmpgt_epi16(a_odd, b_odd);
+
+			// Interleave within the lanes and then put the lanes in order to get states 32g...32g+31
+			__m256i lo = _mm256_unpacklo_epi16(even, odd);
+			__m256i hi = _mm256_unpackhi_epi16(even, odd);
+			n[2 * g] = _mm256_permute2x128_si256(lo, hi, 0x20);
+			n[2 * g + 1] = _mm256_permute2x128_si256(lo, hi, 0x31);
+
+			__m256i d_lo = _mm256_unpacklo_epi16(d_even, d_odd);
+			__m256i d_hi = _mm256_unpackhi_epi16(d_even, d_odd);
+			__m256i d = _mm256_packs_epi16(_mm256_permute2x128_si256(d_lo, d_hi, 0x20), _mm256_permute2x128_si256(d_lo, d_hi, 0x31));
+			d = _mm256_permute4x64_epi64(d, _MM_SHUFFLE(3, 1, 2, 0));
+			decision |= (uint64_t)(uint32_t)_mm256_movemask_epi8(d) << (32 * g);
+		}
+		decisions[s] = decision;
+
+		for (unsigned int i = 0; i < 4; i++)
+			m[i] = n[i];
+
+		if (s % renormalize_interval == renormalize_interval - 1 || s + 1 == steps) {
+			__m256i mn = _mm256_min_epi16(_mm256_min_epi16(m[0], m[1]), _mm256_min_epi16(m[2], m[3]));
+			__m128i mn128 = _mm_min_epi16(_mm256_castsi256_si128(mn), _mm256_extracti128_si256(mn, 1));
+			__m256i sub = _mm256_broadcastw_epi16(min_metric_sse4(mn128));
+			for (unsigned int i = 0; i < 4; i++)
+				m[i] = _mm256_sub_epi16(m[i], sub);
+		}
+	}
+
+	for (unsigned int i = 0; i < 4; i++)
+		_mm256_storeu_si256((__m256i*)(metrics + 16 * i), m[i]);
+}
+
+#endif /* SUO_VITERBI_X86 */
+
+
+bool ViterbiDecoder::isSupported(ViterbiKernel kernel)
+{
+	switch (kernel) {
+	case ViterbiKernel::automatic:
+	case ViterbiKernel::scalar:
+		return true;
+#ifdef SUO_VITERBI_X86
+	case ViterbiKernel::sse4:
+		return __builtin_cpu_supports("sse4.1");
+	case ViterbiKernel::avx2:
+		return __builtin_cpu_supports("avx2");
+#endif
+	default:
+		return false;
+	}
+}
+
+
+const char* ViterbiDecoder::getKernelName(ViterbiKernel kernel)
+{
+	switch (kernel) {
+	case ViterbiKernel::automatic: return "automatic";
+	case ViterbiKernel::scalar: return "scalar";
+	case ViterbiKernel::sse4: return "sse4";
+	case ViterbiKernel::avx2: return "avx2";
+	}
+	return "unknown";
+}
+
+
+ViterbiDecoder::ViterbiDecoder(const ConvolutionalConfig& conf, ViterbiKernel kernel) :
+	conf(conf),
+	kernel(kernel)
+{
+	conf.validate();
+
+	if (conf.k < 3 || conf.k > 7)
+		throw SuoError("ViterbiDecoder: Unsupported constraint length %u", conf.k);
+
+	const unsigned int num_states = 1 << (conf.k - 1);
+	for (int poly: conf.polys) {
+		if (abs(poly) >= (1 << conf.k))
+			throw SuoError("ViterbiDecoder: Generator polynomial longer than the constraint length");
+	}
+
+	if (isSupported(kernel) == false)
+		throw SuoError("ViterbiDecoder: Kernel %s not supported by the CPU", getKernelName(kernel));
+
+	if (kernel == ViterbiKernel::automatic) {
+		if (num_states == 64 && isSupported(ViterbiKernel::avx2))
+			this->kernel = ViterbiKernel::avx2;
+		else if (num_states == 64 && isSupported(ViterbiKernel::sse4))
+			this->kernel = ViterbiKernel::sse4;
+		else
+			this->kernel = ViterbiKernel::scalar;
+	}
+	else if (kernel != ViterbiKernel::scalar && num_states != 64) {
+		throw SuoError("ViterbiDecoder: Kernel %s requires constraint length 7", getKernelName(kernel));
+	}
+
+	switch (this->kernel) {
+#ifdef SUO_VITERBI_X86
+	case ViterbiKernel::avx2: kernel_func = &viterbi_avx2; break;
+	case ViterbiKernel::sse4: kernel_func = &viterbi_sse4; break;
+#endif
+	default: kernel_func = &viterbi_scalar; break;
+	}
+
+	/* Encoder outputs for each shift register value */
+	trellis.num_states = num_states;
+	trellis.rate = conf.rate;
+	trellis.outputs.resize(2 * num_states);
+	for (unsigned int r = 0; r < 2 * num_states; r++) {
+		uint8_t out = 0;
+		for (unsigned int j = 0; j < conf.rate; j++) {
+			unsigned int bit = bit_parity((uint32_t)(r & abs(conf.polys[j])));
+			out |= (bit ^ (conf.polys[j] < 0)) << j;
+		}
+		trellis.outputs[r] = out;
+	}
+
+	/* Butterfly masks for the SIMD kernels */
+	const unsigned int half = num_states / 2;
+	trellis.masks.resize(4 * conf.rate * half);
+	for (unsigned int m = 0; m < half; m++) {
+		const unsigned int regs[4] = { 2 * m, 2 * m + num_states, 2 * m + 1, 2 * m + 1 + num_states };
+		for (unsigned int br = 0; br < 4; br++)
+			for (unsigned int j = 0; j < conf.rate; j++)
+				trellis.masks[(br * conf.rate + j) * half + m] = (trellis.outputs[regs[br]] & (1 << j)) ? -1 : 0;
+	}
+
+	/* Depuncturing pattern */
+	if (conf.puncturing.empty()) {
+		depuncturing.assign(conf.rate, 1);
+	}
+	else {
+		const size_t period = conf.puncturing[0].size();
+		depuncturing.resize(period * conf.rate);
+		for (size_t c = 0; c < period; c++) {
+			bool transmitted = false;
+			for (unsigned int j = 0; j < conf.rate; j++) {
+				depuncturing[c * conf.rate + j] = (conf.puncturing[j][c] != 0);
+				transmitted |= (conf.puncturing[j][c] != 0);
+			}
+			if (transmitted == false)
+				throw SuoError("ViterbiDecoder: Puncturing removes all the bits of a column");
+		}
+	}
+
+	symbols.reserve(conf.rate * (traceback_len + block_len));
+	decisions.resize(traceback_len + block_len);
+	reset();
+}
+
+
+void ViterbiDecoder::reset(uint32_t start_state)
+{
+	const unsigned int num_states = trellis.num_states;
+
+	/* Other states are penalized by more than the worst path over k-1 steps. */
+	metrics.assign(num_states, (conf.k - 1) * conf.rate * 256);
+	metrics[start_state & (num_states - 1)] = 0;
+
+	depuncturing_index = 0;
+	symbols.clear();
+	num_decisions = 0;
+}
+
+
+void ViterbiDecoder::decode(const softbit_t* bits, size_t len, SymbolVector& output)
+{
+	if (conf.puncturing.empty()) {
+		symbols.insert(symbols.end(), bits, bits + len);
+	}
+	else {
+		const size_t pattern_len = depuncturing.size();
+		for (size_t i = 0; i < len; i++) {
+
+			// Fill the punctured positions with erasures
+			while (depuncturing[depuncturing_index] == 0) {
+				symbols.push_back(erasure);
+				depuncturing_index = (depuncturing_index + 1) % pattern_len;
+			}
+
+			symbols.push_back(bits[i]);
+			depuncturing_index = (depuncturing_index + 1) % pattern_len;
+
+			// Complete the step if its remaining bits are punctured
+			while (depuncturing_index % conf.rate != 0 && depuncturing[depuncturing_index] == 0) {
+				symbols.push_back(erasure);
+				depuncturing_index = (depuncturing_index + 1) % pattern_len;
+			}
+		}
+	}
+
+	runTrellis(output);
+}
+
+
+void ViterbiDecoder::decodeHard(const Bit* bits, size_t len, SymbolVector& output)
+{
+	softbit_t soft[256];
+	while (len > 0) {
+		size_t n = min(len, sizeof(soft));
+		for (size_t i = 0; i < n; i++)
+			soft[i] = bits[i] ? 255 : 0;
+		decode(soft, n, output);
+		bits += n;
+		len -= n;
+	}
+}
+
+
+void ViterbiDecoder::flush(SymbolVector& output)
+{
+	if (num_decisions > 0)
+		traceback(num_decisions, output);
+	symbols.clear();
+}
+
+
+void ViterbiDecoder::runTrellis(SymbolVector& output)
+{
+	const size_t steps = symbols.size() / conf.rate;
+
+	size_t done = 0;
+	while (done < steps) {
+		size_t n = min(steps - done, decisions.size() - num_decisions);
+		kernel_func(trellis, &symbols[done * conf.rate], n, metrics.data(), &decisions[num_decisions]);
+		num_decisions += n;
+		done += n;
+
+		if (num_decisions == decisions.size())
+			traceback(block_len, output);
+	}
+
+	// Keep the incomplete step for the next call
+	symbols.erase(symbols.begin(), symbols.begin() + done * conf.rate);
+}
+
+
+void ViterbiDecoder::traceback(size_t count, SymbolVector& output)
+{
+	unsigned int state = min_element(metrics.begin(), metrics.end()) - metrics.begin();
+
+	const size_t base = output.size();
+	output.resize(base + count);
+
+	for (size_t t = num_decisions; t-- > 0; ) {
+		if (t < count)
+			output[base + t] = state & 1;
+		unsigned int d = (decisions[t] >> state) & 1;
+		state = (state >> 1) | (d << (conf.k - 2));
+	}
+
+	copy(decisions.begin() + count, decisions.begin() + num_decisions, decisions.begin());
+	num_decisions -= count;
+}
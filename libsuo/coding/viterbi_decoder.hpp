@@ -0,0 +1,125 @@
+#pragma once
+
+#include "suo.hpp"
+#include "coding/convolutional_encoder.hpp"
+
+namespace suo
+{
+
+/*
+ * Implementations of the add-compare-select kernel.
+ * The SIMD kernels are available for constraint length 7 (64 states).
+ * The automatic selection picks the widest instruction set the CPU supports
+ * and falls back to the scalar kernel for other constraint lengths.
+ */
+enum class ViterbiKernel {
+	automatic,
+	scalar,
+	sse4,
+	avx2
+};
+
+
+/*
+ * Soft-decision Viterbi decoder for the codes described by ConvolutionalConfig.
+ *
+ * The input is the coded (and possibly punctured) bit stream as soft bits.
+ * The punctured positions are filled with erasures (softbit 128) which don't
+ * affect the path metrics. Path metrics are 16-bit and the branch metrics are
+ * calculated from the 8-bit soft bits.
+ *
+ * The path decisions are stored for traceback_len + block_len trellis steps.
+ * When the buffer is full, traceback is done from the best state and
+ * the oldest block_len decoded bits are output.
+ */
+class ViterbiDecoder
+{
+public:
+
+	/* Traceback depth in trellis steps */
+	static const unsigned int traceback_len = 96;
+
+	/* Number of bits output per traceback */
+	static const unsigned int block_len = 160;
+
+	explicit ViterbiDecoder(const ConvolutionalConfig& conf, ViterbiKernel kernel = ViterbiKernel::automatic);
+
+	/*
+	 * Reset the decoder to start from the given encoder state.
+	 */
+	void reset(uint32_t start_state=0);
+
+	/*
+	 * Decode a block of soft bits (0 = very likely '0', 255 = very likely '1').
+	 * The decoded bits are appended to output. Because of the traceback,
+	 * the output lags the input by up to traceback_len + block_len bits.
+	 */
+	void decode(const softbit_t* bits, size_t len, SymbolVector& output);
+
+	/*
+	 * Decode a block of hard bits (0 or 1).
+	 */
+	void decodeHard(const Bit* bits, size_t len, SymbolVector& output);
+
+	/*
+	 * Output the rest of the decoded bits by tracing back from the best state.
+	 * An incomplete puncturing period is discarded. Reset the decoder before
+	 * decoding the next stream.
+	 */
+	void flush(SymbolVector& output);
+
+	/* Returns the kernel in use */
+	ViterbiKernel getKernel() const { return kernel; }
+
+	/* Is given kernel available on this CPU */
+	static bool isSupported(ViterbiKernel kernel);
+
+	/* Get human readable name of the kernel */
+	static const char* getKernelName(ViterbiKernel kernel);
+
+	/*
+	 * Trellis description shared by the kernels.
+	 */
+	struct Trellis {
+		unsigned int num_states;
+		unsigned int rate;
+
+		/* Encoder output bits (bit j = generator j) for each shift register value [0, 2 * num_states) */
+		std::vector<uint8_t> outputs;
+
+		/*
+		 * Output bit masks (0 or -1) for the SIMD kernels as [(branch * rate + j) * num_states / 2 + m].
+		 * Branches: 0 = state m -> 2m, 1 = state m + N/2 -> 2m, 2 = state m -> 2m + 1, 3 = state m + N/2 -> 2m + 1
+		 */
+		std::vector<int16_t> masks;
+	};
+
+	/*
+	 * Kernel runs the trellis for given number of depunctured steps (rate soft bits per step),
+	 * updating the path metrics and writing one decision word per step.
+	 */
+	typedef void (*KernelFunction)(const Trellis& trellis, const softbit_t* symbols, size_t steps, int16_t* metrics, uint64_t* decisions);
+
+private:
+
+	void runTrellis(SymbolVector& output);
+	void traceback(size_t count, SymbolVector& output);
+
+	/* Config */
+	ConvolutionalConfig conf;
+	ViterbiKernel kernel;
+	KernelFunction kernel_func;
+	Trellis trellis;
+
+	/* Depuncturing pattern as [column * rate + j] */
+	std::vector<uint8_t> depuncturing;
+
+	/* State */
+	unsigned int depuncturing_index;
+	std::vector<softbit_t> symbols;
+	std::vector<int16_t> metrics;
+	std::vector<uint64_t> decisions;
+	size_t num_decisions;
+};
+
+}; // namespace suo
@@ -0,0 +1,157 @@
+#include "executor.hpp"
+
+#ifdef __linux__
+#include <pthread.h>
+#endif
+
+using namespace suo;
+using namespace std;
+
+
+/* Maximum number of items processed from one stage before checking the others */
+static const size_t stage_batch_size = 8;
+
+
+Executor::Executor() :
+	is_running(false),
+	has_failed(false)
+{
+}
+
+
+Executor::~Executor()
+{
+	/* Can't throw from the destructor, so a stage's exception is dropped here */
+	join();
+
+	/* Don't leave the stages pointing to the destroyed wake-up counters */
+	for (auto& worker: workers)
+		for (ThreadedStage* stage: worker->stages)
+			stage->wakeup.store(nullptr, std::memory_order_release);
+}
+
+
+unsigned int Executor::addThread(const std::string& name)
+{
+	if (is_running)
+		throw SuoError("Executor: Cannot add threads while running");
+
+	workers.emplace_back(new Worker());
+	workers.back()->name = name;
+	return workers.size() - 1;
+}
+
+
+void Executor::addStage(ThreadedStage& stage, unsigned int thread)
+{
+	if (is_running)
+		throw SuoError("Executor: Cannot add stages while running");
+	if (thread >= workers.size())
+		throw SuoError("Executor: Invalid thread index %u", thread);
+	if (stage.wakeup.load() != nullptr)
+		throw SuoError("Executor: Stage already assigned to a thread");
+
+	Worker& worker = *workers[thread];
+	worker.stages.push_back(&stage);
+	stage.wakeup.store(&worker.wakeup, std::memory_order_release);
+}
+
+
+unsigned int Executor::addStage(ThreadedStage& stage)
+{
+	unsigned int thread = addThread();
+	addStage(stage, thread);
+	return thread;
+}
+
+
+void Executor::start()
+{
+	if (is_running)
+		return;
+	is_running = true;
+	has_failed = false;
+
+	for (auto& worker: workers) {
+		worker->error = nullptr;
+		for (ThreadedStage* stage: worker->stages)
+			stage->attached.store(true, std::memory_order_release);
+
+		Worker* w = worker.get();
+		worker->thread = std::thread([this, w]() { run(*w); });
+
+#ifdef __linux__
+		if (worker->name.empty() == false)
+			pthread_setname_np(worker->thread.native_handle(), worker->name.substr(0, 15).c_str());
+#endif
+	}
+}
+
+
+void Executor::stop()
+{
+	join();
+
+	/* Pass the first exception of the stages to the caller */
+	for (auto& worker: workers) {
+		if (worker->error) {
+			std::exception_ptr error = worker->error;
+			for (auto& w: workers)
+				w->error = nullptr;
+			rethrow_exception(error);
+		}
+	}
+}
+
+
+void Executor::join()
+{
+	if (is_running == false)
+		return;
+	is_running = false;
+
+	for (auto& worker: workers) {
+		worker->wakeup.fetch_add(1, std::memory_order_release);
+		worker->wakeup.notify_all();
+	}
+
+	for (auto& worker: workers) {
+		if (worker->thread.joinable())
+			worker->thread.join();
+		for (ThreadedStage* stage: worker->stages)
+			stage->attached.store(false, std::memory_order_release);
+	}
+}
+
+
+void Executor::run(Worker& worker)
+{
+	while (true) {
+
+		// Read the wake-up counter before checking the queues so no notification is missed
+		uint32_t seen = worker.wakeup.load(std::memory_order_acquire);
+
+		size_t processed = 0;
+		try {
+			for (ThreadedStage* stage: worker.stages)
+				processed += stage->process(stage_batch_size);
+		}
+		catch (...) {
+			/* Stop the worker and keep the exception for stop(). Blocking producers stop waiting for it. */
+			worker.error = current_exception();
+			for (ThreadedStage* stage: worker.stages)
+				stage->attached.store(false, std::memory_order_release);
+			has_failed = true;
+			return;
+		}
+
+		if (processed > 0)
+			continue;
+
+		// All queues are drained
+		if (is_running.load() == false)
+			break;
+
+		worker.wakeup.wait(seen, std::memory_order_acquire);
+	}
+}
@@ -0,0 +1,275 @@
+#pragma once
+
+#include <atomic>
+#include <exception>
+#include <thread>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "suo.hpp"
+#include "ring_buffer.hpp"
+
+namespace suo {
+
+/*
+ * What to do when a producer finds a queue full.
+ */
+enum class QueuePolicy {
+	Block,  // Wait for the consumer to free space (optionally up to a timeout)
+	Drop,   // Drop the new item immediately and count it
+};
+
+
+/*
+ * Base class for stage boundaries which are drained by an Executor thread.
+ */
+class ThreadedStage
+{
+public:
+	ThreadedStage() = default;
+	virtual ~ThreadedStage() = default;
+
+	ThreadedStage(const ThreadedStage&) = delete;
+	ThreadedStage& operator=(const ThreadedStage&) = delete;
+
+	/*
+	 * Consume at most max_items items from the queue and pass them forward.
+	 * Called only from the consumer thread. Returns the number of processed items.
+	 */
+	virtual size_t process(size_t max_items) = 0;
+
+protected:
+	friend class Executor;
+
+	/* Wake up the consumer thread after new items have been committed. */
+	void notify() {
+		std::atomic<uint32_t>* counter = wakeup.load(std::memory_order_acquire);
+		if (counter != nullptr) {
+			counter->fetch_add(1, std::memory_order_release);
+			counter->notify_one();
+		}
+	}
+
+	/* Set by the executor: Wake-up counter of the consumer thread and its run state.
+	 * The executor clears the counter when it's destroyed. */
+	std::atomic<std::atomic<uint32_t>*> wakeup{ nullptr };
+	std::atomic<bool> attached{ false };
+};
+
+
+/*
+ * Bounded single-producer/single-consumer queue between two blocks.
+ *
+ * sink() is called from the producer thread (for example from SoapySDRIO's
+ * sinkSamples port) and copies the item to a preallocated ring slot.
+ * The executor thread pops the items and emits them from the output port,
+ * so every block connected to output runs on the consumer thread.
+ */
+template <typename T>
+class ThreadedQueue : public ThreadedStage
+{
+public:
+
+	struct Config {
+		Config() {
+			capacity = 16;
+			policy = QueuePolicy::Block;
+			block_timeout = 0;
+		}
+
+		/* Number of items the queue can hold. Rounded up to the next power of two. */
+		unsigned int capacity;
+
+		/* What to do when the queue is full */
+		QueuePolicy policy;
+
+		/* Maximum time to wait for free space in Block mode [us]. Zero waits forever. */
+		unsigned int block_timeout;
+	};
+
+	struct Statistics {
+		uint64_t pushed;        // Items accepted to the queue
+		uint64_t dropped;       // Items dropped because the queue was full
+		size_t high_water;      // Maximum number of items in the queue
+	};
+
+	explicit ThreadedQueue(const Config& conf = Config()) :
+		conf(conf),
+		ring(conf.capacity),
+		pushed(0),
+		dropped(0),
+		high_water(0)
+	{ }
+
+	/* Producer: Push a copy of the item to the queue. */
+	void sink(const T& item, Timestamp now) {
+		SUO_PROFILE(profile_sink, 1);
+		Slot* slot = ring.acquire();
+		if (slot == nullptr)
+			slot = waitForSpace();
+		if (slot == nullptr) {
+			dropped.fetch_add(1, std::memory_order_relaxed);
+			SUO_PROFILE_DROP(profile_sink, 1);
+			return;
+		}
+
+		slot->item = item;
+		slot->now = now;
+		ring.commit();
+		pushed.fetch_add(1, std::memory_order_relaxed);
+
+		size_t level = ring.size();
+		if (level > high_water.load(std::memory_order_relaxed))
+			high_water.store(level, std::memory_order_relaxed);
+
+		notify();
+	}
+
+	/* Consumer: Emit queued items from the output port. */
+	size_t process(size_t max_items) {
+		size_t n = 0;
+		while (n < max_items) {
+			Slot* slot = ring.front();
+			if (slot == nullptr)
+				break;
+			output.emit(slot->item, slot->now);
+			ring.pop();
+			n++;
+		}
+		return n;
+	}
+
+	Statistics getStatistics() const {
+		Statistics stats;
+		stats.pushed = pushed.load(std::memory_order_relaxed);
+		stats.dropped = dropped.load(std::memory_order_relaxed);
+		stats.high_water = high_water.load(std::memory_order_relaxed);
+		return stats;
+	}
+
+	size_t size() const { return ring.size(); }
+
+	Port<const T&, Timestamp> output;
+
+private:
+
+	struct Slot {
+		T item;
+		Timestamp now;
+	};
+
+	/* Producer: Handle a full queue according to the policy. Returns nullptr if the item should be dropped. */
+	Slot* waitForSpace() {
+		if (conf.policy == QueuePolicy::Drop)
+			return nullptr;
+
+		const auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(conf.block_timeout);
+		unsigned int spins = 0;
+		while (true) {
+			// Don't wait for a consumer which is not running
+			if (attached.load(std::memory_order_acquire) == false)
+				return nullptr;
+
+			if (++spins < 64)
+				std::this_thread::yield();
+			else
+				std::this_thread::sleep_for(std::chrono::microseconds(50));
+
+			Slot* slot = ring.acquire();
+			if (slot != nullptr)
+				return slot;
+
+			if (conf.block_timeout != 0 && std::chrono::steady_clock::now() > deadline)
+				return nullptr;
+		}
+	}
+
+	Config conf;
+	SPSCRing<Slot> ring;
+
+	std::atomic<uint64_t> pushed;
+	std::atomic<uint64_t> dropped;
+	std::atomic<size_t> high_water;
+
+	/* Profiling */
+	SUO_PROFILE_POINT(profile_sink, "ThreadedQueue", "sink");
+};
+
+typedef ThreadedQueue<SampleVector> SampleQueue;
+typedef ThreadedQueue<SymbolVector> SymbolQueue;
+typedef ThreadedQueue<Frame> FrameQueue;
+
+
+/*
+ * Executor:
+ * Runs the consumer sides of threaded stages on dedicated worker threads.
+ * One worker thread can drain several stages in a round-robin fashion.
+ *
+ * Example:
+ *   SampleQueue samples;
+ *   FrameQueue frames;
+ *   sdr.sinkSamples.connect_member(&samples, &SampleQueue::sink);
+ *   samples.output.connect_member(&demod, &GMSKContinousDemodulator::sinkSamples);
+ *   deframer.sinkFrame.connect_member(&frames, &FrameQueue::sink);
+ *   frames.output.connect_member(&zmq_output, &ZMQPublisher::sinkFrame);
+ *
+ *   Executor executor;
+ *   executor.addStage(samples);  // DSP thread
+ *   executor.addStage(frames);   // Frame output thread
+ *   executor.start();
+ *   sdr.execute();               // SDR I/O on the calling thread
+ *   executor.stop();
+ */
+class Executor
+{
+public:
+	Executor();
+	~Executor();
+
+	Executor(const Executor&) = delete;
+	Executor& operator=(const Executor&) = delete;
+
+	/* Create a new worker thread and return its index */
+	unsigned int addThread(const std::string& name = "");
+
+	/* Assign a stage to be drained by an existing worker thread */
+	void addStage(ThreadedStage& stage, unsigned int thread);
+
+	/* Assign a stage to a new worker thread of its own. Returns the thread index. */
+	unsigned int addStage(ThreadedStage& stage);
+
+	/* Start all worker threads */
+	void start();
+
+	/*
+	 * Drain the queues and stop all worker threads.
+	 * If a stage threw an exception, it is rethrown here after all workers have been joined.
+	 */
+	void stop();
+
+	bool running() const { return is_running.load(); }
+
+	/* A stage has thrown an exception and its worker thread has stopped */
+	bool failed() const { return has_failed.load(); }
+
+private:
+
+	struct Worker {
+		std::string name;
+		std::vector<ThreadedStage*> stages;
+		std::atomic<uint32_t> wakeup{ 0 };
+		std::thread thread;
+		std::exception_ptr error;
+	};
+
+	void run(Worker& worker);
+	void join();
+
+	std::vector<std::unique_ptr<Worker>> workers;
+	std::atomic<bool> is_running;
+	std::atomic<bool> has_failed;
+};
+
+}; // namespace suo
@@ -93,7 +93,12 @@ void FileDump::sinkFrame(const Frame& frame, Timestamp timestamp) {
 	}
 	case FileFormatASCIIHex: {
 		/* Print frame data as hexadecimal string to file. */
-		output << "# " << getCurrentISOTimestamp() << endl;
+		// Prefer the reception time recorded by the deframer
+		const MetadataValue* utc = frame.metadata.find(meta::sync_utc_timestamp);
+		if (utc != nullptr && std::holds_alternative<UTCTimestamp>(*utc))
+			output << "# " << formatISOTimestamp(std::get<UTCTimestamp>(*utc)) << endl;
+		else
+			output << "# " << getCurrentISOTimestamp() << endl;
 		output << hex << right << setw(2) << setfill('0');
 		for (unsigned int i = 0; i < frame.data.size(); i++) {
 			output << (int)frame.data[i];
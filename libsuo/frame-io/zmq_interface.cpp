@@ -21,11 +21,14 @@ ZMQPublisher::Config::Config() {
 	bind = "";
 	connect = "";
 	msg_format = ZMQMessageFormat::JSON;
+	profile_interval = 0;
+	profile_bind = "";
 }
 
 
 ZMQPublisher::ZMQPublisher(const ZMQPublisher::Config& conf):
-	conf(conf)
+	conf(conf),
+	next_profile(0)
 {
 	if (conf.bind.empty() && conf.connect.empty())
 		throw SuoError("Either bind or connect adddres was provided!");
@@ -43,17 +46,29 @@ ZMQPublisher::ZMQPublisher(const ZMQPublisher::Config& conf):
 		zmq_socket.connect(conf.connect);
 	}
 
+	// Bind the profile socket
+	if (conf.profile_interval > 0) {
+		if (conf.profile_bind.empty())
+			throw SuoError("No profile_bind address was provided for the profile!");
+		if (conf.profile_bind == conf.bind)
+			throw SuoError("The profile can't be published on the frame socket!");
+		profile_socket = zmq::socket_t(zmq_ctx, zmq::socket_type::pub);
+		cout << "Profile publisher binding: " << conf.profile_bind << endl;
+		profile_socket.bind(conf.profile_bind);
+	}
 }
 
 
 ZMQPublisher::~ZMQPublisher()
 {
 	zmq_socket.close();
+	profile_socket.close();
 }
 
 
 void ZMQPublisher::sinkFrame(const Frame& frame, Timestamp timestamp)
 {
+	SUO_PROFILE(profile_frame, 1);
 	switch (conf.msg_format) {
 	case ZMQMessageFormat::StructuredBinary:
 		suo_zmq_send_frame(zmq_socket, frame, zmq::send_flags::dontwait);
@@ -80,6 +95,19 @@ void ZMQPublisher::tick(Timestamp now)
 
 	sinkFrame();
 #endif
+
+#ifdef SUO_PROFILING
+	if (conf.profile_interval > 0 && now >= next_profile) {
+		next_profile = now + (Timestamp)conf.profile_interval * 1000000;
+		try {
+			string json_string = getProfileJSON();
+			profile_socket.send(zmq::buffer(json_string), zmq::send_flags::dontwait);
+		}
+		catch (const zmq::error_t& e) {
+			throw SuoError("ZMQ error in tick: %s", e.what());
+		}
+	}
+#endif
 }
 
 
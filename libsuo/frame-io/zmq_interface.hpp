@@ -61,6 +61,14 @@ public:
 		/* Messaging format used over the socket */
 		enum ZMQMessageFormat msg_format;
 
+		/* Interval of publishing the block profile in tick() [ms].
+		 * Zero disables. Requires a build with SUO_PROFILING. */
+		unsigned int profile_interval;
+
+		/* Address which the profile socket will bind to. The profile is
+		 * published on its own socket so frame consumers never see it. */
+		std::string profile_bind;
+
 	};
 
 	explicit ZMQPublisher(const Config& conf = Config());
@@ -69,12 +77,17 @@ public:
 	/* */
 	void sinkFrame(const Frame& frame, Timestamp timestamp);
 
-	/* Send a timing message */
+	/* Send a timing message and the periodic profile */
 	void tick(Timestamp now);
 
 private:
 	Config conf;
 	zmq::socket_t zmq_socket;
+	zmq::socket_t profile_socket;
+	Timestamp next_profile;
+
+	/* Profiling */
+	SUO_PROFILE_POINT(profile_frame, "ZMQPublisher", "sinkFrame");
 };
 
 
@@ -6,6 +6,11 @@
 
 #include <iomanip>
 #include <ctime>
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <stdexcept>
 
 
 using namespace suo;
@@ -36,12 +41,172 @@ void Frame::clear()
 }
 
 
+
+namespace {
+
+/*
+ * Global table of interned metadata names.
+ * Names are only appended, so references to them stay valid.
+ */
+struct MetadataKeyTable {
+	MetadataKeyTable() {
+		// Must match the order of the keys in suo::meta
+		for (const char* name: { "sync_errors", "sync_timestamp", "sync_utc_timestamp",
+				"completed_timestamp", "completed_utc_timestamp", "golay_errors", "golay_coded",
+				"rs_bytes_corrected", "rs_bits_corrected", "cfo", "rssi", "bg_rssi", "cfo_coarse" })
+			intern(name);
+	}
+
+	uint16_t intern(const std::string& name) {
+		uint16_t id;
+		if (lookup(name, id, false) == false)
+			throw SuoError("Too many different metadata names (%u)", (unsigned)names.size());
+		return id;
+	}
+
+	/* Find or register a name. Returns false if the name can't be registered. */
+	bool lookup(const std::string& name, uint16_t& id, bool external) {
+		{
+			std::shared_lock<std::shared_mutex> lock(mutex);
+			auto it = ids.find(name);
+			if (it != ids.end()) {
+				id = it->second;
+				return true;
+			}
+		}
+
+		std::unique_lock<std::shared_mutex> lock(mutex);
+		auto it = ids.find(name);
+		if (it != ids.end()) {
+			id = it->second;
+			return true;
+		}
+
+		// Names from received frames have their own budget so a peer can't fill the table
+		if (external && external_count >= MetadataKey::max_external_keys)
+			return false;
+		if (names.size() >= max_keys)
+			return false;
+
+		id = names.size();
+		names.push_back(name);
+		ids[name] = id;
+		if (external)
+			external_count++;
+		return true;
+	}
+
+	const std::string& name(uint16_t id) {
+		std::shared_lock<std::shared_mutex> lock(mutex);
+		if (id >= names.size())
+			throw SuoError("Unknown metadata key %u", id);
+		return names[id];
+	}
+
+	static const size_t max_keys = 1024;
+	size_t external_count = 0;
+
+	std::shared_mutex mutex;
+	std::deque<std::string> names;
+	std::unordered_map<std::string, uint16_t> ids;
+};
+
+MetadataKeyTable& key_table() {
+	static MetadataKeyTable table;
+	return table;
+}
+
+};
+
+
+MetadataKey::MetadataKey(const std::string& name) :
+	id(key_table().intern(name))
+{ }
+
+MetadataKey::MetadataKey(const char* name) :
+	id(key_table().intern(name))
+{ }
+
+bool MetadataKey::fromExternal(const std::string& name, MetadataKey& key) {
+	return key_table().lookup(name, key.id, true);
+}
+
+const std::string& MetadataKey::name() const {
+	return key_table().name(id);
+}
+
+
+FrameMetadata::FrameMetadata(const FrameMetadata& other) :
+	count(0)
+{
+	*this = other;
+}
+
+FrameMetadata& FrameMetadata::operator=(const FrameMetadata& other) {
+	if (this == &other)
+		return *this;
+	// Copy only the used fields
+	const size_t n_inline = std::min(other.count, inline_capacity);
+	for (size_t i = 0; i < n_inline; i++)
+		fields[i] = other.fields[i];
+	overflow = other.overflow;
+	count = other.count;
+	return *this;
+}
+
+const MetadataValue* FrameMetadata::find(MetadataKey key) const {
+	for (size_t i = 0; i < count; i++) {
+		const Entry& e = entry(i);
+		if (e.key == key)
+			return &e.value;
+	}
+	return nullptr;
+}
+
+MetadataValue* FrameMetadata::find(MetadataKey key) {
+	return const_cast<MetadataValue*>(static_cast<const FrameMetadata*>(this)->find(key));
+}
+
+const MetadataValue& FrameMetadata::at(MetadataKey key) const {
+	const MetadataValue* value = find(key);
+	if (value == nullptr)
+		throw std::out_of_range("No such metadata field");
+	return *value;
+}
+
+MetadataValue& FrameMetadata::operator[](MetadataKey key) {
+	MetadataValue* value = find(key);
+	if (value != nullptr)
+		return *value;
+
+	if (count < inline_capacity) {
+		fields[count].key = key;
+		count++;
+		return fields[count - 1].value;
+	}
+	overflow.push_back({ key, MetadataValue() });
+	count++;
+	return overflow.back().value;
+}
+
+
+std::ostream& suo::operator<<(std::ostream& stream, const UTCTimestamp& timestamp) {
+	stream << formatISOTimestamp(timestamp);
+	return stream;
+}
+
 std::ostream& suo::operator<<(std::ostream& stream, const Metadata& metadata) {
 	stream << metadata.first << " = ";
 	std::visit([&](auto const& a) { stream << a; }, metadata.second);
 	return stream;
 }
 
+std::ostream& suo::operator<<(std::ostream& stream, const FrameMetadata::Entry& entry) {
+	stream << entry.key.name() << " = ";
+	std::visit([&](auto const& a) { stream << a; }, entry.value);
+	return stream;
+}
+
 std::ostream& suo::operator<<(std::ostream& _stream, const Frame& frame) {
 	_stream << frame(Frame::default_formatting);
 	return _stream;
@@ -80,7 +245,7 @@ std::ostream& suo::operator<<(std::ostream& _stream, const Frame::Printer& print
 		stream << "Metadata: ";
 		if (frame.metadata.size() > 0) {
 			bool first = true;
-			for (auto meta : frame.metadata) {
+			for (const auto& meta : frame.metadata) {
 				if (!first)
 					stream << "; ";
 				stream << meta;
@@ -142,15 +307,20 @@ Frame Frame::deserialize_from_json(const std::string& json_string) {
 			if (metas.is_object() == false)
 				throw SuoError("JSON metadata is not a dict/object.");
 			for (auto json_meta : metas.items()) {
+				/* Fields with new names are dropped once the name budget is used */
+				MetadataKey key;
+				if (MetadataKey::fromExternal(json_meta.key(), key) == false)
+					continue;
+
 				auto value = json_meta.value();
 				if (value.is_string())
-					frame.setMetadata(json_meta.key(), value.get<std::string>());
+					frame.setMetadata(key, value.get<std::string>());
 				else if (value.is_number_integer())
-					frame.setMetadata(json_meta.key(), value.get<int>());
+					frame.setMetadata(key, value.get<int>());
 				else if (value.is_number_unsigned())
-					frame.setMetadata(json_meta.key(), value.get<unsigned int>());
+					frame.setMetadata(key, value.get<unsigned int>());
 				else if (value.is_number_float())
-					frame.setMetadata(json_meta.key(), value.get<float>());
+					frame.setMetadata(key, value.get<float>());
 				else
 					throw SuoError("Unsupport metadata datype in JSON message");
 			}
@@ -187,10 +357,13 @@ string Frame::serialize_to_json() const {
 
 	/* Format metadata to a JSON dictionary */
 	json meta_dict = json::object();
-	for (auto metadata : metadata) {
+	for (const auto& field : metadata) {
 		std::visit([&](auto const& a) {
-			meta_dict[metadata.first] = a;
-		}, metadata.second);
+			if constexpr (std::is_same_v<std::decay_t<decltype(a)>, UTCTimestamp>)
+				meta_dict[field.key.name()] = formatISOTimestamp(a);
+			else
+				meta_dict[field.key.name()] = a;
+		}, field.value);
 	}
 	dict["metadata"] = meta_dict;
 
@@ -3,16 +3,148 @@
 #include <string>
 #include <vector>
 #include <variant>
-#include <map>
+#include <array>
+#include <ostream>
+#include <cstdint>
 
 #include "base_types.hpp"
 
 namespace suo {
 
 
-typedef std::variant<int, unsigned int, float, double, Timestamp, std::string> MetadataValue;
+/*
+ * Wall clock (UTC) time stored as raw nanoseconds since the Unix epoch.
+ * Formatted to an ISO 8601 string only when printed or serialized.
+ */
+struct UTCTimestamp {
+	int64_t ns;
+};
+
+
+/*
+ * Interned metadata field name.
+ * Stored and compared as a small integer. The string name is needed only
+ * when the metadata is printed or serialized. Constructing a key from
+ * a string looks up (or registers) the name in a global table, so the
+ * hot paths should use the predefined keys in suo::meta.
+ */
+class MetadataKey
+{
+public:
+	constexpr explicit MetadataKey(int id = 0) : id(id) { }
+	MetadataKey(const std::string& name);
+	MetadataKey(const char* name);
+
+	/*
+	 * Key for a name received from outside (e.g. a JSON frame).
+	 * At most max_external_keys new names are registered this way. After that
+	 * unknown names return false instead of growing the table.
+	 */
+	static bool fromExternal(const std::string& name, MetadataKey& key);
+	static const size_t max_external_keys = 256;
+
+	/* Name of the field */
+	const std::string& name() const;
+
+	constexpr bool operator==(const MetadataKey& other) const { return id == other.id; }
+	constexpr bool operator!=(const MetadataKey& other) const { return id != other.id; }
+
+	uint16_t id;
+};
+
+
+/*
+ * Predefined metadata keys. The names are registered in frame.cpp in the same order.
+ */
+namespace meta {
+constexpr MetadataKey sync_errors(0);
+constexpr MetadataKey sync_timestamp(1);
+constexpr MetadataKey sync_utc_timestamp(2);
+constexpr MetadataKey completed_timestamp(3);
+constexpr MetadataKey completed_utc_timestamp(4);
+constexpr MetadataKey golay_errors(5);
+constexpr MetadataKey golay_coded(6);
+constexpr MetadataKey rs_bytes_corrected(7);
+constexpr MetadataKey rs_bits_corrected(8);
+constexpr MetadataKey cfo(9);
+constexpr MetadataKey rssi(10);
+constexpr MetadataKey bg_rssi(11);
+constexpr MetadataKey cfo_coarse(12);
+}; // namespace meta
+
+
+typedef std::variant<int, unsigned int, float, double, Timestamp, UTCTimestamp, std::string> MetadataValue;
 typedef std::pair<std::string, MetadataValue> Metadata;
 
+
+/*
+ * Small key-value store for frame metadata.
+ * The first inline_capacity fields are stored inside the object itself
+ * so filling the metadata of a received frame doesn't allocate.
+ * Fields are kept in insertion order.
+ */
+class FrameMetadata
+{
+public:
+	static constexpr size_t inline_capacity = 12;
+
+	struct Entry {
+		MetadataKey key;
+		MetadataValue value;
+	};
+
+	class const_iterator {
+	public:
+		const_iterator(const FrameMetadata* store, size_t i) : store(store), i(i) { }
+		const Entry& operator*() const { return store->entry(i); }
+		const Entry* operator->() const { return &store->entry(i); }
+		const_iterator& operator++() { i++; return *this; }
+		bool operator==(const const_iterator& other) const { return i == other.i; }
+		bool operator!=(const const_iterator& other) const { return i != other.i; }
+	private:
+		const FrameMetadata* store;
+		size_t i;
+	};
+
+	FrameMetadata() : count(0) { }
+	FrameMetadata(const FrameMetadata& other);
+	FrameMetadata& operator=(const FrameMetadata& other);
+
+	/* Set the value of a field. Overwrites the old value if the field exists. */
+	void set(MetadataKey key, const MetadataValue& value) { (*this)[key] = value; }
+
+	/* Get pointer to the value of the field or nullptr if the field doesn't exist */
+	const MetadataValue* find(MetadataKey key) const;
+	MetadataValue* find(MetadataKey key);
+
+	bool contains(MetadataKey key) const { return find(key) != nullptr; }
+
+	/* Get the value of the field. Throws std::out_of_range if the field doesn't exist. */
+	const MetadataValue& at(MetadataKey key) const;
+
+	/* Get the value of the field. Creates the field if it doesn't exist. */
+	MetadataValue& operator[](MetadataKey key);
+
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+	void clear() { count = 0; overflow.clear(); }
+
+	const_iterator begin() const { return const_iterator(this, 0); }
+	const_iterator end() const { return const_iterator(this, count); }
+
+private:
+	const Entry& entry(size_t i) const {
+		return (i < inline_capacity) ? fields[i] : overflow[i - inline_capacity];
+	}
+	Entry& entry(size_t i) {
+		return (i < inline_capacity) ? fields[i] : overflow[i - inline_capacity];
+	}
+
+	size_t count;
+	std::array<Entry, inline_capacity> fields;
+	std::vector<Entry> overflow;
+};
+
 /*
  * Frame together with metadata
  */
@@ -51,8 +183,8 @@ public:
 	void clear();
 
 	template<typename T>
-	void setMetadata(std::string field_name, T val) {
-		metadata[field_name] = val;
+	void setMetadata(MetadataKey key, T val) {
+		metadata[key] = val;
 	}
 
 	Byte operator[](size_t _n) { return data[_n]; }
@@ -69,8 +201,8 @@ public:
 	Timestamp timestamp;
 
 
-	/* Metadata vector  */
-	std::map<std::string, MetadataValue> metadata;
+	/* Metadata fields */
+	FrameMetadata metadata;
 
 	/* Actual data (can be bytes, bits or softbits)*/
 	ByteVector data;
@@ -112,7 +244,9 @@ constexpr Frame::Flags operator~(Frame::Flags a) noexcept {
 }
 
 
+std::ostream& operator<<(std::ostream& stream, const UTCTimestamp& timestamp);
 std::ostream& operator<<(std::ostream& stream, const Metadata& metadata);
+std::ostream& operator<<(std::ostream& stream, const FrameMetadata::Entry& entry);
 
 std::ostream& operator<<(std::ostream& stream, const Frame& frame);
 std::ostream& operator<<(std::ostream& stream, const Frame::Printer& printer);
@@ -24,8 +24,8 @@ GolayDeframer::Config::Config() {
 
 GolayDeframer::GolayDeframer(const Config& conf) :
 	conf(conf),
-	rs(RSCodes::CCSDS_RS_255_223)
-//	viterbi(ConvolutionCodes::CCSDS_1_2_7)
+	rs(RSCodes::CCSDS_RS_255_223),
+	viterbi(ConvolutionCodes::CCSDS_1_2_7)
 {
 	if (conf.syncword_len > 8 * sizeof(conf.syncword))
 		throw SuoError("Unrealistic syncword length");
@@ -40,54 +40,68 @@ void GolayDeframer::reset()
 	state = Syncing;
 	latest_bits = 0;
 	frame.clear();
+	frame_ready = false;
 	frame_len = 0;
 	coded_len = 0;
 }
 
-void GolayDeframer::findSyncword(Symbol bit, Timestamp now)
+size_t GolayDeframer::findSyncword(const Symbol* bits, size_t len, Timestamp now, Timestamp symbol_period)
 {
 	/*
 	 * Looking for syncword
 	 */
+	for (size_t i = 0; i < len; i++) {
 
-	latest_bits = (latest_bits << 1) | bit;	
+		latest_bits = (latest_bits << 1) | bits[i];
 
 #if 0
-	// Check for inverse of the syncword
-	if ((latest_bits & syncword_mask) == (conf.syncword ^ syncword_mask))
-		cout << "Inversed syncword detected!" << endl;
+		// Check for inverse of the syncword
+		if ((latest_bits & syncword_mask) == (conf.syncword ^ syncword_mask))
+			cout << "Inversed syncword detected!" << endl;
 #endif
 
-	unsigned int sync_errors = __builtin_popcountll((latest_bits & syncword_mask) ^ conf.syncword);
-	if (sync_errors > conf.sync_threshold)
-		return;
+		if (syncErrors() > conf.sync_threshold)
+			continue;
 
-	//cout << "SYNC DETECTED! " << sync_errors << endl;
+		startFrame(now + i * symbol_period);
+		return i + 1;
+	}
 
-	/* Syncword found, start saving bits when next bit arrives */
-	bit_idx = 0;
-	latest_bits = 0;
+	return len;
+}
+
+void GolayDeframer::startFrame(Timestamp sync_time)
+{
+	//cout << "SYNC DETECTED! " << syncErrors() << endl;
 
 	// Clear the frame and log metadata
 	frame.clear();
 	frame.id = rx_id_counter++;
-	frame.timestamp = now;
-	frame.setMetadata("sync_errors", sync_errors);
-	frame.setMetadata("sync_timestamp", now);
-	frame.setMetadata("sync_utc_timestamp", getCurrentISOTimestamp());
+	frame.timestamp = sync_time;
+	frame.setMetadata(meta::sync_errors, syncErrors());
+	frame.setMetadata(meta::sync_timestamp, sync_time);
+	frame.setMetadata(meta::sync_utc_timestamp, getCurrentUTCTimestamp());
 
-	syncDetected.emit(true, now);
+	/* Syncword found, start saving bits when next bit arrives */
+	bit_idx = 0;
+	latest_bits = 0;
+
+	syncDetected.emit(true, sync_time);
 	state = ReceivingHeader;
 }
 
 /*
  * Receiveiving PHY header (length bytes)
  */
-void GolayDeframer::receiveHeader(Symbol bit, Timestamp now)
+size_t GolayDeframer::receiveHeader(const Symbol* bits, size_t len, Timestamp now, Timestamp symbol_period)
 {
-	latest_bits = (latest_bits << 1) | bit;
-	if (++bit_idx < 24)
-		return;
+	size_t i = 0;
+	while (i < len && bit_idx < 24) {
+		latest_bits = (latest_bits << 1) | bits[i++];
+		bit_idx++;
+	}
+	if (bit_idx < 24)
+		return i;
 
 #if 0
 	if (conf.legacy_mode == false) {
@@ -106,7 +120,7 @@ void GolayDeframer::receiveHeader(Symbol bit, Timestamp now)
 		cerr << "Golay decode failed! " << endl;
 		// TODO: Increase some counter
 		reset();
-		return;
+		return i;
 	}
 
 	// Decode frame length
@@ -123,53 +137,76 @@ void GolayDeframer::receiveHeader(Symbol bit, Timestamp now)
 	if (conf.use_rs && (frame_len < (32 + 1) || frame_len > 255)) {
 		cerr << "Invalid frame length!" << endl;
 		reset();
-		return;
+		return i;
 	}
 
-	frame.setMetadata("golay_errors", golay_errors);
-	//frame.setMetadata("golay_coded", coded_len);
+	frame.setMetadata(meta::golay_errors, golay_errors);
+	//frame.setMetadata(meta::golay_coded, coded_len);
 
 	// Receive double number of bits if viterbi is used
 	if (conf.legacy_mode ? ((coded_len & GolayFramer::use_viterbi_flag) != 0) : conf.use_viterbi)  {
 		frame_len *= 2;
-		cerr << "Viterbi not yet implemented" << endl;
-		reset();
-		return;
 	}
 
 	// Clear for next state
 	latest_bits = 0;
 	bit_idx = 0;
 	state = ReceivingPayload;
+	return i;
 }
 
 
 /*
  * Receiving payload state
  */
-void GolayDeframer::receivePayload(Symbol bit, Timestamp now)
+size_t GolayDeframer::receivePayload(const Symbol* bits, size_t len, Timestamp now, Timestamp symbol_period)
 {
-	latest_bits = (latest_bits << 1) | bit;
-	if (++bit_idx < 8)
-		return;
+	for (size_t i = 0; i < len; i++) {
 
-	frame.data.push_back(latest_bits);
-	latest_bits = 0;
-	bit_idx = 0;
+		latest_bits = (latest_bits << 1) | bits[i];
+		if (++bit_idx < 8)
+			continue;
 
-	// Receiving the frame completed?
-	if (frame.data.size() < frame_len)
-		return;
-		
-	frame.setMetadata("completed_timestamp", now);
-	frame.setMetadata("completed_utc_timestamp", getCurrentISOTimestamp());
+		frame.data.push_back(latest_bits);
+		latest_bits = 0;
+		bit_idx = 0;
+
+		// Receiving the frame completed?
+		if (frame.data.size() < frame_len)
+			continue;
+
+		completeFrame(now + i * symbol_period);
+		return i + 1;
+	}
+
+	return len;
+}
+
+
+void GolayDeframer::completeFrame(Timestamp now)
+{
+	frame.setMetadata(meta::completed_timestamp, now);
+	frame.setMetadata(meta::completed_utc_timestamp, getCurrentUTCTimestamp());
 
 	if (conf.legacy_mode ? ((coded_len & GolayFramer::use_viterbi_flag) != 0) : conf.use_viterbi)
 	{
 		/* Decode viterbi */
-		cerr << "Viterbi not yet implemented" << endl;
-		reset();
-		return;
+		coded_bits.resize(8 * frame.data.size());
+		for (size_t i = 0; i < coded_bits.size(); i++)
+			coded_bits[i] = (frame.data[i / 8] >> (7 - i % 8)) & 1;
+
+		decoded_bits.clear();
+		viterbi.reset();
+		viterbi.decodeHard(coded_bits.data(), coded_bits.size(), decoded_bits);
+		viterbi.flush(decoded_bits);
+
+		frame.data.resize(decoded_bits.size() / 8);
+		for (size_t i = 0; i < frame.data.size(); i++) {
+			Byte byte = 0;
+			for (size_t b = 0; b < 8; b++)
+				byte = (byte << 1) | decoded_bits[8 * i + b];
+			frame.data[i] = byte;
+		}
 	}
 
 	//if // U482C mode
@@ -184,11 +221,11 @@ void GolayDeframer::receivePayload(Symbol bit, Timestamp now)
 	{
 		/* Decode Reed-Solomon */
 		try {
-			ByteVector original = frame.data;
+			rs_original.assign(frame.data.begin(), frame.data.end());
 			unsigned int bytes_corrected = rs.decode(frame.data);
-			unsigned int bits_corrected = count_bit_errors(frame.data, original);
-			frame.setMetadata("rs_bytes_corrected", bytes_corrected);
-			frame.setMetadata("rs_bits_corrected", bits_corrected);
+			unsigned int bits_corrected = count_bit_errors(frame.data, rs_original);
+			frame.setMetadata(meta::rs_bytes_corrected, bytes_corrected);
+			frame.setMetadata(meta::rs_bits_corrected, bits_corrected);
 		}
 		catch (SuoError& e) {
 			// TODO: Increment some statistics
@@ -198,40 +235,44 @@ void GolayDeframer::receivePayload(Symbol bit, Timestamp now)
 		}
 	}
 
+	/* The frame is passed forward and the deframer reset by deliverFrame() */
 	syncDetected.emit(false, now);
-	sinkFrame.emit(frame, now);
-
-	reset();
+	frame_ready = true;
+	frame_time = now;
 }
 
 
-void GolayDeframer::sinkSymbol(Symbol bit, Timestamp now)
+size_t GolayDeframer::processBits(const Symbol* bits, size_t len, Timestamp now, Timestamp symbol_period)
 {
 	switch (state)
 	{
 	case Syncing:
-		findSyncword(bit, now);
-		break;
+		return findSyncword(bits, len, now, symbol_period);
 	case ReceivingHeader:
-		receiveHeader(bit, now);
-		break;
+		return receiveHeader(bits, len, now, symbol_period);
 	case ReceivingPayload:
-		receivePayload(bit, now);
-		break;
+		return receivePayload(bits, len, now, symbol_period);
 	default:
 		throw SuoError("Invalid GolayDeframer state!");
 	}
 }
 
 
+void GolayDeframer::sinkSymbol(Symbol bit, Timestamp now)
+{
+	SUO_PROFILE(profile_symbol, 1);
+	process(bit, now, [this](const Frame& frame, Timestamp now) { sinkFrame.emit(frame, now); });
+}
+
+
 void GolayDeframer::sinkSymbols(const SymbolVector& symbols, Timestamp now)
 {
-	for (const Symbol& symbol: symbols)
-		sinkSymbol(symbol, now);
+	SUO_PROFILE(profile_symbols, symbols.size());
+	process(symbols, now, [this](const Frame& frame, Timestamp now) { sinkFrame.emit(frame, now); });
 }
 
-void GolayDeframer::setMetadata(const std::string& name, const MetadataValue& value) {
-	frame.setMetadata(name, value);
+void GolayDeframer::setMetadata(MetadataKey key, const MetadataValue& value) {
+	frame.setMetadata(key, value);
 }
 
 Block* createGolayDeframer(const Kwargs &args)
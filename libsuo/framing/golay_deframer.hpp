@@ -4,7 +4,7 @@
 
 #include "suo.hpp"
 #include "coding/reed_solomon.hpp"
-//#include "coding/viterbi_decoder.hpp"
+#include "coding/viterbi_decoder.hpp"
 
 namespace suo
 {
@@ -59,21 +59,79 @@ public:
 	void sinkSymbol(Symbol bit, Timestamp time);
 	void sinkSymbols(const SymbolVector& symbols, Timestamp timestamp);
 
-	void setMetadata(const std::string& name, const MetadataValue& value);
+	/*
+	 * Static Pipeline stage: Same as sinkSymbol/sinkSymbols but the decoded
+	 * frames are passed to next() instead of the sinkFrame port.
+	 * The syncword search is inlined into the caller's symbol loop.
+	 */
+	template <typename Next>
+	void process(Symbol bit, Timestamp now, Next&& next) {
+		if (state == Syncing) {
+			if (shiftSyncword(bit))
+				startFrame(now);
+			return;
+		}
+		processBits(&bit, 1, now, 0);
+		deliverFrame(next);
+	}
+
+	template <typename Next>
+	void process(const SymbolVector& symbols, Timestamp now, Next&& next) {
+		if (symbols.flags & has_timestamp)
+			now = symbols.timestamp;
+
+		// Process the whole batch, switching state handler only on state transitions
+		size_t i = 0;
+		while (i < symbols.size()) {
+			i += processBits(&symbols[i], symbols.size() - i, now + i * symbols.symbol_period, symbols.symbol_period);
+			deliverFrame(next);
+		}
+	}
+
+	void setMetadata(MetadataKey key, const MetadataValue& value);
 
 	Port<const Frame&, Timestamp> sinkFrame;
 	Port<bool, Timestamp> syncDetected;
 
 private:
 
-	void findSyncword(Symbol bit, Timestamp now);
-	void receiveHeader(Symbol bit, Timestamp now);
-	void receivePayload(Symbol bit, Timestamp now);
+	/*
+	 * State handlers process as many bits as possible from the given
+	 * buffer and return the number of consumed bits. They return early
+	 * when the deframer state changes. Timestamp of bits[i] is
+	 * now + i * symbol_period.
+	 */
+	size_t findSyncword(const Symbol* bits, size_t len, Timestamp now, Timestamp symbol_period);
+	size_t receiveHeader(const Symbol* bits, size_t len, Timestamp now, Timestamp symbol_period);
+	size_t receivePayload(const Symbol* bits, size_t len, Timestamp now, Timestamp symbol_period);
+	size_t processBits(const Symbol* bits, size_t len, Timestamp now, Timestamp symbol_period);
+	void startFrame(Timestamp sync_time);
+	void completeFrame(Timestamp now);
+
+	/* Shift in a bit and return true if the syncword was found */
+	bool shiftSyncword(Symbol bit) {
+		latest_bits = (latest_bits << 1) | bit;
+		return syncErrors() <= conf.sync_threshold;
+	}
+
+	unsigned int syncErrors() const {
+		return __builtin_popcountll((latest_bits & syncword_mask) ^ conf.syncword);
+	}
+
+	/* Pass the completed frame forward and start searching the next one */
+	template <typename Next>
+	void deliverFrame(Next&& next) {
+		if (frame_ready == false)
+			return;
+		frame_ready = false;
+		next(frame, frame_time);
+		reset();
+	}
 	
 	/* Configuration */
 	Config conf;
 	ReedSolomon rs;
-	//ViterbiDecoder viterbi;
+	ViterbiDecoder viterbi;
 	uint64_t syncword_mask;
 
 	/* State */
@@ -83,8 +141,16 @@ private:
 
 	// Frame
 	Frame frame;
+	bool frame_ready;         // Frame completed but not yet passed forward
+	Timestamp frame_time;
 	unsigned int frame_len;
 	unsigned int coded_len;
+	ByteVector rs_original;   // Uncorrected bytes for counting the corrected bits
+	SymbolVector coded_bits, decoded_bits;
+
+	/* Profiling */
+	SUO_PROFILE_POINT(profile_symbol, "GolayDeframer", "sinkSymbol");
+	SUO_PROFILE_POINT(profile_symbols, "GolayDeframer", "sinkSymbols");
 };
 
 }; // namespace suo
@@ -61,12 +61,16 @@ SymbolGenerator GolayFramer::symbolGenerator(Frame& frame)
 	for (size_t i = 0; i < conf.preamble_len; i++)
 		co_yield (i & 1);
 
+	/* Bit buffer recycled from the shared pool */
+	Pooled<SymbolVector> bits = symbol_pool.acquire(64);
+
 	/* Append syncword */
-	co_yield word_to_lsb_bits(conf.syncword, conf.syncword_len);
+	word_to_lsb_bits(*bits, conf.syncword, conf.syncword_len);
+	co_yield *bits;
 
 
 	/* Calculate Reed Solomon */
-	ByteVector data_buffer = frame.data;
+	data_buffer.assign(frame.data.begin(), frame.data.end());
 	if (conf.use_rs)
 		rs.encode(data_buffer);
 
@@ -85,19 +89,28 @@ SymbolGenerator GolayFramer::symbolGenerator(Frame& frame)
 	}
 
 	encode_golay24(&coded_len);
-	co_yield word_to_lsb_bits(coded_len, 24);
+	word_to_lsb_bits(*bits, coded_len, 24);
+	co_yield *bits;
 
 
-	/* Viterbi decode all bits */
+	/* Output data bits. Convolutional encoder writes the coded bits directly to the output. */
+	SymbolGenerator data_bits = dataBitGenerator();
 	if (conf.use_viterbi) {
-		SymbolVector viterbi_buffer;
-		viterbi_buffer.reserve(2 * frame.size());
-		//conv_encoder.sourceSymbols(viterbi_buffer);
-		co_yield viterbi_buffer;
+		conv_encoder.reset();
+		co_yield conv_encoder.generateSymbols(data_bits);
 	}
 	else {
-		for (Byte byte: data_buffer)
-			co_yield word_to_lsb_bits(byte);
+		co_yield data_bits;
+	}
+}
+
+
+SymbolGenerator GolayFramer::dataBitGenerator()
+{
+	Pooled<SymbolVector> bits = symbol_pool.acquire(8);
+	for (Byte byte: data_buffer) {
+		word_to_lsb_bits(*bits, byte, 8);
+		co_yield *bits;
 	}
 }
 
@@ -66,6 +66,7 @@ public:
 private:
 	
 	SymbolGenerator symbolGenerator(Frame& frame);
+	SymbolGenerator dataBitGenerator();
 
 	/* Configuration */
 	Config conf;
@@ -75,6 +76,7 @@ private:
 	/* Framer state */
 	SymbolGenerator symbol_gen;
 	Frame frame;
+	ByteVector data_buffer;   // Coded frame bytes
 
 };
 
@@ -57,6 +57,7 @@ void HDLCDeframer::reset()
 	shift = 0;
 	bit_idx = 0;
 	frame.clear();
+	frame_ready = false;
 
 	last_bit = 0;
 	scrambler = 0;
@@ -65,38 +66,7 @@ void HDLCDeframer::reset()
 }
 
 
-Symbol HDLCDeframer::descramble_bit(Symbol bit)
-{
-	if (conf.mode == G3RUH) {
-		/* G3RUH descrambler */
-		unsigned int lfsr_hi = (scrambler & 1);
-		unsigned int lfsr_lo = ((scrambler >> 5) & 1);
-		unsigned int descrambled_bit = (bit ^ (lfsr_hi ^ lfsr_lo)) != 0;
-
-		scrambler = (scrambler >> 1);
-
-		if (bit != 0)
-			scrambler |= 0x00010000;
-
-		bit = descrambled_bit;
-
-		/* NRZI decode */
-		Symbol new_bit = (bit != last_bit) ? 0 : 1;
-		last_bit = bit;
-		return new_bit;
-	}
-	else if (conf.mode == NRZI) {
-		/* NRZI decode */
-		Symbol new_bit = (bit != last_bit) ? 0 : 1;
-		last_bit = bit;
-		return new_bit;
-	}
-	else
-		return bit;
-}
-
-
-void HDLCDeframer::findStartFlag(Symbol bit, Timestamp now)
+size_t HDLCDeframer::findStartFlag(const Symbol* bits, size_t len, Timestamp now, Timestamp symbol_period)
 {
 #if 0
 	// TODO: Alternative method for flag detection
@@ -105,142 +75,168 @@ void HDLCDeframer::findStartFlag(Symbol bit, Timestamp now)
 	if (bit_errors < 6);
 #endif
 
-	// More than 5 continious 1's have been received.
-	if (stuffing_counter == 6 && bit == 0) { 
-		// Start/end flag!
-		syncDetected.emit(true, now);
+	for (size_t i = 0; i < len; i++) {
+		if (shiftFlag(bits[i])) {
+			startFrame(now + i * symbol_period);
+			return i + 1;
+		}
+	}
 
-		state = ReceivingFrame;
-		frame.clear();
-		shift = 0;
-		stuffing_counter = 0;
-		bit_idx = 0;
+	return len;
+}
 
-		// Start new frame
-		frame.setMetadata("sync_timestamp", now);
-		frame.setMetadata("sync_utc_timestamp", getCurrentISOTimestamp());
 
-	}
-	stuffing_counter = bit ? (stuffing_counter + 1) : 0;
+
+void HDLCDeframer::startFrame(Timestamp sync_time)
+{
+	// Start/end flag!
+	syncDetected.emit(true, sync_time);
+
+	state = ReceivingFrame;
+	frame.clear();
+	shift = 0;
+	stuffing_counter = 0;
+	bit_idx = 0;
+
+	// Start new frame
+	frame.setMetadata(meta::sync_timestamp, sync_time);
+	frame.setMetadata(meta::sync_utc_timestamp, getCurrentUTCTimestamp());
 }
 
 
+size_t HDLCDeframer::receivingFrame(const Symbol* bits, size_t len, Timestamp now, Timestamp symbol_period) {
 
-void HDLCDeframer::receivingFrame(Symbol bit, Timestamp now) {
+	for (size_t i = 0; i < len; i++) {
+		Symbol bit = descramble_bit(bits[i]);
 
-	if (stuffing_counter >= 5) {
-		// More than 5 continious 1's have been received.
+		if (stuffing_counter >= 5) {
+			// More than 5 continious 1's have been received.
 
-		if (bit == 1) {
-			// 6th 1 breaks the stuffing rule. End flag detected! 
+			if (bit == 1) {
+				// 6th 1 breaks the stuffing rule. End flag detected! 
 
-			if (frame.data.size() < conf.minimum_frame_length) {
-				// Repeated start flag
-				bit_idx = 0;
-				shift = 0;
-				frame.data.clear();
-				return;
-			}
+				if (frame.data.size() < conf.minimum_frame_length) {
+					// Repeated start flag
+					bit_idx = 0;
+					shift = 0;
+					frame.data.clear();
+					continue;
+				}
 
-			syncDetected.emit(false, now);
-			frame.setMetadata("completed_timestamp", now);
-			frame.setMetadata("completed_utc_timestamp", getCurrentISOTimestamp());
+				const Timestamp completed_time = now + i * symbol_period;
+				syncDetected.emit(false, completed_time);
+				frame.setMetadata(meta::completed_timestamp, completed_time);
+				frame.setMetadata(meta::completed_utc_timestamp, getCurrentUTCTimestamp());
 
-			if (conf.check_crc) {
-				const size_t len = frame.data.size() - 2;
-				const uint16_t received_crc = (frame.data[len] << 8) | frame.data[len + 1];
-				const uint16_t calculated_crc = crc16_ccitt(&frame.data[0], len);
+				if (conf.check_crc) {
+					const size_t data_len = frame.data.size() - 2;
+					const uint16_t received_crc = (frame.data[data_len] << 8) | frame.data[data_len + 1];
+					const uint16_t calculated_crc = crc16_ccitt(&frame.data[0], data_len);
 
-				if (received_crc == calculated_crc) {
-					frame.data.resize(len); // Remove CRC
-					sinkFrame.emit(frame, now);
+					if (received_crc == calculated_crc) {
+						frame.data.resize(data_len); // Remove CRC
+						frame_ready = true;
+					}
+
+				}
+				else {
+					frame_ready = true;
 				}
 
+				// Passed forward by deliverFrame()
+				frame_time = completed_time;
+
+				silence_counter = 0;
+				state = Trailer;
+				return i + 1;
 			}
 			else {
-				sinkFrame.emit(frame, now);
+				// More than 6 ones!
+				// Unstuff the stuffing bit
+				stuffing_counter = 0;
 			}
 
-			silence_counter = 0;
-			state = Trailer;
-			return;	
 		}
 		else {
-			// More than 6 ones!
-			// Unstuff the stuffing bit
-			stuffing_counter = 0;
-		}
-
-	}
-	else {
 
-		stuffing_counter = bit ? (stuffing_counter + 1) : 0;
+			stuffing_counter = bit ? (stuffing_counter + 1) : 0;
 
-		shift = (0xFF & (shift << 1)) | bit;
-		bit_idx++;
+			shift = (0xFF & (shift << 1)) | bit;
+			bit_idx++;
 
-		if (bit_idx >= 8) {
-			frame.data.push_back(shift);
-			bit_idx = 0;
-			shift = 0;
+			if (bit_idx >= 8) {
+				frame.data.push_back(shift);
+				bit_idx = 0;
+				shift = 0;
 
-			// Too long frame
-			if (frame.data.size() > conf.maximum_frame_length) {
-				syncDetected.emit(false, now);
-				reset();
+				// Too long frame
+				if (frame.data.size() > conf.maximum_frame_length) {
+					syncDetected.emit(false, now + i * symbol_period);
+					reset();
+					return i + 1;
+				}
 			}
-		}
 
+		}
 	}
+
+	return len;
 }
 
 
-void HDLCDeframer::receivingTrailer(Symbol bit, Timestamp now) {
+size_t HDLCDeframer::receivingTrailer(const Symbol* bits, size_t len, Timestamp now, Timestamp symbol_period) {
 
-	if (stuffing_counter >= 5) {
-		stuffing_counter = 0;
-		silence_counter = 0;
-		return;
-	}
-	else {
-		stuffing_counter = 0;
-	}
+	for (size_t i = 0; i < len; i++) {
+		Symbol bit = descramble_bit(bits[i]);
 
-	stuffing_counter = bit ? (stuffing_counter + 1) : 0;
-	silence_counter++;
+		if (stuffing_counter >= 5) {
+			stuffing_counter = 0;
+			silence_counter = 0;
+			continue;
+		}
+		else {
+			stuffing_counter = 0;
+		}
+
+		stuffing_counter = bit ? (stuffing_counter + 1) : 0;
+		silence_counter++;
 
-	if (silence_counter >= conf.minimum_silence) {
-		state = WaitingSync;
+		if (silence_counter >= conf.minimum_silence) {
+			state = WaitingSync;
+			return i + 1;
+		}
 	}
 
+	return len;
 }
 
 
-void HDLCDeframer::sinkSymbol(Symbol bit, Timestamp now)
+size_t HDLCDeframer::processBits(const Symbol* bits, size_t len, Timestamp now, Timestamp symbol_period)
 {
-	bit = descramble_bit(bit);
-
 	switch (state)
 	{
 	case WaitingSync:
-		findStartFlag(bit, now);
-		break;
+		return findStartFlag(bits, len, now, symbol_period);
 	case ReceivingFrame:
-		receivingFrame(bit, now);
-		break;
+		return receivingFrame(bits, len, now, symbol_period);
 	case Trailer:
-		receivingTrailer(bit, now);
-		break;
+		return receivingTrailer(bits, len, now, symbol_period);
 	default:
 		throw SuoError("Invalid HDLCDeframer state!");
 	}
+}
 
+
+void HDLCDeframer::sinkSymbol(Symbol bit, Timestamp now)
+{
+	SUO_PROFILE(profile_symbol, 1);
+	process(bit, now, [this](const Frame& frame, Timestamp now) { sinkFrame.emit(frame, now); });
 }
 
 void HDLCDeframer::sinkSymbols(const SymbolVector& symbols, Timestamp now)
 {
-	for (const Symbol& symbol : symbols)
-		sinkSymbol(symbol, now);
+	SUO_PROFILE(profile_symbols, symbols.size());
+	process(symbols, now, [this](const Frame& frame, Timestamp now) { sinkFrame.emit(frame, now); });
 }
 
 Block* createHDLCDeframer(const Kwargs& args)
@@ -60,14 +60,97 @@ public:
 	void sinkSymbol(Symbol bit, Timestamp now);
 	void sinkSymbols(const SymbolVector& symbols, Timestamp now);
 
+	/*
+	 * Static Pipeline stage: Same as sinkSymbol/sinkSymbols but the received
+	 * frames are passed to next() instead of the sinkFrame port.
+	 * The start flag search is inlined into the caller's symbol loop.
+	 */
+	template <typename Next>
+	void process(Symbol bit, Timestamp now, Next&& next) {
+		if (state == WaitingSync) {
+			if (shiftFlag(bit))
+				startFrame(now);
+			return;
+		}
+		processBits(&bit, 1, now, 0);
+		deliverFrame(next);
+	}
+
+	template <typename Next>
+	void process(const SymbolVector& symbols, Timestamp now, Next&& next) {
+		if (symbols.flags & has_timestamp)
+			now = symbols.timestamp;
+
+		size_t i = 0;
+		while (i < symbols.size()) {
+			i += processBits(&symbols[i], symbols.size() - i, now + i * symbols.symbol_period, symbols.symbol_period);
+			deliverFrame(next);
+		}
+	}
+
 	Port<const Frame&, Timestamp> sinkFrame;
 	Port<bool, Timestamp> syncDetected;
 
 private:
-	Symbol descramble_bit(Symbol bit);
-	void findStartFlag(Symbol bit, Timestamp now);
-	void receivingFrame(Symbol bit, Timestamp now);
-	void receivingTrailer(Symbol bit, Timestamp now);
+	Symbol descramble_bit(Symbol bit) {
+		if (conf.mode == G3RUH) {
+			/* G3RUH descrambler */
+			unsigned int lfsr_hi = (scrambler & 1);
+			unsigned int lfsr_lo = ((scrambler >> 5) & 1);
+			unsigned int descrambled_bit = (bit ^ (lfsr_hi ^ lfsr_lo)) != 0;
+
+			scrambler = (scrambler >> 1);
+
+			if (bit != 0)
+				scrambler |= 0x00010000;
+
+			bit = descrambled_bit;
+
+			/* NRZI decode */
+			Symbol new_bit = (bit != last_bit) ? 0 : 1;
+			last_bit = bit;
+			return new_bit;
+		}
+		else if (conf.mode == NRZI) {
+			/* NRZI decode */
+			Symbol new_bit = (bit != last_bit) ? 0 : 1;
+			last_bit = bit;
+			return new_bit;
+		}
+		else
+			return bit;
+	}
+
+	/* Shift in a raw bit and return true if a start flag was found */
+	bool shiftFlag(Symbol raw_bit) {
+		Symbol bit = descramble_bit(raw_bit);
+
+		// More than 5 continious 1's have been received.
+		if (stuffing_counter == 6 && bit == 0)
+			return true;
+		stuffing_counter = bit ? (stuffing_counter + 1) : 0;
+		return false;
+	}
+
+	/* Pass the received frame forward */
+	template <typename Next>
+	void deliverFrame(Next&& next) {
+		if (frame_ready == false)
+			return;
+		frame_ready = false;
+		next(frame, frame_time);
+	}
+
+	/*
+	 * State handlers descramble and consume raw bits from the buffer until
+	 * the state changes and return the number of consumed bits.
+	 * Timestamp of bits[i] is now + i * symbol_period.
+	 */
+	size_t findStartFlag(const Symbol* bits, size_t len, Timestamp now, Timestamp symbol_period);
+	size_t receivingFrame(const Symbol* bits, size_t len, Timestamp now, Timestamp symbol_period);
+	size_t receivingTrailer(const Symbol* bits, size_t len, Timestamp now, Timestamp symbol_period);
+	size_t processBits(const Symbol* bits, size_t len, Timestamp now, Timestamp symbol_period);
+	void startFrame(Timestamp sync_time);
 
 	/* Configuration */
 	Config conf;
@@ -78,12 +161,17 @@ private:
 	unsigned int bit_idx;
 	unsigned int silence_counter;
 	Frame frame;
+	bool frame_ready;         // Frame received but not yet passed forward
+	Timestamp frame_time;
 
 	// Scrambler state
 	Symbol last_bit;
 	uint32_t scrambler;
 	unsigned int stuffing_counter;
 
+	/* Profiling */
+	SUO_PROFILE_POINT(profile_symbol, "HDLCDeframer", "sinkSymbol");
+	SUO_PROFILE_POINT(profile_symbols, "HDLCDeframer", "sinkSymbols");
 };
 
 }; // namespace suo
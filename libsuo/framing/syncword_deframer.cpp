@@ -31,103 +31,130 @@ void SyncwordDeframer::reset()
 	syncDetected.emit(false, 0);
 	state = Syncing;
 	frame.clear();
+	frame_ready = false;
 	latest_bits = 0;
 	bit_idx = 0;
 	frame_len = 0;
 }
 
-void SyncwordDeframer::findSyncword(Symbol bit, Timestamp now) {
-	
-	latest_bits = (latest_bits << 1) | bit;
+size_t SyncwordDeframer::findSyncword(const Symbol* bits, size_t len, Timestamp now, Timestamp symbol_period) {
 
-	unsigned int sync_errors = __builtin_popcountll((latest_bits & syncword_mask) ^ conf.syncword);
-	if (sync_errors > conf.sync_threshold)
-		return;
+	for (size_t i = 0; i < len; i++) {
 
-	// cout << "SYNC DETECTED! " << sync_errors << endl;
+		latest_bits = (latest_bits << 1) | bits[i];
 
-	/* Syncword found, start saving bits when next bit arrives */
-	bit_idx = 0;
-	latest_bits = 0;
+		if (syncErrors() > conf.sync_threshold)
+			continue;
+
+		startFrame(now + i * symbol_period);
+		return i + 1;
+	}
+
+	return len;
+}
+
+void SyncwordDeframer::startFrame(Timestamp sync_time) {
+
+	// cout << "SYNC DETECTED! " << syncErrors() << endl;
 
 	// Clear the frame and log metadata
 	frame.clear();
 	frame.id = rx_id_counter++;
-	frame.timestamp = now;
-	frame.setMetadata("sync_errors", sync_errors);
-	frame.setMetadata("sync_timestamp", now);
-	frame.setMetadata("sync_utc_timestamp", getCurrentISOTimestamp());
+	frame.timestamp = sync_time;
+	frame.setMetadata(meta::sync_errors, syncErrors());
+	frame.setMetadata(meta::sync_timestamp, sync_time);
+	frame.setMetadata(meta::sync_utc_timestamp, getCurrentUTCTimestamp());
+
+	/* Syncword found, start saving bits when next bit arrives */
+	bit_idx = 0;
+	latest_bits = 0;
 
-	syncDetected.emit(true, now);
+	syncDetected.emit(true, sync_time);
 	state = ReceivingHeader;
 }
 
-void SyncwordDeframer::receiveHeader(Symbol bit, Timestamp now) {
-	latest_bits = (latest_bits << 1) | bit;
-	if (++bit_idx < 8)
-		return;
+size_t SyncwordDeframer::receiveHeader(const Symbol* bits, size_t len, Timestamp now, Timestamp symbol_period) {
 
-	// Decode Golay code
+	size_t i = 0;
+	while (i < len && bit_idx < 8) {
+		latest_bits = (latest_bits << 1) | bits[i++];
+		bit_idx++;
+	}
+	if (bit_idx < 8)
+		return i;
+
+	// Decode length byte
 	frame_len = latest_bits;
-	frame.data.resize(frame_len);
+	frame.data.reserve(frame_len);
 
 	// Clear for next state
 	latest_bits = 0;
 	bit_idx = 0;
 	state = ReceivingPayload;
+	return i;
 }
 
-void SyncwordDeframer::receivePayload(Symbol bit, Timestamp now) {
-	latest_bits = (latest_bits << 1) | bit;
-	if (++bit_idx < 8)
-		return;
+size_t SyncwordDeframer::receivePayload(const Symbol* bits, size_t len, Timestamp now, Timestamp symbol_period) {
 
-	//cerr << std::hex << latest_bits << endl;
+	for (size_t i = 0; i < len; i++) {
 
-	frame.data.push_back(latest_bits);
-	latest_bits = 0;
-	bit_idx = 0;
+		latest_bits = (latest_bits << 1) | bits[i];
+		if (++bit_idx < 8)
+			continue;
 
-	if (frame.data.size() < frame_len)
-		return;
+		//cerr << std::hex << latest_bits << endl;
 
-	// Receiving the frame completed
-	state = Syncing;
-	frame.setMetadata("completed_timestamp", now);
+		frame.data.push_back(latest_bits);
+		latest_bits = 0;
+		bit_idx = 0;
 
-	syncDetected.emit(false, now);
+		if (frame.data.size() < frame_len)
+			continue;
 
-	sinkFrame.emit(frame, now);
+		// Receiving the frame completed
+		const Timestamp completed_time = now + i * symbol_period;
+		state = Syncing;
+		frame.setMetadata(meta::completed_timestamp, completed_time);
 
-	frame.clear();
+		syncDetected.emit(false, completed_time);
+
+		// Passed forward and cleared by deliverFrame()
+		frame_ready = true;
+		frame_time = completed_time;
+		return i + 1;
+	}
+
+	return len;
 }
 
-void SyncwordDeframer::sinkSymbol(Symbol bit, Timestamp now) {
+size_t SyncwordDeframer::processBits(const Symbol* bits, size_t len, Timestamp now, Timestamp symbol_period) {
 	switch (state)
 	{
 	case Syncing:
-		findSyncword(bit, now);
-		break;
+		return findSyncword(bits, len, now, symbol_period);
 	case ReceivingHeader:
-		receiveHeader(bit, now);
-		break;
+		return receiveHeader(bits, len, now, symbol_period);
 	case ReceivingPayload:
-		receivePayload(bit, now);
-		break;
+		return receivePayload(bits, len, now, symbol_period);
 	default:
 		throw SuoError("Invalid SyncwordDeframer state!");
 	}
 }
 
+void SyncwordDeframer::sinkSymbol(Symbol bit, Timestamp now) {
+	SUO_PROFILE(profile_symbol, 1);
+	process(bit, now, [this](Frame& frame, Timestamp now) { sinkFrame.emit(frame, now); });
+}
+
 void SyncwordDeframer::sinkSymbols(const SymbolVector& symbols, Timestamp now)
 {
-	for (const Symbol& symbol : symbols)
-		sinkSymbol(symbol, now + 0);
+	SUO_PROFILE(profile_symbols, symbols.size());
+	process(symbols, now, [this](Frame& frame, Timestamp now) { sinkFrame.emit(frame, now); });
 }
 
-void SyncwordDeframer::setMetadata(const std::string& name, const MetadataValue& value)
+void SyncwordDeframer::setMetadata(MetadataKey key, const MetadataValue& value)
 {
-	frame.setMetadata(name, value);
+	frame.setMetadata(key, value);
 }
 
 
@@ -49,16 +49,71 @@ public:
 	void sinkSymbol(Symbol bit, Timestamp now);
 	void sinkSymbols(const SymbolVector& symbols, Timestamp now);
 
-	void setMetadata(const std::string& name, const MetadataValue& value);
+	/*
+	 * Static Pipeline stage: Same as sinkSymbol/sinkSymbols but the received
+	 * frames are passed to next() instead of the sinkFrame port.
+	 * The syncword search is inlined into the caller's symbol loop.
+	 */
+	template <typename Next>
+	void process(Symbol bit, Timestamp now, Next&& next) {
+		if (state == Syncing) {
+			if (shiftSyncword(bit))
+				startFrame(now);
+			return;
+		}
+		processBits(&bit, 1, now, 0);
+		deliverFrame(next);
+	}
+
+	template <typename Next>
+	void process(const SymbolVector& symbols, Timestamp now, Next&& next) {
+		if (symbols.flags & has_timestamp)
+			now = symbols.timestamp;
+
+		size_t i = 0;
+		while (i < symbols.size()) {
+			i += processBits(&symbols[i], symbols.size() - i, now + i * symbols.symbol_period, symbols.symbol_period);
+			deliverFrame(next);
+		}
+	}
+
+	void setMetadata(MetadataKey key, const MetadataValue& value);
 
 	Port<Frame&, Timestamp> sinkFrame;
 	Port<bool, Timestamp> syncDetected;
 
 private:
 
-	void findSyncword(Symbol bit, Timestamp now);
-	void receiveHeader(Symbol bit, Timestamp now);
-	void receivePayload(Symbol bit, Timestamp now);
+	/*
+	 * State handlers consume bits from the buffer until the state changes
+	 * and return the number of consumed bits.
+	 * Timestamp of bits[i] is now + i * symbol_period.
+	 */
+	size_t findSyncword(const Symbol* bits, size_t len, Timestamp now, Timestamp symbol_period);
+	size_t receiveHeader(const Symbol* bits, size_t len, Timestamp now, Timestamp symbol_period);
+	size_t receivePayload(const Symbol* bits, size_t len, Timestamp now, Timestamp symbol_period);
+	size_t processBits(const Symbol* bits, size_t len, Timestamp now, Timestamp symbol_period);
+	void startFrame(Timestamp sync_time);
+
+	/* Shift in a bit and return true if the syncword was found */
+	bool shiftSyncword(Symbol bit) {
+		latest_bits = (latest_bits << 1) | bit;
+		return syncErrors() <= conf.sync_threshold;
+	}
+
+	unsigned int syncErrors() const {
+		return __builtin_popcountll((latest_bits & syncword_mask) ^ conf.syncword);
+	}
+
+	/* Pass the received frame forward */
+	template <typename Next>
+	void deliverFrame(Next&& next) {
+		if (frame_ready == false)
+			return;
+		frame_ready = false;
+		next(frame, frame_time);
+		frame.clear();
+	}
 
 	/* Configuration */
 	const Config conf;
@@ -70,6 +125,12 @@ private:
 	unsigned int bit_idx;
 	Frame frame;
 	unsigned int frame_len;
+	bool frame_ready;         // Frame received but not yet passed forward
+	Timestamp frame_time;
+
+	/* Profiling */
+	SUO_PROFILE_POINT(profile_symbol, "SyncwordDeframer", "sinkSymbol");
+	SUO_PROFILE_POINT(profile_symbols, "SyncwordDeframer", "sinkSymbols");
 };
 
 } // namespace suo
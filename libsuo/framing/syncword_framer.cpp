@@ -47,18 +47,25 @@ SymbolGenerator SyncwordFramer::symbolGenerator(const Frame& frame)
 	for (size_t i = 0; i < conf.preamble_len; i++)
 		co_yield (i & 1);
 
+	/* Bit buffer recycled from the shared pool */
+	Pooled<SymbolVector> bits = symbol_pool.acquire(64);
+
 	/* Append syncword */
-	co_yield word_to_lsb_bits(conf.syncword, conf.syncword_len);
+	word_to_lsb_bits(*bits, conf.syncword, conf.syncword_len);
+	co_yield *bits;
 
 	/* If variable length */
 	if (0) {
 		unsigned int payload_len = frame.size();
-		co_yield word_to_lsb_bits(payload_len, 8);
+		word_to_lsb_bits(*bits, payload_len, 8);
+		co_yield *bits;
 	}
 
 	/* Feed the data bits */
-	for (Byte byte : frame.data)
-		co_yield word_to_lsb_bits(byte);
+	for (Byte byte : frame.data) {
+		word_to_lsb_bits(*bits, byte, 8);
+		co_yield *bits;
+	}
 
 }
 
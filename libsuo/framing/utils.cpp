@@ -41,6 +41,16 @@ SymbolVector suo::word_to_lsb_bits(uint64_t word, size_t n_bits)
 }
 
 
+void suo::word_to_lsb_bits(SymbolVector& bits, uint64_t word, size_t n_bits)
+{
+	assert(n_bits <= 8 * sizeof(word));
+	bits.resize(n_bits);
+	for (size_t i = n_bits; i > 0; i--) {
+		bits[i - 1] = (word & 1);
+		word >>= 1;
+	}
+}
+
 
 SymbolVector suo::word_to_lsb_bits(uint8_t byte) {
 	SymbolVector bits(8);
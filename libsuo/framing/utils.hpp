@@ -15,6 +15,7 @@ size_t bytes_to_bits(Bit* bits, const uint8_t* bytes, size_t nbytes, BitOrder or
 
 size_t word_to_lsb_bits(Bit* bits, uint64_t word, size_t nbits);
 SymbolVector word_to_lsb_bits(uint64_t word, size_t n_bits);
+void word_to_lsb_bits(SymbolVector& bits, uint64_t word, size_t n_bits); // Reuses the given vector
 SymbolVector word_to_lsb_bits(uint8_t byte);
 SymbolVector word_to_msb_bits(uint8_t byte);
 
@@ -1,4 +1,5 @@
 #include <iostream>
+#include <algorithm>
 
 #include "generators.hpp"
 
@@ -7,27 +8,159 @@ using namespace suo;
 using namespace std;
 
 
+namespace {
+
+/*
+ * Per-thread cache of freed coroutine frames
+ */
+struct CoroutineFrameCache {
+	static const size_t granularity = 64;
+	static const size_t size_classes = 64;    // Frames up to 4 kB are cached
+	static const size_t max_cached = 32;      // Per size class
+
+	struct FreeFrame {
+		FreeFrame* next;
+	};
+
+	CoroutineFrameCache() : allocations(0), reused(0) {
+		for (size_t i = 0; i < size_classes; i++) {
+			free_frames[i] = nullptr;
+			counts[i] = 0;
+		}
+	}
+
+	~CoroutineFrameCache() {
+		destroyed = true;
+		for (size_t i = 0; i < size_classes; i++) {
+			while (free_frames[i] != nullptr) {
+				FreeFrame* frame = free_frames[i];
+				free_frames[i] = frame->next;
+				::operator delete(frame);
+			}
+		}
+	}
+
+	FreeFrame* free_frames[size_classes];
+	size_t counts[size_classes];
+	uint64_t allocations, reused;
+
+	// Frames might be freed during thread exit after the cache is gone
+	static thread_local bool destroyed;
+};
+
+thread_local bool CoroutineFrameCache::destroyed = false;
+thread_local CoroutineFrameCache frame_cache;
+
+};
+
+
+void* suo::detail::allocate_coroutine_frame(size_t size)
+{
+	const size_t size_class = (size - 1) / CoroutineFrameCache::granularity;
+	if (size_class >= CoroutineFrameCache::size_classes)
+		return ::operator new(size);
+
+	if (CoroutineFrameCache::destroyed == false) {
+		CoroutineFrameCache& cache = frame_cache;
+		CoroutineFrameCache::FreeFrame* frame = cache.free_frames[size_class];
+		if (frame != nullptr) {
+			cache.free_frames[size_class] = frame->next;
+			cache.counts[size_class]--;
+			cache.reused++;
+			return frame;
+		}
+		cache.allocations++;
+	}
+
+	// Allocate the whole size class so the frame can be reused for any size in the class
+	return ::operator new((size_class + 1) * CoroutineFrameCache::granularity);
+}
+
+
+void suo::detail::free_coroutine_frame(void* ptr, size_t size)
+{
+	const size_t size_class = (size - 1) / CoroutineFrameCache::granularity;
+	if (size_class < CoroutineFrameCache::size_classes && CoroutineFrameCache::destroyed == false) {
+		CoroutineFrameCache& cache = frame_cache;
+		if (cache.counts[size_class] < CoroutineFrameCache::max_cached) {
+			CoroutineFrameCache::FreeFrame* frame = static_cast<CoroutineFrameCache::FreeFrame*>(ptr);
+			frame->next = cache.free_frames[size_class];
+			cache.free_frames[size_class] = frame;
+			cache.counts[size_class]++;
+			return;
+		}
+	}
+	::operator delete(ptr);
+}
+
+
+detail::CoroutineFrameStatistics suo::detail::getCoroutineFrameStatistics()
+{
+	CoroutineFrameStatistics stats = { 0, 0 };
+	if (CoroutineFrameCache::destroyed == false) {
+		stats.allocations = frame_cache.allocations;
+		stats.reused = frame_cache.reused;
+	}
+	return stats;
+}
+
+
+
+/*
+ * Copy items from the preempted input iterators to the output.
+ * Returns false if the output got full before the input was exhausted.
+ */
+template <typename Vector>
+static bool source_preempted(typename Vector::const_iterator& input_iter, typename Vector::const_iterator& input_end,
+	Vector& out, const Vector& invalid_vector)
+{
+	if (input_iter == input_end)
+		return true;
+
+	while (1) {
+
+		// End of input vector?
+		if (input_iter == input_end)
+			break;
+
+		// Output vector is full?
+		if (out.full())
+			return false;
+
+		out.push_back(*input_iter++);
+	}
+
+	// Make sure the iterators points to 'invalid_vector' because
+	// the original source vector might get invalidated soon.
+	input_iter = input_end = invalid_vector.end();
+	return true;
+}
+
+
 extern const SymbolVector SymbolGenerator::invalid_vector(0);
 
 SymbolGenerator::SymbolPromise::SymbolPromise() : 
-	out(nullptr)
+	out(nullptr),
+	root(this)
 {
 	input_iter = input_end = invalid_vector.end();
 }
 
 SymbolGenerator SymbolGenerator::SymbolPromise::get_return_object() {
-	return SymbolGenerator(handle_type::from_promise(*this));
+	leaf = handle_type::from_promise(*this);
+	return SymbolGenerator(leaf);
 }
 
 void SymbolGenerator::SymbolPromise::unhandled_exception() {
-	// saving exception
-	exception_ = std::current_exception();
+	// Saving exception to the generator which is being sourced
+	root->exception_ = std::current_exception();
 }
 
 
 
 std::suspend_always SymbolGenerator::SymbolPromise::yield_value(const Symbol& s)
 {
+	SymbolVector* out = root->out;
 	assert(out != nullptr);
 	if (out->full())
 		throw SuoError("Cannot append value! Output buffer is full.");
@@ -40,6 +173,7 @@ std::suspend_always SymbolGenerator::SymbolPromise::yield_value(const Symbol& s)
 
 std::suspend_always SymbolGenerator::SymbolPromise::yield_value(const SymbolVector& symbols)
 {
+	SymbolVector* out = root->out;
 	assert(out != nullptr);
 	//cout << "yield many: " << symbols.size() << " items" << endl;
 
@@ -54,8 +188,8 @@ std::suspend_always SymbolGenerator::SymbolPromise::yield_value(const SymbolVect
 		
 		// Output vector is full
 		if (out->full()) {
-			input_iter = iter; // Preempt
-			input_end = end;
+			root->input_iter = iter; // Preempt
+			root->input_end = end;
 			break;
 		}
 
@@ -66,33 +200,54 @@ std::suspend_always SymbolGenerator::SymbolPromise::yield_value(const SymbolVect
 }
 
 
-std::suspend_always SymbolGenerator::SymbolPromise::yield_value(SymbolGenerator& gen)
+SymbolGenerator::DelegateAwaiter SymbolGenerator::SymbolPromise::yield_value(SymbolGenerator& gen)
 {
-	assert(out != nullptr);
-	cout << "yield generator: " << endl;
-	throw SuoError("Yielding a generator is not yet implemented!");
-#if 0
-	while (1) {
-		// End of input generator
-		gen.sourceSymbols(*out);
+	return DelegateAwaiter{ gen.coro_handle };
+}
 
-		// Output vector is full
-		if (out->full()) {
-			promise.gen = gen;
-			break;
-		}
 
-		out->push_back(*iter++);
+std::coroutine_handle<> SymbolGenerator::DelegateAwaiter::await_suspend(handle_type parent_handle) noexcept
+{
+	SymbolPromise& parent = parent_handle.promise();
+	SymbolPromise& child_promise = child.promise();
+	SymbolPromise* root = parent.root;
+
+	// The child might have delegated further if it was already partially sourced.
+	// Move the whole chain under our root.
+	handle_type leaf = child_promise.leaf;
+	for (handle_type h = leaf; h; h = h.promise().parent)
+		h.promise().root = root;
+	child_promise.parent = parent_handle;
+	root->leaf = leaf;
+
+	// Symbols left over from sourcing the child directly are output first
+	if (child_promise.input_iter != child_promise.input_end) {
+		root->input_iter = child_promise.input_iter;
+		root->input_end = child_promise.input_end;
+		child_promise.input_iter = child_promise.input_end = invalid_vector.end();
+		return std::noop_coroutine();
 	}
-#endif
 
-	return { };
+	// Symmetric transfer to the child
+	return leaf;
+}
+
+
+std::coroutine_handle<> SymbolGenerator::FinalAwaiter::await_suspend(handle_type self) noexcept
+{
+	SymbolPromise& promise = self.promise();
+	if (promise.parent && promise.root->exception_ == nullptr) {
+		// Continue the parent generator right after its co_yield
+		promise.root->leaf = promise.parent;
+		return promise.parent;
+	}
+	return std::noop_coroutine();
 }
 
 
 void SymbolGenerator::SymbolPromise::return_void() {
 	//cout << "return void" << endl;
-	if (out != nullptr)
+	if (root == this && out != nullptr)
 		out->flags |= end_of_burst;
 }
 
@@ -106,9 +261,11 @@ SymbolGenerator::~SymbolGenerator() {
 
 
 SymbolGenerator::SymbolGenerator(SymbolGenerator&& other) noexcept:
-	coro_handle{ other.coro_handle }
+	coro_handle{ other.coro_handle },
+	start{ other.start }
 {
 	other.coro_handle = {};
+	other.start = true;
 }
 
 SymbolGenerator& SymbolGenerator::operator=(SymbolGenerator&& other) noexcept {
@@ -135,6 +292,10 @@ bool SymbolGenerator::running() const
 	if (promise.input_iter != promise.input_end) 
 		return true;
 
+	// Generator has failed
+	if (promise.exception_)
+		return false;
+
 	// Execution has returned
 	return !coro_handle.done();
 }
@@ -159,45 +320,29 @@ void SymbolGenerator::sourceSymbols(SymbolVector& out)
 	SymbolPromise& promise = coro_handle.promise();
 
 	/* Source samples from preempted iterators */
-	if (promise.input_iter != promise.input_end) {
-		while (1) {
-
-			// End of input vector?
-			if (promise.input_iter == promise.input_end)
-				break;
-
-			// Output vector is full?
-			if (out.full())
-				return;
-
-			out.push_back(*promise.input_iter++);
-		}
-
-		// Make sure the iterators points to 'invalid_vector' because
-		// the original source vector might get invalidated soon.
-		promise.input_iter = promise.input_end = invalid_vector.end();
-	}
-
-#if 0
-	/* Source samples from preempted generator */
-	if (gen) {
-		gen.sourceSamples(inserter);
-	}
-#endif
+	if (source_preempted(promise.input_iter, promise.input_end, out, invalid_vector) == false)
+		return;
 
 	/* Try to produce new samples */
 	try {
 		promise.out = &out;
 
 		while (out.full() == false && coro_handle.done() == false) {
-			
-			// Continue execution to generate more samples
-			coro_handle();
+
+			if (promise.exception_)
+				std::rethrow_exception(promise.exception_);
+
+			// Continue execution of the innermost generator to generate more samples
+			promise.leaf.resume();
 
 			// Check exceptions
 			if (promise.exception_)
 				std::rethrow_exception(promise.exception_);
 
+			// A partially sourced generator was yielded and it had buffered symbols
+			if (source_preempted(promise.input_iter, promise.input_end, out, invalid_vector) == false)
+				break;
+
 			// If coroutine returned mark the end of the burst
 			if (coro_handle.done()) {
 				//cout << "generator done" << endl;
@@ -252,9 +397,10 @@ bool SymbolGenerator::Iterator::operator==(std::default_sentinel_t) const {
 
 
 SymbolGenerator::Iterator::Iterator(SymbolGenerator& gen, size_t buffer_size):
-	gen(gen)
+	gen(gen),
+	buffer_handle(symbol_pool.acquire(buffer_size)),
+	buffer(*buffer_handle)
 {
-	buffer.reserve(buffer_size);
 	it = buffer.end();
 }
 
@@ -266,68 +412,153 @@ SymbolGenerator::Iterator SymbolGenerator::begin(size_t buffer_size) {
 
 ////////////////////////////////////////////////////////////////////////////////
 
-const SampleVector SampleGenerator::invalid_vector(0);
-
-
 SampleGenerator::SamplePromise::SamplePromise() :
-	out(nullptr)
+	out(nullptr),
+	out_size(0),
+	out_capacity(0),
+	out_flags(none),
+	input_iter(nullptr),
+	input_end(nullptr),
+	reserved(nullptr),
+	reserved_size(0),
+	root(this)
 {
-	input_iter = input_end = invalid_vector.end();
 }
 
 SampleGenerator SampleGenerator::SamplePromise::get_return_object() {
-	return SampleGenerator(handle_type::from_promise(*this));
+	leaf = handle_type::from_promise(*this);
+	return SampleGenerator(leaf);
 }
 
 
 void SampleGenerator::SamplePromise::unhandled_exception() {
-	// saving exception
-	exception_ = std::current_exception();
+	// Saving exception to the generator which is being sourced
+	root->exception_ = std::current_exception();
+}
+
+
+void SampleGenerator::SamplePromise::output(const Sample* samples, size_t len)
+{
+	SamplePromise* root = this->root;
+	assert(root->out != nullptr);
+
+	const size_t n = std::min(len, root->out_capacity - root->out_size);
+	std::copy(samples, samples + n, root->out + root->out_size);
+	root->out_size += n;
+
+	// Output buffer is full
+	if (n < len) {
+		root->input_iter = samples + n; // Preempt
+		root->input_end = samples + len;
+	}
 }
 
 
 std::suspend_always SampleGenerator::SamplePromise::yield_value(const Sample& s)
 {
-	assert(out != nullptr);
-	if (out->full())
+	assert(root->out != nullptr);
+	if (root->out_size == root->out_capacity)
 		throw SuoError("Cannot append value! Output buffer is full.");
 
 	//cout << "yield single: " << s << endl;
-	out->push_back(s);
+	root->out[root->out_size++] = s;
 	return { };
 }
 
 
 std::suspend_always SampleGenerator::SamplePromise::yield_value(const SampleVector& samples)
 {
-	assert(out != nullptr);
-	SampleVector::const_iterator iter = samples.begin();
-	SampleVector::const_iterator end = samples.end();
-
-	while (1) {
+	output(samples.data(), samples.size());
+	return {};
+}
 
-		// End of input vector
-		if (iter == end)
-			break;
 
-		// Output vector is full
-		if (out->full()) {
-			input_iter = iter; // Preempt
-			input_end = end;
-			break;
-		}
+SampleGenerator::ReserveAwaiter SampleGenerator::SamplePromise::yield_value(Reserve request)
+{
+	assert(root->out != nullptr);
 
-		out->push_back(*iter++);
+	if (root->out_capacity - root->out_size >= request.size) {
+		// Enough room to render directly to the output buffer
+		reserved = root->out + root->out_size;
 	}
+	else {
+		// Render to the scratch buffer and copy when committed
+		if (!scratch)
+			scratch = sample_pool.acquire(request.size);
+		if (scratch->size() < request.size)
+			scratch->resize(request.size);
+		reserved = scratch->data();
+	}
+
+	reserved_size = request.size;
+	return ReserveAwaiter{ SampleSpan{ reserved, request.size } };
+}
+
+
+std::suspend_always SampleGenerator::SamplePromise::yield_value(Commit written)
+{
+	if (reserved == nullptr || written.size > reserved_size)
+		throw SuoError("SampleGenerator: Committed more samples than reserved");
 
+	if (reserved == root->out + root->out_size)
+		root->out_size += written.size;
+	else
+		output(reserved, written.size);
+
+	reserved = nullptr;
+	reserved_size = 0;
 	return {};
 }
 
 
+SampleGenerator::DelegateAwaiter SampleGenerator::SamplePromise::yield_value(SampleGenerator& gen)
+{
+	return DelegateAwaiter{ gen.coro_handle };
+}
+
+
+std::coroutine_handle<> SampleGenerator::DelegateAwaiter::await_suspend(handle_type parent_handle) noexcept
+{
+	SamplePromise& parent = parent_handle.promise();
+	SamplePromise& child_promise = child.promise();
+	SamplePromise* root = parent.root;
+
+	// Move the child's whole delegation chain under our root
+	handle_type leaf = child_promise.leaf;
+	for (handle_type h = leaf; h; h = h.promise().parent)
+		h.promise().root = root;
+	child_promise.parent = parent_handle;
+	root->leaf = leaf;
+
+	// Samples left over from sourcing the child directly are output first
+	if (child_promise.input_iter != child_promise.input_end) {
+		root->input_iter = child_promise.input_iter;
+		root->input_end = child_promise.input_end;
+		child_promise.input_iter = child_promise.input_end = nullptr;
+		return std::noop_coroutine();
+	}
+
+	// Symmetric transfer to the child
+	return leaf;
+}
+
+
+std::coroutine_handle<> SampleGenerator::FinalAwaiter::await_suspend(handle_type self) noexcept
+{
+	SamplePromise& promise = self.promise();
+	if (promise.parent && promise.root->exception_ == nullptr) {
+		// Continue the parent generator right after its co_yield
+		promise.root->leaf = promise.parent;
+		return promise.parent;
+	}
+	return std::noop_coroutine();
+}
+
+
 void SampleGenerator::SamplePromise::return_void() {
 	//cout << "return void" << endl;
-	if (out != nullptr)
-		out->flags |= end_of_burst;
+	if (root == this && out != nullptr)
+		out_flags |= end_of_burst;
 }
 
 
@@ -338,9 +569,11 @@ SampleGenerator::~SampleGenerator() {
 
 
 SampleGenerator::SampleGenerator(SampleGenerator&& other) noexcept : 
-	coro_handle{ other.coro_handle }
+	coro_handle{ other.coro_handle },
+	start{ other.start }
 {
 	other.coro_handle = {};
+	other.start = true;
 }
 
 SampleGenerator& SampleGenerator::operator=(SampleGenerator&& other) noexcept {
@@ -362,81 +595,99 @@ bool SampleGenerator::running() const
 {
 	if (!coro_handle)
 		return false;
+	SamplePromise& promise = coro_handle.promise();
+	if (promise.input_iter != promise.input_end)
+		return true;
+	if (promise.exception_)
+		return false;
 	return !coro_handle.done();
 }
 
 
 void SampleGenerator::sourceSamples(SampleVector& out)
 {
-	if (!coro_handle)
-		throw SuoError("Cannot source samples from invalid generator");
-
 	if (out.capacity() == 0)
 		throw SuoError("out.capacity() == 0");
-	out.clear();
-
-	if (start) {
-		start = false;
-		out.flags |= start_of_burst;
-	}
 
+	// Sample the whole capacity and shrink to the number of produced samples
+	out.clear();
+	out.resize(out.capacity());
 
-	SamplePromise& promise = coro_handle.promise();
-
-	/* Source samples from preempted iterators */
-	if (promise.input_iter != promise.input_end) {
-		while (1) {
+	VectorFlags flags = none;
+	size_t len = sourceSamples(SampleSpan{ out.data(), out.size() }, flags);
+	out.resize(len);
+	out.flags = flags;
+}
 
-			// End of input vector?
-			if (promise.input_iter == promise.input_end)
-				break;
 
-			// Output vector is full?
-			if (out.full())
-				return;
+size_t SampleGenerator::sourceSamples(SampleSpan out, VectorFlags& flags)
+{
+	if (!coro_handle)
+		throw SuoError("Cannot source samples from invalid generator");
 
-			out.push_back(*promise.input_iter++);
-		}
+	if (out.size == 0)
+		throw SuoError("out.size == 0");
 
-		// Make sure the iterators points to 'invalid_vector' because
-		// the original source vector might get invalidated soon.
-		promise.input_iter = promise.input_end = invalid_vector.end();
+	flags = none;
+	if (start) {
+		start = false;
+		flags |= start_of_burst;
 	}
 
-#if 0
-	/* Source samples from preempted generator */
-	if (gen) {
-		gen.sourceSamples(inserter);
-	}
-#endif
+	SamplePromise& promise = coro_handle.promise();
+	promise.out = out.data;
+	promise.out_size = 0;
+	promise.out_capacity = out.size;
+	promise.out_flags = none;
+
+	/* Source samples from preempted input */
+	auto source_preempted = [&promise]() {
+		if (promise.input_iter == promise.input_end)
+			return true;
+		const Sample* input = promise.input_iter;
+		const size_t len = promise.input_end - input;
+		promise.input_iter = promise.input_end = nullptr;
+		promise.output(input, len);
+		return promise.input_iter == promise.input_end;
+	};
 
 	/* Try to produce new samples */
 	try {
-		promise.out = &out;
+		if (source_preempted()) {
 
-		while (out.full() == false && coro_handle.done() == false) {
+			while (promise.out_size < promise.out_capacity && coro_handle.done() == false) {
 
-			// Continue execution to generate more samples
-			coro_handle();
+				if (promise.exception_)
+					std::rethrow_exception(promise.exception_);
 
-			// Check exceptions
-			if (promise.exception_)
-				std::rethrow_exception(promise.exception_);
+				// Continue execution of the innermost generator to generate more samples
+				promise.leaf.resume();
 
-			// If coroutine returned mark the end of the burst
-			if (coro_handle.done()) {
-				//cout << "generator done" << endl;
-				out.flags |= end_of_burst;
-				break;
+				// Check exceptions
+				if (promise.exception_)
+					std::rethrow_exception(promise.exception_);
+
+				// A partially sourced generator was yielded and it had buffered samples
+				if (source_preempted() == false)
+					break;
+
+				// If coroutine returned mark the end of the burst
+				if (coro_handle.done()) {
+					//cout << "generator done" << endl;
+					promise.out_flags |= end_of_burst;
+					break;
+				}
 			}
 		}
-
-		promise.out = nullptr;
 	}
 	catch (...) {
 		promise.out = nullptr;
 		throw;
 	}
+
+	flags |= promise.out_flags;
+	promise.out = nullptr;
+	return promise.out_size;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -477,10 +728,10 @@ SymbolGenerator SymbolGeneratorFromCallback::generator()
 }
 
 
-SymbolGenerator generator_from_vector(const SymbolVector& symbols) {
+SymbolGenerator suo::generator_from_vector(const SymbolVector& symbols) {
 	co_yield symbols;
 }
 
-SampleGenerator generator_from_vector(const SampleVector& samples) {
+SampleGenerator suo::generator_from_vector(const SampleVector& samples) {
 	co_yield samples;
 }
@@ -9,12 +9,53 @@
 namespace suo
 {
 
+namespace detail {
+
+/*
+ * Allocator for coroutine frames.
+ * Freed frames are kept in per-thread free lists (size classes of 64 bytes)
+ * so creating a generator per transmitted frame doesn't call malloc after
+ * the first few frames. Large frames go directly to the heap.
+ */
+void* allocate_coroutine_frame(size_t size);
+void free_coroutine_frame(void* ptr, size_t size);
+
+struct CoroutineFrameStatistics {
+	uint64_t allocations;   // Frames allocated from the heap
+	uint64_t reused;        // Frames taken from the free list
+};
+
+/* Statistics of the calling thread */
+CoroutineFrameStatistics getCoroutineFrameStatistics();
+
+}; // namespace detail
+
+
 // template<typename Complexity>
 class SymbolGenerator
 {
 public:
 	//const unsigned int complexity = Complexity;
 
+	class SymbolPromise;
+	using promise_type = SymbolPromise;
+	using handle_type = std::coroutine_handle<promise_type>;
+
+	/* Transfers the execution directly to a yielded child generator */
+	struct DelegateAwaiter {
+		handle_type child;
+		bool await_ready() const noexcept { return !child || child.done(); }
+		std::coroutine_handle<> await_suspend(handle_type parent) noexcept;
+		void await_resume() const noexcept { }
+	};
+
+	/* Returns the execution to the parent generator when a child finishes */
+	struct FinalAwaiter {
+		bool await_ready() const noexcept { return false; }
+		std::coroutine_handle<> await_suspend(handle_type self) noexcept;
+		void await_resume() const noexcept { }
+	};
+
 	class SymbolPromise {
 	public:
 		SymbolPromise();
@@ -22,28 +63,36 @@ public:
 		SymbolGenerator get_return_object();
 
 		std::suspend_always initial_suspend() { return {}; }
-		std::suspend_always final_suspend() noexcept { return {}; }
+		FinalAwaiter final_suspend() noexcept { return {}; }
 
 		void unhandled_exception();
 
 		std::suspend_always yield_value(const Symbol& symbol);
 		std::suspend_always yield_value(const SymbolVector& symbols);
-		std::suspend_always yield_value(SymbolGenerator& gen);
+
+		/* Delegate to another generator. Its symbols are written directly to the output. */
+		DelegateAwaiter yield_value(SymbolGenerator& gen);
+		DelegateAwaiter yield_value(SymbolGenerator&& gen) { return yield_value(gen); }
 
 		void return_void();
 
+		static void* operator new(size_t size) { return detail::allocate_coroutine_frame(size); }
+		static void operator delete(void* ptr, size_t size) { detail::free_coroutine_frame(ptr, size); }
+
 	private:
 
+		/* Output buffer and preempted input. Used only in the root promise. */
 		SymbolVector* out;
 		SymbolVector::const_iterator input_iter, input_end;
 		std::exception_ptr exception_;
-		
-		friend SymbolGenerator;
-	};
 
+		/* Delegation chain */
+		SymbolPromise* root;  // Outermost generator which is being sourced
+		handle_type parent;   // Generator which yielded this one
+		handle_type leaf;     // Innermost running generator (valid in the root)
 
-	using promise_type = SymbolPromise;
-	using handle_type = std::coroutine_handle<promise_type>;
+		friend SymbolGenerator;
+	};
 
 	SymbolGenerator() = default;
 	SymbolGenerator(const SymbolGenerator&) = delete;
@@ -74,7 +123,8 @@ public:
 
 	private:
 		SymbolGenerator& gen;
-		SymbolVector buffer;
+		Pooled<SymbolVector> buffer_handle;
+		SymbolVector& buffer;
 		SymbolVector::iterator it;
 	};
 
@@ -113,12 +163,67 @@ private:
 
 
 
+
+
+/*
+ * Writable span of samples.
+ * Used to lend an output buffer (e.g. the SDR driver's DMA buffer) to a
+ * SampleGenerator so that the samples are rendered directly into it.
+ */
+struct SampleSpan {
+	Sample* data;
+	size_t size;
+};
 
 
 class SampleGenerator
 {
 public:
 
+	class SamplePromise;
+	using promise_type = SamplePromise;
+	using handle_type = std::coroutine_handle<promise_type>;
+
+	/* Transfers the execution directly to a yielded child generator */
+	struct DelegateAwaiter {
+		handle_type child;
+		bool await_ready() const noexcept { return !child || child.done(); }
+		std::coroutine_handle<> await_suspend(handle_type parent) noexcept;
+		void await_resume() const noexcept { }
+	};
+
+	/* Returns the execution to the parent generator when a child finishes */
+	struct FinalAwaiter {
+		bool await_ready() const noexcept { return false; }
+		std::coroutine_handle<> await_suspend(handle_type self) noexcept;
+		void await_resume() const noexcept { }
+	};
+
+	/*
+	 * In-place rendering:
+	 *
+	 *    SampleSpan buf = co_yield SampleGenerator::reserve(max_samples);
+	 *    ... write n <= max_samples samples to buf.data ...
+	 *    co_yield SampleGenerator::commit(n);
+	 *
+	 * If the output buffer has enough room, the returned span points directly
+	 * to it. Otherwise a scratch buffer is returned and the committed samples
+	 * are copied to the output like a yielded SampleVector.
+	 * Nothing else may be yielded between reserve and commit.
+	 */
+	struct Reserve { size_t size; };
+	struct Commit { size_t size; };
+
+	static Reserve reserve(size_t size) { return Reserve{ size }; }
+	static Commit commit(size_t size) { return Commit{ size }; }
+
+	struct ReserveAwaiter {
+		SampleSpan span;
+		bool await_ready() const noexcept { return true; }
+		void await_suspend(handle_type) const noexcept { }
+		SampleSpan await_resume() const noexcept { return span; }
+	};
+
 	class SamplePromise {
 	public:
 
@@ -127,28 +232,50 @@ public:
 		SampleGenerator get_return_object();
 
 		std::suspend_always initial_suspend() { return {}; }
-		std::suspend_always final_suspend() noexcept { return {}; }
+		FinalAwaiter final_suspend() noexcept { return {}; }
 
 		void unhandled_exception();
 
 		std::suspend_always yield_value(const Sample& s);
 		std::suspend_always yield_value(const SampleVector& samples);
-		std::suspend_always yield_value(const SampleGenerator& gen);
+
+		/* Render samples in place */
+		ReserveAwaiter yield_value(Reserve request);
+		std::suspend_always yield_value(Commit written);
+
+		/* Delegate to another generator. Its samples are written directly to the output. */
+		DelegateAwaiter yield_value(SampleGenerator& gen);
+		DelegateAwaiter yield_value(SampleGenerator&& gen) { return yield_value(gen); }
 
 		void return_void();
 
+		static void* operator new(size_t size) { return detail::allocate_coroutine_frame(size); }
+		static void operator delete(void* ptr, size_t size) { detail::free_coroutine_frame(ptr, size); }
+
 	private:
 
-		SampleVector* out;
-		SampleVector::const_iterator input_iter, input_end;
+		/* Copy samples to the output and preempt the rest */
+		void output(const Sample* samples, size_t len);
+
+		/* Output buffer and preempted input. Used only in the root promise. */
+		Sample* out;
+		size_t out_size, out_capacity;
+		VectorFlags out_flags;
+		const Sample *input_iter, *input_end;
 		std::exception_ptr exception_;
 
-		friend SampleGenerator;
-	};
+		/* Region given by the latest reserve */
+		Sample* reserved;
+		size_t reserved_size;
+		Pooled<SampleVector> scratch;
 
+		/* Delegation chain */
+		SamplePromise* root;  // Outermost generator which is being sourced
+		handle_type parent;   // Generator which yielded this one
+		handle_type leaf;     // Innermost running generator (valid in the root)
 
-	using promise_type = SamplePromise;
-	using handle_type = std::coroutine_handle<promise_type>;
+		friend SampleGenerator;
+	};
 
 	SampleGenerator() = default;
 	SampleGenerator(const SampleGenerator&) = delete;
@@ -162,7 +289,15 @@ public:
 
 	bool running() const;
 
+	/* Source new samples to the vector. Fills up to the vector's capacity. */
 	void sourceSamples(SampleVector& out);
+
+	/*
+	 * Source new samples directly to a lent buffer.
+	 * Returns the number of samples written. start_of_burst/end_of_burst
+	 * are set to flags.
+	 */
+	size_t sourceSamples(SampleSpan out, VectorFlags& flags);
 	
 	operator bool() { return running(); }
 
@@ -170,8 +305,6 @@ private:
 	handle_type coro_handle;
 	bool start = true;
 
-	static const SampleVector invalid_vector;
-	
 };
 
 
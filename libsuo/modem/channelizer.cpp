@@ -0,0 +1,146 @@
+#include <cmath>
+
+#include "modem/channelizer.hpp"
+#include "registry.hpp"
+
+
+using namespace std;
+using namespace suo;
+
+
+Channelizer::Config::Config() {
+	sample_rate = 1e6;
+	num_channels = 8;
+	filter_semilength = 4;
+	attenuation = 60.0f;
+}
+
+
+Channelizer::Channelizer(const Config& conf) :
+	conf(conf)
+{
+	if (conf.sample_rate <= 0)
+		throw SuoError("Channelizer: Non-positive sample rate");
+	if (conf.num_channels < 2 || conf.num_channels % 2 != 0)
+		throw SuoError("Channelizer: Number of channels must be even and at least 2");
+	if (conf.filter_semilength < 1)
+		throw SuoError("Channelizer: Filter semi-length must be at least 1");
+
+	/* The 2x oversampled filter bank decimates by half of the number of channels */
+	decimation = conf.num_channels / 2;
+	sample_ns = round(1.0e9 / conf.sample_rate);
+
+	/* The prototype filter has 2 * num_channels * filter_semilength + 1 taps */
+	delay_ns = conf.num_channels * conf.filter_semilength * sample_ns;
+
+	l_channelizer = firpfbch2_crcf_create_kaiser(LIQUID_ANALYZER, conf.num_channels, conf.filter_semilength, conf.attenuation);
+
+	outputChannels.resize(conf.num_channels);
+	channels.resize(conf.num_channels);
+	bank_output.resize(conf.num_channels);
+	pending.reserve(decimation);
+	active.reserve(conf.num_channels);
+}
+
+
+Channelizer::~Channelizer()
+{
+	firpfbch2_crcf_destroy(l_channelizer);
+}
+
+
+void Channelizer::reset()
+{
+	firpfbch2_crcf_reset(l_channelizer);
+	pending.clear();
+}
+
+
+float Channelizer::getChannelFrequency(unsigned int channel) const
+{
+	if (channel >= conf.num_channels)
+		throw SuoError("Channelizer: Invalid channel %u", channel);
+	int k = channel;
+	if (channel >= conf.num_channels / 2)
+		k -= conf.num_channels;
+	return k * conf.sample_rate / conf.num_channels;
+}
+
+
+unsigned int Channelizer::getChannelIndex(float frequency) const
+{
+	int k = lroundf(frequency / conf.sample_rate * conf.num_channels);
+	k %= (int)conf.num_channels;
+	if (k < 0)
+		k += conf.num_channels;
+	return k;
+}
+
+
+Port<const SampleVector&, Timestamp>& Channelizer::outputChannel(unsigned int channel)
+{
+	if (channel >= conf.num_channels)
+		throw SuoError("Channelizer: Invalid channel %u", channel);
+	return outputChannels[channel];
+}
+
+
+void Channelizer::execute(Sample* x)
+{
+	firpfbch2_crcf_execute(l_channelizer, x, bank_output.data());
+	for (unsigned int k: active)
+		channels[k].push_back(bank_output[k]);
+}
+
+
+void Channelizer::sinkSamples(const SampleVector& samples, Timestamp now)
+{
+	const size_t n = samples.size();
+
+	/* Only the channels someone is listening to are collected */
+	active.clear();
+	for (unsigned int k = 0; k < conf.num_channels; k++) {
+		if (outputChannels[k].has_connections()) {
+			active.push_back(k);
+			channels[k].clear();
+			channels[k].reserve((pending.size() + n) / decimation);
+		}
+	}
+
+	/* The first output is partly made of the samples left over from the previous block
+	 * and is delayed by the filter bank */
+	Timestamp start = now - pending.size() * sample_ns;
+	start = start > delay_ns ? start - delay_ns : 0;
+
+	size_t i = 0;
+	if (pending.empty() == false) {
+		while (pending.size() < decimation && i < n)
+			pending.push_back(samples[i++]);
+		if (pending.size() < decimation)
+			return;
+		execute(pending.data());
+		pending.clear();
+	}
+
+	for (; i + decimation <= n; i += decimation)
+		execute(const_cast<Sample*>(&samples[i]));
+
+	pending.assign(samples.begin() + i, samples.end());
+
+	for (unsigned int k: active) {
+		SampleVector& channel = channels[k];
+		if (channel.empty())
+			continue;
+		channel.timestamp = start;
+		channel.flags = samples.flags;
+		outputChannels[k].emit(channel, start);
+	}
+}
+
+
+Block* createChannelizer(const Kwargs &args)
+{
+	return new Channelizer();
+}
+
+static Registry registerChannelizer("Channelizer", &createChannelizer);
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "suo.hpp"
+#include <liquid/liquid.h>
+
+namespace suo {
+
+/*
+ * Polyphase filter bank channelizer.
+ *
+ * Splits one wideband sample stream into num_channels equally spaced channels
+ * using liquid-dsp's 2x oversampled analysis filter bank. One prototype filter
+ * and one FFT per num_channels/2 input samples are shared between all the channels,
+ * so monitoring more channels adds only the cost of copying their outputs.
+ *
+ * Channel k is centered at k * sample_rate / num_channels, where the upper half
+ * of the channels wraps around to negative frequencies. Each channel is output
+ * at getChannelRate() = 2 * sample_rate / num_channels from its own port.
+ * The demodulator attached to a channel should be configured with the channel
+ * rate and the residual offset frequency - getChannelFrequency(k).
+ * The channel timestamps are corrected by the group delay of the prototype
+ * filter, so they refer to the same instant as the input timestamps.
+ */
+class Channelizer : public Block
+{
+public:
+
+	struct Config {
+		Config();
+
+		/* Input sample rate [Hz] */
+		float sample_rate;
+
+		/* Number of channels. Must be even. */
+		unsigned int num_channels;
+
+		/* Prototype filter semi-length in symbols */
+		unsigned int filter_semilength;
+
+		/* Stopband attenuation [dB] */
+		float attenuation;
+	};
+
+	explicit Channelizer(const Config& conf = Config());
+	~Channelizer();
+
+	Channelizer(const Channelizer&) = delete;
+	Channelizer& operator=(const Channelizer&) = delete;
+
+	void reset();
+
+	/* Sample rate of each output channel */
+	float getChannelRate() const { return 2.0f * conf.sample_rate / conf.num_channels; }
+
+	/* Center frequency of the given channel relative to the input stream */
+	float getChannelFrequency(unsigned int channel) const;
+
+	/* Group delay of the analysis filter bank [ns] */
+	Timestamp getDelay() const { return delay_ns; }
+
+	/* Index of the channel nearest to the given frequency */
+	unsigned int getChannelIndex(float frequency) const;
+
+	/* Output port of the given channel */
+	Port<const SampleVector&, Timestamp>& outputChannel(unsigned int channel);
+
+	void sinkSamples(const SampleVector& samples, Timestamp now);
+
+	/* Output ports for each channel. Channels without connections are not output. */
+	std::vector<Port<const SampleVector&, Timestamp>> outputChannels;
+
+private:
+	void execute(Sample* x);
+
+	Config conf;
+	unsigned int decimation;
+	Timestamp sample_ns;
+	Timestamp delay_ns;
+
+	/* liquid-dsp objects */
+	firpfbch2_crcf l_channelizer;
+
+	/* Input left over from the previous block */
+	SampleVector pending;
+
+	/* Filter bank output for one step and the output buffers for each channel */
+	SampleVector bank_output;
+	std::vector<SampleVector> channels;
+	std::vector<unsigned int> active;
+};
+
+}; // namespace suo
@@ -0,0 +1,191 @@
+#include <algorithm>
+#include <cmath>
+
+#include "modem/cpm_waveform.hpp"
+
+
+using namespace std;
+using namespace suo;
+
+
+/* Sine table size as log2 */
+static const unsigned int sine_bits = 12;
+
+/* Symbol clock bits used for the table position */
+static const unsigned int timing_bits = 8;
+
+static_assert((1u << timing_bits) == CPMWaveform::timing_resolution);
+
+
+CPMWaveform::Config::Config() {
+	sample_rate = 1e6;
+	symbol_rate = 9600;
+	bits_per_symbol = 1;
+	modindex = 0.5f;
+	pulse = Pulse::gaussian;
+	bt = 0.5f;
+	amplitude = 1.0f;
+	ramp_up_duration = 0;
+	ramp_down_duration = 0;
+}
+
+
+/* Same window as liquid-dsp's hamming() */
+static float hamming_window(size_t i, size_t len) {
+	return 0.53836f - 0.46164f * cosf(pi2f * i / (float)(len - 1));
+}
+
+
+CPMWaveform::CPMWaveform(const Config& conf) :
+	conf(conf)
+{
+	const double samples_per_symbol = conf.sample_rate / conf.symbol_rate;
+	if (samples_per_symbol < 2.0)
+		throw SuoError("CPMWaveform: Less than 2 samples per symbol");
+	if (conf.bits_per_symbol < 1 || conf.bits_per_symbol > 4)
+		throw SuoError("CPMWaveform: Unsupported bits per symbol %u", conf.bits_per_symbol);
+	if (conf.modindex <= 0)
+		throw SuoError("CPMWaveform: Non-positive modindex %f", conf.modindex);
+	if (conf.pulse == Pulse::gaussian && conf.bt <= 0)
+		throw SuoError("CPMWaveform: Non-positive bt %f", conf.bt);
+
+	modulation_order = 1 << conf.bits_per_symbol;
+
+	/* Truncate the Gaussian pulse at 3 sigma on both sides of the symbol */
+	if (conf.pulse == Pulse::gaussian) {
+		const double sigma = sqrt(log(2.0)) / (2 * M_PI * conf.bt);
+		pulse_length = 1 + 2 * (unsigned int)ceil(3 * sigma);
+	}
+	else
+		pulse_length = 1;
+
+	/* The phase inside a symbol depends on the symbols within the pulse length */
+	num_histories = 1;
+	for (unsigned int i = 0; i < pulse_length; i++) {
+		num_histories *= modulation_order;
+		if (num_histories > 65536)
+			throw SuoError("CPMWaveform: Too long symbol history for the table");
+	}
+
+	clock_step = llround(4294967296.0 / samples_per_symbol);
+	max_samples = (unsigned int)ceil(samples_per_symbol) + 1;
+
+	/*
+	 * Phase change from the start of the newest symbol to the position t inside it.
+	 * Symbol j steps back in history started j symbols earlier.
+	 * The symbol step (t = 1) sums exactly to the phase change of the symbol
+	 * over the consecutive symbols, so the phase at the boundaries doesn't drift.
+	 */
+	auto symbolPhase = [&](unsigned int h, double t) {
+		double dphi = 0;
+		for (unsigned int j = 0; j < pulse_length; j++) {
+			const int a = 2 * (int)(h % modulation_order) - (int)(modulation_order - 1);
+			dphi += a * (phaseResponse(t + j) - phaseResponse(j));
+			h /= modulation_order;
+		}
+		dphi *= conf.modindex; // [cycles], 2 * pi * h * q(t) in radians
+		return (uint32_t)(int64_t)llround(dphi * 4294967296.0);
+	};
+
+	symbol_phases.resize(num_histories * timing_resolution);
+	symbol_steps.resize(num_histories);
+	for (unsigned int h = 0; h < num_histories; h++) {
+		for (unsigned int p = 0; p < timing_resolution; p++)
+			symbol_phases[h * timing_resolution + p] = symbolPhase(h, (p + 0.5) / timing_resolution);
+		symbol_steps[h] = symbolPhase(h, 1.0);
+	}
+
+	sine_table.resize(1 << sine_bits);
+	for (size_t i = 0; i < sine_table.size(); i++)
+		sine_table[i] = polar(conf.amplitude, (float)(2 * M_PI * i / sine_table.size()));
+
+	/* Hamming windows matching the earlier per-sample ramps */
+	const size_t up_len = lround(conf.ramp_up_duration * samples_per_symbol);
+	ramp_up.resize(up_len);
+	for (size_t i = 0; i < up_len; i++)
+		ramp_up[i] = hamming_window(i, 2 * up_len);
+
+	const size_t down_len = lround(conf.ramp_down_duration * samples_per_symbol);
+	ramp_down.resize(down_len);
+	for (size_t i = 0; i < down_len; i++)
+		ramp_down[i] = hamming_window(down_len + i, 2 * down_len);
+
+	startBurst(0.0f);
+}
+
+
+double CPMWaveform::phaseResponse(double t) const
+{
+	if (t <= 0)
+		return 0.0;
+	if (t >= pulse_length)
+		return 0.5;
+
+	if (conf.pulse == Pulse::rectangular)
+		return 0.5 * t;
+
+	/*
+	 * Integral of the rectangular pulse filtered with the Gaussian:
+	 * g(t) = (Phi((t - c + 1/2) / s) - Phi((t - c - 1/2) / s)) / 2
+	 * using the integral of the normal CDF, x Phi(x) + phi(x).
+	 * Normalized to reach 1/2 at the truncation point.
+	 */
+	const double sigma = sqrt(log(2.0)) / (2 * M_PI * conf.bt);
+	const double c = 0.5 * pulse_length;
+	auto Psi = [](double x) { return x * 0.5 * erfc(-x / M_SQRT2) + exp(-0.5 * x * x) / sqrt(2 * M_PI); };
+	auto G = [&](double t) { return sigma * (Psi((t - c + 0.5) / sigma) - Psi((t - c - 0.5) / sigma)); };
+	return 0.5 * (G(t) - G(0)) / (G(pulse_length) - G(0));
+}
+
+
+void CPMWaveform::startBurst(float frequency)
+{
+	history = 0;
+	symbol_clock = 0;
+	symbol_phase = 0;
+	carrier_phase = 0;
+	carrier_step = (uint32_t)llround(frequency / conf.sample_rate * 4294967296.0);
+
+	ramp = ramp_up.empty() ? nullptr : ramp_up.data();
+	ramp_len = ramp_up.size();
+	ramp_pos = 0;
+	ramp_end = 1.0f;
+}
+
+
+void CPMWaveform::startRampDown()
+{
+	if (ramp_down.empty())
+		return;
+	ramp = ramp_down.data();
+	ramp_len = ramp_down.size();
+	ramp_pos = 0;
+	ramp_end = 0.0f;
+}
+
+
+unsigned int CPMWaveform::modulate(Symbol symbol, Sample* output)
+{
+	history = (history * modulation_order + symbol % modulation_order) % num_histories;
+	const uint32_t* phases = &symbol_phases[history * timing_resolution];
+
+	const uint64_t one = 1ull << 32;
+	unsigned int n = 0;
+	while (symbol_clock < one) {
+		carrier_phase += carrier_step;
+		const uint32_t phase = carrier_phase + symbol_phase + phases[symbol_clock >> (32 - timing_bits)];
+		output[n++] = sine_table[(uint32_t)(phase + (1u << (31 - sine_bits))) >> (32 - sine_bits)];
+		symbol_clock += clock_step;
+	}
+	symbol_clock -= one;
+	symbol_phase += symbol_steps[history];
+
+	if (ramp != nullptr) {
+		for (unsigned int i = 0; i < n; i++)
+			output[i] *= (ramp_pos < ramp_len) ? ramp[ramp_pos++] : ramp_end;
+		if (ramp_pos >= ramp_len && ramp_end == 1.0f)
+			ramp = nullptr;
+	}
+
+	return n;
+}
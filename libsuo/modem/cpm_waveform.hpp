@@ -0,0 +1,121 @@
+#pragma once
+
+#include "suo.hpp"
+
+namespace suo {
+
+/*
+ * Table-driven continuous phase modulation (GMSK and n-FSK) waveform synthesis.
+ *
+ * The frequency pulse spans only a few symbols, so the phase of an output sample
+ * relative to the start of the symbol depends only on the latest symbols and on
+ * the position of the sample inside the symbol. The phases are precalculated for
+ * every symbol history and timing_resolution sample positions, so no interpolation
+ * or resampling is needed for non-integer samples per symbol. The phase at the
+ * symbol boundaries advances by the exact phase step of each symbol, so the
+ * quantized sample positions don't accumulate to a phase drift over long bursts.
+ *
+ * The phases are 32-bit fixed point and the output sample is looked up from
+ * a sine table which includes the amplitude. The amplitude ramps are
+ * precalculated windows.
+ */
+class CPMWaveform
+{
+public:
+
+	enum class Pulse {
+		rectangular,  // n-FSK/MSK with a constant frequency during the symbol
+		gaussian      // Gaussian filtered frequency pulse (GMSK/GFSK)
+	};
+
+	struct Config {
+		Config();
+
+		/* Output sample rate [Hz] */
+		float sample_rate;
+
+		/* Symbol rate [Hz] */
+		float symbol_rate;
+
+		/* Bits per symbol. The symbol m is mapped to the frequency 2 * m - (M - 1). */
+		unsigned int bits_per_symbol;
+
+		/* Modulation index. Phase changes by pi * h per symbol at the outermost frequency of 2-FSK. */
+		float modindex;
+
+		/* Frequency pulse shape */
+		Pulse pulse;
+
+		/* Gaussian filter bandwidth-time product */
+		float bt;
+
+		/* Signal amplitude */
+		float amplitude;
+
+		/* Length of the start/stop ramp in symbols */
+		unsigned int ramp_up_duration;
+		unsigned int ramp_down_duration;
+	};
+
+	/* Number of quantized sample positions inside one symbol */
+	static const unsigned int timing_resolution = 256;
+
+	explicit CPMWaveform(const Config& conf = Config());
+
+	/*
+	 * Start a new burst at given carrier frequency [Hz].
+	 * Resets the phase and the symbol history and starts the ramp up.
+	 */
+	void startBurst(float frequency);
+
+	/* Fade out the signal during the following ramp_down_duration symbols */
+	void startRampDown();
+
+	/*
+	 * Render one symbol period to output.
+	 * Returns the number of samples written (at most getMaxSamples()).
+	 */
+	unsigned int modulate(Symbol symbol, Sample* output);
+
+	/* Maximum number of output samples per symbol */
+	unsigned int getMaxSamples() const { return max_samples; }
+
+	/* Length of the frequency pulse [symbols] */
+	unsigned int getPulseLength() const { return pulse_length; }
+
+private:
+
+	/* Phase response of the frequency pulse; rises from 0 to 1/2 over pulse_length symbols */
+	double phaseResponse(double t) const;
+
+	Config conf;
+	unsigned int modulation_order;
+	unsigned int pulse_length;
+	unsigned int num_histories;
+	unsigned int max_samples;
+	uint64_t clock_step;           // Symbol clock increment per output sample (symbol = 2^32)
+
+	/* Phase relative to the start of the symbol as [history * timing_resolution + position] */
+	std::vector<uint32_t> symbol_phases;
+
+	/* Phase change over the whole symbol for each history */
+	std::vector<uint32_t> symbol_steps;
+
+	/* Amplitude scaled sine table */
+	std::vector<Sample> sine_table;
+
+	/* Precalculated ramp windows (one per output sample) */
+	std::vector<float> ramp_up, ramp_down;
+
+	/* State */
+	unsigned int history;          // Latest symbols as digits of base modulation_order
+	uint64_t symbol_clock;         // Position of the next output sample inside the symbol
+	uint32_t symbol_phase;         // Baseband phase at the start of the symbol (2pi = 2^32)
+	uint32_t carrier_phase;        // Carrier phase of the latest output sample
+	uint32_t carrier_step;         // Carrier phase increment per output sample
+	const float* ramp;             // Active ramp window or nullptr
+	size_t ramp_len, ramp_pos;
+	float ramp_end;                // Window value after the active ramp
+};
+
+}; // namespace suo
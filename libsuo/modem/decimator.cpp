@@ -0,0 +1,191 @@
+#include <algorithm>
+#include <cmath>
+
+#include "modem/decimator.hpp"
+#include "registry.hpp"
+
+
+using namespace std;
+using namespace suo;
+
+
+Decimator::Config::Config() {
+	sample_rate = 1e6;
+	output_rate = 38400;
+	bandwidth = 12000;
+	attenuation = 60.0f;
+}
+
+
+/* Kaiser estimate for the filter length with given normalized transition width */
+static unsigned int kaiserLength(float attenuation, float transition)
+{
+	return ceilf((attenuation - 7.95f) / (14.36f * transition));
+}
+
+
+vector<Decimator::Stage> Decimator::plan(const Config& conf)
+{
+	if (conf.sample_rate <= 0 || conf.output_rate <= 0)
+		throw SuoError("Decimator: Non-positive sample rate");
+	if (conf.bandwidth < 0)
+		throw SuoError("Decimator: Negative bandwidth");
+
+	const float min_rate = max(2.0f * conf.output_rate, 4.0f * conf.bandwidth);
+
+	vector<Stage> stages;
+	float rate = conf.sample_rate;
+
+	/* Half-band stages while there's room for one more factor of 2 after them.
+	 * The FIR stage must come last as execute() indexes the half-bands by stage. */
+	while (rate / 2 >= 2 * min_rate) {
+		/* Aliases fold onto the band from [rate/2 - bandwidth, rate/2] */
+		float transition = 0.5f - 2.0f * conf.bandwidth / rate;
+		unsigned int len = kaiserLength(conf.attenuation, transition);
+		unsigned int m = clamp((len + 3) / 4, 2u, 32u);
+		stages.push_back(Stage{ 2, true, m });
+		rate /= 2;
+	}
+
+	/* Single polyphase FIR stage for the remaining integer factor */
+	unsigned int factor = floorf(rate / min_rate);
+	if (factor >= 2) {
+		/* Transition band from bandwidth to rate / factor - bandwidth */
+		unsigned int m = clamp((unsigned int)ceilf((conf.attenuation - 7.95f) / 14.36f) + 1, 2u, 16u);
+		stages.push_back(Stage{ factor, false, m });
+	}
+
+	return stages;
+}
+
+
+Decimator::Decimator(const Config& conf) :
+	conf(conf),
+	l_firdecim(nullptr)
+{
+	stages = plan(conf);
+
+	decimation = 1;
+	for (const Stage& stage: stages) {
+		decimation *= stage.factor;
+		if (stage.halfband)
+			l_halfbands.push_back(resamp2_crcf_create(stage.semilength, 0.0f, conf.attenuation));
+		else {
+			/* Normalize for unity gain at DC */
+			unsigned int len = 2 * stage.factor * stage.semilength + 1;
+			vector<float> h(len);
+			liquid_firdes_kaiser(len, 0.5f / stage.factor, conf.attenuation, 0.0f, h.data());
+			float gain = 0.0f;
+			for (float c: h)
+				gain += c;
+			for (float& c: h)
+				c /= gain;
+			l_firdecim = firdecim_crcf_create(stage.factor, h.data(), len);
+		}
+		pending.emplace_back();
+		pending.back().reserve(stage.factor);
+	}
+
+	output.reserve(4096);
+}
+
+
+Decimator::~Decimator()
+{
+	for (resamp2_crcf l_halfband: l_halfbands)
+		resamp2_crcf_destroy(l_halfband);
+	if (l_firdecim)
+		firdecim_crcf_destroy(l_firdecim);
+}
+
+
+void Decimator::reset()
+{
+	for (resamp2_crcf l_halfband: l_halfbands)
+		resamp2_crcf_reset(l_halfband);
+	if (l_firdecim)
+		firdecim_crcf_reset(l_firdecim);
+	for (auto& p: pending)
+		p.clear();
+}
+
+
+size_t Decimator::execute(const Sample* in, size_t n, Sample* out)
+{
+	if (stages.empty()) {
+		if (in != out)
+			copy(in, in + n, out);
+		return n;
+	}
+
+	/*
+	 * Every stage reads from src and writes either to the work buffer or, on
+	 * the last stage, to out. The output index never passes the input index
+	 * so the stages can run in-place.
+	 */
+	work.resize(n / stages[0].factor + 1);
+
+	const Sample* src = in;
+	for (size_t s = 0; s < stages.size(); s++) {
+		const unsigned int factor = stages[s].factor;
+		vector<Sample>& left = pending[s];
+		Sample* dst = (s + 1 == stages.size()) ? out : work.data();
+		size_t i = 0, nout = 0;
+
+		auto run = [&](const Sample* x) {
+			Sample* xx = const_cast<Sample*>(x);
+			if (stages[s].halfband)
+				resamp2_crcf_decim_execute(l_halfbands[s], xx, &dst[nout++]);
+			else
+				firdecim_crcf_execute(l_firdecim, xx, &dst[nout++]);
+		};
+
+		/* Complete the partial input from the previous call */
+		if (left.empty() == false) {
+			while (left.size() < factor && i < n)
+				left.push_back(src[i++]);
+			if (left.size() < factor) {
+				src = dst;
+				n = 0;
+				continue;
+			}
+			run(left.data());
+			left.clear();
+		}
+
+		for (; i + factor <= n; i += factor)
+			run(&src[i]);
+
+		left.assign(src + i, src + n);
+
+		src = dst;
+		n = nout;
+	}
+
+	return n;
+}
+
+
+void Decimator::decimate(const SampleVector& samples)
+{
+	output.resize(maxOutput(samples.size()));
+	output.resize(execute(samples.data(), samples.size(), output.data()));
+	output.flags = samples.flags;
+	output.timestamp = samples.timestamp;
+}
+
+
+void Decimator::sinkSamples(const SampleVector& samples, Timestamp now)
+{
+	decimate(samples);
+	if (output.empty() == false)
+		outputSamples.emit(output, now);
+}
+
+
+Block* createDecimator(const Kwargs &args)
+{
+	return new Decimator();
+}
+
+static Registry registerDecimator("Decimator", &createDecimator);
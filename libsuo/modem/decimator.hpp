@@ -0,0 +1,109 @@
+#pragma once
+
+#include "suo.hpp"
+#include <liquid/liquid.h>
+
+namespace suo {
+
+/*
+ * Multi-stage integer decimator for the receiver front end.
+ *
+ * Reduces the sample rate before the demodulator's fractional resampler so
+ * that the per-sample cost of the resampler scales with the signal bandwidth
+ * instead of the SDR sample rate. The chain is planned automatically:
+ *
+ * 1) Half-band decimate-by-2 stages while the rate stays high enough
+ * 2) One polyphase Kaiser FIR decimator with an integer factor
+ *
+ * The output rate is at least min_rate = max(2 * output_rate, 4 * bandwidth)
+ * and below 2 * min_rate when the input rate allows, so the final fractional
+ * resampler runs at a low rate and only has to decimate by 2-4.
+ */
+class Decimator : public Block
+{
+public:
+
+	struct Config {
+		Config();
+
+		/* Input sample rate [Hz] */
+		float sample_rate;
+
+		/* Sample rate required after the final resampler [Hz] */
+		float output_rate;
+
+		/* One-sided bandwidth around DC to be preserved [Hz] */
+		float bandwidth;
+
+		/* Stopband attenuation [dB] */
+		float attenuation;
+	};
+
+	/* Description of one stage in the chain */
+	struct Stage {
+		unsigned int factor;      // Decimation factor
+		bool halfband;            // Half-band or polyphase FIR stage
+		unsigned int semilength;  // Filter semi-length
+	};
+
+	explicit Decimator(const Config& conf = Config());
+	~Decimator();
+
+	Decimator(const Decimator&) = delete;
+	Decimator& operator=(const Decimator&) = delete;
+
+	void reset();
+
+	/* Plan the stages for the given configuration */
+	static std::vector<Stage> plan(const Config& conf);
+
+	/*
+	 * Decimate n samples from in to out. out may be the same buffer as in.
+	 * out must have room for maxOutput(n) samples.
+	 * Returns the number of samples written.
+	 */
+	size_t execute(const Sample* in, size_t n, Sample* out);
+
+	/* Maximum number of output samples from n input samples */
+	size_t maxOutput(size_t n) const { return n / decimation + 1; }
+
+	/* Total decimation factor */
+	unsigned int getDecimation() const { return decimation; }
+
+	/* Sample rate after the decimator */
+	float getOutputRate() const { return conf.sample_rate / decimation; }
+
+	const std::vector<Stage>& getStages() const { return stages; }
+
+	/* Block interface */
+	void sinkSamples(const SampleVector& samples, Timestamp now);
+	Port<const SampleVector&, Timestamp> outputSamples;
+
+	/* Static pipeline stage interface */
+	template <typename Next>
+	void process(const SampleVector& samples, Timestamp now, Next&& next) {
+		decimate(samples);
+		if (output.empty() == false)
+			next(output, now);
+	}
+
+private:
+	void decimate(const SampleVector& samples);
+
+	Config conf;
+	std::vector<Stage> stages;
+	unsigned int decimation;
+
+	/* liquid-dsp objects for each stage */
+	std::vector<resamp2_crcf> l_halfbands;
+	firdecim_crcf l_firdecim;
+
+	/* Input samples left over from the previous call for each stage */
+	std::vector<std::vector<Sample>> pending;
+
+	/* Output of the intermediate stages */
+	SampleVector work;
+	SampleVector output;
+};
+
+}; // namespace suo
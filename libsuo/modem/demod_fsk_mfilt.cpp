@@ -11,6 +11,17 @@ using namespace std;
 using namespace suo;
 
 
+/*
+ * Debug plotting of the matched filters and the demodulator output.
+ * Requires Matplot++.
+ */
+#define FSK_MFILT_PLOTTING 0
+
+#if FSK_MFILT_PLOTTING && !defined(SUO_SUPPORT_PLOTTING)
+#error "FSK_MFILT_PLOTTING requires Matplot++"
+#endif
+
+
 
 FSKMatchedFilterDemodulator::Config::Config() {
 	sample_rate = 1e6;
@@ -24,11 +35,14 @@ FSKMatchedFilterDemodulator::Config::Config() {
 	frequency_offset = 0.0f;
 	pll_bandwidth0 = 0.02f; // < 0.1f;
 	pll_bandwidth1 = 0.01f;
+	acquisition_range = 0.0f;
+	acquisition_threshold = 10.0f;
 }
 
 
 FSKMatchedFilterDemodulator::FSKMatchedFilterDemodulator(const Config& _conf) :
-	conf(_conf)
+	conf(_conf),
+	coarse_offset(0.0f)
 {
 	if (conf.sample_rate <= 0)
 		throw SuoError("FSKMatchedFilterDemodulator: Negative or zero sample rate! %f", conf.sample_rate);
@@ -52,7 +66,7 @@ FSKMatchedFilterDemodulator::FSKMatchedFilterDemodulator(const Config& _conf) :
 
 
 	/* Configure a resampler for a fixed conf.samples_per_symbol ratio */
-	float resamprate = conf.symbol_rate * conf.samples_per_symbol / conf.sample_rate;
+	resamprate = conf.symbol_rate * conf.samples_per_symbol / conf.sample_rate;
 	if (resamprate > 1)
 		throw SuoError("FSKMatchedFilterDemodulator: resamprate > 1! %f", resamprate);
 
@@ -62,7 +76,31 @@ FSKMatchedFilterDemodulator::FSKMatchedFilterDemodulator(const Config& _conf) :
 	if ((abs(conf.center_frequency) + 0.5 * signal_bandwidth) / conf.sample_rate > 0.5)
 		throw SuoError("FSKMatchedFilterDemodulator: Center frequency too large for given sample rate!");
 
+	if (conf.acquisition_range < 0)
+		throw SuoError("FSKMatchedFilterDemodulator: Negative acquisition range! %f", conf.acquisition_range);
+
+	// Decimate first to a rate which is still able to hold the signal and the AFC/acquisition range
+	Decimator::Config decim_conf;
+	decim_conf.sample_rate = conf.sample_rate;
+	decim_conf.output_rate = conf.symbol_rate * conf.samples_per_symbol;
+	decim_conf.bandwidth = 0.5f * signal_bandwidth + max(0.5f * conf.symbol_rate, conf.acquisition_range);
+	decimator = make_unique<Decimator>(decim_conf);
+
+	// Coarse frequency acquisition with about 1/16 symbol rate resolution
+	if (conf.acquisition_range > 0) {
+		FrequencyAcquisition::Config acq_conf;
+		acq_conf.sample_rate = decimator->getOutputRate();
+		acq_conf.fft_length = 64;
+		while (acq_conf.fft_length < 16 * acq_conf.sample_rate / conf.symbol_rate)
+			acq_conf.fft_length *= 2;
+		acq_conf.num_averages = 4;
+		acq_conf.search_range = conf.acquisition_range + 0.5f * signal_bandwidth;
+		acq_conf.threshold = conf.acquisition_threshold;
+		acquisition = make_unique<FrequencyAcquisition>(acq_conf);
+	}
+
 	// Resampler
+	resamprate = conf.symbol_rate * conf.samples_per_symbol / decimator->getOutputRate();
 	double bw = 0.4 * resamprate / conf.samples_per_symbol;
 	int semilen = lroundf(1.0f / bw);
 	l_resamp = resamp_crcf_create(resamprate, semilen, bw, 60.0f, 16);
@@ -70,10 +108,8 @@ FSKMatchedFilterDemodulator::FSKMatchedFilterDemodulator(const Config& _conf) :
 	// TODO: 
 	resamp_crcf_get_delay(l_resamp);
 
-	/* Calculate maximum number of output samples after feeding one sample
-	 * to the resampler. This is needed to allocate a big enough array. */
-	resampint = ceilf(1 / resamprate);
 	sample_ns = roundf(1.0e9 / conf.sample_rate);
+	symbol_ns = roundf(1.0e9 / conf.symbol_rate);
 
 	/* NCO:
 	 * Limit AFC range to half of symbol rate to keep it
@@ -99,6 +135,7 @@ FSKMatchedFilterDemodulator::FSKMatchedFilterDemodulator(const Config& _conf) :
 	const size_t xxxx = 4 * conf.samples_per_symbol;
 	Sample mod_output[xxxx];
 	Sample matched_filter[xxxx];
+	vector<vector<Sample>> filters;
 	for (Symbol symbol_b = 0; symbol_b < constellation_size; symbol_b++) {
 
 		for (size_t j = 0; j < xxxx; j++)
@@ -127,9 +164,10 @@ FSKMatchedFilterDemodulator::FSKMatchedFilterDemodulator(const Config& _conf) :
 		for (size_t j = 0; j < xxxx; j++)
 			matched_filter[j] *= hamming(j, xxxx) / 2 * constellation_size; // TODO: liquid_hamming
 
-		matched_filters.push_back(firfilt_cccf_create(&matched_filter[conf.samples_per_symbol /*+ filter_delay*/], conf.samples_per_symbol));
+		const Sample* taps = &matched_filter[conf.samples_per_symbol /*+ filter_delay*/];
+		filters.emplace_back(taps, taps + conf.samples_per_symbol);
 
-#if 0
+#if FSK_MFILT_PLOTTING
 		std::vector<double> plot_i(xxxx);
 		std::vector<double> plot_q(xxxx);
 		for (size_t j = 0; j < xxxx; j++) {
@@ -146,6 +184,9 @@ FSKMatchedFilterDemodulator::FSKMatchedFilterDemodulator(const Config& _conf) :
 #else
 	}
 #endif
+	cpfskmod_destroy(mod);
+
+	matched_filters.setFilters(filters);
 
 	l_eqfir = firfilt_rrrf_create((float*)(const float[5]){ -.5f, 0, 2.f, 0, -.5f }, 5);
 
@@ -160,16 +201,20 @@ FSKMatchedFilterDemodulator::FSKMatchedFilterDemodulator(const Config& _conf) :
 	l_symsync = symsync_rrrf_create_rnyquist(LIQUID_FIRFILT_ARKAISER, conf.samples_per_symbol, m, beta, num_filters);
 	symsync_rrrf_set_lf_bw(l_symsync, 0.02f); // loop filter bandwidth
 #endif
+
+	mixed.reserve(4096);
+	resampled.reserve(4096);
+	demod.reserve(4096);
+	synced.reserve(1024);
+	symbols.reserve(1024);
 	reset();
 }
 
 
 FSKMatchedFilterDemodulator::~FSKMatchedFilterDemodulator()
 {
-	for (auto& l_fir: matched_filters)
-		firfilt_cccf_destroy(l_fir);
-	matched_filters.clear();
-
+	nco_crcf_destroy(l_nco);
+	resamp_crcf_destroy(l_resamp);
 	firfilt_rrrf_destroy(l_eqfir);
 	symsync_rrrf_destroy(l_symsync);
 }
@@ -177,7 +222,12 @@ FSKMatchedFilterDemodulator::~FSKMatchedFilterDemodulator()
 void FSKMatchedFilterDemodulator::reset() {
 	receiver_lock = false;
 	conf.frequency_offset = 0;
+	coarse_offset = 0;
+	if (acquisition)
+		acquisition->reset();
 	update_nco();
+	est_power = 0.0f;
+	matched_filters.reset();
 	firfilt_rrrf_reset(l_eqfir);
 	symsync_rrrf_reset(l_symsync);
 }
@@ -187,7 +237,7 @@ void FSKMatchedFilterDemodulator::update_nco()
 {
 	float old_freq = nco_crcf_get_frequency(l_nco);
 
-	float center_frequency = (conf.center_frequency + conf.frequency_offset);
+	float center_frequency = (conf.center_frequency + conf.frequency_offset + coarse_offset);
 	nco_crcf_set_frequency(l_nco, nco_1Hz * center_frequency);
 
 	freq_min = nco_1Hz * (center_frequency - 0.5f * conf.symbol_rate);
@@ -197,196 +247,120 @@ void FSKMatchedFilterDemodulator::update_nco()
 }
 
 
+void FSKMatchedFilterDemodulator::seedFrequency(float offset)
+{
+	coarse_offset = clamp(offset, -conf.acquisition_range, conf.acquisition_range);
+	update_nco();
+}
+
+
 void FSKMatchedFilterDemodulator::sinkSamples(const SampleVector& samples, Timestamp timestamp)
 {
+	SUO_PROFILE(profile_samples, samples.size());
+	demodulate(samples, timestamp);
+
+	if (sinkSymbol.has_connections()) {
+		for (size_t k = 0; k < symbols.size(); k++)
+			sinkSymbol.emit(symbols[k], symbols.symbol_time(k));
+	}
+
+	if (sinkSymbols.has_connections() && symbols.empty() == false)
+		sinkSymbols.emit(symbols, timestamp);
+}
 
-	/* Allocate small buffers from stack */
-	Sample samples2[resampint];
 
+void FSKMatchedFilterDemodulator::demodulate(const SampleVector& samples, Timestamp timestamp)
+{
 	if (conf_dirty && receiver_lock == false)
 		update_nco();
 
-	size_t plot_size = 6 * 200;
-	std::vector<double> plot1; plot1.reserve(plot_size);
-	std::vector<double> plot2; plot2.reserve(plot_size);
-	std::vector<double> plot3; plot3.reserve(plot_size);
-	std::vector<double> plot4; plot4.reserve(plot_size);
-	size_t si;
-	for (si = 0; si < samples.size(); si++) {
-		unsigned nsamp2 = 0, si2;
-		Sample s = samples[si];
-
-		/* Downconvert and resample one input sample at a time */
-		nco_crcf_step(l_nco);
-		nco_crcf_mix_down(l_nco, s, &s);
-		resamp_crcf_execute(l_resamp, s, samples2, &nsamp2);
-
-		/* Process output from the resampler one sample at a time */
-		for(si2 = 0; si2 < nsamp2; si2++) {
-			Sample s2 = samples2[si2];
-
-			/* Run matched filters */
-			float demod = 0;
-			float total_power = 0;
-			for (size_t symbol = 0; symbol < matched_filters.size(); symbol++) {
-
-				// Calculate matched filter
-				Sample mf_out;
-				firfilt_cccf_push(matched_filters[symbol], s2);
-				firfilt_cccf_execute(matched_filters[symbol], &mf_out);
-				float power = norm(mf_out);
-				total_power += power;
-
-				// Map symbol powers to [-1, +1] range
-				float mapped = 2.0f * symbol - constellation_size + 1.0f;
-				demod += mapped * power * power;
-				if (symbol == 0)
-					plot1.push_back(power);
-				else
-					plot2.push_back(power);
-				
-			}
-			
-			est_power += (total_power - est_power) * 0.01f;
-			demod /= total_power;
-
-#if 0
-			if (plot1.size() == plot1.capacity()) {
-				cout << "PRKL " << plot1.size() << "  " << plot2.size() << endl;
-				matplot::figure();
-				matplot::hold(matplot::on);
-				matplot::plot(plot1);
-				matplot::plot(plot2);
-				//matplot::show();
-				//return;
-			}
-#endif
-#if 1
-			/* Equalization (Cancel gaussian filter) */
-			firfilt_rrrf_push(l_eqfir, demod);
-			firfilt_rrrf_execute(l_eqfir, &demod);
-#endif
-#if 0
-			float freq = nco_crcf_get_frequency(l_nco);
-			plot3.push_back(demod);
-			plot4.push_back(freq);
-			if (plot3.size() == plot3.capacity()) {
-				matplot::figure();
-				matplot::hold(matplot::on);
-				matplot::plot(plot3);
-				//matplot::plot(plot4);
-				matplot::show();
-				return;
-			}
-#endif
-
+	/* Collect the decided symbols into a single batch */
+	symbols.clear();
+	symbols.flags = has_timestamp;
+	symbols.symbol_period = symbol_ns;
 
-			/*
-			 * Tune the AFC (Automatic Frequency Correction)
-			 */
-			if (1 || receiver_lock == false) {
-				//nco_crcf_pll_step(l_nco, -demod);
-				//nco_crcf_adjust_frequency(l_nco, -0.5 * demod);
-				float freq = nco_crcf_get_frequency(l_nco);
-				if (freq > freq_max)
-					nco_crcf_set_frequency(l_nco, freq_max);
-				if (freq < freq_min)
-					nco_crcf_set_frequency(l_nco, freq_min);
-			}
-
-#if 0
-			/* Feed-forward timing synchronizer
-			 * --------------------------------
-			 * Feed a rectified demodulated signal into a comb filter.
-			 * When the output outputoutputof the comb filter peaks, take a symbol.
-			 * When a frame is detected, keep timing free running
-			 * for rest of the frame. */
-			bool synced = false;
-			float synced_sample = 0;
-
-			//windowcf_push(samples_per_symbol, demod);
-			
-			const float comb_prev = ss_comb[ss_p];
-			const float comb_prev2 = ss_comb[(ss_p+conf.samples_per_symbol-1) % conf.samples_per_symbol];
-			ss_p = (ss_p+1) % conf.samples_per_symbol;
-			float comb = ss_comb[ss_p];
-
-			comb += (clamp(abs(demod), -1.f, 1.f) - comb) * 0.03f;
-
-			ss_comb[ss_p] = comb;
-			ss_p = ss_p;
-
-			if (receiver_lock == false) {
-				if(comb_prev > comb && comb_prev > comb_prev2) {
-					synced = true;
-					synced_sample = demod_prev;
-					ss_ps = (ss_p+conf.samples_per_symbol-1) % conf.samples_per_symbol;
-				}
-			} else {
-				if(ss_p == ss_ps) {
-					synced = true;
-					synced_sample = demod;
-				}
-			}
-
-
-			/* Decisions and deframing
-			 * ----------------------- */
-			if (synced == true) {
-
-				/* Process one output symbol from synchronizer */
-				Symbol decision = (synced_sample >= 0) ? 1 : 0;
-				//cout << decision << " ";
-
-				if (0) { // SinkSymbol(decision, timestamp)) {
-
-					/* If this was the first sync, collect store some metadata. */
-					if (receiver_lock == false) {
-						/*frame->setMetadata("cfo", nco_crcf_get_frequency(l_nco) / nco_1Hz);
-						frame->setMetadata("rssi", 10.0f * log10f(est_power));
-						frame->setMetadata("rssi", agc_crcf_get_rssi(l_agc));
-						frame->setMetadata("bg_rssi", agc_crcf_get_rssi(l_bg_agc));*/
-					}
-
-					receiver_lock = true;
-				}
-				else {
-					/* No sync, no lock */
-					receiver_lock = false;
-				}
-			}
-#else
+	const unsigned int n = samples.size();
+	if (n == 0)
+		return;
 
-			/* Run symbols sync */
-			float synced_symbols[4];
-			unsigned int output_symbols = 0;
-			symsync_rrrf_execute(l_symsync, &demod, 1, synced_symbols, &output_symbols);
-			//cout << "output_symbols " <<  output_symbols << endl;
+	/* Downconvert, decimate and resample the whole block */
+	mixed.resize(n);
+	nco_crcf_mix_block_down(l_nco, const_cast<Sample*>(samples.data()), mixed.data(), n);
 
-			//assert(output_symbols <= 1);
-			if (output_symbols == 0)
-				continue;
+	unsigned int ndecimated = decimator->execute(mixed.data(), n, mixed.data());
 
-			/* Process one output symbol from synchronizer */
-			Timestamp symbol_time = 0; // now + si * sample_ns;
-			//now -= conf.filter_delay * resampint; // or / resamprate
+	/* Coarse acquisition: Retune the NCO when the signal is found far from the current frequency */
+	if (acquisition && receiver_lock == false && acquisition->execute(mixed.data(), ndecimated)) {
+		float nco_offset = nco_crcf_get_frequency(l_nco) / nco_1Hz - (conf.center_frequency + conf.frequency_offset);
+		float offset = nco_offset + acquisition->getFrequency();
+		if (abs(offset - nco_offset) > 0.125f * conf.symbol_rate) {
+			seedFrequency(offset);
+			acquisition->reset();
+		}
+	}
 
-			Symbol decision = (synced_symbols[0] >= 0) ? 1 : 0;
-			cout << (int)decision << " ";
-			sinkSymbol.emit(decision, symbol_time);
+	unsigned int nresampled = 0;
+	resampled.resize(ceil(1.1f * ndecimated * resamprate) + 4);
+	resamp_crcf_execute_block(l_resamp, mixed.data(), ndecimated, resampled.data(), &nresampled);
+	resampled.resize(nresampled);
+	if (nresampled == 0)
+		return;
 
+	/* Run the matched filters and map the symbol powers to soft symbols */
+	demod.resize(nresampled);
+	float power = matched_filters.execute(resampled.data(), nresampled, demod.data());
+	est_power += (1.0f - powf(0.99f, nresampled)) * (power / nresampled - est_power);
 
+#if 1
+	/* Equalization (Cancel gaussian filter) */
+	firfilt_rrrf_execute_block(l_eqfir, demod.data(), nresampled, demod.data());
 #endif
-			demod_prev = demod;
+
+#if FSK_MFILT_PLOTTING
+	static Plotter plot_demod(6 * 200), plot_freq(6 * 200);
+	for (unsigned int i = 0; i < nresampled; i++) {
+		plot_freq.push(nco_crcf_get_frequency(l_nco));
+		if (plot_demod.push(demod[i])) {
+			plot_demod.plot();
+			plot_freq.plot();
+			Plotter::show();
 		}
-		timestamp += sample_ns;
 	}
+#endif
+
+	/*
+	 * Tune the AFC (Automatic Frequency Correction)
+	 */
+	if (1 || receiver_lock == false) {
+		float freq = nco_crcf_get_frequency(l_nco);
+		if (freq > freq_max)
+			nco_crcf_set_frequency(l_nco, freq_max);
+		if (freq < freq_min)
+			nco_crcf_set_frequency(l_nco, freq_min);
+	}
+
+	/* Run symbols sync */
+	unsigned int nsynced = 0;
+	synced.resize(nresampled + 1);
+	symsync_rrrf_execute(l_symsync, demod.data(), nresampled, synced.data(), &nsynced);
+
+	/* 
+	 * Process output symbols from synchronizer.
+	 * Symbols are timestamped backwards from the end of the block at the symbol rate.
+	 */
+	Timestamp block_end = timestamp + n * sample_ns;
+	if (nsynced > 0)
+		symbols.timestamp = block_end - nsynced * symbol_ns;
+	for (unsigned int k = 0; k < nsynced; k++)
+		symbols.push_back((synced[k] >= 0) ? 1 : 0);
 }
 
 
 void FSKMatchedFilterDemodulator::lockReceiver(bool locked, Timestamp now) {
 	if (locked) {
 		receiver_lock = true;
+		if (acquisition)
+			setMetadata.emit(meta::cfo_coarse, coarse_offset);
 		//agc_crcf_lock(l_bg_agc);
 		nco_crcf_pll_set_bandwidth(l_nco, nco_1Hz * conf.pll_bandwidth1 / conf.samples_per_symbol);
 	}
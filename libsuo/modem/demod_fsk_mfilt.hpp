@@ -1,7 +1,12 @@
 #pragma once
 
+#include <memory>
+
 #include "suo.hpp"
 #include <liquid/liquid.h>
+#include "modem/matched_filter_bank.hpp"
+#include "modem/decimator.hpp"
+#include "modem/frequency_acquisition.hpp"
 
 namespace suo {
 
@@ -61,6 +66,16 @@ public:
 		/* */
 		float pll_bandwidth0;
 		float pll_bandwidth1;
+
+		/*
+		 * Coarse frequency acquisition range around the center frequency (Hz).
+		 * When non-zero, the NCO is retuned from the averaged spectrum
+		 * of the decimated signal while the receiver is not locked.
+		 */
+		float acquisition_range;
+
+		/* Required signal to noise floor ratio in the spectrum for the acquisition (dB) */
+		float acquisition_threshold;
 	};
 
 	explicit FSKMatchedFilterDemodulator(const Config& conf = Config());
@@ -72,25 +87,46 @@ public:
 
 	void reset();
 	void sinkSamples(const SampleVector& samples, Timestamp timestamp);
+
+	/*
+	 * Static Pipeline stage: The decided symbols are passed one by one to
+	 * next(), so a static deframer stage is inlined into the symbol loop.
+	 */
+	template <typename Next>
+	void process(const SampleVector& samples, Timestamp timestamp, Next&& next) {
+		SUO_PROFILE(profile_samples, samples.size());
+		demodulate(samples, timestamp);
+		for (size_t k = 0; k < symbols.size(); k++)
+			next(symbols[k], symbols.symbol_time(k));
+	}
+
+	/* Lock state from the deframer. Takes effect from the next sample block
+	 * because the deframer sees the symbols only after the block is demodulated. */
 	void lockReceiver(bool locked, Timestamp now);
 
+	/* Symbols go to sinkSymbols as a batch per sample block and to sinkSymbol
+	 * one at a time. Both are emitted whenever they have connections. */
 	Port<Symbol, Timestamp> sinkSymbol;
+	Port<const SymbolVector&, Timestamp> sinkSymbols;
 	Port<SoftSymbol, Timestamp> sinkSoftSymbol;
-	Port<const std::string&, const MetadataValue&> setMetadata;
+	Port<MetadataKey, const MetadataValue&> setMetadata;
 
 	void setFrequencyOffset(float frequency_offset);
 
 private:
 
+	/* Demodulate a sample block to the symbols batch */
+	void demodulate(const SampleVector& samples, Timestamp timestamp);
 	void update_nco();
+	void seedFrequency(float offset);
 
 	/* Configuration */
 	Config conf;
 	bool conf_dirty;
 
-	// float resamprate;
+	float resamprate;
 	Timestamp sample_ns;
-	unsigned resampint;
+	Timestamp symbol_ns;
 	float nco_1Hz;
 	float afc_speed;
 	bool receiver_lock;
@@ -100,28 +136,34 @@ private:
 	float freq_min; // Normalized minimum frequency
 	float freq_max; // Normalized maximum frequency
 
-	/* Timing synchronizer state */
-	float ss_comb[4];
-	float demod_prev;
-	unsigned ss_p, ss_ps;
-
-
-	agc_crcf l_bg_agc;
-
 	/* General metadata */
 	float est_power; // Running estimate of the signal power
 
+	/* Integer decimation ahead of the resampler */
+	std::unique_ptr<Decimator> decimator;
+
+	/* Coarse frequency acquisition and the acquired offset from the center frequency (Hz) */
+	std::unique_ptr<FrequencyAcquisition> acquisition;
+	float coarse_offset;
+
 	/* liquid-dsp objects */
 	nco_crcf l_nco;
 	resamp_crcf l_resamp;
-	std::vector<firfilt_cccf> matched_filters;
 	firfilt_rrrf l_eqfir;
 	windowcf l_sync_window;
 	symsync_rrrf l_symsync;
 
-	/* Buffers */
-	Frame frame;
+	MatchedFilterBank matched_filters;
+
+	/* Buffers for the processing stages */
+	SampleVector mixed;         // Downconverted input samples
+	SampleVector resampled;     // Samples after resampling to samples_per_symbol
+	std::vector<float> demod;   // Soft symbol estimates from the matched filters
+	std::vector<float> synced;  // Symbol synchronizer output
+	SymbolVector symbols;       // Symbols decided from the latest sample vector
 
+	/* Profiling */
+	SUO_PROFILE_POINT(profile_samples, "FSKMatchedFilterDemodulator", "sinkSamples");
 };
 
 }; // namespace suo
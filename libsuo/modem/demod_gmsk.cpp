@@ -3,9 +3,7 @@
 
 #include <string>
 #include <assert.h>
-#include <iostream>
 #include <liquid/liquid.h>
-#include <iomanip>
 
 using namespace std;
 using namespace suo;
@@ -18,6 +16,9 @@ using namespace suo;
 
 #define FRAMELEN_MAX 0x900
 
+/* Batched symbols are flushed every byte while a burst is tracked */
+static const size_t burst_batch_size = 8;
+
 
 GMSKDemodulator::Config::Config() {
 	sample_rate = 1e6;
@@ -25,11 +26,16 @@ GMSKDemodulator::Config::Config() {
 	center_frequency = 100000;
 	bt = 0.3;
 	samples_per_symbol = 4;
+	syncword = 0xC9D08A7B;
+	syncword_len = 32;
+	detection_threshold = 0.5f;
 }
 
 
 GMSKDemodulator::GMSKDemodulator(const Config& conf) :
-	conf(conf)
+	conf(conf),
+	m(3),
+	discriminator(conf.samples_per_symbol)
 {
 
 
@@ -37,19 +43,22 @@ GMSKDemodulator::GMSKDemodulator(const Config& conf) :
 	float signal_bandwidth = 2 * (0.5 * conf.symbol_rate + conf.symbol_rate); // [Hz]
 	if ((abs(conf.center_frequency) + 0.5 * signal_bandwidth) / conf.sample_rate > 0.50)
 		throw SuoError("GMSKDemodulator: Center frequency too large for given sample rate!");
+	if (conf.syncword_len < 8 || conf.syncword_len > 8 * sizeof(conf.syncword))
+		throw SuoError("GMSKDemodulator: Invalid syncword length %u", conf.syncword_len);
 
-	//syncmask = (1ULL << conf.synclen) - 1;
-	//framepos = conf.framelen;
+	/* Decimate first to a rate which is still able to hold the signal */
+	Decimator::Config decim_conf;
+	decim_conf.sample_rate = conf.sample_rate;
+	decim_conf.output_rate = conf.symbol_rate * conf.samples_per_symbol;
+	decim_conf.bandwidth = 0.5f * signal_bandwidth;
+	decimator = make_unique<Decimator>(decim_conf);
 
 	/* Configure a resampler for a fixed oversampling ratio */
-	float resamprate = conf.symbol_rate * conf.samples_per_symbol / conf.sample_rate;
-	double bw = 0.4 * resamprate / conf.samples_per_symbol;
-	int semilen = lroundf(1.0f / bw);
+	float resamprate = conf.symbol_rate * conf.samples_per_symbol / decimator->getOutputRate();
 	l_resamp = resamp_crcf_create(resamprate, 25, 0.4f / conf.samples_per_symbol, 60.0f, 32);
-	/* Calculate maximum number of output samples after feeding one sample
-	 * to the resampler. This is needed to allocate a big enough array. */
-	resampint = ceilf(1 / resamprate);
 
+	resampled_ns = round(1.0e9 / (conf.symbol_rate * conf.samples_per_symbol));
+	symbol_ns = round(1.0e9 / conf.symbol_rate);
 
 	center_frequency = conf.center_frequency;
 	nco_1Hz = pi2f / conf.sample_rate;
@@ -60,20 +69,23 @@ GMSKDemodulator::GMSKDemodulator(const Config& conf) :
 
 
 	/*
-	 * Frame detector
+	 * Frame detector:
+	 * The syncword is modulated (MSB first) to get the waveform of the preamble.
+	 * The first m symbols out of the modulator are the filter delay.
 	 */
-	preamble_len = conf.sync_len;
-	preamble_pn = new float[preamble_len];
-	preamble_rx = new float[preamble_len];
-	Sample syncword_samples[preamble_len * conf.samples_per_symbol];
+	preamble_len = conf.syncword_len;
+	preamble_pn.resize(preamble_len);
+	preamble_rx.resize(preamble_len);
+	vector<Sample> syncword_samples(preamble_len * conf.samples_per_symbol);
+	vector<Sample> delay_samples(conf.samples_per_symbol);
 
 	gmskmod mod = gmskmod_create(conf.samples_per_symbol, m, conf.bt);
 
-	for (unsigned int i=0; i<conf.sync_len + m; i++) {
+	for (unsigned int i = 0; i < preamble_len + m; i++) {
 
 		unsigned char bit;
-		if (i < m)
-			bit = (conf.sync_word & (conf.sync_len - i)) != 0;
+		if (i < preamble_len)
+			bit = (conf.syncword >> (preamble_len - 1 - i)) & 1;
 		else
 			bit = i & 1;
 
@@ -83,7 +95,7 @@ GMSKDemodulator::GMSKDemodulator(const Config& conf) :
 
 		// modulate/interpolate
 		if (i < m)
-			gmskmod_modulate(mod, bit, &syncword_samples[0]);
+			gmskmod_modulate(mod, bit, delay_samples.data());
 		else
 			gmskmod_modulate(mod, bit, &syncword_samples[(i - m) * conf.samples_per_symbol]);
 	}
@@ -91,10 +103,11 @@ GMSKDemodulator::GMSKDemodulator(const Config& conf) :
 
 
 	// create frame detector
-	float threshold = 0.50f;     // detection threshold
-	float dphi_max  = 0.05f;    // maximum carrier offset allowable
-	l_frame_detector = detector_cccf_create(syncword_samples, preamble_len * conf.samples_per_symbol, threshold, dphi_max);
-	l_buffer = windowcf_create(conf.samples_per_symbol * (preamble_len + m));
+	PreambleCorrelator::Config corr_conf;
+	corr_conf.threshold = conf.detection_threshold;   // detection threshold
+	corr_conf.dphi_max  = 0.05f;                      // maximum carrier offset allowable
+	correlator = make_unique<PreambleCorrelator>(corr_conf);
+	correlator->setPreamble(syncword_samples);
 
 	// create symbol timing recovery filters
 	npfb = 32;   // number of filters in the bank
@@ -104,6 +117,14 @@ GMSKDemodulator::GMSKDemodulator(const Config& conf) :
 	// create down-coverters for carrier phase tracking
 	l_nco_coarse = nco_crcf_create(LIQUID_NCO);
 
+	mixed.reserve(4096);
+	resampled.reserve(4096);
+	buffer.reserve(2 * correlator->getFFTLength());
+	symbols.reserve(1024);
+	history = 0;
+	buffer_time = 0;
+	sample_time = 0;
+
 	state = STATE_DETECTFRAME;
 	reset();
 }
@@ -111,14 +132,14 @@ GMSKDemodulator::GMSKDemodulator(const Config& conf) :
 void GMSKDemodulator::reset()
 {
 	state = STATE_DETECTFRAME;
+	receiver_lock = false;
 
-	windowcf_reset(l_buffer);
-	detector_cccf_reset(l_frame_detector);
 	nco_crcf_reset(l_nco_coarse);
 
 	preamble_counter = 0;
+	payload_counter = 0;
 
-	x_prime = 0.0f;
+	discriminator.reset();
 	fi_hat  = 0.0f;
 
 	firpfb_rrrf_reset(l_mf);
@@ -129,17 +150,11 @@ void GMSKDemodulator::reset()
 
 GMSKDemodulator::~GMSKDemodulator()
 {
-	//iirfilt_crcf_destroy(l_prefilter);        // pre-demodulator filter
+	nco_crcf_destroy(l_nco);
+	resamp_crcf_destroy(l_resamp);
 	firpfb_rrrf_destroy(l_mf);                // matched filter
 	firpfb_rrrf_destroy(l_dmf);               // derivative matched filter
 	nco_crcf_destroy(l_nco_coarse);           // coarse NCO
-
-	// preamble
-	detector_cccf_destroy(l_frame_detector);
-	windowcf_destroy(l_buffer);
-
-	delete[] preamble_pn;
-	delete[] preamble_rx;
 }
 
 
@@ -198,7 +213,6 @@ int GMSKDemodulator::update_symbol_sync(float _x, float *_y)
 			// adjust pfb output timer
 			pfb_timer++;
 		}
-		// cout << "  b/soft    :   " << pfb_soft << endl; // %12.8f\n;
 	}
 
 	// decrement symbol timer
@@ -213,7 +227,7 @@ int GMSKDemodulator::update_symbol_sync(float _x, float *_y)
 
 
 // push buffered p/n sequence through synchronizer
-void GMSKDemodulator::pushpn()
+void GMSKDemodulator::pushpn(const Sample* rc, Timestamp t0)
 {
 	unsigned int i;
 
@@ -221,10 +235,6 @@ void GMSKDemodulator::pushpn()
 	firpfb_rrrf_reset(l_mf);
 	firpfb_rrrf_reset(l_dmf);
 
-	// read buffer
-	Complex * rc;
-	windowcf_read(l_buffer, &rc);
-
 	// compute delay and filterbank index
 	//  tau_hat < 0 :   delay = 2*k*m-1, index = round(   tau_hat *npfb), flag = 0
 	//  tau_hat > 0 :   delay = 2*k*m-2, index = round((1-tau_hat)*npfb), flag = 0
@@ -262,6 +272,7 @@ void GMSKDemodulator::pushpn()
 
 	for (i=delay; i<buffer_len; i++) {
 		// run remaining samples through sample state machine
+		sample_time = t0 + i * resampled_ns;
 		execute_sample(rc[i]);
 	}
 
@@ -274,35 +285,30 @@ void GMSKDemodulator::pushpn()
 void GMSKDemodulator::update_fi(Complex _x)
 {
 	// compute differential phase
-	fi_hat = arg(conj(x_prime) * _x) * conf.samples_per_symbol;
+	fi_hat = discriminator.step(_x);
+}
+
 
-	// update internal state
-	x_prime = _x;
+void GMSKDemodulator::emit_symbol(Symbol s)
+{
+	if (sinkSymbol.has_connections())
+		sinkSymbol.emit(s, sample_time);
+
+	/* The batch is delivered by flush_symbols() */
+	if (sinkSymbols.has_connections() == false)
+		return;
+	if (symbols.empty())
+		symbols.timestamp = sample_time;
+	symbols.push_back(s);
 }
 
 
-void GMSKDemodulator::execute_detectframe(const Complex _x)
+void GMSKDemodulator::flush_symbols(Timestamp now)
 {
-	// push sample into pre-demod p/n sequence buffer
-	windowcf_push(l_buffer, _x);
-
-	// push through pre-demod synchronizer
-	int detected = detector_cccf_correlate(l_frame_detector, _x,
-		&tau_hat,  &dphi_hat, &gamma_hat);
-
-	// check if frame has been detected
-	if (detected) {
-#if 1
-		cout << endl << endl;
-		cout << "***** Frame detected!"; // %8.4f, dphi-hat:%8.4f, gamma:%8.2f dB\n",
-		cout << "tau-hat: " << setw(8) << setprecision(4) << tau_hat;
-		cout << "dphi-hat: " << dphi_hat;
-		cout << "gamma: " << setprecision(2) << (20 * log10f(gamma_hat)) << " dB" << endl,
-#endif
-		// push buffered samples through synchronizer
-		// NOTE: state will be updated to STATE_RXPREAMBLE internally
-		pushpn();
-	}
+	if (symbols.empty())
+		return;
+	sinkSymbols.emit(symbols, now);
+	symbols.clear();
 }
 
 
@@ -330,17 +336,14 @@ void GMSKDemodulator::execute_rxpreamble(const Complex _x)
 		// save output in p/n symbols buffer
 		preamble_rx[preamble_counter] = mf_out / (float)conf.samples_per_symbol;
 
-		unsigned char s = mf_out > 0.0f ? 1 : 0;
-		cout << s << " ";
+		// the syncword is passed on for the deframer
+		emit_symbol(mf_out > 0.0f ? 1 : 0);
 
 		// update counter
 		preamble_counter++;
 
-		if (preamble_counter == preamble_len) {
-			//syncpn();
-			cout << endl;
+		if (preamble_counter == preamble_len)
 			state = STATE_RXPAYLOAD;
-		}
 	}
 }
 
@@ -354,8 +357,6 @@ void GMSKDemodulator::execute_rxpayload(const Complex _x)
 	// update instantanenous frequency estimate
 	update_fi(y);
 
-	cout << "x ";
-
 	// update symbol synchronizer
 	float mf_out = 0.0f;
 	int sample_available = update_symbol_sync(fi_hat, &mf_out);
@@ -363,21 +364,11 @@ void GMSKDemodulator::execute_rxpayload(const Complex _x)
 	// compute output if timeout
 	if (sample_available) {
 		// demodulate
-		unsigned char s = mf_out > 0.0f ? 1 : 0;
-		cout << s << " ";
-
-		if (state == STATE_RXPREAMBLE) {
-			if (0) { // SymbolSink(s, 0) == 1) {
-				cout << "PRKL\n";
-				state = STATE_HELLO;
-			}
-		}
-		else {
-			if (0) { // SymbolSink(s, 0) == 0) {
-				cout << "reset\n";
-				reset();
-			}
-		}
+		emit_symbol(mf_out > 0.0f ? 1 : 0);
+
+		// give up if the deframer doesn't end the burst
+		if (++payload_counter >= FRAMELEN_MAX)
+			reset();
 	}
 }
 
@@ -385,10 +376,8 @@ void GMSKDemodulator::execute_rxpayload(const Complex _x)
 void GMSKDemodulator::execute_sample(Complex _x)
 {
 	switch (state) {
-	case STATE_DETECTFRAME: return execute_detectframe(_x);
 	case STATE_RXPREAMBLE:  return execute_rxpreamble (_x);
 	case STATE_RXPAYLOAD:   return execute_rxpayload  (_x);
-	case STATE_HELLO:  return execute_rxpayload  (_x);
 	default:;
 		throw SuoError("GMSK fault state");
 	}
@@ -397,29 +386,112 @@ void GMSKDemodulator::execute_sample(Complex _x)
 
 void GMSKDemodulator::sinkSamples(const SampleVector& samples, Timestamp timestamp)
 {
-	/* Allocate small buffers from stack */
-	Sample samples2[resampint];
+	SUO_PROFILE(profile_samples, samples.size());
+
+	/* Collect the decided symbols into a single batch */
+	symbols.clear();
+	symbols.flags = has_timestamp;
+	symbols.symbol_period = symbol_ns;
+
+	const size_t n = samples.size();
+	if (n == 0)
+		return;
+
+	/* Downconvert, decimate and resample the whole block */
+	mixed.resize(n);
+	nco_crcf_mix_block_down(l_nco, const_cast<Sample*>(samples.data()), mixed.data(), n);
+	unsigned int ndecimated = decimator->execute(mixed.data(), n, mixed.data());
+
+	unsigned int nresampled = 0;
+	resampled.resize(ceil(1.1f * ndecimated * conf.symbol_rate * conf.samples_per_symbol / decimator->getOutputRate()) + 4);
+	resamp_crcf_execute_block(l_resamp, mixed.data(), ndecimated, resampled.data(), &nresampled);
+
+	/* The buffered samples precede the new ones */
+	buffer_time = timestamp - buffer.size() * resampled_ns;
+	buffer.insert(buffer.end(), resampled.begin(), resampled.begin() + nresampled);
+
+	const size_t L = correlator->getPreambleLength();
+	const size_t span_len = (preamble_len + m) * conf.samples_per_symbol;
+
+	size_t pos = history;
+	while (pos < buffer.size()) {
+
+		if (state != STATE_DETECTFRAME) {
+			/* Track the burst one sample at a time */
+			sample_time = buffer_time + pos * resampled_ns;
+			execute_sample(buffer[pos++]);
+
+			/*
+			 * Deliver the batch in small pieces so that the deframer's unlock at
+			 * the end of the frame is seen before the rest of the block is consumed,
+			 * and a following burst in the same block is searched for.
+			 */
+			if (symbols.size() >= burst_batch_size)
+				flush_symbols(timestamp);
+			continue;
+		}
 
-	Timestamp sample_ns = roundf(1.0e9f / conf.sample_rate);
+		/* Search the rest of the buffer for the preamble */
+		PreambleCorrelator::Detection det;
+		size_t searched = 0;
+		if (correlator->search(&buffer[pos], buffer.size() - pos, det, searched) == false) {
+			pos += searched;
+			break;
+		}
 
-	size_t si;
-	for(si = 0; si < samples.size(); si++) {
-		unsigned nsamp2 = 0, si2;
-		Sample s = samples[si];
+		/*
+		 * The tracking loops are started from the samples preceding the
+		 * preamble and the detection point one sample past the peak.
+		 */
+		const size_t start = pos + det.offset;
+		const size_t span_end = start + L + 1;
+		if (span_end < span_len) {
+			pos = start + 1; // Not enough history in the beginning of the stream
+			continue;
+		}
+		if (span_end > buffer.size()) {
+			pos = start;
+			break;
+		}
+		const size_t span_begin = span_end - span_len;
 
-		/* Downconvert and resample one input sample at a time */
-		nco_crcf_step(l_nco);
-		nco_crcf_mix_down(l_nco, s, &s);
-		resamp_crcf_execute(l_resamp, s, samples2, &nsamp2);
-		assert(nsamp2 <= resampint);
+		tau_hat = det.tau;
+		dphi_hat = det.dphi;
+		gamma_hat = det.gamma;
 
-		/* Process output from the resampler one sample at a time */
-		for(si2 = 0; si2 < nsamp2; si2++)
-			execute_sample(samples2[si2]);
+		setMetadata.emit(meta::cfo, center_frequency + dphi_hat / pi2f * conf.symbol_rate * conf.samples_per_symbol);
+		setMetadata.emit(meta::rssi, 20.0f * log10f(gamma_hat + 1e-20f));
 
-		timestamp += sample_ns;
+		// push buffered samples through synchronizer
+		// NOTE: state will be updated to STATE_RXPREAMBLE internally
+		pushpn(&buffer[span_begin], buffer_time + span_begin * resampled_ns);
+		pos = span_end;
 	}
 
+	/* Keep the unsearched samples and the history needed by the tracking loops */
+	const size_t warmup = span_len - L;
+	const size_t discard = pos > warmup ? pos - warmup : 0;
+	buffer.erase(buffer.begin(), buffer.begin() + discard);
+	history = pos - discard;
+
+	flush_symbols(timestamp);
+}
+
+
+void GMSKDemodulator::lockReceiver(bool locked, Timestamp now)
+{
+	receiver_lock = locked;
+
+	/* The deframer has received the whole burst */
+	if (locked == false && state != STATE_DETECTFRAME)
+		reset();
+}
+
+
+void GMSKDemodulator::setFrequencyOffset(float frequency_offset)
+{
+	center_frequency = conf.center_frequency + frequency_offset;
+	nco_crcf_set_frequency(l_nco, nco_1Hz * center_frequency);
 }
 
 
@@ -428,4 +500,4 @@ Block* createGMSKDemodulator(const Kwargs &args)
 	return new GMSKDemodulator();
 }
 
-static Registry registerGMSKDemodulator("GMSKDemodulator", &createGMSKDemodulator);
\ No newline at end of file
+static Registry registerGMSKDemodulator("GMSKDemodulator", &createGMSKDemodulator);
@@ -1,12 +1,22 @@
 #pragma once
 
+#include <memory>
+
 #include "suo.hpp"
 #include <liquid/liquid.h>
+#include "modem/discriminator.hpp"
+#include "modem/decimator.hpp"
+#include "modem/preamble_correlator.hpp"
 
 namespace suo {
 
 /*
+ * Burst GMSK demodulator.
  *
+ * The resampled signal is scanned a block at a time for the modulated syncword
+ * with an FFT correlator. Only after a detection the samples are run one at
+ * a time through the carrier and symbol timing tracking loops, starting from
+ * the timing, carrier offset and gain estimated from the preamble.
  */
 class GMSKDemodulator : public Block
 {
@@ -16,7 +26,6 @@ public:
 		STATE_DETECTFRAME = 0, // detect frame (seek p/n sequence)
 		STATE_RXPREAMBLE,	   // receive p/n sequence
 		STATE_RXPAYLOAD,	   // receive payload data
-		STATE_HELLO,
 	};
 
 	/* Configuration struct for the GMSK demod block */
@@ -49,8 +58,12 @@ public:
 		 */
 		float bt;
 
-		unsigned int sync_word;
-		unsigned int sync_len;
+		/* Syncword used as the preamble */
+		unsigned int syncword;
+		unsigned int syncword_len;
+
+		/* Normalized correlation required for the preamble detection (0...1) */
+		float detection_threshold;
 	};
 
 	explicit GMSKDemodulator(const Config& args = Config());
@@ -61,50 +74,67 @@ public:
 
 	void sinkSamples(const SampleVector& samples, Timestamp timestamp);
 	void reset();
+	/* Lock state from the deframer. The batch is flushed every few symbols
+	 * while a burst is tracked, so after the unlock the rest of the sample
+	 * block is searched for the next burst. */
+	void lockReceiver(bool locked, Timestamp now);
 
-	Port<Symbol, Timestamp> SymbolSink;
+	/* Symbols one at a time and as batches of a sample block (a few symbols at a time
+	 * during a burst). Both are emitted whenever they have connections. */
+	Port<Symbol, Timestamp> sinkSymbol;
+	Port<const SymbolVector&, Timestamp> sinkSymbols;
+	Port<MetadataKey, const MetadataValue&> setMetadata;
 
 	void setFrequencyOffset(float frequency_offset);
 
 private:
 
 	int update_symbol_sync(float _x, float *_y);
-	void pushpn();
+	void pushpn(const Sample* rc, Timestamp t0);
 
 	void update_fi(Complex x);
-	void execute_detectframe(const Complex x);
 	void execute_rxpreamble(const Complex x);
 	void execute_rxpayload(const Complex x);
 	void execute_sample(const Complex x);
+	void emit_symbol(Symbol s);
+	void flush_symbols(Timestamp now);
 
 	/* Configuration */
 	Config conf;
 
-	// float resamprate;
-	unsigned int resampint;
-	uint64_t syncmask;
-
 	unsigned int m; // filter semi-length (symbols)
 
-	/* Deframer state */
+	/* Receiver state */
 	State state;
-	uint64_t latest_bits;
-	unsigned framepos, totalbits;
-	bool receiving_frame;
-
-	unsigned int mod_rate;
+	bool receiver_lock;
+	unsigned int payload_counter;
 
 	float nco_1Hz;
 	float center_frequency; // Currently set center frequency
 
+	Timestamp resampled_ns;  // Duration of one resampled sample
+	Timestamp symbol_ns;
+	Timestamp sample_time;   // Timestamp of the sample being processed
+
 	/* liquid-dsp objects */
 	nco_crcf l_nco;
 	resamp_crcf l_resamp;
-	gmskdem l_demod;
+	std::unique_ptr<Decimator> decimator;
+
+	SampleVector mixed;      // Downconverted and decimated input
+	SampleVector resampled;  // Output of the resampler
 
+	/*
+	 * Resampled signal waiting for the preamble search. The first
+	 * history samples have been searched already and are kept to
+	 * warm up the tracking loops after a detection.
+	 */
+	SampleVector buffer;
+	size_t history;
+	Timestamp buffer_time;   // Timestamp of the first sample in the buffer
 
 	float fi_hat;
-	Complex x_prime;
+	FrequencyDiscriminator discriminator;
 
 	// timing recovery objects, states
 	firpfb_rrrf l_mf;  // matched filter decimator
@@ -117,22 +147,23 @@ private:
 	float symsync_out; // symbol synchronizer output
 
 	// synchronizer objects
-	detector_cccf l_frame_detector; // pre-demod detector
+	std::unique_ptr<PreambleCorrelator> correlator; // pre-demod detector
 	float tau_hat;					// fractional timing offset estimate
 	float dphi_hat;					// carrier frequency offset estimate
 	float gamma_hat;				// channel gain estimate
-	windowcf l_buffer;				// pre-demod buffered samples, size: k*(pn_len+m)
 	nco_crcf l_nco_coarse;			// coarse carrier frequency recovery
 
 	unsigned int preamble_counter;
-	float *preamble_pn; // preamble p/n sequence (known)
-	float *preamble_rx; // preamble p/n sequence (received)
+	std::vector<float> preamble_pn; // preamble p/n sequence (known)
+	std::vector<float> preamble_rx; // preamble p/n sequence (received)
 
 	unsigned int preamble_len;
 
-	/* Buffers */
-	Frame* frame;
+	/* Symbols decided from the latest sample vector */
+	SymbolVector symbols;
 
+	/* Profiling */
+	SUO_PROFILE_POINT(profile_samples, "GMSKDemodulator", "sinkSamples");
 };
 
-};
+}; // namespace suo
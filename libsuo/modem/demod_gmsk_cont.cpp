@@ -31,10 +31,14 @@ GMSKContinousDemodulator::Config::Config() {
 
 	symsync_bandwidth0 = 0.01f;
 	symsync_bandwidth1 = 0.01f;
+
+	acquisition_range = 0.0f;
+	acquisition_threshold = 10.0f;
 }
 
 GMSKContinousDemodulator::GMSKContinousDemodulator(const Config& conf) :
-	conf(conf)
+	conf(conf),
+	coarse_offset(0.0f)
 {
 
 
@@ -44,16 +48,41 @@ GMSKContinousDemodulator::GMSKContinousDemodulator(const Config& conf) :
 		throw SuoError("GMSKContinousDemodulator: Center frequency too large for given sample rate!");
 
 
+	if (conf.acquisition_range < 0)
+		throw SuoError("GMSKContinousDemodulator: Negative acquisition range!");
+
+	/* Decimate first to a rate which is still able to hold the signal and the AFC/acquisition range */
+	Decimator::Config decim_conf;
+	decim_conf.sample_rate = conf.sample_rate;
+	decim_conf.output_rate = conf.symbol_rate * conf.samples_per_symbol;
+	decim_conf.bandwidth = 0.75f * conf.symbol_rate + max(0.5f * conf.symbol_rate, conf.acquisition_range);
+	decimator = make_unique<Decimator>(decim_conf);
+
+	/*
+	 * Coarse frequency acquisition:
+	 * Frequency resolution about 1/16 of the symbol rate and the search
+	 * range covering the whole signal at the edge of the acquisition range.
+	 */
+	if (conf.acquisition_range > 0) {
+		FrequencyAcquisition::Config acq_conf;
+		acq_conf.sample_rate = decimator->getOutputRate();
+		acq_conf.fft_length = 64;
+		while (acq_conf.fft_length < 16 * acq_conf.sample_rate / conf.symbol_rate)
+			acq_conf.fft_length *= 2;
+		acq_conf.num_averages = 4;
+		acq_conf.search_range = conf.acquisition_range + 0.75f * conf.symbol_rate;
+		acq_conf.threshold = conf.acquisition_threshold;
+		acquisition = make_unique<FrequencyAcquisition>(acq_conf);
+	}
+
 	/* Configure a resampler for a fixed oversampling ratio */
-	float resamprate = conf.symbol_rate * conf.samples_per_symbol / conf.sample_rate;
+	resamprate = conf.symbol_rate * conf.samples_per_symbol / decimator->getOutputRate();
 	double bw = 0.75 * resamprate / conf.samples_per_symbol;
 	int semilen = lroundf(1.0f / bw);
 	l_resamp = resamp_crcf_create(resamprate, semilen, bw, 60.0f, 16);
 
-	/* Calculate maximum number of output samples after feeding one sample
-	 * to the resampler. This is needed to allocate a big enough array. */
-	resampint = ceil(1 / resamprate);
 	sample_ns = round(1.0e9 / conf.sample_rate);
+	symbol_ns = round(1.0e9 / conf.symbol_rate);
 
 	/* 
 	 * NCO:
@@ -66,17 +95,15 @@ GMSKContinousDemodulator::GMSKContinousDemodulator(const Config& conf) :
 
 
 	/*
-	 * AGC: Automatic gain control
+	 * RSSI: Exponentially windowed mean power of the resampled signal.
+	 * The background estimate is frozen while the receiver is locked.
 	 */
-	l_agc = agc_crcf_create();
-	agc_crcf_set_bandwidth(l_agc, conf.agc_bandwidth0 / conf.samples_per_symbol);
-	//agc_crcf_set_gain_limits(l_agc, 1e-2f, 1e2f);
-	l_bg_agc = agc_crcf_create();
-	agc_crcf_set_bandwidth(l_bg_agc, 2e-3f / conf.samples_per_symbol);
+	rssi_bandwidth = conf.agc_bandwidth0 / conf.samples_per_symbol;
 
 
 	float kf = 0.01 * conf.samples_per_symbol;
 	k_ref = 1.0f / (2 * M_PI * kf);
+	discriminator.setGain(k_ref);
 
 	/* 
 	 * Symbol synchronizer:
@@ -87,20 +114,32 @@ GMSKContinousDemodulator::GMSKContinousDemodulator(const Config& conf) :
 	l_symsync = symsync_rrrf_create_rnyquist(LIQUID_FIRFILT_GMSKRX, conf.samples_per_symbol, conf.filter_delay, conf.bt, 16);
 	symsync_rrrf_set_lf_bw(l_symsync, conf.symsync_bandwidth0 / conf.samples_per_symbol);
 
+	mixed.reserve(4096);
+	resampled.reserve(4096);
+	freq.reserve(4096);
+	synced.reserve(1024);
+	symbols.reserve(1024);
 	reset();
 }
 
 
 GMSKContinousDemodulator::~GMSKContinousDemodulator()
 {
-	agc_crcf_destroy(l_agc);
+	nco_crcf_destroy(l_nco);
+	resamp_crcf_destroy(l_resamp);
 	symsync_rrrf_destroy(l_symsync);
 }
 
 
 void GMSKContinousDemodulator::reset() {
-	x_prime = 0.0f;
+	discriminator.reset();
+	signal_power = 0.0f;
+	bg_power = 0.0f;
+	coarse_offset = 0.0f;
+	if (acquisition)
+		acquisition->reset();
 	nco_crcf_set_frequency(l_nco, nco_1Hz * (conf.center_frequency + conf.frequency_offset));
+	update_nco();
 	receiver_lock = false;
 }
 
@@ -110,7 +149,7 @@ void GMSKContinousDemodulator::update_nco()
 	conf_dirty = false;
 
 	// Calclate new frequency limits
-	float center_frequency = (conf.center_frequency + conf.frequency_offset);
+	float center_frequency = (conf.center_frequency + conf.frequency_offset + coarse_offset);
 	freq_min = nco_1Hz * (center_frequency - 0.5f * conf.symbol_rate);
 	freq_max = nco_1Hz * (center_frequency + 0.5f * conf.symbol_rate);
 
@@ -125,122 +164,142 @@ void GMSKContinousDemodulator::update_nco()
 }
 
 
-void GMSKContinousDemodulator::sinkSamples(const SampleVector& samples, Timestamp now)
+void GMSKContinousDemodulator::updateRSSI(float power, size_t n)
 {
+	/* Equivalent of n single-pole averaging steps with the same mean power */
+	float alpha = 1.0f - powf(1.0f - rssi_bandwidth, n);
+	signal_power += alpha * (power - signal_power);
+	if (receiver_lock == false) {
+		float bg_alpha = 1.0f - powf(1.0f - 2e-3f / conf.samples_per_symbol, n);
+		bg_power += bg_alpha * (power - bg_power);
+	}
+}
 
-	/* Allocate small buffers from stack */
-	Sample samples2[resampint];
 
-	if (conf_dirty && receiver_lock == false)
-		update_nco();
-	
-	float d_hat;
-	size_t symbol_phase = 0;
-	Sample null;
+void GMSKContinousDemodulator::seedFrequency(float offset)
+{
+	/* Jump directly to the acquired frequency and center the PLL range around it */
+	coarse_offset = clamp(offset, -conf.acquisition_range, conf.acquisition_range);
+	nco_crcf_set_frequency(l_nco, nco_1Hz * (conf.center_frequency + conf.frequency_offset + coarse_offset));
+	update_nco();
+}
 
 
-	for (size_t si = 0; si < samples.size(); si++) {
-		unsigned nsamp2 = 0, si2;
-		Sample s = samples[si];
+void GMSKContinousDemodulator::sinkSamples(const SampleVector& samples, Timestamp now)
+{
+	SUO_PROFILE(profile_samples, samples.size());
+	demodulate(samples, now);
 
+	if (sinkSymbol.has_connections()) {
+		for (size_t i = 0; i < symbols.size(); i++)
+			sinkSymbol.emit(symbols[i], symbols.symbol_time(i));
+	}
 
-		/* Downconvert and resample one input sample at a time */
-		nco_crcf_step(l_nco);
-		nco_crcf_mix_down(l_nco, s, &s);
-		resamp_crcf_execute(l_resamp, s, samples2, &nsamp2);
+	if (sinkSymbols.has_connections() && symbols.empty() == false)
+		sinkSymbols.emit(symbols, now);
+}
 
-		/* Process output from the resampler one sample at a time */
-		for(si2 = 0; si2 < nsamp2; si2++) {
-			Sample s2 = samples2[si2];
+void GMSKContinousDemodulator::demodulate(const SampleVector& samples, Timestamp now)
+{
+	if (conf_dirty && receiver_lock == false)
+		update_nco();
 
-			/* Update AGC just to track RSSI's */
-			agc_crcf_execute(l_bg_agc, s2, &null);
-			agc_crcf_execute(l_agc, s2, &null);
+	/* Collect the decided symbols into a single batch */
+	symbols.clear();
+	symbols.flags = has_timestamp;
+	symbols.symbol_period = symbol_ns;
 
-#if 1
-			/*  */
-			float phase_error = arg(conj(x_primee) * s2) * k_ref;
-			x_primee = s2;
-			nco_crcf_mix_up(l_nco, x_primee, &x_primee);
-			nco_crcf_pll_step(l_nco, phase_error);
-			nco_crcf_mix_down(l_nco, x_primee, &x_primee);
-#else
-			/* Update PLL feedback (Costas loop for QPSK) */
-			//float phase_error = copysign(s2.imag(), s2.real()) - copysign(s2.real(), s2.imag());
-			//float phase_error = s2.real() * s2.imag();
-			float phase_error = (s2 * conj(x_primee)).imag();
-			x_primee = s2;
-			nco_crcf_pll_step(l_nco, -100* phase_error);
-#endif
+	const unsigned int n = samples.size();
+	if (n == 0)
+		return;
 
-			/* Clamp the PLL frequency between min and max */
-			float freq = nco_crcf_get_frequency(l_nco);
-			if (freq > freq_max)
-				nco_crcf_set_frequency(l_nco, freq_max);
-			if (freq < freq_min)
-				nco_crcf_set_frequency(l_nco, freq_min);
+	/* Stage 1: Downconvert the whole block */
+	mixed.resize(n);
+	nco_crcf_mix_block_down(l_nco, const_cast<Sample*>(samples.data()), mixed.data(), n);
+
+	/* Stage 2: Decimate and resample to samples_per_symbol */
+	unsigned int ndecimated = decimator->execute(mixed.data(), n, mixed.data());
+
+	/*
+	 * Coarse acquisition: Retune if the spectrum shows the signal further
+	 * away than the PLL would comfortably pull in.
+	 */
+	if (acquisition && receiver_lock == false && acquisition->execute(mixed.data(), ndecimated)) {
+		float nco_offset = nco_crcf_get_frequency(l_nco) / nco_1Hz - (conf.center_frequency + conf.frequency_offset);
+		float offset = nco_offset + acquisition->getFrequency();
+		if (abs(offset - nco_offset) > 0.125f * conf.symbol_rate) {
+			seedFrequency(offset);
+			acquisition->reset();
+		}
+	}
 
+	unsigned int nresampled = 0;
+	resampled.resize(ceil(1.1f * ndecimated * resamprate) + 4);
+	resamp_crcf_execute_block(l_resamp, mixed.data(), ndecimated, resampled.data(), &nresampled);
+	resampled.resize(nresampled);
 
-			/* Quadrature FM-demodulation */
-			float phi = arg(conj(x_prime) * s2) * k_ref;
-			x_prime = s2;
+	/* Stage 3: Quadrature FM-demodulation and mean power of the block */
+	freq.resize(nresampled);
+	discriminator.execute(resampled.data(), nresampled, freq.data());
 
-			/* Run symbols synchronization.
-			 * This has also gaussian undistortion and decimation */
-			float synced_symbol;
-			unsigned int output_symbols = 0;
-			symsync_rrrf_execute(l_symsync, &phi, 1, &synced_symbol, &output_symbols);
+	float power = 0.0f, freq_error = 0.0f;
+	for (unsigned int i = 0; i < nresampled; i++) {
+		freq_error += freq[i];
+		power += norm(resampled[i]);
+	}
+	if (nresampled > 0)
+		updateRSSI(power / nresampled, nresampled);
 
-			if (output_symbols == 0)
-				continue;
+	/*
+	 * Frequency tracking: The discriminator output is the PLL error.
+	 * Feeding the error sum once per block is equal to stepping the loop
+	 * after every sample with the NCO correction delayed to the next block.
+	 */
+	nco_crcf_pll_step(l_nco, freq_error);
 
-			assert(output_symbols == 1);
+	/* Clamp the PLL frequency between min and max */
+	float nco_freq = nco_crcf_get_frequency(l_nco);
+	if (nco_freq > freq_max)
+		nco_crcf_set_frequency(l_nco, freq_max);
+	if (nco_freq < freq_min)
+		nco_crcf_set_frequency(l_nco, freq_min);
 
-		
-			/* Process one output symbol from synchronizer */
-			Timestamp symbol_time = now + si * sample_ns;
-			//now -= conf.filter_delay * resampint; // or / resamprate
-
-			Symbol decision = (synced_symbol >= 0) ? 1 : 0;
-			//cout << (int)decision << " ";
-			sinkSymbol.emit(decision, symbol_time);
-
-			//SoftSymbol soft_bit = synced_symbol;
-			//sinkSoftSymbol.emit
-
-#if 0
-			//SinkSymbol(decision, timestamp)) {
-			if (0) { 
-				receiver_lock = true;
-			}
-			else {
-				/* No sync, no lock */
-				receiver_lock = false;
-			}
-#endif
+	/* Stage 4: Symbol synchronization.
+	 * This has also gaussian undistortion and decimation */
+	unsigned int nsynced = 0;
+	synced.resize(nresampled + 1);
+	symsync_rrrf_execute(l_symsync, freq.data(), nresampled, synced.data(), &nsynced);
 
-		}
-	}
+	/* 
+	 * Decide the symbols. The exact sampling instants are not tracked
+	 * inside the block so the symbols are timestamped backwards from the
+	 * end of the block at the symbol rate.
+	 */
+	Timestamp block_end = now + n * sample_ns;
+	if (nsynced > 0)
+		symbols.timestamp = block_end - nsynced * symbol_ns;
+	for (unsigned int i = 0; i < nsynced; i++)
+		symbols.push_back((synced[i] >= 0) ? 1 : 0);
 }
 
 void GMSKContinousDemodulator::lockReceiver(bool locked, Timestamp now) {
 	receiver_lock = locked;
 	if (locked) {
 		
-		setMetadata.emit("cfo", nco_crcf_get_frequency(l_nco) / nco_1Hz);
-		setMetadata.emit("rssi", agc_crcf_get_rssi(l_agc));
-		setMetadata.emit("bg_rssi", agc_crcf_get_rssi(l_bg_agc));
+		setMetadata.emit(meta::cfo, nco_crcf_get_frequency(l_nco) / nco_1Hz);
+		setMetadata.emit(meta::rssi, 10.0f * log10f(signal_power + 1e-20f));
+		setMetadata.emit(meta::bg_rssi, 10.0f * log10f(bg_power + 1e-20f));
+		if (acquisition)
+			setMetadata.emit(meta::cfo_coarse, coarse_offset);
 
 		symsync_rrrf_set_lf_bw(l_symsync, conf.symsync_bandwidth1 / conf.samples_per_symbol);
 		nco_crcf_pll_set_bandwidth(l_nco, conf.pll_bandwidth1 * nco_1Hz);
-		agc_crcf_set_bandwidth(l_agc, conf.agc_bandwidth1 / conf.samples_per_symbol);
-		agc_crcf_lock(l_bg_agc);
+		rssi_bandwidth = conf.agc_bandwidth1 / conf.samples_per_symbol;
 	}
 	else {
 		symsync_rrrf_set_lf_bw(l_symsync, conf.symsync_bandwidth0 / conf.samples_per_symbol);
 		nco_crcf_pll_set_bandwidth(l_nco, conf.pll_bandwidth0 * nco_1Hz);
-		agc_crcf_set_bandwidth(l_agc, conf.agc_bandwidth0 / conf.samples_per_symbol);
-		agc_crcf_unlock(l_bg_agc);
+		rssi_bandwidth = conf.agc_bandwidth0 / conf.samples_per_symbol;
 	}
 }
 
@@ -1,7 +1,12 @@
 #pragma once
 
+#include <memory>
+
 #include "suo.hpp"
 #include <liquid/liquid.h>
+#include "modem/discriminator.hpp"
+#include "modem/decimator.hpp"
+#include "modem/frequency_acquisition.hpp"
 #include "plotter.hpp"
 
 namespace suo {
@@ -52,11 +57,25 @@ public:
 		float pll_bandwidth0;
 		float pll_bandwidth1;
 
+		/*
+		 * RSSI averaging bandwidth (normalized to the symbol rate)
+		 * before and after the receiver lock.
+		 */
 		float agc_bandwidth0;
 		float agc_bandwidth1;
 
 		float symsync_bandwidth0;
 		float symsync_bandwidth1;
+
+		/*
+		 * Coarse frequency acquisition range around the center frequency (Hz).
+		 * When non-zero, the NCO is retuned from the averaged spectrum
+		 * of the decimated signal while the receiver is not locked.
+		 */
+		float acquisition_range;
+
+		/* Required signal to noise floor ratio in the spectrum for the acquisition (dB) */
+		float acquisition_threshold;
 	};
 
 	GMSKContinousDemodulator(const Config& conf = Config());
@@ -69,43 +88,81 @@ public:
 	void reset();
 
 	void sinkSamples(const SampleVector& samples, Timestamp timestamp);
+
+	/*
+	 * Static Pipeline stage: The decided symbols are passed one by one to
+	 * next(), so a static deframer stage is inlined into the symbol loop.
+	 */
+	template <typename Next>
+	void process(const SampleVector& samples, Timestamp now, Next&& next) {
+		SUO_PROFILE(profile_samples, samples.size());
+		demodulate(samples, now);
+		for (size_t i = 0; i < symbols.size(); i++)
+			next(symbols[i], symbols.symbol_time(i));
+	}
+
+	/* Lock state from the deframer. When called while a batch is being
+	 * delivered, the new loop bandwidths apply from the next sample block. */
 	void lockReceiver(bool locked, Timestamp now);
 
+	/* Decided symbols of each sample block as one batch from sinkSymbols and
+	 * one by one from sinkSymbol. Both are emitted whenever they have connections. */
 	Port<Symbol, Timestamp> sinkSymbol;
+	Port<const SymbolVector&, Timestamp> sinkSymbols;
 	Port<SoftSymbol, Timestamp> sinkSoftSymbol;
-	Port<const std::string&, const MetadataValue&> setMetadata;
+	Port<MetadataKey, const MetadataValue&> setMetadata;
 
 	void setFrequency(float frequency);
 	void setFrequencyOffset(float frequency_offset);
 
 
 private:
+	/* Demodulate a sample block to the symbols batch */
+	void demodulate(const SampleVector& samples, Timestamp now);
 	void update_nco();
+	void updateRSSI(float power, size_t n);
+	void seedFrequency(float offset);
 
 	/* Configuration */
 	Config conf;
 	bool conf_dirty;
 
-	// float resamprate;
+	float resamprate;
 	Timestamp sample_ns;
-	unsigned resampint;
+	Timestamp symbol_ns;
 	float nco_1Hz;
 	bool receiver_lock;
 
-	Sample x_prime, x_primee;
 	float freq_min, freq_max;
 	float k_ref;
 
+	/* Windowed power estimates for RSSI */
+	float rssi_bandwidth;
+	float signal_power, bg_power;
+
+	/* Integer decimation ahead of the resampler */
+	std::unique_ptr<Decimator> decimator;
+
+	/* Coarse frequency acquisition and the acquired offset from the center frequency (Hz) */
+	std::unique_ptr<FrequencyAcquisition> acquisition;
+	float coarse_offset;
+
 	/* liquid-dsp objects */
 	nco_crcf l_nco;
 	resamp_crcf l_resamp;
 	symsync_rrrf l_symsync;
-	agc_crcf l_agc;
-	agc_crcf l_bg_agc;
 
-	/* Buffers */
-	Frame* frame;
+	FrequencyDiscriminator discriminator;
+
+	/* Buffers for the processing stages */
+	SampleVector mixed;         // Downconverted input samples
+	SampleVector resampled;     // Samples after resampling to samples_per_symbol
+	std::vector<float> freq;    // Discriminator output
+	std::vector<float> synced;  // Symbol synchronizer output
+	SymbolVector symbols;       // Symbols decided from the latest sample vector
 
+	/* Profiling */
+	SUO_PROFILE_POINT(profile_samples, "GMSKContinousDemodulator", "sinkSamples");
 };
 
 }; // namespace suo
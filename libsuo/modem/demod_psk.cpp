@@ -1,8 +1,11 @@
+
 #include <string>
-#include <assert.h>
+#include <cassert>
 #include <iostream>
+#include <algorithm> // clamp
 
 #include "modem/demod_psk.hpp"
+#include "modem/discriminator.hpp"
 #include "registry.hpp"
 
 
@@ -19,206 +22,325 @@ https://github.com/jgaeddert/liquid-dsp/blob/master/examples/symsync_crcf_exampl
 */
 
 PSKDemodulator::Config::Config() {
-	center_frequency = 100;
+	sample_rate = 1e6;
+	symbol_rate = 9600;
+	center_frequency = 100e3;
+	frequency_offset = 0.0f;
+	maximum_frequency_offset = 1000.0f;
+	bits_per_symbol = 1;
+	differential = false;
 	samples_per_symbol = 4;
 	filter_delay = 5;
-	bt = 0.3;
+	bt = 0.5;
+
+	agc_bandwidth0 = 5e-2f;
+	agc_bandwidth1 = 1e-2f;
+
+	afc_speed0 = 5e-2f;
+	afc_speed1 = 5e-3f;
+
+	symsync_bw0 = 0.02f;
+	symsync_bw1 = 0.005f;
+}
+
+
+/*
+ * Mix the samples down to baseband with a phasor recursion.
+ * Eight phasors are advanced together so that the loop vectorizes.
+ * The phasors are recalculated every 1024 samples to keep the amplitude
+ * and phase errors from accumulating.
+ */
+static void mix_down(const Sample* in, size_t n, Sample* out, double& phase, double frequency)
+{
+	const float* x = reinterpret_cast<const float*>(in);
+	float* y = reinterpret_cast<float*>(out);
+	const float rot_re = cos(8 * frequency), rot_im = -sin(8 * frequency);
+
+	size_t i = 0;
+	while (i < n) {
+		const size_t len = min<size_t>(n - i, 1024);
+
+		float re[8], im[8];
+		for (unsigned int k = 0; k < 8; k++) {
+			re[k] = cos(phase + k * frequency);
+			im[k] = -sin(phase + k * frequency);
+		}
+
+		size_t j = 0;
+		for (; j + 8 <= len; j += 8) {
+			const float* xs = x + 2 * (i + j);
+			float* ys = y + 2 * (i + j);
+			for (unsigned int k = 0; k < 8; k++) {
+				const float a = xs[2 * k], b = xs[2 * k + 1];
+				ys[2 * k] = a * re[k] - b * im[k];
+				ys[2 * k + 1] = a * im[k] + b * re[k];
+			}
+			for (unsigned int k = 0; k < 8; k++) {
+				const float r = re[k] * rot_re - im[k] * rot_im;
+				im[k] = re[k] * rot_im + im[k] * rot_re;
+				re[k] = r;
+			}
+		}
+
+		for (unsigned int k = 0; j < len; j++, k++) {
+			const float a = x[2 * (i + j)], b = x[2 * (i + j) + 1];
+			y[2 * (i + j)] = a * re[k] - b * im[k];
+			y[2 * (i + j) + 1] = a * im[k] + b * re[k];
+		}
+
+		phase = fmod(phase + len * frequency, 2 * M_PI);
+		i += len;
+	}
 }
 
 
 PSKDemodulator::PSKDemodulator(const Config& conf) :
 	conf(conf)
 {
+	if (conf.bits_per_symbol < 1 || conf.bits_per_symbol > 3)
+		throw SuoError("PSKDemodulator: Unsupported bits per symbol %u", conf.bits_per_symbol);
+
+	modulation_order = 1 << conf.bits_per_symbol;
+
+	/* The PSKModulator encodes only BPSK differentially */
+	if (conf.differential && modulation_order != 2)
+		throw SuoError("PSKDemodulator: Differential decoding supports only BPSK");
 
-	float signal_bandwidth = conf.symbol_rate; // [Hz]   For BPSK!!!
-	if ((abs(conf.center_frequency) + 0.5 * signal_bandwidth) / conf.sample_rate > 0.5)
+	const float signal_bandwidth = (1.0f + conf.bt) * conf.symbol_rate; // [Hz]
+	if ((abs(conf.center_frequency) + 0.5 * signal_bandwidth + conf.maximum_frequency_offset) / conf.sample_rate > 0.5)
 		throw SuoError("PSKDemodulator: Center frequency too large for given sample rate!");
 
+	/* Decimate first to a rate which is still able to hold the signal and the frequency offset */
+	Decimator::Config decim_conf;
+	decim_conf.sample_rate = conf.sample_rate;
+	decim_conf.output_rate = conf.symbol_rate * conf.samples_per_symbol;
+	decim_conf.bandwidth = 0.5f * signal_bandwidth + conf.maximum_frequency_offset;
+	decimator = make_unique<Decimator>(decim_conf);
+
 	/* Configure a resampler for a fixed oversampling ratio */
-	float resamprate = conf.symbol_rate * conf.samples_per_symbol / conf.sample_rate;
-	double bw = 0.4 * resamprate / conf.samples_per_symbol;
+	resamprate = conf.symbol_rate * conf.samples_per_symbol / decimator->getOutputRate();
+	double bw = decim_conf.bandwidth / decimator->getOutputRate();
 	int semilen = lroundf(1.0f / bw);
 	l_resamp = resamp_crcf_create(resamprate, semilen, bw, 60.0f, 16);
-	resamp_crcf_print(l_resamp);
-
-	/* Calculate maximum number of output samples after feeding one sample
-	 * to the resampler. This is needed to allocate a big enough array. */
-	resampint = ceilf(1 / resamprate);
-	sample_ns = roundf(1.0e9 / conf.sample_rate);
 
-	/* NCO:
-	 * Limit AFC range to half of symbol rate to keep it
-	 * from wandering too far */
+	sample_ns = round(1.0e9 / conf.sample_rate);
+	symbol_ns = round(1.0e9 / conf.symbol_rate);
 	nco_1Hz = pi2f / conf.sample_rate;
-	l_nco = nco_crcf_create(LIQUID_NCO);
-	nco_crcf_pll_set_bandwidth(l_nco, 0.5 * nco_1Hz);
-	update_nco();
 
+	/* Costas loop frequency is limited to the maximum frequency offset */
+	max_costas_frequency = pi2f * conf.maximum_frequency_offset / conf.symbol_rate;
 
 	/*
-	 * AGC: Automatic gain control
+	 * Symbol synchronizer:
+	 * - Root raised cosine matched filter
+	 * - Polyphase filter bank for the symbol timing recovery
+	 * - Decimates to symbol rate
 	 */
-	l_agc = agc_crcf_create();
-	agc_crcf_set_bandwidth(l_agc, 1e-3f);
-	//agc_crcf_set_gain_limits(l_agc, 1e-2f, 1e2f);
-
-	l_demod_delay = windowcf_create(4 * conf.samples_per_symbol);
-
-
-	l_mod = modem_create(LIQUID_MODEM_PSK2);
-
-	/* Symbol synchroniser */
-	unsigned int m = 5;                 // filter delay (symbols)
-	float        beta = 0.5f;           // filter excess bandwidth factor
-	unsigned int num_filters = 32;      // number of filters in the bank
-	unsigned int num_symbols = 400;     // number of data symbols
-
-	l_sync = symsync_crcf_create_rnyquist(LIQUID_FIRFILT_ARKAISER,
-		conf.samples_per_symbol, m, beta, num_filters);
-
-	symsync_crcf_set_lf_bw(l_sync, conf.symsync_bw0); // loop filter bandwidth
+	l_sync = symsync_crcf_create_rnyquist(LIQUID_FIRFILT_RRC, conf.samples_per_symbol, conf.filter_delay, conf.bt, 32);
 
+	mixed.reserve(4096);
+	resampled.reserve(4096);
+	synced.reserve(1024);
+	symbols.reserve(1024);
 	reset();
 }
 
 
 PSKDemodulator::~PSKDemodulator()
 {
-	agc_crcf_destroy(l_agc);
+	resamp_crcf_destroy(l_resamp);
 	symsync_crcf_destroy(l_sync);
-	windowcf_destroy(l_demod_delay);
-	modemcf_destroy(l_mod);
 }
 
 
 void PSKDemodulator::reset() {
-	agc_crcf_reset(l_agc);
-	nco_crcf_reset(l_nco);
+	decimator->reset();
+	resamp_crcf_reset(l_resamp);
+	symsync_crcf_reset(l_sync);
+
+	mixer_phase = 0.0;
+	mixer_frequency = nco_1Hz * (conf.center_frequency + conf.frequency_offset);
+	conf_dirty = false;
+
+	costas_phase = 0.0f;
+	costas_frequency = 0.0f;
+	previous_point = 0;
+	symbol_power = 0.0f;
+	signal_power = 0.0f;
+	bg_power = 0.0f;
+
+	lockReceiver(false, 0);
 }
 
 
 void PSKDemodulator::update_nco()
 {
 	conf_dirty = false;
+	mixer_frequency = nco_1Hz * (conf.center_frequency + conf.frequency_offset);
+}
+
 
-	// Calclate new frequency limits
-	float center_frequency = (conf.center_frequency + conf.frequency_offset);
-	freq_min = nco_1Hz * (center_frequency - 0.5f * conf.symbol_rate);
-	freq_max = nco_1Hz * (center_frequency + 0.5f * conf.symbol_rate);
-
-#if 1
-	// Clamp the NCO frequency between new limits
-	float old_freq = nco_crcf_get_frequency(l_nco);
-	nco_crcf_set_frequency(l_nco, clamp(old_freq, freq_min, freq_max));
-#else
-	// Set new NCO frequency 
-	nco_crcf_set_frequency(l_nco, nco_1Hz * center_frequency);
-#endif
+void PSKDemodulator::updateRSSI(float power, size_t n)
+{
+	/* Equivalent of n single-pole averaging steps with the same mean power */
+	float alpha = 1.0f - powf(1.0f - rssi_bandwidth, n);
+	signal_power += alpha * (power - signal_power);
+	if (receiver_lock == false) {
+		float bg_alpha = 1.0f - powf(1.0f - 2e-3f / conf.samples_per_symbol, n);
+		bg_power += bg_alpha * (power - bg_power);
+	}
 }
 
 
-void PSKDemodulator::sinkSamples(const SampleVector& samples, Timestamp timestamp)
+void PSKDemodulator::setLoopBandwidth(float bandwidth)
 {
-	float phase_error;
-	
-	/* Allocate small buffers from stack */
-	Sample samples2[resampint];
+	/* Second order loop filter with critical damping */
+	const float zeta = 0.7071f;
+	float theta = bandwidth / (zeta + 0.25f / zeta);
+	float d = 1.0f + 2.0f * zeta * theta + theta * theta;
+	costas_alpha = 4.0f * zeta * theta / d;
+	costas_beta = 4.0f * theta * theta / d;
+}
 
-	if (conf_dirty && receiver_lock == false)
-		update_nco();
 
-	size_t si;
-	for (si = 0; si < samples.size(); si++) {
-		unsigned nsamp2 = 0, si2;
-		Sample s = samples[si];
-
-		/* Downconvert and resample one input sample at a time */
-		nco_crcf_step(l_nco);
-		nco_crcf_mix_down(l_nco, s, &s);
-
-		Sample r, x_hat;
-
-		enum CostasLoopOrder pll_order = CostasLoopBPSK;
-		const float k = sqrt(2.f) - 1.f;
-
-		switch(pll_order) {
-		case CostasLoopBPSK:
-			phase_error = r.real() * r.imag();
-			break;
-
-		case CostasLoopQPSK:
-		case CostasLoopGMSK:
-			phase_error = copysign(r.imag(), r.real()) - copysign(r.real(), r.imag());
-			break;
-
-		case CostasLoop8PSK:
-			if (abs(r.real()) >= abs(r.imag()))
-				phase_error = copysign(r.imag(), r.real()) - k * copysign(r.real(), r.imag());
-			else
-				phase_error = k * copysign(r.imag(), r.real()) - copysign(r.real(), r.imag());
-			break;
-			
-		default:
-			//phase_error = arg(r * conj(x_hat)); // FM demod
-			phase_error = (r * conj(x_hat)).imag(); // Dunno: modemcf_get_demodulator_phase_error
-			break;
+void PSKDemodulator::costasLoop(const Sample* in, size_t n, Timestamp block_end)
+{
+	const unsigned int M = modulation_order;
+	const float point_angle = pi2f / M;
+	const Timestamp bit_ns = symbol_ns / conf.bits_per_symbol;
+
+	for (size_t i = 0; i < n; i++) {
+
+		/* Normalize the symbol amplitude */
+		float power = norm(in[i]);
+		if (symbol_power == 0.0f)
+			symbol_power = power;
+		symbol_power += agc_bandwidth * (power - symbol_power);
+		const float gain = 1.0f / sqrtf(symbol_power + 1e-20f);
+
+		/* Remove the tracked carrier phase */
+		Sample y = in[i] * gain;
+		const float c = cosf(costas_phase), s = sinf(costas_phase);
+		y = Sample(y.real() * c + y.imag() * s, y.imag() * c - y.real() * s);
+
+		/* Decide the nearest constellation point */
+		const int k = lroundf(fast_atan2f(y.imag(), y.real()) / point_angle);
+		const unsigned int point = (k + M) % M;
+
+		/* Decision-directed phase error: Im(y * conj(decided point)) */
+		const float dc = cosf(k * point_angle), ds = sinf(k * point_angle);
+		const float error = clamp(y.imag() * dc - y.real() * ds, -1.0f, 1.0f);
+
+		costas_frequency = clamp(costas_frequency + costas_beta * error, -max_costas_frequency, max_costas_frequency);
+		costas_phase += costas_frequency + costas_alpha * error;
+		if (costas_phase > pi2f)
+			costas_phase -= pi2f;
+		else if (costas_phase < -pi2f)
+			costas_phase += pi2f;
+
+		/* Differential decoding and Gray coding */
+		unsigned int symbol = point;
+		if (conf.differential) {
+			symbol = (point + M - previous_point) % M;
+			previous_point = point;
+		}
+		symbol ^= symbol >> 1;
+
+		/* Output the bits MSB first */
+		const Timestamp symbol_time = block_end - (n - i) * symbol_ns;
+		for (unsigned int b = 0; b < conf.bits_per_symbol; b++) {
+			const Symbol bit = (symbol >> (conf.bits_per_symbol - 1 - b)) & 1;
+			if (symbols.empty())
+				symbols.timestamp = symbol_time + b * bit_ns;
+			symbols.push_back(bit);
 		}
+	}
+}
+
 
-		nco_crcf_pll_step(l_nco, -phase_error);
+void PSKDemodulator::sinkSamples(const SampleVector& samples, Timestamp now)
+{
+	SUO_PROFILE(profile_samples, samples.size());
+	demodulate(samples, now);
 
-		/* Clamp the PLL frequency between min and max */
-		float freq = nco_crcf_get_frequency(l_nco);
-		if (freq > freq_max)
-			nco_crcf_set_frequency(l_nco, freq_max);
-		if (freq < freq_min)
-			nco_crcf_set_frequency(l_nco, freq_min);
+	if (sinkSymbol.has_connections()) {
+		for (size_t i = 0; i < symbols.size(); i++)
+			sinkSymbol.emit(symbols[i], symbols.symbol_time(i));
+	}
 
+	if (sinkSymbols.has_connections() && symbols.empty() == false)
+		sinkSymbols.emit(symbols, now);
+}
 
-		resamp_crcf_execute(l_resamp, s, samples2, &nsamp2);
 
-		/* Process output from the resampler one sample at a time */
-		for(si2 = 0; si2 < nsamp2; si2++) {
-			Sample s2 = samples2[si2];
+void PSKDemodulator::demodulate(const SampleVector& samples, Timestamp now)
+{
+	if (conf_dirty && receiver_lock == false)
+		update_nco();
 
-			/* AGC */
-			agc_crcf_execute(l_agc, s2, &s2);
+	/* Collect the decided bits into a single batch */
+	symbols.clear();
+	symbols.flags = has_timestamp;
+	symbols.symbol_period = symbol_ns / conf.bits_per_symbol;
 
+	const unsigned int n = samples.size();
+	if (n == 0)
+		return;
 
-			/* Run symbols sync */
-			Complex synced_symbols[4];
-			unsigned int output_symbols = 0;
-			symsync_crcf_execute(l_sync, &s2, 1, synced_symbols, &output_symbols);
-			//symsync_crcf_step(l_sync, s2, synced_symbols, &output_symbols);
+	/* Stage 1: Downconvert the whole block */
+	mixed.resize(n);
+	mix_down(samples.data(), n, mixed.data(), mixer_phase, mixer_frequency);
 
-			Sample s3 = synced_symbols[0];
-			
+	/* Stage 2: Decimate and resample to samples_per_symbol */
+	unsigned int ndecimated = decimator->execute(mixed.data(), n, mixed.data());
 
+	unsigned int nresampled = 0;
+	resampled.resize(ceil(1.1f * ndecimated * resamprate) + 4);
+	resamp_crcf_execute_block(l_resamp, mixed.data(), ndecimated, resampled.data(), &nresampled);
+	resampled.resize(nresampled);
 
-		}
-		timestamp += sample_ns;
-	}
+	float power = 0.0f;
+	for (unsigned int i = 0; i < nresampled; i++)
+		power += norm(resampled[i]);
+	if (nresampled > 0)
+		updateRSSI(power / nresampled, nresampled);
+
+	/* Stage 3: Matched filtering, symbol timing recovery and decimation to the symbol rate */
+	unsigned int nsynced = 0;
+	synced.resize(nresampled + 1);
+	symsync_crcf_execute(l_sync, resampled.data(), nresampled, synced.data(), &nsynced);
+
+	/*
+	 * Stage 4: Carrier recovery and decisions.
+	 * The exact sampling instants are not tracked inside the block so the symbols
+	 * are timestamped backwards from the end of the block at the symbol rate.
+	 */
+	costasLoop(synced.data(), nsynced, now + n * sample_ns);
 }
 
 
 void PSKDemodulator::lockReceiver(bool locked, Timestamp now) {
 	receiver_lock = locked;
-#if 0
 	if (locked) {
-		setMetadata.emit("cfo", nco_crcf_get_frequency(l_nco) / nco_1Hz);
-		setMetadata.emit("rssi", agc_crcf_get_rssi(l_agc));
-
-		// Sync acquired
-		symsync_crcf_set_lf_bw(l_sync, conf.symsync_bandwidth1);
-		nco_crcf_pll_set_bandwidth(l_nco, conf.pll_bandwidth1);
-		agc_crcf_set_bandwidth(l_agc, conf.agc_bandwidth1);
+		float cfo = mixer_frequency / nco_1Hz + costas_frequency * conf.symbol_rate / pi2f;
+		setMetadata.emit(meta::cfo, cfo);
+		setMetadata.emit(meta::rssi, 10.0f * log10f(signal_power + 1e-20f));
+		setMetadata.emit(meta::bg_rssi, 10.0f * log10f(bg_power + 1e-20f));
+
+		symsync_crcf_set_lf_bw(l_sync, conf.symsync_bw1 / conf.samples_per_symbol);
+		setLoopBandwidth(conf.afc_speed1);
+		agc_bandwidth = conf.agc_bandwidth1;
+		rssi_bandwidth = conf.agc_bandwidth1 / conf.samples_per_symbol;
 	}
 	else {
-		// Sync lost
-		symsync_crcf_set_lf_bw(l_sync, conf.symsync_bandwidth0);
-		nco_crcf_pll_set_bandwidth(l_nco, conf.pll_bandwidth0);
-		agc_crcf_set_bandwidth(l_agc, conf.agc_bandwidth0);
+		/* The modulator starts every burst with a fresh differential encoder */
+		previous_point = 0;
+
+		symsync_crcf_set_lf_bw(l_sync, conf.symsync_bw0 / conf.samples_per_symbol);
+		setLoopBandwidth(conf.afc_speed0);
+		agc_bandwidth = conf.agc_bandwidth0;
+		rssi_bandwidth = conf.agc_bandwidth0 / conf.samples_per_symbol;
 	}
-#endif
 }
 
 void PSKDemodulator::setFrequencyOffset(float frequency_offset) {
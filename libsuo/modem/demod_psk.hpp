@@ -1,7 +1,10 @@
 #pragma once
 
+#include <memory>
+
 #include "suo.hpp"
 #include <liquid/liquid.h>
+#include "modem/decimator.hpp"
 
 
 namespace suo {
@@ -15,13 +18,24 @@ enum CostasLoopOrder {
 };
 
 /*
- * GMSK demodulator
+ * PSK demodulator
+ *
+ * The samples are processed one block at a time through the stages:
+ * 1) Mix-down to baseband
+ * 2) Decimation and resampling to samples_per_symbol
+ * 3) Root raised cosine matched filtering and symbol timing recovery
+ * 4) Decision-directed Costas loop for the carrier phase and residual frequency
+ * 5) Symbol decision and optional differential decoding
+ *
+ * The decided symbols are emitted as bits, most significant bit first.
+ * The constellation points are exp(j * 2 * pi * k / M) and the symbols are Gray coded
+ * (the liquid-dsp PSK mapping used by the PSKModulator).
  */
 class PSKDemodulator : public Block
 {
 public:
 
-	/* Configuration struct for the FSK demod */
+	/* Configuration struct for the PSK demod */
 	struct Config {
 		Config();
 
@@ -40,33 +54,60 @@ public:
 		 */
 		float center_frequency;
 
-		/* 
+		/*
 		 * Frequency offset from the center frequency (Hz)
 		 */
 		float frequency_offset;
 
-		/* 
-		 * Maximum allowed frequency offset (Hz)
+		/*
+		 * Maximum frequency offset tracked by the Costas loop (Hz)
 		 */
 		float maximum_frequency_offset;
 
+		/*
+		 * Bits per symbol: 1 = BPSK, 2 = QPSK, 3 = 8PSK
+		 */
+		unsigned int bits_per_symbol;
+
+		/*
+		 * Decode differentially encoded symbols (BPSK only).
+		 * Removes the phase ambiguity of the Costas loop.
+		 */
+		bool differential;
+
 		/*
 		 * Number of samples per symbol/bit after decimation.
 		 */
 		unsigned int samples_per_symbol;
+
+		/*
+		 * Matched filter delay (symbols)
+		 */
 		unsigned int filter_delay;
+
 		/*
-		 * Gaussian filter bandwidth-time product / excess bandwidth factor.
-		 * Usually 0.3 or 0.5
+		 * Root raised cosine excess bandwidth factor of the matched filter.
 		 */
 		float bt;
 
+		/*
+		 * Symbol amplitude and RSSI averaging bandwidth (normalized to the symbol rate)
+		 * before and after the receiver lock.
+		 */
 		float agc_bandwidth0;
 		float agc_bandwidth1;
 
+		/*
+		 * Costas loop bandwidth (normalized to the symbol rate)
+		 * before and after the receiver lock.
+		 */
 		float afc_speed0;
 		float afc_speed1;
 
+		/*
+		 * Symbol synchronizer loop bandwidth (normalized to the symbol rate)
+		 * before and after the receiver lock.
+		 */
 		float symsync_bw0;
 		float symsync_bw1;
 	};
@@ -81,43 +122,83 @@ public:
 
 	void sinkSamples(const SampleVector& samples, Timestamp timestamp);
 
+	/*
+	 * Static Pipeline stage: The decided bits are passed one by one to
+	 * next(), so a static deframer stage is inlined into the bit loop.
+	 */
+	template <typename Next>
+	void process(const SampleVector& samples, Timestamp timestamp, Next&& next) {
+		SUO_PROFILE(profile_samples, samples.size());
+		demodulate(samples, timestamp);
+		for (size_t i = 0; i < symbols.size(); i++)
+			next(symbols[i], symbols.symbol_time(i));
+	}
+
+	/* Lock state from the deframer. The tracking bandwidths change from the
+	 * next sample block on, since the bits reach the deframer block by block. */
 	void lockReceiver(bool locked, Timestamp now);
 
 	void setFrequencyOffset(float frequency_offset);
 
+	/* The bits of a block as one batch via sinkSymbols and one by one via sinkSymbol, whichever are connected */
 	Port<Symbol, Timestamp> sinkSymbol;
+	Port<const SymbolVector&, Timestamp> sinkSymbols;
 	Port<SoftSymbol, Timestamp> sinkSoftSymbol;
-	Port<const std::string&, const MetadataValue&> setMetadata;
+	Port<MetadataKey, const MetadataValue&> setMetadata;
 
 private:
 
+	/* Demodulate a sample block to the symbols batch */
+	void demodulate(const SampleVector& samples, Timestamp timestamp);
 	void update_nco();
+	void updateRSSI(float power, size_t n);
+	void setLoopBandwidth(float bandwidth);
+	void costasLoop(const Sample* in, size_t n, Timestamp first_symbol);
 
 	/* Configuration */
 	Config conf;
 	bool conf_dirty;
 
-	// float resamprate;
+	float resamprate;
 	Timestamp sample_ns;
-	unsigned resampint;
+	Timestamp symbol_ns;
 	float nco_1Hz;
-	float afc_speed;
 	bool receiver_lock;
+	unsigned int modulation_order;
+
+	/* Mixer state */
+	double mixer_phase;
+	double mixer_frequency;
+
+	/* Costas loop state: phase [rad], frequency [rad/symbol] and the loop filter gains */
+	float costas_phase, costas_frequency;
+	float costas_alpha, costas_beta;
+	float max_costas_frequency;
+	unsigned int previous_point;
 
-	float freq_min, freq_max;
+	/* Symbol amplitude normalization */
+	float agc_bandwidth;
+	float symbol_power;
+
+	/* Windowed power estimates for RSSI */
+	float rssi_bandwidth;
+	float signal_power, bg_power;
+
+	/* Integer decimation ahead of the resampler */
+	std::unique_ptr<Decimator> decimator;
 
 	/* liquid-dsp objects */
-	nco_crcf l_nco;
-	modemcf l_mod;
 	resamp_crcf l_resamp;
-	agc_crcf l_agc;
 	symsync_crcf l_sync;
-	windowcf l_demod_delay;
 
-	/* Buffers */
-	Frame* frame;
+	/* Buffers for the processing stages */
+	SampleVector mixed;         // Downconverted and decimated input samples
+	SampleVector resampled;     // Samples after resampling to samples_per_symbol
+	SampleVector synced;        // Matched filtered samples at the symbol instants
+	SymbolVector symbols;       // Bits decided from the latest sample vector
 
+	/* Profiling */
+	SUO_PROFILE_POINT(profile_samples, "PSKDemodulator", "sinkSamples");
 };
 
 }; // namespace suo
-
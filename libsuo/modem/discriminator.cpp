@@ -0,0 +1,320 @@
+
+#include <cmath>
+
+#include "modem/discriminator.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SUO_DISCRIMINATOR_X86
+#endif
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#define SUO_DISCRIMINATOR_NEON
+#endif
+
+
+using namespace std;
+using namespace suo;
+
+
+/* Coefficients for atan(z) = z * P(z^2) on 0 <= z <= 1 */
+static const float atan_c1 =  0.9998660f;
+static const float atan_c3 = -0.3302995f;
+static const float atan_c5 =  0.1801410f;
+static const float atan_c7 = -0.0851330f;
+static const float atan_c9 =  0.0208351f;
+
+static const float pi_f = 3.14159265359f;
+static const float pi_2 = 1.57079632679f;
+
+
+float suo::fast_atan2f(float y, float x)
+{
+	float ax = fabsf(x), ay = fabsf(y);
+	float mx = fmaxf(ax, ay), mn = fminf(ax, ay);
+
+	/* Reduce to the first octant */
+	float z = mn / fmaxf(mx, 1e-30f);
+	float z2 = z * z;
+	float a = z * ((((atan_c9 * z2 + atan_c7) * z2 + atan_c5) * z2 + atan_c3) * z2 + atan_c1);
+
+	/* Map back to the original octant */
+	if (ay > ax)
+		a = pi_2 - a;
+	if (x < 0.0f)
+		a = pi_f - a;
+	return copysignf(a, y);
+}
+
+
+static inline float discriminate(Sample s, Sample prev, float gain)
+{
+	/* arg(s * conj(prev)) */
+	float re = s.real() * prev.real() + s.imag() * prev.imag();
+	float im = s.imag() * prev.real() - s.real() * prev.imag();
+	return gain * fast_atan2f(im, re);
+}
+
+
+static void discriminator_scalar(const Sample* in, size_t n, Sample prev, float gain, float* out)
+{
+	for (size_t i = 0; i < n; i++) {
+		out[i] = discriminate(in[i], prev, gain);
+		prev = in[i];
+	}
+}
+
+
+#ifdef SUO_DISCRIMINATOR_X86
+
+__attribute__((target("avx2,fma")))
+static inline __m256 atan2_avx2(__m256 y, __m256 x)
+{
+	const __m256 sign_mask = _mm256_set1_ps(-0.0f);
+	__m256 ax = _mm256_andnot_ps(sign_mask, x);
+	__m256 ay = _mm256_andnot_ps(sign_mask, y);
+	__m256 mx = _mm256_max_ps(ax, ay);
+	__m256 mn = _mm256_min_ps(ax, ay);
+
+	__m256 z = _mm256_div_ps(mn, _mm256_max_ps(mx, _mm256_set1_ps(1e-30f)));
+	__m256 z2 = _mm256_mul_ps(z, z);
+	__m256 p = _mm256_fmadd_ps(_mm256_set1_ps(atan_c9), z2, _mm256_set1_ps(atan_c7));
+	p = _mm256_fmadd_ps(p, z2, _mm256_set1_ps(atan_c5));
+	p = _mm256_fmadd_ps(p, z2, _mm256_set1_ps(atan_c3));
+	p = _mm256_fmadd_ps(p, z2, _mm256_set1_ps(atan_c1));
+	__m256 a = _mm256_mul_ps(z, p);
+
+	__m256 swapped = _mm256_cmp_ps(ay, ax, _CMP_GT_OQ);
+	a = _mm256_blendv_ps(a, _mm256_sub_ps(_mm256_set1_ps(pi_2), a), swapped);
+	__m256 negative = _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_LT_OQ);
+	a = _mm256_blendv_ps(a, _mm256_sub_ps(_mm256_set1_ps(pi_f), a), negative);
+	return _mm256_xor_ps(a, _mm256_and_ps(y, sign_mask));
+}
+
+
+__attribute__((target("avx2,fma")))
+static void discriminator_avx2(const Sample* in, size_t n, Sample prev, float gain, float* out)
+{
+	if (n == 0)
+		return;
+	out[0] = discriminate(in[0], prev, gain);
+
+	const float* f = reinterpret_cast<const float*>(in);
+	const __m256 g = _mm256_set1_ps(gain);
+
+	size_t i = 1;
+	for (; i + 8 <= n; i += 8) {
+		__m256 s0 = _mm256_loadu_ps(f + 2 * i);
+		__m256 s1 = _mm256_loadu_ps(f + 2 * i + 8);
+		__m256 p0 = _mm256_loadu_ps(f + 2 * i - 2);
+		__m256 p1 = _mm256_loadu_ps(f + 2 * i + 6);
+
+		/* Deinterleave. The lanes end up in order 0,1,4,5,2,3,6,7 */
+		__m256 sr = _mm256_shuffle_ps(s0, s1, _MM_SHUFFLE(2, 0, 2, 0));
+		__m256 si = _mm256_shuffle_ps(s0, s1, _MM_SHUFFLE(3, 1, 3, 1));
+		__m256 pr = _mm256_shuffle_ps(p0, p1, _MM_SHUFFLE(2, 0, 2, 0));
+		__m256 pim = _mm256_shuffle_ps(p0, p1, _MM_SHUFFLE(3, 1, 3, 1));
+
+		__m256 re = _mm256_fmadd_ps(sr, pr, _mm256_mul_ps(si, pim));
+		__m256 im = _mm256_fmsub_ps(si, pr, _mm256_mul_ps(sr, pim));
+		__m256 a = _mm256_mul_ps(atan2_avx2(im, re), g);
+
+		/* Restore the sample order */
+		a = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(a), _MM_SHUFFLE(3, 1, 2, 0)));
+		_mm256_storeu_ps(out + i, a);
+	}
+
+	for (; i < n; i++)
+		out[i] = discriminate(in[i], in[i - 1], gain);
+}
+
+
+__attribute__((target("sse4.1")))
+static inline __m128 atan2_sse4(__m128 y, __m128 x)
+{
+	const __m128 sign_mask = _mm_set1_ps(-0.0f);
+	__m128 ax = _mm_andnot_ps(sign_mask, x);
+	__m128 ay = _mm_andnot_ps(sign_mask, y);
+	__m128 mx = _mm_max_ps(ax, ay);
+	__m128 mn = _mm_min_ps(ax, ay);
+
+	__m128 z = _mm_div_ps(mn, _mm_max_ps(mx, _mm_set1_ps(1e-30f)));
+	__m128 z2 = _mm_mul_ps(z, z);
+	__m128 p = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(atan_c9), z2), _mm_set1_ps(atan_c7));
+	p = _mm_add_ps(_mm_mul_ps(p, z2), _mm_set1_ps(atan_c5));
+	p = _mm_add_ps(_mm_mul_ps(p, z2), _mm_set1_ps(atan_c3));
+	p = _mm_add_ps(_mm_mul_ps(p, z2), _mm_set1_ps(atan_c1));
+	__m128 a = _mm_mul_ps(z, p);
+
+	__m128 swapped = _mm_cmpgt_ps(ay, ax);
+	a = _mm_blendv_ps(a, _mm_sub_ps(_mm_set1_ps(pi_2), a), swapped);
+	__m128 negative = _mm_cmplt_ps(x, _mm_setzero_ps());
+	a = _mm_blendv_ps(a, _mm_sub_ps(_mm_set1_ps(pi_f), a), negative);
+	return _mm_xor_ps(a, _mm_and_ps(y, sign_mask));
+}
+
+
+__attribute__((target("sse4.1")))
+static void discriminator_sse4(const Sample* in, size_t n, Sample prev, float gain, float* out)
+{
+	if (n == 0)
+		return;
+	out[0] = discriminate(in[0], prev, gain);
+
+	const float* f = reinterpret_cast<const float*>(in);
+	const __m128 g = _mm_set1_ps(gain);
+
+	size_t i = 1;
+	for (; i + 4 <= n; i += 4) {
+		__m128 s0 = _mm_loadu_ps(f + 2 * i);
+		__m128 s1 = _mm_loadu_ps(f + 2 * i + 4);
+		__m128 p0 = _mm_loadu_ps(f + 2 * i - 2);
+		__m128 p1 = _mm_loadu_ps(f + 2 * i + 2);
+
+		__m128 sr = _mm_shuffle_ps(s0, s1, _MM_SHUFFLE(2, 0, 2, 0));
+		__m128 si = _mm_shuffle_ps(s0, s1, _MM_SHUFFLE(3, 1, 3, 1));
+		__m128 pr = _mm_shuffle_ps(p0, p1, _MM_SHUFFLE(2, 0, 2, 0));
+		__m128 pim = _mm_shuffle_ps(p0, p1, _MM_SHUFFLE(3, 1, 3, 1));
+
+		__m128 re = _mm_add_ps(_mm_mul_ps(sr, pr), _mm_mul_ps(si, pim));
+		__m128 im = _mm_sub_ps(_mm_mul_ps(si, pr), _mm_mul_ps(sr, pim));
+		_mm_storeu_ps(out + i, _mm_mul_ps(atan2_sse4(im, re), g));
+	}
+
+	for (; i < n; i++)
+		out[i] = discriminate(in[i], in[i - 1], gain);
+}
+
+#endif /* SUO_DISCRIMINATOR_X86 */
+
+
+#ifdef SUO_DISCRIMINATOR_NEON
+
+static inline float32x4_t atan2_neon(float32x4_t y, float32x4_t x)
+{
+	float32x4_t ax = vabsq_f32(x);
+	float32x4_t ay = vabsq_f32(y);
+	float32x4_t mx = vmaxq_f32(ax, ay);
+	float32x4_t mn = vminq_f32(ax, ay);
+
+	float32x4_t z = vdivq_f32(mn, vmaxq_f32(mx, vdupq_n_f32(1e-30f)));
+	float32x4_t z2 = vmulq_f32(z, z);
+	float32x4_t p = vfmaq_f32(vdupq_n_f32(atan_c7), vdupq_n_f32(atan_c9), z2);
+	p = vfmaq_f32(vdupq_n_f32(atan_c5), p, z2);
+	p = vfmaq_f32(vdupq_n_f32(atan_c3), p, z2);
+	p = vfmaq_f32(vdupq_n_f32(atan_c1), p, z2);
+	float32x4_t a = vmulq_f32(z, p);
+
+	a = vbslq_f32(vcgtq_f32(ay, ax), vsubq_f32(vdupq_n_f32(pi_2), a), a);
+	a = vbslq_f32(vcltq_f32(x, vdupq_n_f32(0.0f)), vsubq_f32(vdupq_n_f32(pi_f), a), a);
+	uint32x4_t sign = vandq_u32(vreinterpretq_u32_f32(y), vdupq_n_u32(0x80000000));
+	return vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(a), sign));
+}
+
+
+static void discriminator_neon(const Sample* in, size_t n, Sample prev, float gain, float* out)
+{
+	if (n == 0)
+		return;
+	out[0] = discriminate(in[0], prev, gain);
+
+	const float* f = reinterpret_cast<const float*>(in);
+
+	size_t i = 1;
+	for (; i + 4 <= n; i += 4) {
+		float32x4x2_t s = vld2q_f32(f + 2 * i);
+		float32x4x2_t p = vld2q_f32(f + 2 * i - 2);
+
+		float32x4_t re = vfmaq_f32(vmulq_f32(s.val[1], p.val[1]), s.val[0], p.val[0]);
+		float32x4_t im = vfmsq_f32(vmulq_f32(s.val[1], p.val[0]), s.val[0], p.val[1]);
+		vst1q_f32(out + i, vmulq_n_f32(atan2_neon(im, re), gain));
+	}
+
+	for (; i < n; i++)
+		out[i] = discriminate(in[i], in[i - 1], gain);
+}
+
+#endif /* SUO_DISCRIMINATOR_NEON */
+
+
+bool FrequencyDiscriminator::isSupported(DiscriminatorKernel kernel)
+{
+	switch (kernel) {
+	case DiscriminatorKernel::automatic:
+	case DiscriminatorKernel::scalar:
+		return true;
+#ifdef SUO_DISCRIMINATOR_X86
+	case DiscriminatorKernel::sse4:
+		return __builtin_cpu_supports("sse4.1");
+	case DiscriminatorKernel::avx2:
+		return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+#ifdef SUO_DISCRIMINATOR_NEON
+	case DiscriminatorKernel::neon:
+		return true;
+#endif
+	default:
+		return false;
+	}
+}
+
+
+const char* FrequencyDiscriminator::getKernelName(DiscriminatorKernel kernel)
+{
+	switch (kernel) {
+	case DiscriminatorKernel::automatic: return "automatic";
+	case DiscriminatorKernel::scalar: return "scalar";
+	case DiscriminatorKernel::sse4: return "sse4";
+	case DiscriminatorKernel::avx2: return "avx2";
+	case DiscriminatorKernel::neon: return "neon";
+	}
+	return "unknown";
+}
+
+
+FrequencyDiscriminator::FrequencyDiscriminator(float gain, DiscriminatorKernel kernel) :
+	gain(gain),
+	prev(0.0f),
+	kernel(kernel)
+{
+	if (isSupported(kernel) == false)
+		throw SuoError("FrequencyDiscriminator: Kernel %s not supported by the CPU", getKernelName(kernel));
+
+	if (kernel == DiscriminatorKernel::automatic) {
+		if (isSupported(DiscriminatorKernel::avx2))
+			this->kernel = DiscriminatorKernel::avx2;
+		else if (isSupported(DiscriminatorKernel::sse4))
+			this->kernel = DiscriminatorKernel::sse4;
+		else if (isSupported(DiscriminatorKernel::neon))
+			this->kernel = DiscriminatorKernel::neon;
+		else
+			this->kernel = DiscriminatorKernel::scalar;
+	}
+
+	switch (this->kernel) {
+#ifdef SUO_DISCRIMINATOR_X86
+	case DiscriminatorKernel::avx2: kernel_func = &discriminator_avx2; break;
+	case DiscriminatorKernel::sse4: kernel_func = &discriminator_sse4; break;
+#endif
+#ifdef SUO_DISCRIMINATOR_NEON
+	case DiscriminatorKernel::neon: kernel_func = &discriminator_neon; break;
+#endif
+	default: kernel_func = &discriminator_scalar; break;
+	}
+}
+
+
+void FrequencyDiscriminator::reset()
+{
+	prev = 0.0f;
+}
+
+
+void FrequencyDiscriminator::execute(const Sample* in, size_t n, float* out)
+{
+	if (n == 0)
+		return;
+	kernel_func(in, n, prev, gain, out);
+	prev = in[n - 1];
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "suo.hpp"
+
+namespace suo {
+
+/*
+ * Implementations of the discriminator kernel.
+ * The automatic selection picks the widest instruction set the CPU supports.
+ */
+enum class DiscriminatorKernel {
+	automatic,
+	scalar,
+	sse4,
+	avx2,
+	neon
+};
+
+
+/*
+ * Fast polynomial approximation of atan2(y, x).
+ * Maximum absolute error is 1.2e-5 radians. (Abramowitz & Stegun 4.4.47)
+ * atan2(0, 0) returns 0.
+ */
+float fast_atan2f(float y, float x);
+
+
+/*
+ * Quadrature FM-discriminator
+ *
+ * Calculates the phase difference between consecutive samples:
+ *   out[i] = gain * arg(in[i] * conj(in[i - 1]))
+ * The latest sample is kept over calls so the discriminator can be used on a sample stream.
+ * All the kernels use the same polynomial so their outputs differ only by rounding.
+ */
+class FrequencyDiscriminator
+{
+public:
+	explicit FrequencyDiscriminator(float gain = 1.0f, DiscriminatorKernel kernel = DiscriminatorKernel::automatic);
+
+	/* Reset the stored previous sample */
+	void reset();
+
+	/* Run the discriminator over a block of samples. out must have space for n floats. */
+	void execute(const Sample* in, size_t n, float* out);
+
+	/* Run the discriminator for a single sample */
+	float step(Sample s) {
+		float ret = gain * fast_atan2f(s.imag() * prev.real() - s.real() * prev.imag(), s.real() * prev.real() + s.imag() * prev.imag());
+		prev = s;
+		return ret;
+	}
+
+	void setGain(float g) { gain = g; }
+	float getGain() const { return gain; }
+
+	/* Returns the kernel in use */
+	DiscriminatorKernel getKernel() const { return kernel; }
+
+	/* Is given kernel available on this CPU */
+	static bool isSupported(DiscriminatorKernel kernel);
+
+	/* Get human readable name of the kernel */
+	static const char* getKernelName(DiscriminatorKernel kernel);
+
+	typedef void (*KernelFunction)(const Sample* in, size_t n, Sample prev, float gain, float* out);
+
+private:
+	float gain;
+	Sample prev;
+	DiscriminatorKernel kernel;
+	KernelFunction kernel_func;
+};
+
+}; // namespace suo
@@ -0,0 +1,124 @@
+#include <algorithm>
+#include <cmath>
+
+#include "modem/frequency_acquisition.hpp"
+
+
+using namespace std;
+using namespace suo;
+
+
+FrequencyAcquisition::Config::Config() {
+	sample_rate = 100e3;
+	fft_length = 256;
+	num_averages = 4;
+	search_range = 10e3;
+	threshold = 10.0f;
+}
+
+
+FrequencyAcquisition::FrequencyAcquisition(const Config& conf) :
+	conf(conf)
+{
+	if (conf.sample_rate <= 0)
+		throw SuoError("FrequencyAcquisition: Non-positive sample rate");
+	if (conf.fft_length < 8 || (conf.fft_length & (conf.fft_length - 1)) != 0)
+		throw SuoError("FrequencyAcquisition: FFT length must be a power of two");
+	if (conf.num_averages < 1)
+		throw SuoError("FrequencyAcquisition: Number of averages must be at least 1");
+
+	threshold = powf(10.0f, conf.threshold / 10.0f);
+
+	const unsigned int N = conf.fft_length;
+	window.resize(N);
+	for (unsigned int i = 0; i < N; i++)
+		window[i] = 0.5f - 0.5f * cosf(pi2f * i / N);
+
+	spectrum.resize(N);
+	sorted.resize(N);
+	fft_input.resize(N);
+	fft_output.resize(N);
+	l_fft = fft_create_plan(N, fft_input.data(), fft_output.data(), LIQUID_FFT_FORWARD, 0);
+
+	reset();
+}
+
+
+FrequencyAcquisition::~FrequencyAcquisition()
+{
+	fft_destroy_plan(l_fft);
+}
+
+
+void FrequencyAcquisition::reset()
+{
+	fill(spectrum.begin(), spectrum.end(), 0.0f);
+	num_buffered = 0;
+	num_accumulated = 0;
+	frequency = 0.0f;
+	snr = 0.0f;
+}
+
+
+bool FrequencyAcquisition::execute(const Sample* x, size_t n)
+{
+	const unsigned int N = conf.fft_length;
+	bool detected = false;
+
+	for (size_t i = 0; i < n; ) {
+		/* Window the samples directly into the FFT input */
+		size_t len = min<size_t>(N - num_buffered, n - i);
+		for (size_t j = 0; j < len; j++)
+			fft_input[num_buffered + j] = window[num_buffered + j] * x[i + j];
+		num_buffered += len;
+		i += len;
+
+		if (num_buffered < N)
+			break;
+		num_buffered = 0;
+
+		fft_execute(l_fft);
+		for (unsigned int k = 0; k < N; k++)
+			spectrum[k] += norm(fft_output[k]);
+
+		if (++num_accumulated == conf.num_averages) {
+			detected = estimate();
+			fill(spectrum.begin(), spectrum.end(), 0.0f);
+			num_accumulated = 0;
+		}
+	}
+
+	return detected;
+}
+
+
+bool FrequencyAcquisition::estimate()
+{
+	const unsigned int N = conf.fft_length;
+	const float resolution = conf.sample_rate / N;
+
+	/* Median of the spectrum as the noise floor */
+	copy(spectrum.begin(), spectrum.end(), sorted.begin());
+	nth_element(sorted.begin(), sorted.begin() + N / 2, sorted.end());
+	const float noise = max(sorted[N / 2], 1e-30f);
+
+	/* Bins within the search range on both sides of DC */
+	const int range = min<int>(conf.search_range / resolution, N / 2 - 1);
+
+	float peak = 0.0f, weighted = 0.0f, total = 0.0f;
+	for (int b = -range; b <= range; b++) {
+		float p = spectrum[(b + N) % N];
+		peak = max(peak, p);
+		if (p > threshold * noise) {
+			weighted += b * (p - noise);
+			total += p - noise;
+		}
+	}
+
+	snr = 10.0f * log10f(peak / noise);
+	if (total <= 0.0f)
+		return false;
+
+	frequency = resolution * weighted / total;
+	return true;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "suo.hpp"
+#include <liquid/liquid.h>
+
+namespace suo {
+
+/*
+ * Coarse carrier frequency offset estimator.
+ *
+ * Accumulates num_averages Hann-windowed periodograms of fft_length samples
+ * and estimates the carrier frequency as the power-weighted centroid of the
+ * spectrum bins inside the search range which exceed the noise floor by the
+ * detection threshold. The noise floor is the median of the averaged spectrum,
+ * so the signal should occupy less than half of the input bandwidth.
+ *
+ * The centroid is unbiased for the symmetric spectra of FSK and GMSK signals,
+ * where picking the strongest bin would lock on to one of the tones.
+ * The cost is one FFT per fft_length input samples.
+ */
+class FrequencyAcquisition
+{
+public:
+
+	struct Config {
+		Config();
+
+		/* Input sample rate [Hz] */
+		float sample_rate;
+
+		/* Length of one periodogram. Must be a power of two. */
+		unsigned int fft_length;
+
+		/* Number of periodograms averaged for one estimate */
+		unsigned int num_averages;
+
+		/* Maximum carrier offset from DC included in the search [Hz] */
+		float search_range;
+
+		/* Required ratio of the strongest bin to the noise floor [dB] */
+		float threshold;
+	};
+
+	explicit FrequencyAcquisition(const Config& conf = Config());
+	~FrequencyAcquisition();
+
+	FrequencyAcquisition(const FrequencyAcquisition&) = delete;
+	FrequencyAcquisition& operator=(const FrequencyAcquisition&) = delete;
+
+	/* Discard the partially accumulated spectrum */
+	void reset();
+
+	/*
+	 * Accumulate n samples to the spectrum.
+	 * Returns true if a signal was detected and a new estimate is available.
+	 */
+	bool execute(const Sample* x, size_t n);
+
+	/* Estimated carrier frequency relative to DC [Hz] */
+	float getFrequency() const { return frequency; }
+
+	/* Strongest bin to noise floor ratio of the latest estimate [dB] */
+	float getSNR() const { return snr; }
+
+	/* Frequency resolution of the periodogram [Hz] */
+	float getResolution() const { return conf.sample_rate / conf.fft_length; }
+
+private:
+	bool estimate();
+
+	Config conf;
+	float threshold;
+
+	/* Periodogram state */
+	std::vector<float> window;
+	std::vector<float> spectrum;
+	std::vector<float> sorted;
+	unsigned int num_buffered;
+	unsigned int num_accumulated;
+
+	/* FFT buffers */
+	SampleVector fft_input, fft_output;
+	fftplan l_fft;
+
+	/* Latest estimate */
+	float frequency;
+	float snr;
+};
+
+}; // namespace suo
@@ -0,0 +1,170 @@
+#include <algorithm>
+
+#include "modem/matched_filter_bank.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SUO_FILTER_BANK_X86
+#endif
+
+
+using namespace std;
+using namespace suo;
+
+
+/* Floor for the normalization to avoid NaNs from an all-zero input */
+static const float min_power = 1e-30f;
+
+
+MatchedFilterBank::MatchedFilterBank() :
+	num_filters(0),
+	len(0),
+	use_avx2(false)
+{
+#ifdef SUO_FILTER_BANK_X86
+	use_avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+}
+
+
+void MatchedFilterBank::setFilters(const std::vector<std::vector<Sample>>& filters)
+{
+	if (filters.empty() || filters[0].empty())
+		throw SuoError("MatchedFilterBank: No filters given");
+
+	num_filters = filters.size();
+	len = filters[0].size();
+
+	taps_re.resize(num_filters * len);
+	taps_im.resize(num_filters * len);
+	mapping.resize(num_filters);
+	for (size_t m = 0; m < num_filters; m++) {
+		if (filters[m].size() != len)
+			throw SuoError("MatchedFilterBank: Filters of different lengths");
+		for (size_t k = 0; k < len; k++) {
+			taps_re[m * len + k] = filters[m][k].real();
+			taps_im[m * len + k] = filters[m][k].imag();
+		}
+		mapping[m] = 2.0f * m - num_filters + 1.0f;
+	}
+
+	reset();
+}
+
+
+void MatchedFilterBank::reset()
+{
+	buf_re.assign(len - 1, 0.0f);
+	buf_im.assign(len - 1, 0.0f);
+}
+
+
+#ifdef SUO_FILTER_BANK_X86
+
+/* Evaluate 8 consecutive output samples starting from x[0] */
+__attribute__((target("avx2,fma")))
+static __m256 filter_bank_avx2(const float* xr, const float* xi, const float* taps_re, const float* taps_im,
+	const float* mapping, size_t num_filters, size_t len, __m256& total)
+{
+	__m256 demod = _mm256_setzero_ps();
+	total = _mm256_setzero_ps();
+
+	for (size_t m = 0; m < num_filters; m++) {
+		const float* hr = &taps_re[m * len];
+		const float* hi = &taps_im[m * len];
+
+		__m256 acc_r = _mm256_setzero_ps(), acc_i = _mm256_setzero_ps();
+		for (size_t k = 0; k < len; k++) {
+			__m256 sr = _mm256_loadu_ps(xr - k), si = _mm256_loadu_ps(xi - k);
+			__m256 tr = _mm256_set1_ps(hr[k]), ti = _mm256_set1_ps(hi[k]);
+			acc_r = _mm256_fmadd_ps(tr, sr, _mm256_fnmadd_ps(ti, si, acc_r));
+			acc_i = _mm256_fmadd_ps(tr, si, _mm256_fmadd_ps(ti, sr, acc_i));
+		}
+
+		__m256 power = _mm256_fmadd_ps(acc_r, acc_r, _mm256_mul_ps(acc_i, acc_i));
+		total = _mm256_add_ps(total, power);
+		demod = _mm256_fmadd_ps(_mm256_set1_ps(mapping[m]), _mm256_mul_ps(power, power), demod);
+	}
+
+	return _mm256_div_ps(demod, _mm256_max_ps(total, _mm256_set1_ps(min_power)));
+}
+
+
+__attribute__((target("avx2,fma")))
+static size_t execute_avx2(const float* xr, const float* xi, size_t n, const float* taps_re, const float* taps_im,
+	const float* mapping, size_t num_filters, size_t len, float* out, float& power_sum)
+{
+	__m256 powers = _mm256_setzero_ps();
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m256 total;
+		__m256 demod = filter_bank_avx2(xr + i, xi + i, taps_re, taps_im, mapping, num_filters, len, total);
+		_mm256_storeu_ps(out + i, demod);
+		powers = _mm256_add_ps(powers, total);
+	}
+
+	float p[8];
+	_mm256_storeu_ps(p, powers);
+	power_sum += p[0] + p[1] + p[2] + p[3] + p[4] + p[5] + p[6] + p[7];
+	return i;
+}
+
+#endif /* SUO_FILTER_BANK_X86 */
+
+
+float MatchedFilterBank::execute(const Sample* in, size_t n, float* out)
+{
+	if (n == 0)
+		return 0.0f;
+
+	/* Append the new samples after the history */
+	const size_t hist = len - 1;
+	buf_re.resize(hist + n);
+	buf_im.resize(hist + n);
+	for (size_t i = 0; i < n; i++) {
+		buf_re[hist + i] = in[i].real();
+		buf_im[hist + i] = in[i].imag();
+	}
+
+	/* Pointers to the newest sample of the first output */
+	const float* xr = &buf_re[hist];
+	const float* xi = &buf_im[hist];
+
+	float power_sum = 0.0f;
+	size_t i = 0;
+#ifdef SUO_FILTER_BANK_X86
+	if (use_avx2)
+		i = execute_avx2(xr, xi, n, taps_re.data(), taps_im.data(), mapping.data(), num_filters, len, out, power_sum);
+#endif
+
+	for (; i < n; i++) {
+		const float* sr = xr + i;
+		const float* si = xi + i;
+
+		float demod = 0.0f, total = 0.0f;
+		for (size_t m = 0; m < num_filters; m++) {
+			const float* hr = &taps_re[m * len];
+			const float* hi = &taps_im[m * len];
+
+			float acc_r = 0.0f, acc_i = 0.0f;
+			for (size_t k = 0; k < len; k++) {
+				acc_r += hr[k] * *(sr - k) - hi[k] * *(si - k);
+				acc_i += hr[k] * *(si - k) + hi[k] * *(sr - k);
+			}
+
+			float power = acc_r * acc_r + acc_i * acc_i;
+			total += power;
+			demod += mapping[m] * power * power;
+		}
+		out[i] = demod / max(total, min_power);
+		power_sum += total;
+	}
+
+	/* Keep the tail as history for the next block */
+	copy(buf_re.end() - hist, buf_re.end(), buf_re.begin());
+	copy(buf_im.end() - hist, buf_im.end(), buf_im.begin());
+	buf_re.resize(hist);
+	buf_im.resize(hist);
+
+	return power_sum;
+}
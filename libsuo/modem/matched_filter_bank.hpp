@@ -0,0 +1,50 @@
+#pragma once
+
+#include "suo.hpp"
+
+namespace suo {
+
+/*
+ * Bank of complex FIR filters for FSK symbol hypotheses sharing one delay line.
+ *
+ * For each input sample every filter output is calculated as
+ *   y_m[n] = sum_k h_m[k] * x[n - k]
+ * and the filter powers p_m = |y_m[n]|^2 are combined into a soft symbol estimate
+ *   demod[n] = sum_m mapping_m * p_m^2 / sum_m p_m
+ * where the symbol indices are mapped evenly to the range [-(M-1), M-1].
+ *
+ * The block is processed several output samples at a time with AVX2 when the CPU supports it.
+ */
+class MatchedFilterBank
+{
+public:
+	MatchedFilterBank();
+
+	/* Set the filter coefficients. All the filters must be of equal length. */
+	void setFilters(const std::vector<std::vector<Sample>>& filters);
+
+	/* Clear the delay line */
+	void reset();
+
+	/*
+	 * Filter a block of samples and write the soft symbol estimates to demod.
+	 * Returns the sum of the total filter powers over the block.
+	 */
+	float execute(const Sample* in, size_t n, float* demod);
+
+	size_t getNumFilters() const { return num_filters; }
+	size_t getLength() const { return len; }
+
+private:
+	size_t num_filters, len;
+	bool use_avx2;
+
+	/* Coefficients as [filter * len + k] */
+	std::vector<float> taps_re, taps_im;
+	std::vector<float> mapping;
+
+	/* Deinterleaved delay line. The first len - 1 samples are history from the previous block. */
+	std::vector<float> buf_re, buf_im;
+};
+
+}; // namespace suo
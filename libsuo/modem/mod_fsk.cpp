@@ -20,19 +20,9 @@ FSKModulator::Config::Config() {
 }
 
 
-FSKModulator::FSKModulator(const Config& _conf) :
-	conf(_conf)
+/* Check the configuration and resolve the modulation index */
+static FSKModulator::Config checkConfig(FSKModulator::Config conf)
 {
-	sample_ns = round(1.0e9f / conf.sample_rate);
-	nco_1Hz = pi2f / conf.sample_rate;
-
-	const float samples_per_symbol = conf.sample_rate / conf.symbol_rate;
-	mod_rate = (unsigned int)samples_per_symbol + 1;
-	const float resamp_rate = samples_per_symbol / (float)mod_rate;
-
-	symbols.resize(8 * 256);
-	symbols.clear();
-
 	if (conf.modindex < 0)
 		throw SuoError("FSKModulator: Negative modindex! %f", conf.modindex);
 	if (conf.deviation < 0)
@@ -45,47 +35,45 @@ FSKModulator::FSKModulator(const Config& _conf) :
 	else if (conf.modindex == 0)
 		throw SuoError("FSKModulator: Neither mod_index or deviation given!");
 
-
 	// Carson bandwidth rule: Bandwidth = 2 * (deviation + symbol_rate)
 	float signal_bandwidth = 2 * (/* conf.bits_per_symbol * */ conf.modindex * conf.symbol_rate + conf.symbol_rate);
 	if ((abs(conf.center_frequency) + 0.5 * signal_bandwidth) / conf.sample_rate > 0.5)
 		throw SuoError("FSKModulator: Center frequency too large for given sample rate!");
 
-	center_frequency = pi2f * conf.center_frequency / conf.sample_rate;
+	return conf;
+}
 
-	/*
-	 * Init NCO for FSK generating
-	 */
-	unsigned int cpfsk_filter_delay = 2;
-	l_mod = cpfskmod_create(conf.complexity, conf.modindex, mod_rate, cpfsk_filter_delay, conf.bt, LIQUID_CPFSK_SQUARE);
 
-	/*
-	 * Init NCO for up mixing
-	 */
-	l_nco = nco_crcf_create(LIQUID_NCO);
-	nco_crcf_set_frequency(l_nco, nco_1Hz * (conf.center_frequency + conf.frequency_offset));
+static CPMWaveform::Config waveformConfig(const FSKModulator::Config& conf)
+{
+	CPMWaveform::Config waveform_conf;
+	waveform_conf.sample_rate = conf.sample_rate;
+	waveform_conf.symbol_rate = conf.symbol_rate;
+	waveform_conf.bits_per_symbol = conf.complexity;
+	waveform_conf.modindex = conf.modindex;
+	waveform_conf.pulse = CPMWaveform::Pulse::rectangular;
+	waveform_conf.bt = conf.bt;
+	waveform_conf.amplitude = conf.amplitude;
+	waveform_conf.ramp_up_duration = conf.ramp_up_duration;
+	waveform_conf.ramp_down_duration = conf.ramp_down_duration;
+	return waveform_conf;
+}
 
-	/*
-	 * Init resampler
-	 * The GMSK demodulator can produce signal samples/symbol ratio is an integer.
-	 * This ratio doesn't usually match with the SDR's output sample ratio and thus fractional
-	 * resampler is needed.
-	 */
-	l_resamp = resamp_crcf_create(resamp_rate,
-		13,    /* filter semi-length (filter delay) */
-		0.45f, /* resampling filter bandwidth */
-		60.0f, /* resampling filter sidelobe suppression level */
-		32     /* number of filters in bank (timing resolution) */
-	);
 
+FSKModulator::FSKModulator(const Config& _conf) :
+	conf(checkConfig(_conf)),
+	waveform(waveformConfig(conf))
+{
+	sample_ns = round(1.0e9f / conf.sample_rate);
 
-	// Calculate number of trailer symbols to 
-	trailer_length = cpfsk_filter_delay + conf.ramp_down_duration;
-	trailer_length += (int)ceil((float)resamp_crcf_get_delay(l_resamp) / mod_rate);
+	symbols.resize(8 * 256);
+	symbols.clear();
 
-	// Calculate total delay of the start of the transmission due to gaussian filter and resampling 
-	filter_delay = ceil((cpfsk_filter_delay * mod_rate + resamp_crcf_get_delay(l_resamp)) * sample_ns);
+	// Number of trailer symbols to complete the last symbol and to ramp down
+	trailer_length = waveform.getPulseLength() + conf.ramp_down_duration;
 
+	// Delay from a symbol to the center of its frequency pulse
+	filter_delay = round(0.5e9 * waveform.getPulseLength() / conf.symbol_rate);
 
 	reset();
 }
@@ -93,45 +81,13 @@ FSKModulator::FSKModulator(const Config& _conf) :
 
 FSKModulator::~FSKModulator()
 {
-	nco_crcf_destroy(l_nco);
-	resamp_crcf_destroy(l_resamp);
-	cpfskmod_destroy(l_mod);
 }
 
 
 void FSKModulator::reset() {
 	state = Idle;
 	symbols.clear();
-	symbols_i = 0;
-	mod_i = 0;
-	mod_samples.clear();
-
-	cpfskmod_reset(l_mod);
-	nco_crcf_reset(l_nco);
-	resamp_crcf_reset(l_resamp);
-}
-
-
-void FSKModulator::modulateSamples(Symbol symbol) {
-
-	Sample mod_output[mod_rate];
-	mod_samples.resize(mod_rate);
-
-	// Generate samples from the symbol
-	cpfskmod_modulate(l_mod, symbol, mod_output);
-
-	// Scale the signal by the amplitude
-	liquid_vectorcf_mulscalar(mod_output, mod_rate, conf.amplitude, mod_output);
-
-	// Interpolate to final sample rate
-	unsigned int resampler_output = 0;
-	resamp_crcf_execute_block(l_resamp, mod_output, mod_rate, mod_samples.data(), &resampler_output);
-
-	// Mix up the samples
-	nco_crcf_mix_block_up(l_nco, mod_samples.data(), mod_samples.data(), resampler_output);
-
-	mod_samples.resize(resampler_output);
-	mod_i = 0;
+	waveform.startBurst(conf.center_frequency + conf.frequency_offset);
 }
 
 
@@ -169,8 +125,7 @@ SampleGenerator FSKModulator::sampleGenerator()
 	}
 #endif
 
-	nco_crcf_reset(l_nco);
-	nco_crcf_set_frequency(l_nco, nco_1Hz * (conf.center_frequency + conf.frequency_offset));
+	waveform.startBurst(conf.center_frequency + conf.frequency_offset);
 	symbols.flags |= VectorFlags::start_of_burst;
 
 	/*
@@ -185,20 +140,10 @@ SampleGenerator FSKModulator::sampleGenerator()
 
 		for (Symbol symbol : symbols) {
 
-			// Fill the modulator output buffer
-			modulateSamples(symbols[symbols_i]);
-
-			// Calculate amplitude ramp up
-			if ((symbols.flags & start_of_burst) && symbols_i < conf.ramp_up_duration) {
-				const size_t ramp_duration = conf.ramp_up_duration * mod_rate;
-				const size_t hamming_window_start = symbols_i * mod_rate;
-				const size_t hamming_window_len = 2 * ramp_duration;
-				//cout << "Ramp up " << ramp_duration << " " << hamming_window_start << " " << hamming_window_len << endl;
-				for (unsigned int i = 0; i < mod_samples.size(); i++)
-					mod_samples[i] *= hamming(hamming_window_start + i, hamming_window_len); // TODO: liquid_hamming
-			}
-
-			co_yield mod_samples;
+			// Render the symbol directly to the output buffer
+			SampleSpan out = co_yield SampleGenerator::reserve(waveform.getMaxSamples());
+			unsigned int num_written = waveform.modulate(symbol, out.data);
+			co_yield SampleGenerator::commit(num_written);
 		}
 
 		if (symbols.flags & end_of_burst)
@@ -212,23 +157,14 @@ SampleGenerator FSKModulator::sampleGenerator()
 	 */
 	for (size_t i = 0; i < trailer_length; i++) {
 
-		// Feed zeros to the modulator to "flush" the filters
-		modulateSamples(0);
-
-		// Calculate amplitude ramp down
-		if (conf.ramp_down_duration > 0) {
-			int end = symbols_i - trailer_length + conf.ramp_down_duration - 1;
-			if (end >= 0) {
-				const size_t ramp_duration = conf.ramp_down_duration * mod_rate;
-				const size_t hamming_window_start = (conf.ramp_down_duration + end) * mod_rate;
-				const size_t hamming_window_len = 2 * ramp_duration;
-				//cout << "Ramp down " << ramp_duration << " " << hamming_window_start << " " << hamming_window_len << " " << mod_rate << endl;
-				for (unsigned int i = 0; i < mod_samples.size(); i++)
-					mod_samples[i] *= hamming(hamming_window_start + i, hamming_window_len); // TODO: liquid_hamming
-			}
-		}
-		
-		co_yield mod_samples;
+		// Fade out during the last symbols
+		if (i + conf.ramp_down_duration == trailer_length)
+			waveform.startRampDown();
+
+		// Feed zeros to the modulator to complete the last symbol
+		SampleSpan out = co_yield SampleGenerator::reserve(waveform.getMaxSamples());
+		unsigned int num_written = waveform.modulate(0, out.data);
+		co_yield SampleGenerator::commit(num_written);
 	}
 
 }
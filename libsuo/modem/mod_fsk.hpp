@@ -1,7 +1,7 @@
 #pragma once
 
 #include "suo.hpp"
-#include <liquid/liquid.h>
+#include "modem/cpm_waveform.hpp"
 
 namespace suo {
 
@@ -9,6 +9,8 @@ class FSKModulator : public Block
 {
 	/*
 	 * n-FSK modulator
+	 * The waveform is synthesized directly at the output sample rate
+	 * from precalculated phase increments (see CPMWaveform).
 	 */
 public:
 
@@ -76,15 +78,11 @@ public:
 
 private:
 
-	void modulateSamples(Symbol symbol);
 	SampleGenerator sampleGenerator();
 
 	/* Configuration */
 	Config conf;
 	float sample_ns;  // Sample duration in ns
-	float nco_1Hz;
-	float center_frequency;
-	unsigned int mod_rate;
 	unsigned int trailer_length; // [symbols]
 	Timestamp filter_delay; // [ns]
 
@@ -93,14 +91,9 @@ private:
 	enum State state;
 	SymbolVector symbols;
 	SymbolGenerator symbol_gen;
-	size_t symbols_i;
-	SampleVector mod_samples;
-	unsigned int mod_i;
-
-	/* liquid-dsp objects */
-	nco_crcf l_nco;
-	cpfskmod l_mod;
-	resamp_crcf l_resamp;     // Rational resampler
+
+	/* Waveform tables */
+	CPMWaveform waveform;
 
 };
 
@@ -2,13 +2,16 @@
 
 #include <memory>
 #include "suo.hpp"
-#include <liquid/liquid.h>
+#include "modem/cpm_waveform.hpp"
 
 
 namespace suo {
 
 /*
  * GMSK modulator
+ *
+ * The waveform is synthesized directly at the output sample rate
+ * from precalculated phase increments (see CPMWaveform).
  */
 class GMSKModulator : public Block
 {	
@@ -82,8 +85,6 @@ private:
 	Config conf;
 	
 	Timestamp sample_ns;        // Sample duration in ns
-	unsigned int mod_rate;      // GMSK modulator samples per symbols rate
-	float nco_1Hz;
 	unsigned int trailer_length; // Number of symbols in trailer [symbols]
 	Timestamp filter_delay;      // Total timedelay in the FIR filtering [ns]
 
@@ -92,10 +93,8 @@ private:
 	SampleGenerator sample_gen;
 	SymbolGenerator symbol_gen;
 
-	/* Liquid-DSP objects */
-	gmskmod l_mod;            // GMSK modulator
-	resamp_crcf l_resamp;     // Rational resampler
-	nco_crcf l_nco;	          // NCO for mixing up the signal
+	/* Waveform tables */
+	CPMWaveform waveform;
 
 };
 
@@ -15,6 +15,7 @@ PSKModulator::Config::Config() {
 	amplitude = 1.0f;
 	ramp_up_duration = 0;
 	ramp_down_duration = 0;
+	differential = false;
 }
 
 
@@ -75,6 +76,7 @@ PSKModulator::~PSKModulator()
 
 void PSKModulator::reset() {
 	symbols.clear();
+	previous_bit = 0;
 
 	modemcf_reset(l_mod);
 	nco_crcf_reset(l_nco);
@@ -127,7 +129,12 @@ SampleGenerator PSKModulator::sampleGenerator()
 	}
 #endif
 
-	SampleVector mod_samples;
+	// Sample buffer borrowed from the shared pool for the duration of the burst
+	Pooled<SampleVector> mod_buffer = sample_pool.acquire(mod_rate);
+	SampleVector& mod_samples = *mod_buffer;
+
+	// Every burst starts with a fresh differential encoder
+	previous_bit = 0;
 
 	// Update the mixer NCO on the correct frequency
 	modemcf_reset(l_mod);
@@ -148,8 +155,12 @@ SampleGenerator PSKModulator::sampleGenerator()
 		for (size_t si = 0; si < symbols.size(); si++) {
 
 			// Calculate complex symbol from integer symbol
+			Symbol symbol = symbols[si];
+			if (conf.differential)
+				symbol = previous_bit = previous_bit ^ symbol;
+
 			Complex complex_symbol;
-			modemcf_modulate(l_mod, symbols[si], &complex_symbol);
+			modemcf_modulate(l_mod, symbol, &complex_symbol);
 			complex_symbol *= conf.amplitude;
 
 			// Mix up the samples
@@ -164,21 +175,21 @@ SampleGenerator PSKModulator::sampleGenerator()
 				mod_samples[i] = complex_symbol * carrier;
 			}
 
-			// Interpolate to final sample rate
+			// Interpolate to final sample rate directly to the output buffer
+			SampleSpan out = co_yield SampleGenerator::reserve(mod_rate + 1);
 			unsigned int num_written = 0;
-			resamp_crcf_execute_block(l_resamp, mod_samples.data(), mod_samples.size(), mod_samples.data(), &num_written);
-			mod_samples.resize(num_written);
+			resamp_crcf_execute_block(l_resamp, mod_samples.data(), mod_rate, out.data, &num_written);
 
 			// Calculate amplitude ramp up
 			if ((symbols.flags & start_of_burst) && si < conf.ramp_up_duration) {
 				const size_t ramp_duration = conf.ramp_up_duration * mod_rate;
 				const size_t hamming_window_start = si * mod_rate;
 				const size_t hamming_window_len = 2 * ramp_duration;
-				for (unsigned int i = 0; i < mod_samples.size(); i++)
-					mod_samples[i] *= hamming(hamming_window_start + i, hamming_window_len); // TODO: liquid_hamming
+				for (unsigned int i = 0; i < num_written; i++)
+					out.data[i] *= hamming(hamming_window_start + i, hamming_window_len); // TODO: liquid_hamming
 			}
 
-			co_yield mod_samples;
+			co_yield SampleGenerator::commit(num_written);
 		}
 
 		if (symbols.flags & end_of_burst)
@@ -196,10 +207,10 @@ SampleGenerator PSKModulator::sampleGenerator()
 	for (size_t i = 0; i < trailer_length; i++)
 		mod_samples[i] = 0.0f;
 
+	SampleSpan out = co_yield SampleGenerator::reserve(trailer_length + 1);
 	unsigned int num_written = 0;
-	resamp_crcf_execute_block(l_resamp, mod_samples.data(), mod_samples.size(), mod_samples.data(), &num_written);
-	mod_samples.resize(num_written);
-	co_yield mod_samples;
+	resamp_crcf_execute_block(l_resamp, mod_samples.data(), trailer_length, out.data, &num_written);
+	co_yield SampleGenerator::commit(num_written);
 
 	reset();
 }
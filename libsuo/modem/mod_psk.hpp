@@ -33,6 +33,9 @@ public:
 		/* Length of the start/stop ramp in symbols */
 		unsigned int ramp_up_duration, ramp_down_duration;
 
+		/* Differentially encode the bits (a '1' flips the phase) */
+		bool differential;
+
 	};
 
 
@@ -66,6 +69,7 @@ private:
 	
 	/* State */
 	SymbolVector symbols;
+	Symbol previous_bit;
 	SymbolGenerator symbol_gen;
 
 	/* liquid-dsp and suo objects */
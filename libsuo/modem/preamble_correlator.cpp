@@ -0,0 +1,199 @@
+#include <algorithm>
+#include <cmath>
+
+#include "modem/preamble_correlator.hpp"
+
+
+using namespace std;
+using namespace suo;
+
+
+PreambleCorrelator::Config::Config() {
+	threshold = 0.5f;
+	dphi_max = 0.05f;
+}
+
+
+PreambleCorrelator::PreambleCorrelator(const Config& conf) :
+	conf(conf),
+	preamble_energy(0.0f),
+	fft_length(0),
+	l_fft(nullptr),
+	l_ifft(nullptr)
+{
+	if (conf.threshold <= 0.0f || conf.threshold > 1.0f)
+		throw SuoError("PreambleCorrelator: Threshold must be between 0 and 1");
+	if (conf.dphi_max < 0.0f)
+		throw SuoError("PreambleCorrelator: Negative maximum carrier offset");
+}
+
+
+PreambleCorrelator::~PreambleCorrelator()
+{
+	destroyPlans();
+}
+
+
+void PreambleCorrelator::destroyPlans()
+{
+	if (l_fft)
+		fft_destroy_plan(l_fft);
+	if (l_ifft)
+		fft_destroy_plan(l_ifft);
+	l_fft = l_ifft = nullptr;
+}
+
+
+void PreambleCorrelator::setPreamble(const std::vector<Sample>& _preamble)
+{
+	if (_preamble.size() < 2)
+		throw SuoError("PreambleCorrelator: Too short preamble");
+
+	preamble = _preamble;
+	const size_t L = preamble.size();
+
+	preamble_energy = 0.0f;
+	for (Sample s: preamble)
+		preamble_energy += norm(s);
+	if (preamble_energy <= 0.0f)
+		throw SuoError("PreambleCorrelator: Preamble has no energy");
+
+	/* At least 3/4 of each FFT gives new lags */
+	fft_length = 64;
+	while (fft_length < 4 * L)
+		fft_length *= 2;
+
+	destroyPlans();
+	fft_input.assign(fft_length, 0.0f);
+	fft_output.resize(fft_length);
+	ifft_input.resize(fft_length);
+	ifft_output.resize(fft_length);
+	l_fft = fft_create_plan(fft_length, fft_input.data(), fft_output.data(), LIQUID_FFT_FORWARD, 0);
+	l_ifft = fft_create_plan(fft_length, ifft_input.data(), ifft_output.data(), LIQUID_FFT_BACKWARD, 0);
+
+	/*
+	 * Carrier offset hypotheses spaced so that the residual phase drift
+	 * over the preamble is at most pi/2 from the nearest hypothesis.
+	 */
+	const float spacing = 0.5f * pi2f / L;
+	const int num_offsets = ceilf(conf.dphi_max / spacing);
+
+	templates.clear();
+	for (int h = -num_offsets; h <= num_offsets; h++) {
+		fill(fft_input.begin(), fft_input.end(), 0.0f);
+		for (size_t k = 0; k < L; k++)
+			fft_input[k] = preamble[k] * polar(1.0f, h * spacing * k);
+		fft_execute(l_fft);
+
+		/* Conjugated for correlation and scaled for the unnormalized inverse FFT */
+		SampleVector spectrum(fft_length);
+		for (size_t i = 0; i < fft_length; i++)
+			spectrum[i] = conj(fft_output[i]) / (float)fft_length;
+		templates.push_back(std::move(spectrum));
+	}
+
+	magnitude.resize(getBlockLength());
+	energy.resize(getBlockLength());
+}
+
+
+void PreambleCorrelator::correlate(const Sample* x)
+{
+	const size_t L = preamble.size();
+	const size_t B = getBlockLength();
+
+	copy(x, x + fft_length, fft_input.begin());
+	fft_execute(l_fft);
+
+	/* Strongest correlation over the carrier offset hypotheses */
+	fill(magnitude.begin(), magnitude.end(), 0.0f);
+	for (const SampleVector& spectrum: templates) {
+		for (size_t i = 0; i < fft_length; i++)
+			ifft_input[i] = fft_output[i] * spectrum[i];
+		fft_execute(l_ifft);
+		for (size_t j = 0; j < B; j++)
+			magnitude[j] = max(magnitude[j], norm(ifft_output[j]));
+	}
+
+	/* Input energy under the template at every lag as a sliding sum */
+	double window = 0.0;
+	for (size_t k = 0; k < L; k++)
+		window += norm(x[k]);
+	for (size_t j = 0; j < B; j++) {
+		energy[j] = window;
+		if (j + 1 < B)
+			window += norm(x[j + L]) - norm(x[j]);
+	}
+
+	/* Normalized correlation */
+	for (size_t j = 0; j < B; j++)
+		magnitude[j] = sqrtf(magnitude[j] / (preamble_energy * max(energy[j], 1e-30f)));
+}
+
+
+void PreambleCorrelator::refine(const Sample* x, size_t lag, size_t end, Detection& det)
+{
+	const size_t L = preamble.size();
+	const size_t half = L / 2;
+
+	det.rho = magnitude[lag];
+
+	/* Fractional timing from a parabola fitted to the neighbouring lags */
+	det.tau = 0.0f;
+	if (lag > 0 && lag + 1 < end) {
+		float a = magnitude[lag - 1], b = magnitude[lag], c = magnitude[lag + 1];
+		float d = a - 2.0f * b + c;
+		if (d < 0.0f)
+			det.tau = clamp(0.5f * (a - c) / d, -0.49f, 0.49f);
+	}
+
+	/* Carrier offset from the phase rotation between the halves of the preamble */
+	Complex c1 = 0.0f, c2 = 0.0f;
+	for (size_t k = 0; k < half; k++) {
+		c1 += x[lag + k] * conj(preamble[k]);
+		c2 += x[lag + half + k] * conj(preamble[half + k]);
+	}
+	det.dphi = arg(c2 * conj(c1)) / half;
+	det.gamma = (abs(c1) + abs(c2)) / preamble_energy;
+}
+
+
+bool PreambleCorrelator::search(const Sample* x, size_t n, Detection& det, size_t& searched)
+{
+	if (preamble.empty())
+		throw SuoError("PreambleCorrelator: No preamble set");
+
+	const size_t B = getBlockLength();
+
+	size_t lag = 0;
+	while (lag + fft_length <= n) {
+		correlate(&x[lag]);
+
+		size_t next = B;
+		for (size_t j = 0; j < B; j++) {
+			if (magnitude[j] < conf.threshold)
+				continue;
+
+			/* Climb to the local maximum */
+			size_t k = j;
+			while (k + 1 < B && magnitude[k + 1] > magnitude[k])
+				k++;
+
+			/* The peak may continue in the next block, so restart the next block from here */
+			if (k + 1 == B && j > 0) {
+				next = j;
+				break;
+			}
+
+			refine(&x[lag], k, B, det);
+			det.offset = lag + k;
+			searched = lag + k;
+			return true;
+		}
+
+		lag += next;
+	}
+
+	searched = lag;
+	return false;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "suo.hpp"
+#include <liquid/liquid.h>
+
+namespace suo {
+
+/*
+ * Block-based preamble correlator using overlap-save FFT convolution.
+ *
+ * The normalized cross-correlation between the input and the known preamble
+ * waveform is calculated for a whole block of lags at once:
+ *   rho[j] = |sum_k x[j + k] * conj(t[k])| / sqrt(E_t * E_x[j])
+ * Each FFT of fft_length samples gives fft_length - preamble_length + 1 lags,
+ * so the cost per input sample doesn't depend on the preamble length.
+ *
+ * Carrier offsets are tolerated by correlating against a few frequency shifted
+ * copies of the template. After the detection the fractional timing offset is
+ * interpolated from the neighbouring lags and the carrier offset is refined
+ * from the phase difference between the two halves of the preamble.
+ */
+class PreambleCorrelator
+{
+public:
+
+	struct Config {
+		Config();
+
+		/* Normalized correlation required for the detection (0...1) */
+		float threshold;
+
+		/* Maximum carrier frequency offset (radians per sample) */
+		float dphi_max;
+	};
+
+	/* Detected preamble */
+	struct Detection {
+		size_t offset;  // Index of the first sample of the preamble in the searched buffer
+		float tau;      // Fractional timing offset (-0.5...0.5 samples)
+		float dphi;     // Carrier frequency offset (radians per sample)
+		float gamma;    // Channel gain
+		float rho;      // Normalized correlation
+	};
+
+	explicit PreambleCorrelator(const Config& conf = Config());
+	~PreambleCorrelator();
+
+	PreambleCorrelator(const PreambleCorrelator&) = delete;
+	PreambleCorrelator& operator=(const PreambleCorrelator&) = delete;
+
+	/* Set the preamble waveform */
+	void setPreamble(const std::vector<Sample>& preamble);
+
+	/*
+	 * Search the buffer for the preamble. The lags are evaluated one FFT block
+	 * at a time, so the buffer must extend fft_length - 1 samples past the last
+	 * lag to be searched.
+	 * Returns true and fills det on the first detection. searched is set to the
+	 * number of leading lags which were searched without a detection.
+	 */
+	bool search(const Sample* x, size_t n, Detection& det, size_t& searched);
+
+	size_t getPreambleLength() const { return preamble.size(); }
+	size_t getFFTLength() const { return fft_length; }
+
+	/* Number of new lags evaluated by one FFT */
+	size_t getBlockLength() const { return fft_length - preamble.size() + 1; }
+
+private:
+	void destroyPlans();
+	void correlate(const Sample* x);
+	void refine(const Sample* x, size_t lag, size_t end, Detection& det);
+
+	Config conf;
+	std::vector<Sample> preamble;
+	float preamble_energy;
+	size_t fft_length;
+
+	/* Frequency domain templates for each carrier offset hypothesis */
+	std::vector<SampleVector> templates;
+
+	/* Correlation magnitudes for the lags of the current block and the running input energy */
+	std::vector<float> magnitude;
+	std::vector<float> energy;
+
+	/* FFT buffers */
+	SampleVector fft_input, fft_output, ifft_input, ifft_output;
+	fftplan l_fft, l_ifft;
+};
+
+}; // namespace suo
@@ -0,0 +1,228 @@
+#include <iostream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "offline_decoder.hpp"
+#include "coding/crc_generic.hpp"
+#include "signal-io/conversion.hpp"
+#include "signal-io/mapped_file.hpp"
+
+using namespace suo;
+using namespace std;
+
+
+OfflineDecoder::Config::Config() {
+	sample_rate = 100e3;
+	format = "CF32";
+	chunk_duration = 60.0;
+	overlap = 1.0;
+	duplicate_window = 1000000;
+	threads = 0;
+	buffer = 4 * 4096;
+}
+
+
+OfflineDecoder::OfflineDecoder(const Config& conf, ReceiverFactory factory) :
+	conf(conf),
+	factory(factory),
+	stats{ 0, 0, 0 }
+{
+	if (conf.format == "CF32")
+		sample_size = sizeof(Sample);
+	else if (conf.format == "CS16")
+		sample_size = sizeof(cs16_t);
+	else if (conf.format == "CS8")
+		sample_size = sizeof(cs8_t);
+	else if (conf.format == "CU8")
+		sample_size = sizeof(cu8_t);
+	else
+		throw SuoError("OfflineDecoder: Unsupported format %s", conf.format.c_str());
+
+	if (conf.buffer == 0)
+		throw SuoError("OfflineDecoder: Zero buffer length");
+	if (conf.overlap < 0 || conf.chunk_duration <= conf.overlap)
+		throw SuoError("OfflineDecoder: Chunk duration must be longer than the overlap");
+	if (!factory)
+		throw SuoError("OfflineDecoder: No receiver factory");
+}
+
+
+void OfflineDecoder::decode(const std::string& filename)
+{
+	MappedFile file;
+	if (file.open(filename) == false)
+		throw SuoError("OfflineDecoder: Failed to map %s", filename.c_str());
+	decode(file.data(), file.size());
+}
+
+
+void OfflineDecoder::decode(const void* data, size_t bytes)
+{
+	const char* raw = static_cast<const char*>(data);
+	const size_t total = bytes / sample_size;
+
+	/* Chunk boundaries are aligned to the buffers so every chunk sees the same buffers as a sequential run */
+	auto align = [&](double seconds) {
+		size_t n = (size_t)ceil(seconds * conf.sample_rate);
+		return ((n + conf.buffer - 1) / conf.buffer) * conf.buffer;
+	};
+	const size_t chunk_len = align(conf.chunk_duration);
+	const size_t overlap_len = align(conf.overlap);
+	const size_t num_chunks = (total + chunk_len - 1) / chunk_len;
+	auto chunkFirst = [&](size_t c) { return c * chunk_len - min(c * chunk_len, overlap_len); };
+
+	unsigned int num_threads = conf.threads;
+	if (num_threads == 0)
+		num_threads = max(1u, thread::hardware_concurrency());
+	num_threads = min<size_t>(num_threads, num_chunks);
+
+	struct ChunkResult {
+		vector<Entry> frames;
+		bool done = false;
+	};
+	vector<ChunkResult> results(num_chunks);
+
+	mutex result_mutex;
+	condition_variable result_cond;
+	atomic<size_t> next_chunk{ 0 };
+	atomic<bool> failed{ false };
+	exception_ptr error;
+
+	auto worker = [&]() {
+		while (failed.load() == false) {
+			const size_t c = next_chunk.fetch_add(1);
+			if (c >= num_chunks)
+				break;
+
+			vector<Entry> frames;
+			try {
+				decodeChunk(raw, chunkFirst(c), c * chunk_len, min(total, (c + 1) * chunk_len), c, frames);
+			}
+			catch (...) {
+				lock_guard<mutex> lock(result_mutex);
+				error = current_exception();
+				failed = true;
+				result_cond.notify_all();
+				return;
+			}
+
+			lock_guard<mutex> lock(result_mutex);
+			results[c].frames = std::move(frames);
+			results[c].done = true;
+			result_cond.notify_all();
+		}
+	};
+
+	vector<thread> workers;
+	for (unsigned int i = 0; i < num_threads; i++)
+		workers.emplace_back(worker);
+
+	/* Merge the chunks in order. Later chunks can't produce frames before their first sample. */
+	vector<Entry> pending;
+	recent.clear();
+	try {
+		for (size_t c = 0; c < num_chunks; c++) {
+			{
+				unique_lock<mutex> lock(result_mutex);
+				result_cond.wait(lock, [&]() { return results[c].done || failed.load(); });
+				if (results[c].done == false)
+					break;
+				move(results[c].frames.begin(), results[c].frames.end(), back_inserter(pending));
+				results[c].frames.clear();
+			}
+			stats.chunks++;
+
+			Timestamp cutoff = numeric_limits<Timestamp>::max();
+			if (c + 1 < num_chunks) {
+				const Timestamp next_start = sampleTime(chunkFirst(c + 1));
+				cutoff = next_start > conf.duplicate_window ? next_start - conf.duplicate_window : 0;
+			}
+			emitFrames(pending, cutoff);
+		}
+	}
+	catch (...) {
+		/* Exception from the frame sink. Stop the workers before passing it on. */
+		failed = true;
+		for (thread& t: workers)
+			t.join();
+		throw;
+	}
+
+	for (thread& t: workers)
+		t.join();
+	if (error)
+		rethrow_exception(error);
+}
+
+
+void OfflineDecoder::decodeChunk(const char* data, size_t first, size_t start, size_t end, size_t chunk, vector<Entry>& frames)
+{
+	const CRC32 crc(CRCAlgorithms::CRC32);
+	SampleConverter converter;
+
+	/*
+	 * Frames completed during the warm-up belong to the previous chunk, which has
+	 * seen the same samples with a settled receiver. They are dropped here, so a
+	 * false lock or a corrupted copy from the warm-up never reaches the output.
+	 */
+	size_t i = first;
+	unique_ptr<Receiver> receiver = factory();
+	receiver->sinkFrame.connect([&](const Frame& frame, Timestamp now) {
+		if (i < start)
+			return;
+		frames.push_back(Entry{ Key{ now, crc.calculate(frame.data), chunk }, frame });
+	});
+
+	Pooled<SampleVector> buffer = sample_pool.acquire(conf.buffer);
+	for (; i < end; i += conf.buffer) {
+		const size_t n = min<size_t>(conf.buffer, end - i);
+		const Timestamp now = sampleTime(i);
+		buffer->resize(n);
+		converter.to_cf(conf.format, data + i * sample_size, buffer->data(), n);
+		buffer->timestamp = now;
+		receiver->sinkSamples(*buffer, now);
+	}
+}
+
+
+void OfflineDecoder::emitFrames(vector<Entry>& pending, Timestamp cutoff)
+{
+	stable_sort(pending.begin(), pending.end(), [](const Entry& a, const Entry& b) {
+		return a.key.now < b.key.now || (a.key.now == b.key.now && a.key.chunk < b.key.chunk);
+	});
+
+	auto isDuplicate = [&](const Key& a, const Key& b) {
+		const Timestamp diff = a.now > b.now ? a.now - b.now : b.now - a.now;
+		return a.crc == b.crc && a.chunk != b.chunk && diff <= conf.duplicate_window;
+	};
+
+	size_t i = 0;
+	for (; i < pending.size() && pending[i].key.now < cutoff; i++) {
+		const Key& key = pending[i].key;
+
+		while (recent.empty() == false && recent.front().now + conf.duplicate_window < key.now)
+			recent.pop_front();
+
+		/* Copies already emitted or coming later from an earlier chunk take precedence */
+		bool duplicate = false;
+		for (const Key& r: recent)
+			duplicate |= isDuplicate(key, r);
+		for (size_t j = i + 1; j < pending.size() && pending[j].key.now <= key.now + conf.duplicate_window; j++)
+			duplicate |= pending[j].key.chunk < key.chunk && isDuplicate(key, pending[j].key);
+
+		if (duplicate) {
+			stats.duplicates++;
+			continue;
+		}
+
+		sinkFrame.emit(pending[i].frame, key.now);
+		stats.frames++;
+		recent.push_back(key);
+	}
+	pending.erase(pending.begin(), pending.begin() + i);
+}
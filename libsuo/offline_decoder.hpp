@@ -0,0 +1,142 @@
+#pragma once
+
+#include <memory>
+#include <deque>
+#include <functional>
+
+#include "suo.hpp"
+
+namespace suo {
+
+/*
+ * Parallel offline decoder for IQ recordings.
+ *
+ * Splits the recording into chunks and decodes each chunk with an
+ * independent receiver chain (e.g. demodulator + deframer) on a pool of
+ * threads. Each chunk starts `overlap` seconds before its own part of
+ * the recording, so that the receiver has settled and a frame crossing
+ * the chunk boundary is completely inside the next chunk. The overlap
+ * must therefore cover the receiver's settling time (filter delays,
+ * symbol synchronization, AFC) and the longest frame.
+ *
+ * Frames which the receiver completes during the overlap are taken only
+ * from the previous chunk, so the warm-up never adds frames of its own.
+ * The frames are emitted from the calling thread in timestamp order as
+ * soon as all the chunks they can come from are done. If a frame which
+ * straddles a chunk boundary is still decoded in both chunks, the copies
+ * are recognized by the data CRC and a timestamp within `duplicate_window`,
+ * and only the copy from the earlier chunk is kept.
+ * The samples are fed in the same buffers with the same timestamps as
+ * FileIO does, so the output matches a sequential FileIO run.
+ *
+ * Example:
+ *   struct Receiver: public OfflineDecoder::Receiver {
+ *       Receiver() {
+ *           demod.sinkSymbol.connect_member(&deframer, &GolayDeframer::sinkSymbol);
+ *           deframer.sinkFrame.connect([this](const Frame& f, Timestamp t) { sinkFrame.emit(f, t); });
+ *       }
+ *       void sinkSamples(const SampleVector& samples, Timestamp now) { demod.sinkSamples(samples, now); }
+ *       GMSKContinousDemodulator demod;
+ *       GolayDeframer deframer;
+ *   };
+ *   OfflineDecoder decoder(conf, []() { return std::make_unique<Receiver>(); });
+ *   decoder.sinkFrame.connect_member(&output, &FileDump::sinkFrame);
+ *   decoder.decode("pass.cf32");
+ */
+class OfflineDecoder
+{
+public:
+
+	struct Config {
+		Config();
+
+		/* Sample rate of the recording */
+		double sample_rate;
+
+		/* Sample format: CF32, CS16, CS8 or CU8 */
+		std::string format;
+
+		/* Length of one chunk excluding the overlap [s] */
+		double chunk_duration;
+
+		/* Length of the overlap between consecutive chunks [s] */
+		double overlap;
+
+		/* Frames with the same CRC closer than this from different chunks are duplicates [ns] */
+		Timestamp duplicate_window;
+
+		/* Number of worker threads. Zero uses all the cores. */
+		unsigned int threads;
+
+		/* Number of samples passed to the receiver at once */
+		unsigned int buffer;
+	};
+
+	/*
+	 * One independent receiver chain.
+	 * Implementations feed the samples through their blocks and pass the
+	 * decoded frames to the sinkFrame port.
+	 */
+	class Receiver {
+	public:
+		virtual ~Receiver() = default;
+		virtual void sinkSamples(const SampleVector& samples, Timestamp now) = 0;
+		Port<const Frame&, Timestamp> sinkFrame;
+	};
+
+	typedef std::function<std::unique_ptr<Receiver>()> ReceiverFactory;
+
+	struct Statistics {
+		uint64_t chunks;        // Chunks decoded
+		uint64_t frames;        // Frames emitted
+		uint64_t duplicates;    // Frames dropped as duplicates
+	};
+
+	explicit OfflineDecoder(const Config& conf, ReceiverFactory factory);
+
+	/* Decode a recording file. Returns when the whole file is processed. */
+	void decode(const std::string& filename);
+
+	/* Decode a recording in memory */
+	void decode(const void* data, size_t bytes);
+
+	Statistics getStatistics() const { return stats; }
+
+	/* Decoded frames in timestamp order */
+	Port<const Frame&, Timestamp> sinkFrame;
+
+private:
+
+	/* Duplicate detection key */
+	struct Key {
+		Timestamp now;
+		uint32_t crc;
+		size_t chunk;
+	};
+
+	struct Entry {
+		Key key;
+		Frame frame;
+	};
+
+	/* Decode samples [first, end) and keep the frames completed after the chunk's own start */
+	void decodeChunk(const char* data, size_t first, size_t start, size_t end, size_t chunk, std::vector<Entry>& frames);
+
+	/* Emit the pending frames before the cutoff time and drop the duplicates */
+	void emitFrames(std::vector<Entry>& pending, Timestamp cutoff);
+
+	Timestamp sampleTime(size_t index) const {
+		return (Timestamp)(1e9 * index / conf.sample_rate);
+	}
+
+	Config conf;
+	ReceiverFactory factory;
+	size_t sample_size;
+
+	/* Recently emitted frames for the duplicate detection */
+	std::deque<Key> recent;
+
+	Statistics stats;
+};
+
+}; // namespace suo
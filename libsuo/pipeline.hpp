@@ -0,0 +1,234 @@
+#pragma once
+
+#include <tuple>
+#include <utility>
+#include <type_traits>
+
+#include "suo.hpp"
+
+namespace suo {
+
+/*
+ * Compile-time wired pipeline for static flowgraphs.
+ *
+ * Pipeline<A, B, C> passes the output of every stage directly to the next
+ * one. The wiring is resolved at compile time, so there is no Port or
+ * virtual call between the stages and the compiler is free to inline the
+ * following stage into the processing loop of the previous one.
+ *
+ * A stage can be either:
+ *
+ * 1) A static stage, which implements a process() template and hands its
+ *    outputs forward by calling next():
+ *
+ *        template <typename Next>
+ *        void process(const SampleVector& samples, Timestamp now, Next&& next) {
+ *            for (...)
+ *                next(bit, now);
+ *        }
+ *
+ *    The demodulators and deframers (e.g. GMSKContinousDemodulator and
+ *    GolayDeframer) are static stages. Outputs of the last stage are
+ *    emitted from its output Port matching the output type, e.g. sinkFrame.
+ *
+ * 2) A regular block. Its input is called directly with a qualified,
+ *    non-virtual call to the sinkX() method matching the input type.
+ *    If the block is followed by another stage, exactly one of its output
+ *    Ports is connected to the next stage: The first one in the order
+ *    sinkFrame, sinkSymbols, sinkSymbol, sinkSoftSymbols, sinkSoftSymbol,
+ *    sinkSamples whose type the next stage accepts, so the batched output
+ *    is preferred. This is the runtime-wired fallback: one Port call per
+ *    emitted item.
+ *
+ * The pipeline keeps references to the stages. It can be fed directly by
+ * calling sink() or wired to a runtime graph with a lambda:
+ *
+ *    GMSKContinousDemodulator demod(demod_conf);
+ *    GolayDeframer deframer(deframer_conf);
+ *    Pipeline<GMSKContinousDemodulator, GolayDeframer> rx(demod, deframer);
+ *    sdr.sinkSamples.connect([&](const SampleVector& s, Timestamp t) { rx.sink(s, t); });
+ */
+template <typename... Stages>
+class Pipeline
+{
+public:
+	static constexpr size_t length = sizeof...(Stages);
+
+	explicit Pipeline(Stages&... stages) :
+		stages(stages...)
+	{
+		connectOutputs(std::make_index_sequence<length>());
+	}
+
+	Pipeline(const Pipeline&) = delete;
+	Pipeline& operator=(const Pipeline&) = delete;
+
+	/* Feed input to the first stage */
+	template <typename... Args>
+	void sink(Args&&... args) {
+		deliver<0>(std::forward<Args>(args)...);
+	}
+
+	/* Access the I:th stage */
+	template <size_t I>
+	auto& stage() { return std::get<I>(stages); }
+
+private:
+
+	/* Compile-time reference to the input of the I:th stage */
+	template <size_t I>
+	struct Next {
+		Pipeline* pipeline;
+
+		template <typename... Args>
+		void operator()(Args&&... args) const {
+			if constexpr (I < length)
+				pipeline->template deliver<I>(std::forward<Args>(args)...);
+			else
+				pipeline->emitOutput(std::forward<Args>(args)...);
+		}
+	};
+
+	template <typename Stage, typename... Args>
+	static constexpr bool is_static_stage = requires (Stage& stage, Args&&... args, Next<0> next) {
+		stage.process(std::forward<Args>(args)..., next);
+	};
+
+	/* Is the stage static for any of the stream types */
+	template <typename Stage>
+	static constexpr bool is_static =
+		is_static_stage<Stage, const SampleVector&, Timestamp> ||
+		is_static_stage<Stage, const SymbolVector&, Timestamp> ||
+		is_static_stage<Stage, Symbol, Timestamp> ||
+		is_static_stage<Stage, SoftSymbol, Timestamp> ||
+		is_static_stage<Stage, const std::vector<SoftSymbol>&, Timestamp> ||
+		is_static_stage<Stage, const Frame&, Timestamp>;
+
+	/* Argument which converts only to exactly the given type, e.g. no SoftSymbol to Symbol */
+	template <typename T>
+	struct Exactly {
+		operator T() const;
+		template <typename U> operator U() const = delete;
+	};
+
+#define SUO_PIPELINE_INPUT(name) \
+	requires { requires !std::is_same_v<decltype(&Stage::name), decltype(&Block::name)>; }
+
+	/* Does the stage take the given type as input: Either as a static stage
+	 * or by its own input method instead of the throwing Block default. */
+	template <typename Stage, typename Type>
+	static constexpr bool accepts() {
+		if constexpr (is_static_stage<Stage, Exactly<Type>, Timestamp>)
+			return true;
+		else if constexpr (std::is_same_v<Type, SampleVector>)
+			return SUO_PIPELINE_INPUT(sinkSamples);
+		else if constexpr (std::is_same_v<Type, SymbolVector>)
+			return SUO_PIPELINE_INPUT(sinkSymbols);
+		else if constexpr (std::is_same_v<Type, Symbol>)
+			return SUO_PIPELINE_INPUT(sinkSymbol);
+		else if constexpr (std::is_same_v<Type, SoftSymbol>)
+			return SUO_PIPELINE_INPUT(sinkSoftSymbol);
+		else if constexpr (std::is_same_v<Type, std::vector<SoftSymbol>>)
+			return SUO_PIPELINE_INPUT(sinkSoftSymbols);
+		else if constexpr (std::is_same_v<Type, Frame>)
+			return SUO_PIPELINE_INPUT(sinkFrame);
+		else
+			return false;
+	}
+
+#undef SUO_PIPELINE_INPUT
+
+	/* Pass items to the input of the I:th stage */
+	template <size_t I, typename... Args>
+	void deliver(Args&&... args) {
+		auto& stage = std::get<I>(stages);
+		typedef std::remove_reference_t<decltype(stage)> Stage;
+
+		if constexpr (is_static_stage<Stage, Args...>)
+			stage.process(std::forward<Args>(args)..., Next<I + 1>{ this });
+		else
+			sinkBlock(stage, std::forward<Args>(args)...);
+	}
+
+	/* Call the input method of a regular block without virtual dispatch */
+	template <typename T, typename Input>
+	static void sinkBlock(T& block, Input&& input, Timestamp now) {
+		typedef std::decay_t<Input> Type;
+		if constexpr (std::is_same_v<Type, SampleVector>)
+			block.T::sinkSamples(input, now);
+		else if constexpr (std::is_same_v<Type, SymbolVector>)
+			block.T::sinkSymbols(input, now);
+		else if constexpr (std::is_same_v<Type, Symbol>)
+			block.T::sinkSymbol(input, now);
+		else if constexpr (std::is_same_v<Type, SoftSymbol>)
+			block.T::sinkSoftSymbol(input, now);
+		else if constexpr (std::is_same_v<Type, std::vector<SoftSymbol>>)
+			block.T::sinkSoftSymbols(input, now);
+		else if constexpr (std::is_same_v<Type, Frame>)
+			block.T::sinkFrame(input, now);
+		else
+			static_assert(sizeof(Type) == 0, "Pipeline: No input method for the given type");
+	}
+
+	/* Emit the outputs of the last static stage from its output Port */
+	template <typename Output>
+	void emitOutput(Output&& output, Timestamp now) {
+		auto& stage = std::get<length - 1>(stages);
+		typedef std::decay_t<Output> Type;
+		if constexpr (std::is_same_v<Type, SampleVector>)
+			stage.sinkSamples.emit(output, now);
+		else if constexpr (std::is_same_v<Type, SymbolVector>)
+			stage.sinkSymbols.emit(output, now);
+		else if constexpr (std::is_same_v<Type, Symbol>)
+			stage.sinkSymbol.emit(output, now);
+		else if constexpr (std::is_same_v<Type, SoftSymbol>)
+			stage.sinkSoftSymbol.emit(output, now);
+		else if constexpr (std::is_same_v<Type, std::vector<SoftSymbol>>)
+			stage.sinkSoftSymbols.emit(output, now);
+		else if constexpr (std::is_same_v<Type, Frame>)
+			stage.sinkFrame.emit(output, now);
+		else
+			static_assert(sizeof(Type) == 0, "Pipeline: No output port for the given type");
+	}
+
+	/* Connect the output Port of a regular block to the I:th stage */
+	template <size_t I, typename... Args>
+	void connectPort(Port<Args...>& port) {
+		port.connect([this](Args... args) {
+			deliver<I>(args...);
+		});
+	}
+
+#define SUO_PIPELINE_OUTPUT(name, Type) \
+	else if constexpr (requires { requires std::is_member_object_pointer_v<decltype(&Stage::name)>; } && accepts<NextStage, Type>()) \
+		connectPort<I + 1>(stage.name);
+
+	template <size_t I>
+	void connectOutput() {
+		if constexpr (I + 1 < length) {
+			auto& stage = std::get<I>(stages);
+			typedef std::remove_reference_t<decltype(stage)> Stage;
+			typedef std::remove_reference_t<decltype(std::get<I + 1>(stages))> NextStage;
+			if constexpr (is_static<Stage>) {
+				// Outputs are passed to the next stage by process()
+			}
+			SUO_PIPELINE_OUTPUT(sinkFrame, Frame)
+			SUO_PIPELINE_OUTPUT(sinkSymbols, SymbolVector)
+			SUO_PIPELINE_OUTPUT(sinkSymbol, Symbol)
+			SUO_PIPELINE_OUTPUT(sinkSoftSymbols, std::vector<SoftSymbol>)
+			SUO_PIPELINE_OUTPUT(sinkSoftSymbol, SoftSymbol)
+			SUO_PIPELINE_OUTPUT(sinkSamples, SampleVector)
+		}
+	}
+
+#undef SUO_PIPELINE_OUTPUT
+
+	template <size_t... I>
+	void connectOutputs(std::index_sequence<I...>) {
+		(connectOutput<I>(), ...);
+	}
+
+	std::tuple<Stages&...> stages;
+};
+
+}; // namespace suo
@@ -3,7 +3,9 @@
 // http://schneegans.github.io/tutorials/2015/09/20/signal-slot
 
 #include <functional>
-#include <map>
+#include <vector>
+#include <algorithm>
+#include <cstring>
 
 namespace suo {
 
@@ -12,10 +14,204 @@ namespace suo {
 // which will be called when the emit() method on the
 // Port object is invoked. Any argument passed to emit()
 // will be passed to the given functions.
+//
+// Slots are stored in a flat vector in connection order. Member
+// functions connected with connect_member() are called through a
+// raw instance pointer and member function pointer, so the common
+// "one block feeds one block" case is a single indirect call without
+// std::function type erasure or map traversal.
+// Only slots connected with connect() hold a std::function, which
+// is allocated separately so that member slots stay small.
+//
+// Slots connected or disconnected from inside a callback take effect
+// when the outermost emit() returns, so the slot vector is never
+// reallocated under a running callback.
+
+namespace detail {
+
+// Member function pointers are two words on the Itanium ABI.
+// Reserve enough room for any non-virtual-inheritance member pointer.
+struct UndefinedClass;
+typedef void (UndefinedClass::* GenericMemberFunction)();
+constexpr size_t member_function_size = sizeof(GenericMemberFunction);
+
+template <typename Ret, typename... Args>
+struct PortSlot {
+	typedef Ret (*Invoker)(const PortSlot&, Args...);
+	typedef std::function<Ret(Args...)> Function;
+
+	int id;
+	bool owns_function;
+	Invoker invoke;
+	void* instance;  // Object of a member slot or the owned Function of a generic slot
+	alignas(GenericMemberFunction) unsigned char method[member_function_size];
+
+	PortSlot() : id(0), owns_function(false), invoke(nullptr), instance(nullptr) { }
+	~PortSlot() { release(); }
+
+	// Slots are moved between the slot vectors but never copied
+	PortSlot(const PortSlot&) = delete;
+	PortSlot& operator=(const PortSlot&) = delete;
+
+	PortSlot(PortSlot&& other) noexcept { take(other); }
+
+	PortSlot& operator=(PortSlot&& other) noexcept {
+		if (this != &other) {
+			release();
+			take(other);
+		}
+		return *this;
+	}
+
+	// Call a member function via the raw instance and method pointer
+	template <typename T, typename F>
+	static Ret invoke_member(const PortSlot& slot, Args... args) {
+		F func;
+		std::memcpy(&func, slot.method, sizeof(F));
+		return (static_cast<T*>(slot.instance)->*func)(args...);
+	}
+
+	// Call a generic std::function
+	static Ret invoke_function(const PortSlot& slot, Args... args) {
+		return (*static_cast<const Function*>(slot.instance))(args...);
+	}
+
+	template <typename T, typename F>
+	static PortSlot from_member(int id, T* inst, F func) {
+		static_assert(sizeof(F) <= member_function_size, "Member function pointer too large for a Port slot");
+		PortSlot slot;
+		slot.id = id;
+		slot.invoke = &invoke_member<T, F>;
+		slot.instance = const_cast<void*>(static_cast<const void*>(inst));
+		std::memcpy(slot.method, &func, sizeof(F));
+		return slot;
+	}
+
+	// Generic callables are held in a heap allocated std::function owned by the slot
+	static PortSlot from_function(int id, Function const& func) {
+		PortSlot slot;
+		slot.id = id;
+		slot.owns_function = true;
+		slot.invoke = &invoke_function;
+		slot.instance = new Function(func);
+		return slot;
+	}
+
+private:
+	void take(PortSlot& other) {
+		id = other.id;
+		owns_function = other.owns_function;
+		invoke = other.invoke;
+		instance = other.instance;
+		std::memcpy(method, other.method, sizeof(method));
+		other.owns_function = false;
+		other.instance = nullptr;
+	}
+
+	void release() {
+		if (owns_function)
+			delete static_cast<Function*>(instance);
+		owns_function = false;
+		instance = nullptr;
+	}
+};
+
+
+// Flat slot storage shared by Port and SourcePort.
+// Changes made while an emit is running are deferred until it finishes.
+template <typename Slot>
+struct SlotList {
+	std::vector<Slot> slots;
+	std::vector<Slot> pending_connect;
+	std::vector<int> pending_disconnect;
+	bool pending_clear = false;
+	unsigned int emit_depth = 0;
+	int current_id = 0;
+
+	// Marks an emit in progress for the lifetime of the object
+	struct EmitGuard {
+		SlotList& list;
+		explicit EmitGuard(SlotList& list) : list(list) { list.emit_depth++; }
+		~EmitGuard() {
+			if (--list.emit_depth == 0 && list.has_pending())
+				list.apply_pending();
+		}
+	};
+
+	int add(Slot&& slot) {
+		if (emit_depth > 0)
+			pending_connect.push_back(std::move(slot));
+		else
+			slots.push_back(std::move(slot));
+		return current_id;
+	}
+
+	void remove(int id) {
+		if (emit_depth > 0) {
+			auto it = find(pending_connect, id);
+			if (it != pending_connect.end())
+				pending_connect.erase(it);
+			else
+				pending_disconnect.push_back(id);
+			return;
+		}
+		auto it = find(slots, id);
+		if (it != slots.end())
+			slots.erase(it);
+	}
+
+	void clear() {
+		pending_connect.clear();
+		if (emit_depth > 0) {
+			pending_disconnect.clear();
+			pending_clear = true;
+			return;
+		}
+		slots.clear();
+	}
+
+	bool has_pending() const {
+		return pending_clear || pending_connect.empty() == false || pending_disconnect.empty() == false;
+	}
+
+	void apply_pending() {
+		if (pending_clear)
+			slots.clear();
+		for (int id: pending_disconnect) {
+			auto it = find(slots, id);
+			if (it != slots.end())
+				slots.erase(it);
+		}
+		for (Slot& slot: pending_connect)
+			slots.push_back(std::move(slot));
+		pending_connect.clear();
+		pending_disconnect.clear();
+		pending_clear = false;
+	}
+
+	// Slot IDs are monotonically increasing so the vectors are always sorted by ID.
+	static typename std::vector<Slot>::iterator find(std::vector<Slot>& v, int id) {
+		auto it = std::lower_bound(v.begin(), v.end(), id,
+			[](const Slot& slot, int id) { return slot.id < id; });
+		if (it != v.end() && it->id == id)
+			return it;
+		return v.end();
+	}
+
+	typename std::vector<Slot>::iterator find(int id) {
+		return find(slots, id);
+	}
+};
+
+}; // namespace detail
+
 
 template <typename... Args>
 class Port {
 
+	typedef detail::PortSlot<void, Args...> Slot;
+	typedef detail::SlotList<Slot> SlotList;
+
 public:
 	Port() = default;
 	~Port() = default;
@@ -32,13 +228,11 @@ public:
 
 	// Move constructor and assignment operator work as expected.
 	Port(Port&& other) noexcept :
-		_slots(std::move(other._slots)),
-		_current_id(other._current_id) {}
+		_list(std::move(other._list)) {}
 
 	Port& operator=(Port&& other) noexcept {
 		if (this != &other) {
-			_slots = std::move(other._slots);
-			_current_id = other._current_id;
+			_list = std::move(other._list);
 		}
 
 		return *this;
@@ -48,69 +242,74 @@ public:
 	// Connects a std::function to the Port. The returned
 	// value can be used to disconnect the function again.
 	int connect(std::function<void(Args...)> const& slot) const {
-		_slots.insert(std::make_pair(++_current_id, slot));
-		return _current_id;
+		return _list.add(Slot::from_function(++_list.current_id, slot));
 	}
 
 	// Convenience method to connect a member function of an
 	// object to this Port.
 	template <typename T>
 	int connect_member(T* inst, void (T::* func)(Args...)) {
-		return connect([=](Args... args) {
-			(inst->*func)(args...);
-			});
+		return _list.add(Slot::from_member(++_list.current_id, inst, func));
 	}
 
 	// Convenience method to connect a const member function
 	// of an object to this Port.
 	template <typename T>
 	int connect_member(T* inst, void (T::* func)(Args...) const) {
-		return connect([=](Args... args) {
-			(inst->*func)(args...);
-			});
+		return _list.add(Slot::from_member(++_list.current_id, inst, func));
 	}
 
 	// Disconnects a previously connected function.
 	void disconnect(int id) const {
-		_slots.erase(id);
+		_list.remove(id);
 	}
 
 	// Disconnects all previously connected functions.
 	void disconnect_all() const {
-		_slots.clear();
+		_list.clear();
 	}
 
 	// Calls all connected functions.
 	void emit(Args... p) {
-		for (auto const& it : _slots) {
-			it.second(p...);
+		typename SlotList::EmitGuard guard(_list);
+		// Fast path for the single subscriber case
+		if (_list.slots.size() == 1) {
+			const Slot& slot = _list.slots.front();
+			slot.invoke(slot, p...);
+			return;
+		}
+		for (size_t i = 0; i < _list.slots.size(); i++) {
+			const Slot& slot = _list.slots[i];
+			slot.invoke(slot, p...);
 		}
 	}
 
 	// Calls all connected functions except for one.
 	void emit_for_all_but_one(int excludedConnectionID, Args... p) {
-		for (auto const& it : _slots) {
-			if (it.first != excludedConnectionID) {
-				it.second(p...);
+		typename SlotList::EmitGuard guard(_list);
+		for (size_t i = 0; i < _list.slots.size(); i++) {
+			const Slot& slot = _list.slots[i];
+			if (slot.id != excludedConnectionID) {
+				slot.invoke(slot, p...);
 			}
 		}
 	}
 
 	// Calls only one connected function.
 	void emit_for(int connectionID, Args... p) {
-		auto const& it = _slots.find(connectionID);
-		if (it != _slots.end()) {
-			it->second(p...);
+		typename SlotList::EmitGuard guard(_list);
+		auto it = _list.find(connectionID);
+		if (it != _list.slots.end()) {
+			it->invoke(*it, p...);
 		}
 	}
 
 	bool has_connections() const {
-		return _slots.empty() == false;
+		return _list.slots.empty() == false;
 	}
 
 private:
-	mutable std::map<int, std::function<void(Args...)>> _slots;
-	mutable int _current_id{ 0 };
+	mutable SlotList _list;
 };
 
 
@@ -118,6 +317,9 @@ private:
 template <typename Ret, typename... Args>
 class SourcePort {
 
+	typedef detail::PortSlot<Ret, Args...> Slot;
+	typedef detail::SlotList<Slot> SlotList;
+
 public:
 	SourcePort() = default;
 	~SourcePort() = default;
@@ -134,13 +336,11 @@ public:
 
 	// Move constructor and assignment operator work as expected.
 	SourcePort(SourcePort&& other) noexcept:
-		_slots(std::move(other._slots)),
-		_current_id(other._current_id) {}
+		_list(std::move(other._list)) {}
 
 	SourcePort& operator=(SourcePort&& other) noexcept {
 		if (this != &other) {
-			_slots = std::move(other._slots);
-			_current_id = other._current_id;
+			_list = std::move(other._list);
 		}
 
 		return *this;
@@ -150,42 +350,44 @@ public:
 	// Connects a std::function to the SourcePort. The returned
 	// value can be used to disconnect the function again.
 	int connect(std::function<Ret(Args...)> const& slot) const {
-		_slots.insert(std::make_pair(++_current_id, slot));
-		return _current_id;
+		return _list.add(Slot::from_function(++_list.current_id, slot));
 	}
 
 	// Convenience method to connect a member function of an
 	// object to this SourcePort.
 	template <typename T>
 	int connect_member(T* inst, Ret (T::* func)(Args...)) {
-		return connect([=](Args... args) -> Ret {
-			return (inst->*func)(args...);
-			});
+		return _list.add(Slot::from_member(++_list.current_id, inst, func));
 	}
 
 	// Convenience method to connect a const member function
 	// of an object to this SourcePort.
 	template <typename T>
 	int connect_member(T* inst, Ret (T::* func)(Args...) const) {
-		return connect([=](Args... args) -> Ret {
-			return (inst->*func)(args...);
-			});
+		return _list.add(Slot::from_member(++_list.current_id, inst, func));
 	}
 
 	// Disconnects a previously connected function.
 	void disconnect(int id) const {
-		_slots.erase(id);
+		_list.remove(id);
 	}
 
 	// Disconnects all previously connected functions.
 	void disconnect_all() const {
-		_slots.clear();
+		_list.clear();
 	}
 
-	// Calls all connected functions.
+	// Calls all connected functions until one of them returns a non-empty value.
 	Ret emit(Args... p) {
-		for (auto const& it : _slots) {
-			Ret ret = it.second(p...);
+		typename SlotList::EmitGuard guard(_list);
+		// Fast path for the single subscriber case
+		if (_list.slots.size() == 1) {
+			const Slot& slot = _list.slots.front();
+			return slot.invoke(slot, p...);
+		}
+		for (size_t i = 0; i < _list.slots.size(); i++) {
+			const Slot& slot = _list.slots[i];
+			Ret ret = slot.invoke(slot, p...);
 			if (ret)
 				return ret;
 		}
@@ -194,19 +396,20 @@ public:
 
 	// Calls only one connected function.
 	Ret emit_for(int connectionID, Args... p) {
-		auto const& it = _slots.find(connectionID);
-		if (it != _slots.end()) {
-			return it->second(p...);
+		typename SlotList::EmitGuard guard(_list);
+		auto it = _list.find(connectionID);
+		if (it != _list.slots.end()) {
+			return it->invoke(*it, p...);
 		}
+		return Ret();
 	}
 
 	bool has_connections() const {
-		return _slots.empty() == false;
+		return _list.slots.empty() == false;
 	}
 
 private:
-	mutable std::map<int, std::function<Ret(Args...)>> _slots;
-	mutable int _current_id{ 0 };
+	mutable SlotList _list;
 };
 
 
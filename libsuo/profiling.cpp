@@ -0,0 +1,261 @@
+#include "profiling.hpp"
+#include "suo.hpp"
+#include "json.hpp"
+
+#include <map>
+#include <mutex>
+
+using namespace suo;
+using namespace std;
+
+
+thread_local ProfileScope* ProfileScope::current = nullptr;
+
+
+namespace {
+
+const size_t chunk_size = 256;        // Counters per chunk
+const size_t max_chunks = 256;        // Max 65536 profile points
+
+struct ThreadCounters;
+
+struct PointInfo {
+	string type;
+	string block;
+	string entry;
+	bool alive;
+	chrono::steady_clock::time_point created;
+};
+
+/* Plain sums of the counters of the exited threads */
+struct RetiredCounter {
+	uint64_t calls = 0, items = 0, drops = 0, total_ns = 0, self_ns = 0, max_ns = 0;
+};
+
+struct ProfileRegistry {
+	mutex lock;
+	vector<PointInfo> points;
+	vector<unsigned int> free_ids;
+	vector<ThreadCounters*> threads;
+	vector<RetiredCounter> retired;
+	map<string, unsigned int> instances;
+};
+
+/* Never destroyed, because thread local counters and static blocks can outlive it */
+ProfileRegistry& registry() {
+	static ProfileRegistry* registry = new ProfileRegistry();
+	return *registry;
+}
+
+
+/*
+ * Counters of one thread. Chunks are allocated on demand and never moved,
+ * so other threads can read them while the owner keeps on counting.
+ */
+struct ThreadCounters {
+	atomic<detail::ProfileCounter*> chunks[max_chunks];
+
+	ThreadCounters() {
+		for (size_t i = 0; i < max_chunks; i++)
+			chunks[i].store(nullptr, memory_order_relaxed);
+		ProfileRegistry& reg = registry();
+		lock_guard<mutex> guard(reg.lock);
+		reg.threads.push_back(this);
+	}
+
+	~ThreadCounters() {
+		ProfileRegistry& reg = registry();
+		lock_guard<mutex> guard(reg.lock);
+
+		// Keep the counts of the exited thread
+		for (size_t id = 0; id < reg.points.size(); id++) {
+			detail::ProfileCounter* counter = get(id);
+			if (counter == nullptr)
+				continue;
+			RetiredCounter& r = reg.retired[id];
+			r.calls += counter->calls.load(memory_order_relaxed);
+			r.items += counter->items.load(memory_order_relaxed);
+			r.drops += counter->drops.load(memory_order_relaxed);
+			r.total_ns += counter->total_ns.load(memory_order_relaxed);
+			r.self_ns += counter->self_ns.load(memory_order_relaxed);
+			r.max_ns = max(r.max_ns, counter->max_ns.load(memory_order_relaxed));
+		}
+
+		reg.threads.erase(find(reg.threads.begin(), reg.threads.end(), this));
+		for (size_t i = 0; i < max_chunks; i++)
+			delete[] chunks[i].load(memory_order_relaxed);
+	}
+
+	/* Get counter without allocating. Returns nullptr if the thread has never touched the point. */
+	detail::ProfileCounter* get(size_t index) const {
+		detail::ProfileCounter* chunk = chunks[index / chunk_size].load(memory_order_acquire);
+		return chunk ? &chunk[index % chunk_size] : nullptr;
+	}
+};
+
+thread_local ThreadCounters thread_counters;
+
+
+void clear_counter(detail::ProfileCounter& counter) {
+	counter.calls.store(0, memory_order_relaxed);
+	counter.items.store(0, memory_order_relaxed);
+	counter.drops.store(0, memory_order_relaxed);
+	counter.total_ns.store(0, memory_order_relaxed);
+	counter.self_ns.store(0, memory_order_relaxed);
+	counter.max_ns.store(0, memory_order_relaxed);
+}
+
+
+unsigned int register_point(const string& type, const char* entry)
+{
+	ProfileRegistry& reg = registry();
+	lock_guard<mutex> guard(reg.lock);
+
+	unsigned int id;
+	if (reg.free_ids.empty() == false) {
+		id = reg.free_ids.back();
+		reg.free_ids.pop_back();
+	}
+	else {
+		if (reg.points.size() >= chunk_size * max_chunks)
+			throw SuoError("Too many profile points");
+		id = reg.points.size();
+		reg.points.emplace_back();
+		reg.retired.emplace_back();
+	}
+
+	// Entry points of the same block instance get the same instance number
+	unsigned int& instances = reg.instances[type + "." + entry];
+
+	PointInfo& info = reg.points[id];
+	info.type = type;
+	info.block = type + "#" + to_string(instances++);
+	info.entry = entry;
+	info.alive = true;
+	info.created = chrono::steady_clock::now();
+	return id;
+}
+
+};
+
+
+detail::ProfileCounter& suo::detail::profile_counter(unsigned int index)
+{
+	ThreadCounters& counters = thread_counters;
+	atomic<ProfileCounter*>& slot = counters.chunks[index / chunk_size];
+	ProfileCounter* chunk = slot.load(memory_order_relaxed);
+	if (chunk == nullptr) {
+		chunk = new ProfileCounter[chunk_size];
+		slot.store(chunk, memory_order_release);
+	}
+	return chunk[index % chunk_size];
+}
+
+
+ProfilePoint::ProfilePoint(const char* block, const char* entry) :
+	id(register_point(block, entry))
+{ }
+
+
+ProfilePoint::ProfilePoint(const ProfilePoint& other)
+{
+	string type, entry;
+	{
+		ProfileRegistry& reg = registry();
+		lock_guard<mutex> guard(reg.lock);
+		type = reg.points[other.id].type;
+		entry = reg.points[other.id].entry;
+	}
+	id = register_point(type, entry.c_str());
+}
+
+
+ProfilePoint::~ProfilePoint()
+{
+	ProfileRegistry& reg = registry();
+	lock_guard<mutex> guard(reg.lock);
+
+	// Nobody counts to a destroyed point so the counters can be cleared for reuse
+	for (ThreadCounters* thread: reg.threads) {
+		detail::ProfileCounter* counter = thread->get(id);
+		if (counter != nullptr)
+			clear_counter(*counter);
+	}
+	reg.retired[id] = RetiredCounter();
+	reg.points[id].alive = false;
+	reg.free_ids.push_back(id);
+}
+
+
+void ProfilePoint::drop(uint64_t items)
+{
+	detail::profile_add(detail::profile_counter(id).drops, items);
+}
+
+
+std::vector<ProfileStatistics> suo::getProfile()
+{
+	ProfileRegistry& reg = registry();
+	lock_guard<mutex> guard(reg.lock);
+	const auto now = chrono::steady_clock::now();
+
+	vector<ProfileStatistics> profile;
+	for (size_t id = 0; id < reg.points.size(); id++) {
+		const PointInfo& info = reg.points[id];
+		if (info.alive == false)
+			continue;
+
+		const RetiredCounter& r = reg.retired[id];
+		ProfileStatistics stats;
+		stats.block = info.block;
+		stats.entry = info.entry;
+		stats.calls = r.calls;
+		stats.items = r.items;
+		stats.drops = r.drops;
+		stats.total_ns = r.total_ns;
+		stats.self_ns = r.self_ns;
+		stats.max_ns = r.max_ns;
+
+		for (ThreadCounters* thread: reg.threads) {
+			const detail::ProfileCounter* counter = thread->get(id);
+			if (counter == nullptr)
+				continue;
+			stats.calls += counter->calls.load(memory_order_relaxed);
+			stats.items += counter->items.load(memory_order_relaxed);
+			stats.drops += counter->drops.load(memory_order_relaxed);
+			stats.total_ns += counter->total_ns.load(memory_order_relaxed);
+			stats.self_ns += counter->self_ns.load(memory_order_relaxed);
+			stats.max_ns = max(stats.max_ns, counter->max_ns.load(memory_order_relaxed));
+		}
+
+		const double elapsed = chrono::duration<double>(now - info.created).count();
+		stats.call_rate = elapsed > 0 ? stats.calls / elapsed : 0;
+		stats.item_rate = elapsed > 0 ? stats.items / elapsed : 0;
+		profile.push_back(stats);
+	}
+	return profile;
+}
+
+
+std::string suo::getProfileJSON()
+{
+	nlohmann::json blocks = nlohmann::json::array();
+	for (const ProfileStatistics& stats: getProfile()) {
+		blocks.push_back({
+			{ "block", stats.block },
+			{ "entry", stats.entry },
+			{ "calls", stats.calls },
+			{ "items", stats.items },
+			{ "drops", stats.drops },
+			{ "total_ns", stats.total_ns },
+			{ "self_ns", stats.self_ns },
+			{ "max_ns", stats.max_ns },
+			{ "call_rate", stats.call_rate },
+			{ "item_rate", stats.item_rate },
+		});
+	}
+
+	nlohmann::json dict;
+	dict["profile"] = blocks;
+	return dict.dump();
+}
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace suo {
+
+/*
+ * Opt-in per-block profiling.
+ *
+ * Blocks declare a profile point for each entry point and open a scope for
+ * every call:
+ *
+ *    class GolayDeframer : public Block {
+ *        ...
+ *        SUO_PROFILE_POINT(profile_symbol, "GolayDeframer", "sinkSymbol");
+ *    };
+ *
+ *    void GolayDeframer::sinkSymbol(Symbol bit, Timestamp now) {
+ *        SUO_PROFILE(profile_symbol, 1);
+ *        ...
+ *    }
+ *
+ * The counters are kept per thread so the hot path doesn't take locks or do
+ * atomic read-modify-writes. Time spent in nested scopes (i.e. in the blocks
+ * called via the output Ports) is counted as the total time of the caller
+ * but not as its self time.
+ *
+ * The macros expand to nothing unless the library is built with
+ * SUO_PROFILING defined (cmake -DSUO_PROFILING=ON).
+ */
+
+/* Profile of one entry point of a block instance */
+struct ProfileStatistics {
+	std::string block;      // Block instance, e.g. "GolayDeframer#0"
+	std::string entry;      // Entry point, e.g. "sinkSymbol"
+	uint64_t calls;         // Number of calls
+	uint64_t items;         // Number of processed items (samples, symbols, frames)
+	uint64_t drops;         // Number of dropped items
+	uint64_t total_ns;      // Cumulative time including the nested scopes [ns]
+	uint64_t self_ns;       // Cumulative time excluding the nested scopes [ns]
+	uint64_t max_ns;        // Longest single call [ns]
+	double call_rate;       // Calls per second since the point was created
+	double item_rate;       // Items per second since the point was created
+};
+
+
+/*
+ * Profiled entry point of a block instance.
+ */
+class ProfilePoint
+{
+public:
+	ProfilePoint(const char* block, const char* entry);
+	ProfilePoint(const ProfilePoint& other);
+	~ProfilePoint();
+
+	ProfilePoint& operator=(const ProfilePoint&) { return *this; }
+
+	/* Count dropped items (e.g. on queue overflow) */
+	void drop(uint64_t items = 1);
+
+	unsigned int index() const { return id; }
+
+private:
+	unsigned int id;
+};
+
+
+namespace detail {
+
+/* Counters of one profile point in one thread. Written only by the owning thread. */
+struct ProfileCounter {
+	std::atomic<uint64_t> calls{ 0 };
+	std::atomic<uint64_t> items{ 0 };
+	std::atomic<uint64_t> drops{ 0 };
+	std::atomic<uint64_t> total_ns{ 0 };
+	std::atomic<uint64_t> self_ns{ 0 };
+	std::atomic<uint64_t> max_ns{ 0 };
+};
+
+/* Get the calling thread's counter of the point */
+ProfileCounter& profile_counter(unsigned int index);
+
+/* Add to a single-writer counter without read-modify-write atomics */
+inline void profile_add(std::atomic<uint64_t>& counter, uint64_t value) {
+	counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+}; // namespace detail
+
+
+/*
+ * Measures one call of a profiled entry point.
+ */
+class ProfileScope
+{
+public:
+	ProfileScope(ProfilePoint& point, uint64_t items) :
+		counter(detail::profile_counter(point.index())),
+		items(items),
+		child_ns(0),
+		parent(current)
+	{
+		current = this;
+		start = std::chrono::steady_clock::now();
+	}
+
+	~ProfileScope() {
+		const uint64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - start).count();
+		current = parent;
+		if (parent != nullptr)
+			parent->child_ns += elapsed;
+
+		detail::profile_add(counter.calls, 1);
+		detail::profile_add(counter.items, items);
+		detail::profile_add(counter.total_ns, elapsed);
+		detail::profile_add(counter.self_ns, elapsed > child_ns ? elapsed - child_ns : 0);
+		if (elapsed > counter.max_ns.load(std::memory_order_relaxed))
+			counter.max_ns.store(elapsed, std::memory_order_relaxed);
+	}
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+
+	/* Set the number of processed items if it's known only at the end of the call */
+	void setItems(uint64_t n) { items = n; }
+
+private:
+	detail::ProfileCounter& counter;
+	uint64_t items;
+	uint64_t child_ns;
+	ProfileScope* parent;
+	std::chrono::steady_clock::time_point start;
+
+	static thread_local ProfileScope* current;
+};
+
+
+/*
+ * Snapshot of all live profile points summed over the threads.
+ * Can be called from any thread.
+ */
+std::vector<ProfileStatistics> getProfile();
+
+/* Snapshot as a JSON string */
+std::string getProfileJSON();
+
+
+#ifdef SUO_PROFILING
+#define SUO_PROFILE_POINT(name, block, entry) suo::ProfilePoint name{ block, entry }
+#define SUO_PROFILE(point, items) suo::ProfileScope _suo_profile_scope(point, items)
+#define SUO_PROFILE_ITEMS(items) _suo_profile_scope.setItems(items)
+#define SUO_PROFILE_DROP(point, items) (point).drop(items)
+#else
+#define SUO_PROFILE_POINT(name, block, entry)
+#define SUO_PROFILE(point, items) do { } while (0)
+#define SUO_PROFILE_ITEMS(items) do { } while (0)
+#define SUO_PROFILE_DROP(point, items) do { } while (0)
+#endif
+
+}; // namespace suo
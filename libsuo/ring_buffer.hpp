@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+
+namespace suo {
+
+/*
+ * Bounded lock-free single-producer/single-consumer ring buffer.
+ *
+ * The slots are allocated once in the constructor and reused, so pushing
+ * a vector or a frame into a slot only copies the contents into the
+ * already allocated slot object. The consumer reads the item in place
+ * and releases the slot with pop().
+ *
+ * Exactly one thread may call the producer methods (acquire, commit)
+ * and exactly one thread may call the consumer methods (front, pop).
+ */
+template <typename T>
+class SPSCRing
+{
+public:
+
+	explicit SPSCRing(size_t min_capacity) :
+		head(0),
+		cached_tail(0),
+		tail(0),
+		cached_head(0)
+	{
+		// Round capacity up to the next power of two
+		size_t capacity = 2;
+		while (capacity < min_capacity)
+			capacity <<= 1;
+		slots.resize(capacity);
+		mask = capacity - 1;
+	}
+
+	SPSCRing(const SPSCRing&) = delete;
+	SPSCRing& operator=(const SPSCRing&) = delete;
+
+	/* Producer: Get the next free slot or nullptr if the ring is full. */
+	T* acquire() {
+		const size_t h = head.load(std::memory_order_relaxed);
+		if (h - cached_tail > mask) {
+			cached_tail = tail.load(std::memory_order_acquire);
+			if (h - cached_tail > mask)
+				return nullptr;
+		}
+		return &slots[h & mask];
+	}
+
+	/* Producer: Publish the slot returned by acquire() to the consumer. */
+	void commit() {
+		head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	/* Consumer: Get the oldest item or nullptr if the ring is empty. */
+	T* front() {
+		const size_t t = tail.load(std::memory_order_relaxed);
+		if (t == cached_head) {
+			cached_head = head.load(std::memory_order_acquire);
+			if (t == cached_head)
+				return nullptr;
+		}
+		return &slots[t & mask];
+	}
+
+	/* Consumer: Release the slot returned by front() back to the producer. */
+	void pop() {
+		tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+
+	/*
+	 * Number of items in the ring. Only approximate when called from a third thread.
+	 * The tail is loaded first so that the difference can't go negative, and the
+	 * result is limited to the capacity if both ends moved between the loads.
+	 */
+	size_t size() const {
+		const size_t t = tail.load(std::memory_order_acquire);
+		const size_t h = head.load(std::memory_order_acquire);
+		return std::min(h - t, mask + 1);
+	}
+
+	bool empty() const {
+		return size() == 0;
+	}
+
+	size_t capacity() const {
+		return mask + 1;
+	}
+
+private:
+	std::vector<T> slots;
+	size_t mask;
+
+	/* Producer side. The consumer's position is cached to avoid cache line ping-pong. */
+	alignas(64) std::atomic<size_t> head;
+	size_t cached_tail;
+
+	/* Consumer side */
+	alignas(64) std::atomic<size_t> tail;
+	size_t cached_head;
+};
+
+}; // namespace suo
@@ -0,0 +1,382 @@
+
+#include "suo.hpp"
+#include "signal-io/conversion.hpp"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SUO_CONVERSION_X86
+#endif
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#define SUO_CONVERSION_NEON
+#endif
+
+
+using namespace std;
+using namespace suo;
+
+
+/*
+ * Every kernel loads a block of input before storing the block of output,
+ * and the tails are handled with the scalar functions, so the in place
+ * layouts described in the header work with all of them.
+ */
+
+static void cs16_scalar(const cs16_t *in, Sample *out, size_t n, float scale) { suo::cs16_to_cf(in, out, n, scale); }
+static void cs8_scalar(const cs8_t *in, Sample *out, size_t n, float scale) { suo::cs8_to_cf(in, out, n, scale); }
+static void cu8_scalar(const cu8_t *in, Sample *out, size_t n) { suo::cu8_to_cf(in, out, n); }
+static void cf_cs16_scalar(const Sample *in, cs16_t *out, size_t n, float scale) { suo::cf_to_cs16(in, out, n, scale); }
+
+static const float cu8_dc = -127.4f;
+static const float cu8_scale = 1.0f / 127.6f;
+
+
+#ifdef SUO_CONVERSION_X86
+
+__attribute__((target("avx2")))
+static void cs16_avx2(const cs16_t *in, Sample *out, size_t n, float scale)
+{
+	const int16_t* s = &in[0][0];
+	float* f = reinterpret_cast<float*>(out);
+	const __m256 g = _mm256_set1_ps(scale);
+
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m128i a = _mm_loadu_si128((const __m128i*)(s + 2 * i));
+		__m128i b = _mm_loadu_si128((const __m128i*)(s + 2 * i + 8));
+		__m256 fa = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(a)), g);
+		__m256 fb = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(b)), g);
+		_mm256_storeu_ps(f + 2 * i, fa);
+		_mm256_storeu_ps(f + 2 * i + 8, fb);
+	}
+	suo::cs16_to_cf(in + i, out + i, n - i, scale);
+}
+
+
+__attribute__((target("avx2")))
+static void cs8_avx2(const cs8_t *in, Sample *out, size_t n, float scale)
+{
+	const int8_t* s = &in[0][0];
+	float* f = reinterpret_cast<float*>(out);
+	const __m256 g = _mm256_set1_ps(scale);
+
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m128i v = _mm_loadu_si128((const __m128i*)(s + 2 * i));
+		__m256 fa = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(v)), g);
+		__m256 fb = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_srli_si128(v, 8))), g);
+		_mm256_storeu_ps(f + 2 * i, fa);
+		_mm256_storeu_ps(f + 2 * i + 8, fb);
+	}
+	suo::cs8_to_cf(in + i, out + i, n - i, scale);
+}
+
+
+__attribute__((target("avx2")))
+static void cu8_avx2(const cu8_t *in, Sample *out, size_t n)
+{
+	const uint8_t* s = &in[0][0];
+	float* f = reinterpret_cast<float*>(out);
+	const __m256 dc = _mm256_set1_ps(cu8_dc);
+	const __m256 g = _mm256_set1_ps(cu8_scale);
+
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m128i v = _mm_loadu_si128((const __m128i*)(s + 2 * i));
+		__m256 fa = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(v));
+		__m256 fb = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(v, 8)));
+		_mm256_storeu_ps(f + 2 * i, _mm256_mul_ps(_mm256_add_ps(fa, dc), g));
+		_mm256_storeu_ps(f + 2 * i + 8, _mm256_mul_ps(_mm256_add_ps(fb, dc), g));
+	}
+	suo::cu8_to_cf(in + i, out + i, n - i);
+}
+
+
+__attribute__((target("avx2")))
+static void cf_cs16_avx2(const Sample *in, cs16_t *out, size_t n, float scale)
+{
+	const float* f = reinterpret_cast<const float*>(in);
+	int16_t* d = &out[0][0];
+	const __m256 g = _mm256_set1_ps(scale);
+	const __m256 lo = _mm256_set1_ps(-32768.0f);
+	const __m256 hi = _mm256_set1_ps(32767.0f);
+
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		__m256 a = _mm256_mul_ps(_mm256_loadu_ps(f + 2 * i), g);
+		__m256 b = _mm256_mul_ps(_mm256_loadu_ps(f + 2 * i + 8), g);
+		a = _mm256_min_ps(_mm256_max_ps(a, lo), hi);
+		b = _mm256_min_ps(_mm256_max_ps(b, lo), hi);
+
+		/* The pack works within 128-bit lanes so the quarters need to be reordered */
+		__m256i p = _mm256_packs_epi32(_mm256_cvtps_epi32(a), _mm256_cvtps_epi32(b));
+		p = _mm256_permute4x64_epi64(p, _MM_SHUFFLE(3, 1, 2, 0));
+		_mm256_storeu_si256((__m256i*)(d + 2 * i), p);
+	}
+	suo::cf_to_cs16(in + i, out + i, n - i, scale);
+}
+
+
+__attribute__((target("sse4.1")))
+static void cs16_sse4(const cs16_t *in, Sample *out, size_t n, float scale)
+{
+	const int16_t* s = &in[0][0];
+	float* f = reinterpret_cast<float*>(out);
+	const __m128 g = _mm_set1_ps(scale);
+
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m128i v = _mm_loadu_si128((const __m128i*)(s + 2 * i));
+		__m128 fa = _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepi16_epi32(v)), g);
+		__m128 fb = _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepi16_epi32(_mm_srli_si128(v, 8))), g);
+		_mm_storeu_ps(f + 2 * i, fa);
+		_mm_storeu_ps(f + 2 * i + 4, fb);
+	}
+	suo::cs16_to_cf(in + i, out + i, n - i, scale);
+}
+
+
+__attribute__((target("sse4.1")))
+static void cs8_sse4(const cs8_t *in, Sample *out, size_t n, float scale)
+{
+	const int8_t* s = &in[0][0];
+	float* f = reinterpret_cast<float*>(out);
+	const __m128 g = _mm_set1_ps(scale);
+
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m128i v = _mm_loadl_epi64((const __m128i*)(s + 2 * i));
+		__m128 fa = _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepi8_epi32(v)), g);
+		__m128 fb = _mm_mul_ps(_mm_cvtepi32_ps(_mm_cvtepi8_epi32(_mm_srli_si128(v, 4))), g);
+		_mm_storeu_ps(f + 2 * i, fa);
+		_mm_storeu_ps(f + 2 * i + 4, fb);
+	}
+	suo::cs8_to_cf(in + i, out + i, n - i, scale);
+}
+
+
+__attribute__((target("sse4.1")))
+static void cu8_sse4(const cu8_t *in, Sample *out, size_t n)
+{
+	const uint8_t* s = &in[0][0];
+	float* f = reinterpret_cast<float*>(out);
+	const __m128 dc = _mm_set1_ps(cu8_dc);
+	const __m128 g = _mm_set1_ps(cu8_scale);
+
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m128i v = _mm_loadl_epi64((const __m128i*)(s + 2 * i));
+		__m128 fa = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(v));
+		__m128 fb = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(v, 4)));
+		_mm_storeu_ps(f + 2 * i, _mm_mul_ps(_mm_add_ps(fa, dc), g));
+		_mm_storeu_ps(f + 2 * i + 4, _mm_mul_ps(_mm_add_ps(fb, dc), g));
+	}
+	suo::cu8_to_cf(in + i, out + i, n - i);
+}
+
+
+__attribute__((target("sse4.1")))
+static void cf_cs16_sse4(const Sample *in, cs16_t *out, size_t n, float scale)
+{
+	const float* f = reinterpret_cast<const float*>(in);
+	int16_t* d = &out[0][0];
+	const __m128 g = _mm_set1_ps(scale);
+	const __m128 lo = _mm_set1_ps(-32768.0f);
+	const __m128 hi = _mm_set1_ps(32767.0f);
+
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m128 a = _mm_mul_ps(_mm_loadu_ps(f + 2 * i), g);
+		__m128 b = _mm_mul_ps(_mm_loadu_ps(f + 2 * i + 4), g);
+		a = _mm_min_ps(_mm_max_ps(a, lo), hi);
+		b = _mm_min_ps(_mm_max_ps(b, lo), hi);
+		_mm_storeu_si128((__m128i*)(d + 2 * i), _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b)));
+	}
+	suo::cf_to_cs16(in + i, out + i, n - i, scale);
+}
+
+#endif /* SUO_CONVERSION_X86 */
+
+
+#ifdef SUO_CONVERSION_NEON
+
+static void cs16_neon(const cs16_t *in, Sample *out, size_t n, float scale)
+{
+	const int16_t* s = &in[0][0];
+	float* f = reinterpret_cast<float*>(out);
+
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		int16x8_t v = vld1q_s16(s + 2 * i);
+		float32x4_t fa = vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), scale);
+		float32x4_t fb = vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), scale);
+		vst1q_f32(f + 2 * i, fa);
+		vst1q_f32(f + 2 * i + 4, fb);
+	}
+	suo::cs16_to_cf(in + i, out + i, n - i, scale);
+}
+
+
+static void cs8_neon(const cs8_t *in, Sample *out, size_t n, float scale)
+{
+	const int8_t* s = &in[0][0];
+	float* f = reinterpret_cast<float*>(out);
+
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		int16x8_t v = vmovl_s8(vld1_s8(s + 2 * i));
+		float32x4_t fa = vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), scale);
+		float32x4_t fb = vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), scale);
+		vst1q_f32(f + 2 * i, fa);
+		vst1q_f32(f + 2 * i + 4, fb);
+	}
+	suo::cs8_to_cf(in + i, out + i, n - i, scale);
+}
+
+
+static void cu8_neon(const cu8_t *in, Sample *out, size_t n)
+{
+	const uint8_t* s = &in[0][0];
+	float* f = reinterpret_cast<float*>(out);
+	const float32x4_t dc = vdupq_n_f32(cu8_dc);
+
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		uint16x8_t v = vmovl_u8(vld1_u8(s + 2 * i));
+		float32x4_t fa = vcvtq_f32_u32(vmovl_u16(vget_low_u16(v)));
+		float32x4_t fb = vcvtq_f32_u32(vmovl_u16(vget_high_u16(v)));
+		vst1q_f32(f + 2 * i, vmulq_n_f32(vaddq_f32(fa, dc), cu8_scale));
+		vst1q_f32(f + 2 * i + 4, vmulq_n_f32(vaddq_f32(fb, dc), cu8_scale));
+	}
+	suo::cu8_to_cf(in + i, out + i, n - i);
+}
+
+
+static void cf_cs16_neon(const Sample *in, cs16_t *out, size_t n, float scale)
+{
+	const float* f = reinterpret_cast<const float*>(in);
+	int16_t* d = &out[0][0];
+
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		/* Round to nearest and narrow with saturation */
+		int32x4_t a = vcvtnq_s32_f32(vmulq_n_f32(vld1q_f32(f + 2 * i), scale));
+		int32x4_t b = vcvtnq_s32_f32(vmulq_n_f32(vld1q_f32(f + 2 * i + 4), scale));
+		vst1q_s16(d + 2 * i, vcombine_s16(vqmovn_s32(a), vqmovn_s32(b)));
+	}
+	suo::cf_to_cs16(in + i, out + i, n - i, scale);
+}
+
+#endif /* SUO_CONVERSION_NEON */
+
+
+bool SampleConverter::isSupported(ConversionKernel kernel)
+{
+	switch (kernel) {
+	case ConversionKernel::automatic:
+	case ConversionKernel::scalar:
+		return true;
+#ifdef SUO_CONVERSION_X86
+	case ConversionKernel::sse4:
+		return __builtin_cpu_supports("sse4.1");
+	case ConversionKernel::avx2:
+		return __builtin_cpu_supports("avx2");
+#endif
+#ifdef SUO_CONVERSION_NEON
+	case ConversionKernel::neon:
+		return true;
+#endif
+	default:
+		return false;
+	}
+}
+
+
+const char* SampleConverter::getKernelName(ConversionKernel kernel)
+{
+	switch (kernel) {
+	case ConversionKernel::automatic: return "automatic";
+	case ConversionKernel::scalar: return "scalar";
+	case ConversionKernel::sse4: return "sse4";
+	case ConversionKernel::avx2: return "avx2";
+	case ConversionKernel::neon: return "neon";
+	}
+	return "unknown";
+}
+
+
+SampleConverter::SampleConverter(ConversionKernel kernel) :
+	kernel(kernel)
+{
+	if (isSupported(kernel) == false)
+		throw SuoError("SampleConverter: Kernel %s not supported by the CPU", getKernelName(kernel));
+
+	if (kernel == ConversionKernel::automatic) {
+		if (isSupported(ConversionKernel::avx2))
+			this->kernel = ConversionKernel::avx2;
+		else if (isSupported(ConversionKernel::sse4))
+			this->kernel = ConversionKernel::sse4;
+		else if (isSupported(ConversionKernel::neon))
+			this->kernel = ConversionKernel::neon;
+		else
+			this->kernel = ConversionKernel::scalar;
+	}
+
+	switch (this->kernel) {
+#ifdef SUO_CONVERSION_X86
+	case ConversionKernel::avx2:
+		cs16_func = &cs16_avx2;
+		cs8_func = &cs8_avx2;
+		cu8_func = &cu8_avx2;
+		cf_cs16_func = &cf_cs16_avx2;
+		break;
+	case ConversionKernel::sse4:
+		cs16_func = &cs16_sse4;
+		cs8_func = &cs8_sse4;
+		cu8_func = &cu8_sse4;
+		cf_cs16_func = &cf_cs16_sse4;
+		break;
+#endif
+#ifdef SUO_CONVERSION_NEON
+	case ConversionKernel::neon:
+		cs16_func = &cs16_neon;
+		cs8_func = &cs8_neon;
+		cu8_func = &cu8_neon;
+		cf_cs16_func = &cf_cs16_neon;
+		break;
+#endif
+	default:
+		cs16_func = &cs16_scalar;
+		cs8_func = &cs8_scalar;
+		cu8_func = &cu8_scalar;
+		cf_cs16_func = &cf_cs16_scalar;
+		break;
+	}
+}
+
+
+bool SampleConverter::isSupportedFormat(const std::string& format)
+{
+	return format == "CF32" || format == "CS16" || format == "CS8" || format == "CU8";
+}
+
+
+bool SampleConverter::to_cf(const std::string& format, const void *in, Sample *out, size_t n) const
+{
+	if (format == "CF32") {
+		if (in != out)
+			memmove(out, in, n * sizeof(Sample));
+	}
+	else if (format == "CS16")
+		cs16_func(static_cast<const cs16_t*>(in), out, n, 1.0f / 0x8000);
+	else if (format == "CS8")
+		cs8_func(static_cast<const cs8_t*>(in), out, n, 1.0f / 0x80);
+	else if (format == "CU8")
+		cu8_func(static_cast<const cu8_t*>(in), out, n);
+	else
+		return false;
+	return true;
+}
@@ -1,20 +1,39 @@
 #pragma once
 
+#include <cmath>
+#include <algorithm>
+#include <string>
+
 #include "base_types.hpp"
 
 namespace suo {
 
-static inline size_t cs16_to_cf(cs16_t *in, Sample *out, size_t n)
+/*
+ * Conversions between the SDR wire formats and complex floats.
+ *
+ * The inline functions are the scalar reference implementations.
+ * SampleConverter runs the same conversions with SIMD kernels.
+ */
+
+static inline size_t cs16_to_cf(const cs16_t *in, Sample *out, size_t n, float scale = 1.0f / 0x8000)
+{
+	size_t i;
+	for (i = 0; i < n; i++)
+		out[i] = Sample((float)in[i][0] * scale, (float)in[i][1] * scale);
+	return n;
+}
+
+
+static inline size_t cs8_to_cf(const cs8_t *in, Sample *out, size_t n, float scale = 1.0f / 0x80)
 {
 	size_t i;
-	const float scale = 1.0f / 0x8000;
 	for (i = 0; i < n; i++)
 		out[i] = Sample((float)in[i][0] * scale, (float)in[i][1] * scale);
 	return n;
 }
 
 
-static inline size_t cu8_to_cf(cu8_t *in, Sample *out, size_t n)
+static inline size_t cu8_to_cf(const cu8_t *in, Sample *out, size_t n)
 {
 	size_t i;
 	const float dc = -127.4f;
@@ -25,16 +44,93 @@ static inline size_t cu8_to_cf(cu8_t *in, Sample *out, size_t n)
 }
 
 
-static inline size_t cf_to_cs16(Sample *in, cs16_t *out, size_t n)
+/* Values outside the 16-bit range are saturated. Rounds to the nearest integer. */
+static inline int16_t float_to_s16(float x)
+{
+	return (int16_t)lrintf(std::min(std::max(x, -32768.0f), 32767.0f));
+}
+
+
+static inline size_t cf_to_cs16(const Sample *in, cs16_t *out, size_t n, float scale = 0x8000)
 {
 	size_t i;
-	const float scale = 0x8000;
-	// TODO: clip
 	for (i = 0; i < n; i++) {
-		out[i][0] = in[i].real() * scale;
-		out[i][1] = in[i].imag() * scale;
+		out[i][0] = float_to_s16(in[i].real() * scale);
+		out[i][1] = float_to_s16(in[i].imag() * scale);
 	}
 	return n;
 }
 
+
+/*
+ * Implementations of the conversion kernels.
+ * The automatic selection picks the widest instruction set the CPU supports.
+ */
+enum class ConversionKernel {
+	automatic,
+	scalar,
+	sse4,
+	avx2,
+	neon
+};
+
+
+/*
+ * Vectorized sample format conversions.
+ *
+ * The kernels give the same results as the scalar functions above.
+ * All conversions may be done in place in one buffer:
+ * To complex floats, the n input samples must be at the end of the
+ * n * sizeof(Sample) byte buffer. From complex floats, the output
+ * is written to the beginning of the input buffer.
+ */
+class SampleConverter
+{
+public:
+	explicit SampleConverter(ConversionKernel kernel = ConversionKernel::automatic);
+
+	size_t cs16_to_cf(const cs16_t *in, Sample *out, size_t n, float scale = 1.0f / 0x8000) const {
+		cs16_func(in, out, n, scale);
+		return n;
+	}
+
+	size_t cs8_to_cf(const cs8_t *in, Sample *out, size_t n, float scale = 1.0f / 0x80) const {
+		cs8_func(in, out, n, scale);
+		return n;
+	}
+
+	size_t cu8_to_cf(const cu8_t *in, Sample *out, size_t n) const {
+		cu8_func(in, out, n);
+		return n;
+	}
+
+	size_t cf_to_cs16(const Sample *in, cs16_t *out, size_t n, float scale = 0x8000) const {
+		cf_cs16_func(in, out, n, scale);
+		return n;
+	}
+
+	/* Convert from a format named like in SoapySDR: CF32, CS16, CS8 or CU8.
+	 * Returns false if the format is not one of these. */
+	bool to_cf(const std::string& format, const void *in, Sample *out, size_t n) const;
+
+	/* Is the format supported by to_cf */
+	static bool isSupportedFormat(const std::string& format);
+
+	/* Returns the kernel in use */
+	ConversionKernel getKernel() const { return kernel; }
+
+	/* Is given kernel available on this CPU */
+	static bool isSupported(ConversionKernel kernel);
+
+	/* Get human readable name of the kernel */
+	static const char* getKernelName(ConversionKernel kernel);
+
+private:
+	ConversionKernel kernel;
+	void (*cs16_func)(const cs16_t *in, Sample *out, size_t n, float scale);
+	void (*cs8_func)(const cs8_t *in, Sample *out, size_t n, float scale);
+	void (*cu8_func)(const cu8_t *in, Sample *out, size_t n);
+	void (*cf_cs16_func)(const Sample *in, cs16_t *out, size_t n, float scale);
+};
+
 };
@@ -17,25 +17,35 @@ struct noop {
 	void operator()(...) const {}
 };
 
+/* Consumed parts of the mapping are released in steps of this many bytes */
+static const size_t map_release_step = 64 << 20;
+
+
 FileIO::Config::Config() {
 	format = "CF32";
 	throttle = false;
 	sample_rate = 100e3; // [Hz]
+	buffer = 4 * 4096;
 }
 
 
 FileIO::FileIO(const Config& _conf) :
 	conf(_conf)
 {
+	if (conf.buffer == 0)
+		throw SuoError("FileIO: Zero buffer length");
+
 	/* Setup input stream */
 	if (conf.input == "-")
 		in.reset(&cin, noop());
 	else if (conf.input.empty() == false) {
 		cout << "Opening '" << conf.input << "' for signal input." << endl;
-		std::ifstream *input_file = new std::ifstream(conf.input);
-		if (!*input_file)
-			throw SuoError("Failed to open signal input file");
-		in.reset(input_file);
+		if (mapped.open(conf.input) == false) {
+			std::ifstream *input_file = new std::ifstream(conf.input, ios::binary);
+			if (!*input_file)
+				throw SuoError("Failed to open signal input file");
+			in.reset(input_file);
+		}
 	}
 
 	/* Setup output stream */
@@ -53,57 +63,83 @@ FileIO::FileIO(const Config& _conf) :
 		throw SuoError("Neither to file input or output is defined");
 }
 
+
 void FileIO::execute()
 {
-	Timestamp now = 0;
-	Timestamp tx_latency_time = 0;
-
-	const size_t buffer_len = 4 * 4096;
-
-	size_t input_format_size = SoapySDR::formatToSize(conf.format);
-	SoapySDR::ConverterRegistry::ConverterFunction converter = nullptr;
-
-	char* read_buffer = nullptr;
-	SampleVector buffer(buffer_len);
-
-	if (conf.format != "CF32") {
-		converter = SoapySDR::ConverterRegistry::getFunction(conf.format, "CF32");
-		if (converter == nullptr)
+	const size_t buffer_len = conf.buffer;
+	const size_t input_format_size = SoapySDR::formatToSize(conf.format);
+
+	/* Formats other than the ones with own kernels go through the SoapySDR converters */
+	SoapySDR::ConverterRegistry::ConverterFunction soapy_converter = nullptr;
+	if (SampleConverter::isSupportedFormat(conf.format) == false) {
+		soapy_converter = SoapySDR::ConverterRegistry::getFunction(conf.format, "CF32");
+		if (soapy_converter == nullptr)
 			throw SuoError("Unsupported input format %s", conf.format.c_str());
-		read_buffer = new char[buffer_len * input_format_size];
-	}
-	else {
-		read_buffer = reinterpret_cast<char*>(buffer.data());
 	}
 
-	unsigned int total_samples = 0;
+	/* Convert n samples to complex floats */
+	auto convert = [&](const char* raw, Sample* samples, size_t n) {
+		if (soapy_converter != nullptr)
+			soapy_converter(raw, samples, n, 1.0);
+		else
+			converter.to_cf(conf.format, raw, samples, n);
+	};
+
+	Pooled<SampleVector> buffer = sample_pool.acquire(buffer_len);
+	buffer->resize(buffer_len);
+
+	/* Stream input is read to the end of the sample buffer and converted in place
+	 * as SampleConverter allows. SoapySDR's converters get a separate buffer. */
+	vector<char> read_buffer;
+	char* read_ptr = reinterpret_cast<char*>(buffer->data() + buffer_len) - buffer_len * input_format_size;
+	if (soapy_converter != nullptr) {
+		read_buffer.resize(buffer_len * input_format_size);
+		read_ptr = read_buffer.data();
+	}
 
-	while (true) {
+	const bool rx = sinkSamples.has_connections() && (mapped.isOpen() || in.get() != nullptr);
+	if (rx == false)
+		cerr << "FileIO: No input or sinkSamples not connected" << endl;
 
-		size_t new_samples;
+	uint64_t total_samples = 0;
+	size_t map_offset = 0, map_released = 0;
+	const auto start_time = chrono::steady_clock::now();
 
-		// RX
-		if (sinkSamples.has_connections() && in.get() != nullptr) {
+	while (rx) {
 
-			// Read more samples
-			size_t read_len = in->readsome(read_buffer, input_format_size * buffer_len);
-			if (read_len == 0) // TODO: Check for EOF not for read=0
-				break;
+		size_t new_samples;
+		const char* raw;
 
+		// Read more samples
+		if (mapped.isOpen()) {
+			new_samples = min(buffer_len, (mapped.size() - map_offset) / input_format_size);
+			raw = mapped.data() + map_offset;
+			map_offset += new_samples * input_format_size;
+		}
+		else {
+			in->read(read_ptr, input_format_size * buffer_len);
+			size_t read_len = in->gcount();
 			if ((read_len % input_format_size) != 0)
-				throw SuoError("Number of read bytes is not diviable by the input format size!");
+				cerr << "Warning: Input ended in the middle of a sample" << endl;
 			new_samples = read_len / input_format_size;
-			total_samples += new_samples;
+			raw = read_ptr;
+		}
 
+		if (new_samples == 0)
+			break;
 
-			// Convert the samples to complex floats if needed
-			if (converter != nullptr)
-				converter(read_buffer, buffer.data(), new_samples, 1);
-			buffer.resize(new_samples);
-			
-			// Feed
-			sinkSamples.emit(buffer, now);
-		}
+		/* Timestamps from the sample index so that no rounding errors accumulate */
+		const Timestamp now = (Timestamp)(1e9 * total_samples / conf.sample_rate);
+
+		// Convert the samples to complex floats if needed
+		buffer->resize(new_samples);
+		convert(raw, buffer->data(), new_samples);
+		buffer->timestamp = now;
+
+		// Feed
+		sinkSamples.emit(*buffer, now);
+		total_samples += new_samples;
+		buffer->resize(buffer_len);
 
 #if 0
 		// TX
@@ -115,16 +151,21 @@ void FileIO::execute()
 		}
 #endif
 
-		Timestamp samples_ns = 1e9 * new_samples / conf.sample_rate;
-		now += samples_ns;
+		/* Drop the consumed pages to keep the resident size small with long recordings */
+		if (mapped.isOpen() && map_offset - map_released >= map_release_step) {
+			map_released = mapped.release(map_released, map_offset - map_released);
+		}
 
-		if (conf.throttle)
-			std::this_thread::sleep_for(std::chrono::nanoseconds(samples_ns));
-		
+		if (conf.throttle) {
+			const Timestamp end = (Timestamp)(1e9 * total_samples / conf.sample_rate);
+			std::this_thread::sleep_until(start_time + chrono::nanoseconds(end));
+		}
 	}
 
+	const double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
 	cout << "Processed " << total_samples << " samples in total";
-	cout << " (" << fixed << setprecision(1) << (total_samples / conf.sample_rate) << " seconds)" << endl;
+	cout << " (" << fixed << setprecision(1) << (total_samples / conf.sample_rate) << " seconds";
+	cout << " in " << elapsed << " seconds)" << endl;
 }
 
 
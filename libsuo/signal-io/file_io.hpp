@@ -1,6 +1,8 @@
 #pragma once
 
 #include "suo.hpp"
+#include "signal-io/conversion.hpp"
+#include "signal-io/mapped_file.hpp"
 #include <ios>
 #include <fstream>
 #include <memory>
@@ -8,20 +10,27 @@
 namespace suo {
 
 /*
+ * File I/O:
+ * Replays IQ recordings to the receiver.
+ *
+ * Regular files are memory mapped and read sequentially straight from
+ * the mapping. Standard input and other non-mappable inputs are read
+ * as a stream. The timestamps are derived from the sample index so
+ * the replay runs as fast as the receiver can process unless throttled.
  */
 class FileIO: public Block
 {
 public:
-	
-	/* 
+
+	/*
 	 */
 	struct Config {
 		Config();
 
 		/* Sample rate of the files */
 		double sample_rate;
-		
-		/* Throttle execution */
+
+		/* Throttle execution to the sample rate */
 		bool throttle;
 
 		/* File name of input file containing received signal */
@@ -32,6 +41,9 @@ public:
 
 		/* Data format */
 		std::string format;
+
+		/* Number of samples passed to sinkSamples at once */
+		unsigned int buffer;
 	};
 
 	explicit FileIO(const Config& conf = Config());
@@ -46,6 +58,11 @@ private:
 	const Config conf;
 	std::shared_ptr<std::istream> in;
 	std::shared_ptr<std::ostream> out;
+
+	/* Memory mapped input file */
+	MappedFile mapped;
+
+	SampleConverter converter;
 };
 
 
@@ -0,0 +1,313 @@
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <cerrno>
+#include <limits>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "signal-io/iq_recorder.hpp"
+#include "json.hpp"
+
+using namespace suo;
+using namespace std;
+using json = nlohmann::json;
+
+
+IQRecorder::Config::Config() {
+	format = "CF32";
+	sample_rate = 1e6;
+	center_frequency = 0;
+	capacity = 64;
+	max_buffer = 4 * 4096;
+	write_size = 1 << 20;
+	direct_io = true;
+}
+
+
+IQRecorder::IQRecorder(const Config& conf) :
+	conf(conf),
+	ring(conf.capacity),
+	recording(false),
+	gap_pending(false),
+	fd(-1),
+	direct(false),
+	staged(0),
+	file_samples(0),
+	buffers(0),
+	samples(0),
+	dropped_buffers(0),
+	dropped_samples(0),
+	bytes_written(0),
+	capture_count(0),
+	high_water(0),
+	write_error(false)
+{
+	if (conf.format == "CF32")
+		sample_size = sizeof(Sample);
+	else if (conf.format == "CS16")
+		sample_size = sizeof(cs16_t);
+	else
+		throw SuoError("IQRecorder: Unsupported format %s", conf.format.c_str());
+
+	if (conf.sample_rate <= 0)
+		throw SuoError("IQRecorder: Invalid sample rate");
+	if (conf.max_buffer == 0)
+		throw SuoError("IQRecorder: Zero max_buffer");
+
+	/* O_DIRECT requires the writes to be aligned to the logical block size */
+	staging.resize(((max(conf.write_size, 1u) + 4095) / 4096) * 4096);
+
+	/* Cycle through the ring once to preallocate the slots so the SDR thread doesn't allocate */
+	for (size_t i = 0; i < ring.capacity(); i++) {
+		ring.acquire()->samples.reserve(conf.max_buffer);
+		ring.commit();
+		ring.front();
+		ring.pop();
+	}
+
+	if (conf.filename.empty() == false)
+		open(conf.filename);
+}
+
+
+IQRecorder::~IQRecorder()
+{
+	close();
+}
+
+
+void IQRecorder::open(const std::string& _filename)
+{
+	close();
+
+	filename = _filename;
+	const string data_file = filename + ".sigmf-data";
+	const int flags = O_WRONLY | O_CREAT | O_TRUNC;
+
+	direct = false;
+#ifdef O_DIRECT
+	if (conf.direct_io) {
+		fd = ::open(data_file.c_str(), flags | O_DIRECT, 0644);
+		direct = (fd >= 0);
+	}
+#endif
+	/* Not all file systems (e.g. tmpfs) support direct I/O */
+	if (fd < 0)
+		fd = ::open(data_file.c_str(), flags, 0644);
+	if (fd < 0)
+		throw SuoError("IQRecorder: Failed to open %s: %s", data_file.c_str(), strerror(errno));
+
+	staged = 0;
+	file_samples = 0;
+	captures.clear();
+	capture_count = 0;
+	write_error = false;
+	gap_pending = false;
+	recording = true;
+}
+
+
+void IQRecorder::close()
+{
+	if (fd < 0)
+		return;
+
+	/* Write everything still in the queue */
+	recording = false;
+	while (process(numeric_limits<size_t>::max()) > 0);
+
+#ifdef O_DIRECT
+	/* The last block is shorter than the alignment */
+	if (direct && staged % 4096 != 0) {
+		fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_DIRECT);
+		direct = false;
+	}
+#endif
+	if (staged > 0 && write_error == false)
+		flush(staged);
+
+	::close(fd);
+	fd = -1;
+
+	writeMetadata();
+}
+
+
+void IQRecorder::sinkSamples(const SampleVector& _samples, Timestamp now)
+{
+	if (recording.load(std::memory_order_relaxed) == false)
+		return;
+
+	SUO_PROFILE(profile_sink, _samples.size());
+	const UTCTimestamp datetime = getCurrentUTCTimestamp();
+
+	/* Buffers larger than the preallocated slots are split to several slots so the SDR thread never allocates */
+	size_t offset = 0, queued = 0;
+	while (offset < _samples.size()) {
+		Slot* slot = ring.acquire();
+		if (slot == nullptr) {
+			const size_t left = _samples.size() - offset;
+			dropped_buffers.fetch_add(1, std::memory_order_relaxed);
+			dropped_samples.fetch_add(left, std::memory_order_relaxed);
+			SUO_PROFILE_DROP(profile_sink, left);
+			gap_pending = true;
+			break;
+		}
+
+		const size_t n = min<size_t>(_samples.size() - offset, conf.max_buffer);
+		slot->samples.assign(_samples.begin() + offset, _samples.begin() + offset + n);
+		slot->now = now + (Timestamp)(1e9 * offset / conf.sample_rate);
+		slot->datetime = datetime;
+		slot->gap = gap_pending;
+		gap_pending = false;
+		ring.commit();
+
+		buffers.fetch_add(1, std::memory_order_relaxed);
+		samples.fetch_add(n, std::memory_order_relaxed);
+		offset += n;
+		queued++;
+	}
+
+	if (queued == 0)
+		return;
+
+	size_t level = ring.size();
+	if (level > high_water.load(std::memory_order_relaxed))
+		high_water.store(level, std::memory_order_relaxed);
+
+	notify();
+}
+
+
+size_t IQRecorder::process(size_t max_items)
+{
+	size_t n = 0;
+	while (n < max_items) {
+		Slot* slot = ring.front();
+		if (slot == nullptr)
+			break;
+		if (fd >= 0 && write_error == false)
+			writeSlot(*slot);
+		ring.pop();
+		n++;
+	}
+	return n;
+}
+
+
+void IQRecorder::writeSlot(const Slot& slot)
+{
+	SUO_PROFILE(profile_write, slot.samples.size());
+
+	/* Start a new capture segment if samples were lost or the timestamps jump */
+	bool new_capture = captures.empty() || slot.gap;
+	if (new_capture == false) {
+		const Capture& c = captures.back();
+		const double expected = c.now + 1e9 * (file_samples - c.sample_start) / conf.sample_rate;
+		const double tolerance = max(2e9 / conf.sample_rate, 1000.0);
+		new_capture = abs((double)slot.now - expected) > tolerance;
+	}
+	if (new_capture) {
+		captures.push_back(Capture{ file_samples, slot.now, slot.datetime });
+		capture_count.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	const Sample* in = slot.samples.data();
+	size_t left = slot.samples.size();
+	while (left > 0 && write_error == false) {
+		const size_t n = min(left, (staging.size() - staged) / sample_size);
+		char* out = staging.data() + staged;
+		if (sample_size == sizeof(Sample))
+			memcpy(out, in, n * sizeof(Sample));
+		else
+			converter.cf_to_cs16(in, reinterpret_cast<cs16_t*>(out), n);
+
+		staged += n * sample_size;
+		in += n;
+		left -= n;
+
+		if (staged == staging.size())
+			flush(staged);
+	}
+
+	file_samples += slot.samples.size();
+}
+
+
+void IQRecorder::flush(size_t bytes)
+{
+	const char* data = staging.data();
+	size_t written = 0;
+	while (written < bytes) {
+		ssize_t ret = ::write(fd, data + written, bytes - written);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			cerr << "IQRecorder: Writing " << filename << " failed: " << strerror(errno) << endl;
+			write_error = true;
+			recording = false;
+			return;
+		}
+		written += ret;
+	}
+	bytes_written.fetch_add(bytes, std::memory_order_relaxed);
+	staged = 0;
+}
+
+
+void IQRecorder::writeMetadata()
+{
+	json global = {
+		{ "core:datatype", (sample_size == sizeof(Sample)) ? "cf32_le" : "ci16_le" },
+		{ "core:sample_rate", conf.sample_rate },
+		{ "core:version", "1.0.0" },
+		{ "core:num_channels", 1 },
+		{ "core:recorder", "suo" },
+		{ "core:extensions", json::array({ { { "name", "suo" }, { "version", "1.0.0" }, { "optional", true } } }) },
+		{ "suo:dropped_buffers", dropped_buffers.load() },
+		{ "suo:dropped_samples", dropped_samples.load() },
+	};
+	if (conf.description.empty() == false)
+		global["core:description"] = conf.description;
+	if (conf.hardware.empty() == false)
+		global["core:hw"] = conf.hardware;
+
+	json capture_list = json::array();
+	for (const Capture& c: captures) {
+		capture_list.push_back({
+			{ "core:sample_start", c.sample_start },
+			{ "core:frequency", conf.center_frequency },
+			{ "core:datetime", formatISOTimestamp(c.datetime) },
+			{ "suo:timestamp", c.now },
+		});
+	}
+
+	json meta = {
+		{ "global", global },
+		{ "captures", capture_list },
+		{ "annotations", json::array() },
+	};
+
+	const string meta_file = filename + ".sigmf-meta";
+	ofstream output(meta_file);
+	output << meta.dump(4) << endl;
+	if (output.good() == false)
+		cerr << "IQRecorder: Failed to write " << meta_file << endl;
+}
+
+
+IQRecorder::Statistics IQRecorder::getStatistics() const
+{
+	Statistics stats;
+	stats.buffers = buffers.load(std::memory_order_relaxed);
+	stats.samples = samples.load(std::memory_order_relaxed);
+	stats.dropped_buffers = dropped_buffers.load(std::memory_order_relaxed);
+	stats.dropped_samples = dropped_samples.load(std::memory_order_relaxed);
+	stats.bytes_written = bytes_written.load(std::memory_order_relaxed);
+	stats.captures = capture_count.load(std::memory_order_relaxed);
+	stats.high_water = high_water.load(std::memory_order_relaxed);
+	stats.write_error = write_error.load(std::memory_order_relaxed);
+	return stats;
+}
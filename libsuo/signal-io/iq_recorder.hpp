@@ -0,0 +1,158 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "suo.hpp"
+#include "executor.hpp"
+#include "signal-io/conversion.hpp"
+
+namespace suo {
+
+/*
+ * IQ recorder:
+ * Records the received signal in SigMF format next to the live decoding.
+ *
+ * sinkSamples runs on the SDR thread and only copies the buffer to
+ * preallocated slots of a lock-free ring. If the ring is full, the rest of
+ * the buffer is dropped and counted instead of ever blocking the RX loop.
+ * The executor thread converts the samples to the file format and writes
+ * them in large aligned blocks, using O_DIRECT where the file system
+ * supports it so the recording doesn't flood the page cache.
+ *
+ * The recording is written to <filename>.sigmf-data and the metadata to
+ * <filename>.sigmf-meta when the recording is closed. A new capture
+ * segment is started after dropped buffers and whenever the stream
+ * timestamps jump, so each segment carries the hardware timestamp
+ * (suo:timestamp) and the host time (core:datetime) of its first sample.
+ *
+ * open() and close() must not be called while an executor is draining
+ * the recorder.
+ *
+ * Example:
+ *   IQRecorder recorder(recorder_conf);
+ *   sdr.sinkSamples.connect_member(&recorder, &IQRecorder::sinkSamples);
+ *   executor.addStage(recorder);
+ *   executor.start();
+ *   sdr.execute();
+ *   executor.stop();
+ *   recorder.close();
+ */
+class IQRecorder : public Block, public ThreadedStage
+{
+public:
+
+	struct Config {
+		Config();
+
+		/* Recording file name without the .sigmf-data/.sigmf-meta extension.
+		 * If given, the recording is opened in the constructor. */
+		std::string filename;
+
+		/* Sample format of the recording: CF32 or CS16 */
+		std::string format;
+
+		/* Sample rate of the recorded signal */
+		double sample_rate;
+
+		/* Center frequency of the recorded signal [Hz] */
+		double center_frequency;
+
+		/* Free text description and hardware name for the metadata */
+		std::string description;
+		std::string hardware;
+
+		/* Number of buffers the queue can hold. Rounded up to the next power of two. */
+		unsigned int capacity;
+
+		/* Number of samples preallocated for each queued buffer. Larger buffers are split to several slots. */
+		unsigned int max_buffer;
+
+		/* Size of one file write [bytes]. Rounded up to a multiple of 4096. */
+		unsigned int write_size;
+
+		/* Bypass the page cache with O_DIRECT if possible */
+		bool direct_io;
+	};
+
+	struct Statistics {
+		uint64_t buffers;           // Buffers queued for writing
+		uint64_t samples;           // Samples queued for writing
+		uint64_t dropped_buffers;   // Buffers dropped because the queue was full
+		uint64_t dropped_samples;   // Samples in the dropped buffers
+		uint64_t bytes_written;     // Bytes written to the data file
+		uint64_t captures;          // Capture segments in the recording
+		size_t high_water;          // Maximum number of buffers in the queue
+		bool write_error;           // Writing failed and the recording was stopped
+	};
+
+	explicit IQRecorder(const Config& conf = Config());
+	~IQRecorder();
+
+	/* Start a new recording */
+	void open(const std::string& filename);
+
+	/* Write the remaining samples and the metadata and close the files */
+	void close();
+
+	bool isOpen() const { return fd >= 0; }
+
+	/* SDR thread: Queue a copy of the samples. Never blocks. */
+	void sinkSamples(const SampleVector& samples, Timestamp now);
+
+	/* Executor thread: Write queued buffers to the file */
+	size_t process(size_t max_items);
+
+	Statistics getStatistics() const;
+
+	/* Number of buffers waiting to be written */
+	size_t size() const { return ring.size(); }
+
+private:
+
+	struct Slot {
+		SampleVector samples;
+		Timestamp now;
+		UTCTimestamp datetime;
+		bool gap;       // Buffers were dropped right before this one
+	};
+
+	struct Capture {
+		uint64_t sample_start;
+		Timestamp now;
+		UTCTimestamp datetime;
+	};
+
+	void writeSlot(const Slot& slot);
+	void flush(size_t bytes);
+	void writeMetadata();
+
+	Config conf;
+	size_t sample_size;
+	SampleConverter converter;
+	SPSCRing<Slot> ring;
+
+	/* Producer side */
+	std::atomic<bool> recording;
+	bool gap_pending;
+
+	/* Writer side */
+	int fd;
+	bool direct;
+	std::string filename;
+	std::vector<char, AlignedAllocator<char, 4096>> staging;
+	size_t staged;
+	uint64_t file_samples;
+	std::vector<Capture> captures;
+
+	std::atomic<uint64_t> buffers, samples, dropped_buffers, dropped_samples, bytes_written, capture_count;
+	std::atomic<size_t> high_water;
+	std::atomic<bool> write_error;
+
+	/* Profiling */
+	SUO_PROFILE_POINT(profile_sink, "IQRecorder", "sinkSamples");
+	SUO_PROFILE_POINT(profile_write, "IQRecorder", "write");
+};
+
+}; // namespace suo
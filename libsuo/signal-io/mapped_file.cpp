@@ -0,0 +1,86 @@
+#include "signal-io/mapped_file.hpp"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+using namespace suo;
+
+
+MappedFile::MappedFile() :
+	map_data(nullptr),
+	map_size(0)
+{
+}
+
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+
+bool MappedFile::open(const std::string& filename)
+{
+	close();
+#ifndef _WIN32
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	/* Pipes, devices and empty files are read as streams */
+	struct stat st;
+	if (fstat(fd, &st) != 0 || S_ISREG(st.st_mode) == false || st.st_size == 0) {
+		::close(fd);
+		return false;
+	}
+
+	void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd); // The mapping keeps the file open
+	if (addr == MAP_FAILED)
+		return false;
+
+	/* Aggressive read-ahead and early reuse of the pages behind */
+	madvise(addr, st.st_size, MADV_SEQUENTIAL);
+
+	map_data = static_cast<const char*>(addr);
+	map_size = st.st_size;
+	return true;
+#else
+	(void)filename;
+	return false;
+#endif
+}
+
+
+void MappedFile::close()
+{
+#ifndef _WIN32
+	if (map_data != nullptr)
+		munmap(const_cast<char*>(map_data), map_size);
+#endif
+	map_data = nullptr;
+	map_size = 0;
+}
+
+
+size_t MappedFile::release(size_t offset, size_t length)
+{
+#ifndef _WIN32
+	if (map_data == nullptr)
+		return offset;
+	const size_t page_size = sysconf(_SC_PAGESIZE);
+	const size_t begin = ((offset + page_size - 1) / page_size) * page_size;
+	const size_t end = ((offset + length) / page_size) * page_size;
+	if (end <= begin)
+		return offset;
+	madvise(const_cast<char*>(map_data) + begin, end - begin, MADV_DONTNEED);
+	return end;
+#else
+	(void)length;
+	return offset;
+#endif
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+namespace suo {
+
+/*
+ * Read-only memory mapping of a recording file.
+ *
+ * The whole file is mapped with sequential access advice so the kernel
+ * reads ahead aggressively. Pipes, devices and empty files can't be
+ * mapped and have to be read as streams instead.
+ */
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	/* Map a file. Returns false if the file can't be memory mapped. */
+	bool open(const std::string& filename);
+
+	/* Unmap the file */
+	void close();
+
+	bool isOpen() const { return map_data != nullptr; }
+	const char* data() const { return map_data; }
+	size_t size() const { return map_size; }
+
+	/* Drop the pages of a consumed region to keep the resident size small.
+	 * Only the whole pages inside the region are released. Returns the end of
+	 * the released pages, where the next region should start. */
+	size_t release(size_t offset, size_t length);
+
+private:
+	const char* map_data;
+	size_t map_size;
+};
+
+}; // namespace suo
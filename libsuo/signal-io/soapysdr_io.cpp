@@ -8,6 +8,7 @@
 #include <signal.h>
 #include <unistd.h> // usleep
 #include <assert.h>
+#include <algorithm>
 
 #include <SoapySDR/Device.hpp>
 #include <SoapySDR/Version.hpp>
@@ -23,7 +24,7 @@ using namespace suo;
 using namespace std;
 
 
-static bool running = true;
+static volatile sig_atomic_t running = true;
 
 #ifdef _WIN32
 static BOOL WINAPI winhandler(DWORD ctrl)
@@ -63,6 +64,66 @@ SoapySDRIO::Config::Config() {
 	tx_channel = 0;
 	rx_antenna = "";
 	tx_antenna = "";
+	rx_format = SOAPY_SDR_CF32;
+	tx_format = SOAPY_SDR_CF32;
+}
+
+
+/* Stream formats suo converts by itself */
+enum class WireFormat {
+	cf32,
+	cs16,
+	cs8,
+	cu8
+};
+
+
+/*
+ * Resolve the stream format to use.
+ * "native" is replaced with the device's native format if it is one of the
+ * supported formats, otherwise CF32 is used.
+ * full_scale is set to the sample value corresponding to 1.0 in CF32.
+ */
+static string selectStreamFormat(SoapySDR::Device* sdr, int direction, size_t channel,
+	const string& requested, const vector<string>& supported, double& full_scale)
+{
+	double native_scale = 0;
+	const string native = sdr->getNativeStreamFormat(direction, channel, native_scale);
+
+	string format = requested;
+	if (format == "native") {
+		format = native;
+		if (find(supported.begin(), supported.end(), format) == supported.end()) {
+			cerr << "Native stream format " << native << " not supported, using CF32" << endl;
+			format = SOAPY_SDR_CF32;
+		}
+	}
+	else if (find(supported.begin(), supported.end(), format) == supported.end())
+		throw SuoError("Unsupported stream format %s", format.c_str());
+
+	/* Drivers scale their own conversions from the native full scale (e.g. 2048 for 12-bit radios) */
+	if (format == native && native_scale > 0)
+		full_scale = native_scale;
+	else if (format == SOAPY_SDR_CS16)
+		full_scale = 0x8000;
+	else if (format == SOAPY_SDR_CS8)
+		full_scale = 0x80;
+	else
+		full_scale = 1.0;
+
+	return format;
+}
+
+
+static WireFormat getWireFormat(const string& format)
+{
+	if (format == SOAPY_SDR_CS16)
+		return WireFormat::cs16;
+	if (format == SOAPY_SDR_CS8)
+		return WireFormat::cs8;
+	if (format == SOAPY_SDR_CU8)
+		return WireFormat::cu8;
+	return WireFormat::cf32;
 }
 
 
@@ -103,9 +164,8 @@ void SoapySDRIO::execute()
 	const double sample_ns = 1.0e9 / conf.samplerate;
 	const long long tx_latency_time = sample_ns * conf.tx_latency;
 	const size_t rx_buflen = conf.buffer;
-	// Reserve a bit more space in TX buffer to allow for timing variations
-	//const size_t tx_buflen = 610000 - 1000;
-	const size_t tx_buflen = 4e6; //8 * rx_buflen; // (rx_buflen * 3) / 2;
+	// Bursts are written in chunks of at most the TX latency
+	const size_t tx_buflen = max(conf.buffer, conf.tx_latency);
 	// Timeout a few times the buffer length
 	const long timeout_us = (sample_ns * rx_buflen) * 0.1;
 	// Used for lost sample detection
@@ -171,20 +231,38 @@ void SoapySDRIO::execute()
 		sdr->setSampleRate(SOAPY_SDR_TX, conf.tx_channel, conf.samplerate);
 	}
 
+	/* Samples are received in the wire format and converted to CF32 by suo,
+	 * which halves or quarters the bus traffic compared to CF32 streams. */
+	string rx_format = SOAPY_SDR_CF32, tx_format = SOAPY_SDR_CF32;
+	double rx_full_scale = 1.0, tx_full_scale = 1.0;
+
 	if (conf.rx_on) {
+		rx_format = selectStreamFormat(sdr, SOAPY_SDR_RX, conf.rx_channel, conf.rx_format,
+			{ SOAPY_SDR_CF32, SOAPY_SDR_CS16, SOAPY_SDR_CS8, SOAPY_SDR_CU8 }, rx_full_scale);
+		cerr << "RX stream format " << rx_format << endl;
+
 		std::vector<size_t> rx_channels = { conf.rx_channel };
-		rxstream = sdr->setupStream(SOAPY_SDR_RX, SOAPY_SDR_CF32, rx_channels, conf.rx_args);
+		rxstream = sdr->setupStream(SOAPY_SDR_RX, rx_format, rx_channels, conf.rx_args);
 		if(rxstream == NULL)
 			throw SuoError("Failed to create RX stream");
 	}
 
 	if (conf.tx_on) {
+		tx_format = selectStreamFormat(sdr, SOAPY_SDR_TX, conf.tx_channel, conf.tx_format,
+			{ SOAPY_SDR_CF32, SOAPY_SDR_CS16 }, tx_full_scale);
+		cerr << "TX stream format " << tx_format << endl;
+
 		std::vector<size_t> tx_channels = { conf.tx_channel };
-		txstream = sdr->setupStream(SOAPY_SDR_TX, SOAPY_SDR_CF32, tx_channels, conf.tx_args);
+		txstream = sdr->setupStream(SOAPY_SDR_TX, tx_format, tx_channels, conf.tx_args);
 		if(txstream == NULL)
 			throw SuoError("Failed to create TX stream");
 	}
 
+	const WireFormat rx_wire = getWireFormat(rx_format);
+	const WireFormat tx_wire = getWireFormat(tx_format);
+	const size_t rx_sample_size = SoapySDR::formatToSize(rx_format);
+	const size_t tx_sample_size = SoapySDR::formatToSize(tx_format);
+
 	configureSDR.emit(sdr);
 
 	cerr << "Starting streams" << endl;
@@ -211,16 +289,129 @@ void SoapySDRIO::execute()
 	 * ended, i.e. where the next buffer should begin */
 	Timestamp tx_last_end_time = (Timestamp)current_time + tx_latency_time;
 
-	SampleVector rxbuf, txbuf;
-	rxbuf.resize(rx_buflen);
-	txbuf.resize(tx_buflen);
-
-	// Array of buffers for Soapy interface
-	void* rxbuffs[] = { rxbuf.data() };
-	const void* txbuffs[] = { txbuf.data() };
+	Pooled<SampleVector> rxbuf = sample_pool.acquire(rx_buflen);
+	rxbuf->resize(rx_buflen);
+
+	/* Array of buffers for Soapy interface. Samples in other formats than CF32
+	 * are read to the end of the buffer and converted in place. */
+	void* rxbuffs[] = { reinterpret_cast<char*>(rxbuf->data() + rx_buflen) - rx_buflen * rx_sample_size };
+
+	/*
+	 * Convert the received wire samples to CF32 at the beginning of the buffer.
+	 */
+	auto convert_rx = [&](size_t n) {
+		Sample* out = rxbuf->data();
+		switch (rx_wire) {
+		case WireFormat::cs16:
+			converter.cs16_to_cf(static_cast<const cs16_t*>(rxbuffs[0]), out, n, 1.0 / rx_full_scale);
+			break;
+		case WireFormat::cs8:
+			converter.cs8_to_cf(static_cast<const cs8_t*>(rxbuffs[0]), out, n, 1.0 / rx_full_scale);
+			break;
+		case WireFormat::cu8:
+			converter.cu8_to_cf(static_cast<const cu8_t*>(rxbuffs[0]), out, n);
+			break;
+		case WireFormat::cf32:
+			break;
+		}
+	};
+
+	/* If the driver exposes its DMA buffers, the samples are rendered directly
+	 * to them. Otherwise they are rendered to a pooled buffer and written from there.
+	 * Direct buffers are used only with CF32 as the other formats need a conversion. */
+	const bool tx_direct = conf.tx_on && tx_wire == WireFormat::cf32 && sdr->getNumDirectAccessBuffers(txstream) > 0;
+	Pooled<SampleVector> txbuf;
+	if (conf.tx_on && tx_direct == false) {
+		txbuf = sample_pool.acquire(tx_buflen);
+		txbuf->resize(tx_buflen);
+	}
 
 	SampleGenerator sample_gen;
 
+	/*
+	 * Render the next chunk of the burst and write it to the TX stream.
+	 * Returns the SoapySDR flags of the chunk.
+	 */
+	auto transmit = [&](bool first, Timestamp t) -> int {
+
+		size_t handle = 0;
+		void* txbuffs[1];
+		size_t capacity;
+		if (tx_direct) {
+			int ret = sdr->acquireWriteBuffer(txstream, handle, txbuffs, timeout_us);
+			if (ret <= 0)
+				throw SuoError("sdr->acquireWriteBuffer %d", ret);
+			capacity = (size_t)ret;
+		}
+		else {
+			txbuffs[0] = txbuf->data();
+			capacity = tx_buflen;
+		}
+
+		Sample* samples = static_cast<Sample*>(txbuffs[0]);
+		VectorFlags flags = none;
+		size_t len;
+		{
+			SUO_PROFILE(profile_generate, 0);
+			len = sample_gen.sourceSamples(SampleSpan{ samples, capacity }, flags);
+			SUO_PROFILE_ITEMS(len);
+		}
+
+		int tx_flags = 0;
+		if (first) {
+			if ((flags & VectorFlags::start_of_burst) == 0)
+				cout << "Warning: start of burst no properly marked!" << endl;
+			if (flags & VectorFlags::has_timestamp)
+				tx_flags |= SOAPY_SDR_HAS_TIME;
+		}
+
+		if (len == 0) {
+			/* If end of burst flag wasn't sent in last round,
+			 * send it now together with one dummy sample.
+			 * One sample is sent because trying to send
+			 * zero samples gave a timeout error. */
+			samples[0] = 0;
+			len = 1;
+			tx_flags |= SOAPY_SDR_END_BURST;
+			cout << "Warning: End of TX samples without end_of_burst!" << endl;
+		}
+
+		if (sample_gen.running() == false || (flags & VectorFlags::end_of_burst) != 0)
+			tx_flags |= SOAPY_SDR_END_BURST;
+
+		/* The next chunk continues where this one ends */
+		tx_last_end_time = t + (Timestamp)(sample_ns * len);
+
+		/* The stream is activated with the flags of the burst's first chunk */
+		if (first && conf.tx_active == false)
+			sdr->activateStream(txstream, tx_flags, t);
+
+		if (tx_direct) {
+			int release_flags = tx_flags;
+			sdr->releaseWriteBuffer(txstream, handle, len, release_flags, t);
+			return tx_flags;
+		}
+
+		/* Convert in place to the wire format. Values over the full scale are saturated. */
+		if (tx_wire == WireFormat::cs16)
+			converter.cf_to_cs16(samples, reinterpret_cast<cs16_t*>(samples), len, tx_full_scale);
+		const char* wire = reinterpret_cast<const char*>(samples);
+
+		/* Write the buffer, the driver might accept only a part of it at once.
+		 * The first write of a burst waits at most timeout_us and the rest use the SoapySDR default. */
+		const long write_timeout_us = first ? timeout_us : 100000;
+		size_t written = 0;
+		while (written < len) {
+			const void* buffs[] = { wire + written * tx_sample_size };
+			int write_flags = tx_flags;
+			int ret = sdr->writeStream(txstream, buffs, len - written, write_flags, t + (Timestamp)(sample_ns * written), write_timeout_us);
+			if (ret <= 0)
+				throw SuoError("sdr->writeStream %d", ret);
+			written += (size_t)ret;
+		}
+		return tx_flags;
+	};
+
 	while(running) {
 
 		if (conf.rx_on && tx_active == false) {
@@ -231,9 +422,10 @@ void SoapySDRIO::execute()
 			//cout << "rx_timestamp " << rx_timestamp << endl;
 			if (ret > 0) {
 
-				rxbuf.timestamp = rx_timestamp;
 				const size_t new_samples = (size_t)ret;
-				rxbuf.resize(new_samples);
+				convert_rx(new_samples);
+				rxbuf->timestamp = rx_timestamp;
+				rxbuf->resize(new_samples);
 				//if (new_samples != rx_buflen)
 				//	cout << "Received only " << new_samples << " samples" << endl;
 				
@@ -266,12 +458,18 @@ void SoapySDRIO::execute()
 				}
 
 				// Pass the samples to other blocks
-				if (!(tx_active && conf.half_duplex))
-					sinkSamples.emit(rxbuf, rx_timestamp);
+				if (!(tx_active && conf.half_duplex)) {
+					SUO_PROFILE(profile_samples, new_samples);
+					sinkSamples.emit(*rxbuf, rx_timestamp);
+				}
+
+				// Restore the full length for the next read
+				rxbuf->resize(rx_buflen);
 
 			}
 			else if (ret == SOAPY_SDR_OVERFLOW) {
 				cerr << "RX OVERFLOW" << endl;
+				SUO_PROFILE_DROP(profile_samples, 1);
 			} else if(ret < 0) {
 				throw SuoError("sdr->readStream: %d", ret);
 			}
@@ -296,95 +494,40 @@ void SoapySDRIO::execute()
 		if (conf.tx_on) {
 
 
+			/* A new burst can't begin before the TX latency from now */
+			if (tx_active == false)
+				tx_last_end_time = max(tx_last_end_time, (Timestamp)(current_time + tx_latency_time));
+
 			Timestamp tx_from_time = tx_last_end_time;
-			//Timestamp tx_until_time = (Timestamp)current_time + tx_latency_time;
-			//size_t new_sample = round((double)(tx_until_time - tx_from_time) / sample_ns);
-			//new_sample = max(new_sample, tx_buflen);
 
 
+			int tx_flags = 0;
 			if (tx_active) {
 				/*
 				 * Transmission/Burst on going on
 				 */
-
-				// Generate new samples 
-				int tx_flags = 0;
-				txbuf.clear();
-				sample_gen.sourceSamples(txbuf);
-
-				if (txbuf.empty()) {
-					/* If end of burst flag wasn't sent in last round,
-					 * send it now together with one dummy sample.
-					 * One sample is sent because trying to send
-					 * zero samples gave a timeout error. */
-
-					txbuf.resize(1);
-					txbuf[0] = 0;
-
-					tx_flags |= SOAPY_SDR_END_BURST;
-
-					cout << "Warning: End of TX samples without end_of_burst!" << endl;
-				}
-
-				if (sample_gen.running() == false || (txbuf.flags & VectorFlags::end_of_burst) != 0)
-					tx_flags |= SOAPY_SDR_END_BURST;
-
-				/* Write what we have */
-				Timestamp t = tx_from_time + (Timestamp)(sample_ns * 0);
-				int flags = tx_flags;
-				int ret = sdr->writeStream(txstream, txbuffs, txbuf.size(), flags, t);
-				cout << " sdr->writeStream " << ret << endl;
-				if (ret <= 0)
-					throw SuoError("sdr->writeStream %d", ret);
-
-				// Deactivate txstream
-				if ((tx_flags & SOAPY_SDR_END_BURST) != 0) {
-					cout << "end of burst" << endl;
-					if (conf.tx_active == false)
-						sdr->deactivateStream(txstream);
-					tx_active = false; 
-				}
-				
+				tx_flags = transmit(false, tx_from_time);
 			}
 			else {
 
-				//tx_last_end_time = tx_from_time + (Timestamp)(sample_ns * txbuf.size());
-
 				sample_gen = generateSamples.emit(tx_from_time);
 				if (sample_gen.running()) {
 
-					// Source samples
-					sample_gen.sourceSamples(txbuf);
-					cout << "start of burst " << txbuf.size() << endl;
-
 					/* New burst or start of transmission */
-					int tx_flags = 0;
 					tx_active = true;
-
-					if ((txbuf.flags & VectorFlags::start_of_burst) == 0)
-						cout << "Warning: start of burst no properly marked!" << endl;
-
-					if (txbuf.flags & VectorFlags::has_timestamp)
-						tx_flags |= SOAPY_SDR_HAS_TIME;
-
-					if ((txbuf.flags & VectorFlags::end_of_burst) != 0) {
-						tx_flags |= SOAPY_SDR_END_BURST;
-						tx_active = false;
-					}
+					cout << "start of burst" << endl;
 
 					Timestamp t = tx_from_time + (Timestamp)(sample_ns * 0);
-					
-					if (conf.tx_active == false)
-						sdr->activateStream(txstream, tx_flags, t);
-
-					// Write samples to buffer
-					int ret = sdr->writeStream(txstream, txbuffs, txbuf.size(), tx_flags, t, timeout_us);
-					cout << " sdr->writeStream " << ret << endl;
-					if ((size_t)ret != txbuf.size())
-						throw SuoError("sdr->writeStream %d", ret);
-						
+					tx_flags = transmit(true, t);
 				}
+			}
 
+			// Deactivate txstream
+			if (tx_active && (tx_flags & SOAPY_SDR_END_BURST) != 0) {
+				cout << "end of burst" << endl;
+				if (conf.tx_active == false)
+					sdr->deactivateStream(txstream);
+				tx_active = false;
 			}
 
 		}
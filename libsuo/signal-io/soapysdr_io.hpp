@@ -1,6 +1,7 @@
 #pragma once
 
 #include "suo.hpp"
+#include "signal-io/conversion.hpp"
 
 
 namespace SoapySDR {
@@ -13,6 +14,10 @@ namespace suo {
 /*
  * SoapySDR I/O:
  * Main loop with SoapySDR interfacing
+ *
+ * TX bursts are sourced from generateSamples inside the RX/TX loop.
+ * Connect it to a BurstRenderer to encode and modulate the bursts ahead
+ * on a worker thread instead of inside the loop.
  */
 class SoapySDRIO: public Block // SignalIO
 {
@@ -70,6 +75,14 @@ public:
 		
 		/* Radio TX antenna name */
 		std::string tx_antenna;
+
+		/* Sample format of the RX stream: CF32, CS16, CS8, CU8 or "native".
+		 * Native uses the device's native format if it is one of these.
+		 * Other than CF32 samples are converted to CF32 by suo. */
+		std::string rx_format;
+
+		/* Sample format of the TX stream: CF32, CS16 or "native" */
+		std::string tx_format;
 		
 		/* SoapySDR device args, such as the driver to use */
 		Kwargs args;
@@ -105,6 +118,12 @@ private:
 
 	bool tx_locked = false;
 	Timestamp tx_free;
+
+	SampleConverter converter;
+
+	/* Profiling */
+	SUO_PROFILE_POINT(profile_samples, "SoapySDRIO", "sinkSamples");
+	SUO_PROFILE_POINT(profile_generate, "SoapySDRIO", "generateSamples");
 };
 
 };
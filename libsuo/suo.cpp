@@ -14,7 +14,10 @@ using namespace suo;
 using namespace std;
 
 
-unsigned int suo::rx_id_counter = 0;
+std::atomic<unsigned int> suo::rx_id_counter(0);
+
+BufferPool<SampleVector> suo::sample_pool;
+BufferPool<SymbolVector> suo::symbol_pool;
 
 
 SuoError::SuoError(const char* format, ...) : std::exception() {
@@ -78,18 +81,27 @@ Timestamp get_time() {
 
 string suo::getCurrentISOTimestamp()
 {
-#if 1
-	timeval curTime;
-	gettimeofday(&curTime, NULL);
+	return formatISOTimestamp(getCurrentUTCTimestamp());
+}
+
+
+UTCTimestamp suo::getCurrentUTCTimestamp()
+{
+	timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return UTCTimestamp{ 1000000000LL * ts.tv_sec + ts.tv_nsec };
+}
+
+
+string suo::formatISOTimestamp(UTCTimestamp timestamp)
+{
+	time_t secs = timestamp.ns / 1000000000LL;
+	int milli = (timestamp.ns % 1000000000LL) / 1000000;
 
-	int milli = curTime.tv_usec / 1000;
 	char buf[64];
-	char* p = buf + strftime(buf, sizeof buf, "%FT%T", gmtime(&curTime.tv_sec));
+	struct tm tm_buf; // gmtime_r is thread safe
+	char* p = buf + strftime(buf, sizeof buf, "%FT%T", gmtime_r(&secs, &tm_buf));
 	sprintf(p, ".%03dZ", milli);
 
 	return buf;
-#else
-	auto now = chrono::system_clock::now();
-	return std::format("{:%FT%TZ}", now);
-#endif
 }
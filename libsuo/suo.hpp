@@ -6,11 +6,13 @@
 #include <exception>
 #include <iostream>
 #include <map>
+#include <atomic>
 
 #include "base_types.hpp"
 #include "vectors.hpp"
 #include "frame.hpp"
 #include "port.hpp"
+#include "profiling.hpp"
 
 namespace suo
 {
@@ -38,7 +40,15 @@ private:
 
 
 typedef std::map<std::string, std::string> Kwargs;
-extern unsigned int rx_id_counter;
+
+/* Running ID number for received frames. Shared by all deframers and threads. */
+extern std::atomic<unsigned int> rx_id_counter;
+
+/* Shared pools of recycled buffers for the TX path and the signal I/O boundaries.
+ * The demodulators and deframers reuse member buffers and frames instead, so after
+ * a warm-up neither RX nor TX allocates per buffer (see tests/test_allocations.cpp). */
+extern BufferPool<SampleVector> sample_pool;
+extern BufferPool<SymbolVector> symbol_pool;
 
 /* -----------------------------------------
  * Receive related interfaces and data types
@@ -68,8 +78,15 @@ protected:
 	//std::map<std::string,int> conf_map;
 };
 
+/* Get current UTC time as an ISO 8601 string */
 std::string getCurrentISOTimestamp();
 
+/* Get current UTC time as a raw timestamp (cheap, doesn't allocate) */
+UTCTimestamp getCurrentUTCTimestamp();
+
+/* Format raw UTC timestamp as an ISO 8601 string with millisecond precision */
+std::string formatISOTimestamp(UTCTimestamp timestamp);
+
 
 }; // namespace suo
 
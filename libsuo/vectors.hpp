@@ -1,6 +1,7 @@
 #pragma once
 
 #include "base_types.hpp"
+#include "buffer_pool.hpp"
 #include <cassert>
 
 namespace suo {
@@ -33,7 +34,10 @@ constexpr VectorFlags operator~(VectorFlags a) noexcept {
 
 //template<class T> inline T& operator|= (T& a, T b) { return (T&)((int&)a |= (int)b); }
 
-class SampleVector : public std::vector<Sample>
+/*
+ * Sample and symbol buffers are SIMD-aligned so the DSP kernels can use aligned loads.
+ */
+class SampleVector : public std::vector<Sample, AlignedAllocator<Sample>>
 {
 public:
 	using vector::vector; // Inherit std::vector constructors
@@ -50,7 +54,7 @@ public:
 	}
 
 	void clear() {
-		std::vector<Sample>::clear();
+		vector::clear();
 		flags = none;
 		timestamp = 0;
 	}
@@ -58,14 +62,23 @@ public:
 	operator bool() { return empty() == false; }
 };
 
-class SymbolVector : public std::vector<Symbol>
+class SymbolVector : public std::vector<Symbol, AlignedAllocator<Symbol>>
 {
 public:
 	using vector::vector; // Inherit std::vector constructors
 
+	/* Timestamp of the first symbol in the vector */
 	Timestamp timestamp;
 	VectorFlags flags;
 
+	/* Nominal duration of one symbol [ns]. Zero if unknown. */
+	Timestamp symbol_period = 0;
+
+	/* Timestamp of the n:th symbol in the vector */
+	Timestamp symbol_time(size_t n) const {
+		return timestamp + n * symbol_period;
+	}
+
 	size_t left() const {
 		return capacity() - size();
 	}
@@ -75,9 +88,10 @@ public:
 	}
 	
 	void clear() {
-		std::vector<Symbol>::clear();
+		vector::clear();
 		flags = none;
 		timestamp = 0;
+		symbol_period = 0;
 	}
 
 	operator bool() { return empty() == false; }
@@ -5,12 +5,31 @@
 //#include "coding/test_convolutional.cpp"
 #include "coding/test_crc.cpp"
 #include "coding/test_reed_solomon.cpp"
+#include "coding/test_viterbi.cpp"
 
 #include "test_golay_framing.cpp"
 #include "test_hdlc_framing.cpp"
 
 #include "test_generator.cpp"
+#include "test_port.cpp"
+#include "test_executor.cpp"
+#include "test_burst_renderer.cpp"
+#include "test_buffer_pool.cpp"
+#include "test_pipeline.cpp"
+#include "test_profiling.cpp"
 #include "test_utils.cpp"
+#include "test_conversion.cpp"
+#include "test_file_io.cpp"
+#include "test_offline_decoder.cpp"
+#include "test_iq_recorder.cpp"
+
+#include "test_discriminator.cpp"
+#include "test_matched_filter_bank.cpp"
+#include "test_decimator.cpp"
+#include "test_channelizer.cpp"
+#include "test_frequency_acquisition.cpp"
+#include "test_preamble_correlator.cpp"
+#include "test_cpm_waveform.cpp"
 
 
 int main(int argc, char** argv)
@@ -20,16 +39,36 @@ int main(int argc, char** argv)
 	// Utility tests
 	runner.addTest(FrameTest::suite());
 	runner.addTest(GeneratorTest::suite());
+	runner.addTest(PortTest::suite());
+	runner.addTest(ExecutorTest::suite());
+	runner.addTest(BurstRendererTest::suite());
+	runner.addTest(BufferPoolTest::suite());
+	runner.addTest(PipelineTest::suite());
+	runner.addTest(ProfilingTest::suite());
+	runner.addTest(ConversionTest::suite());
+	runner.addTest(FileIOTest::suite());
+	runner.addTest(OfflineDecoderTest::suite());
+	runner.addTest(IQRecorderTest::suite());
 
 	// Coding tests
 	//runner.addTest(ConvolutionalTest::suite());
 	runner.addTest(CRCTest::suite());
 	runner.addTest(ReedSolomonTest::suite());
+	runner.addTest(ViterbiTest::suite());
 
 	// Framing tests
 	runner.addTest(GolayFramingTest::suite());
 	runner.addTest(HDLCFramingTest::suite());
 
+	// Modem tests
+	runner.addTest(DiscriminatorTest::suite());
+	runner.addTest(MatchedFilterBankTest::suite());
+	runner.addTest(DecimatorTest::suite());
+	runner.addTest(ChannelizerTest::suite());
+	runner.addTest(FrequencyAcquisitionTest::suite());
+	runner.addTest(PreambleCorrelatorTest::suite());
+	runner.addTest(CPMWaveformTest::suite());
+
 
 	runner.run();
 	return 0;
@@ -0,0 +1,179 @@
+/*
+ * Throughput of the coding kernels.
+ */
+#include <benchmark/benchmark.h>
+
+#include <suo.hpp>
+#include <coding/reed_solomon.hpp>
+#include <coding/crc_generic.hpp>
+#include <coding/golay24.hpp>
+#include <coding/convolutional_encoder.hpp>
+#include <coding/viterbi_decoder.hpp>
+
+#include "../utils.hpp"
+
+using namespace std;
+using namespace suo;
+
+
+static ByteVector randomBytes(size_t len)
+{
+	ByteVector bytes(len);
+	for (Byte& b: bytes)
+		b = random_byte();
+	return bytes;
+}
+
+
+static void BM_ReedSolomonEncode(benchmark::State& state)
+{
+	ReedSolomon rs(RSCodes::CCSDS_RS_255_223);
+	const ByteVector data = randomBytes(223);
+	ByteVector msg;
+	msg.reserve(255);
+
+	for (auto _: state) {
+		msg = data;
+		rs.encode(msg);
+		benchmark::DoNotOptimize(msg.data());
+	}
+	state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_ReedSolomonEncode);
+
+
+/* Decode a codeword with the given number of byte errors. Includes a 255 byte copy per iteration. */
+static void BM_ReedSolomonDecode(benchmark::State& state)
+{
+	ReedSolomon rs(RSCodes::CCSDS_RS_255_223);
+	ByteVector codeword = randomBytes(223);
+	rs.encode(codeword);
+
+	const unsigned int errors = state.range(0);
+	for (unsigned int i = 0; i < errors; i++)
+		codeword[(i * 97) % codeword.size()] ^= 1 + (i % 255);
+
+	ByteVector msg;
+	msg.reserve(255);
+	for (auto _: state) {
+		msg = codeword;
+		unsigned int corrected = rs.decode(msg);
+		benchmark::DoNotOptimize(corrected);
+	}
+	state.SetBytesProcessed(state.iterations() * codeword.size());
+}
+BENCHMARK(BM_ReedSolomonDecode)->ArgName("errors")->Arg(0)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->Arg(12)->Arg(16);
+
+
+template <typename CRCType>
+static void runCRC(benchmark::State& state, const CRCAlgorithm& algo)
+{
+	CRCType crc(algo);
+	const ByteVector data = randomBytes(state.range(0));
+	for (auto _: state)
+		benchmark::DoNotOptimize(crc.calculate(data));
+	state.SetBytesProcessed(state.iterations() * data.size());
+}
+
+static void BM_CRC16_X25(benchmark::State& state) {
+	runCRC<CRC16>(state, CRCAlgorithms::CRC16_X25);
+}
+BENCHMARK(BM_CRC16_X25)->ArgName("bytes")->Arg(64)->Arg(256)->Arg(4096);
+
+static void BM_CRC32(benchmark::State& state) {
+	runCRC<CRC32>(state, CRCAlgorithms::CRC32);
+}
+BENCHMARK(BM_CRC32)->ArgName("bytes")->Arg(64)->Arg(256)->Arg(4096);
+
+
+static void BM_Golay24Decode(benchmark::State& state)
+{
+	// Codewords with the given number of bit errors
+	vector<uint32_t> codewords(256);
+	for (size_t i = 0; i < codewords.size(); i++) {
+		uint32_t word = rand() & 0xfff;
+		encode_golay24(&word);
+		for (int e = 0; e < state.range(0); e++)
+			word ^= 1 << ((i + 7 * e) % 24);
+		codewords[i] = word;
+	}
+
+	for (auto _: state) {
+		for (uint32_t codeword: codewords) {
+			int ret = decode_golay24(&codeword);
+			benchmark::DoNotOptimize(ret);
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * codewords.size());
+}
+BENCHMARK(BM_Golay24Decode)->ArgName("errors")->DenseRange(0, 3);
+
+
+static void BM_ConvolutionalEncoder(benchmark::State& state, const ConvolutionalConfig* conf)
+{
+	ConvolutionalEncoder encoder(*conf);
+	SymbolVector bits(1024), coded;
+	for (Symbol& bit: bits)
+		bit = random_bit();
+	coded.reserve(4096);
+
+	size_t total = 0;
+	for (auto _: state) {
+		encoder.reset();
+		SymbolGenerator input = generator_from_vector(bits);
+		SymbolGenerator gen = encoder.generateSymbols(input);
+		while (gen.running()) {
+			gen.sourceSymbols(coded);
+			total += coded.size();
+		}
+	}
+	state.SetItemsProcessed(state.iterations() * bits.size());
+	state.counters["coded_bits"] = benchmark::Counter(total, benchmark::Counter::kAvgIterations);
+}
+BENCHMARK_CAPTURE(BM_ConvolutionalEncoder, r1_2_k7, &ConvolutionCodes::CCSDS_1_2_7);
+BENCHMARK_CAPTURE(BM_ConvolutionalEncoder, r3_4_k7, &ConvolutionCodes::CCSDS_3_4_7);
+
+
+/* Decode noisy soft bits. Items are the decoded bits. */
+static void BM_ViterbiDecoder(benchmark::State& state, const ConvolutionalConfig* conf, ViterbiKernel kernel)
+{
+	if (ViterbiDecoder::isSupported(kernel) == false) {
+		state.SkipWithError("Kernel not supported");
+		return;
+	}
+
+	SymbolVector bits(4096);
+	for (Symbol& bit: bits)
+		bit = random_bit();
+
+	ConvolutionalEncoder encoder(*conf);
+	SymbolGenerator input = generator_from_vector(bits);
+	SymbolGenerator gen = encoder.generateSymbols(input);
+	SymbolVector coded, block;
+	block.reserve(256);
+	while (gen.running()) {
+		gen.sourceSymbols(block);
+		coded.insert(coded.end(), block.begin(), block.end());
+	}
+
+	vector<softbit_t> soft(coded.size());
+	for (size_t i = 0; i < coded.size(); i++)
+		soft[i] = (coded[i] ? 192 : 64) + (rand() % 97) - 48;
+
+	ViterbiDecoder decoder(*conf, kernel);
+	SymbolVector decoded;
+	decoded.reserve(bits.size());
+	for (auto _: state) {
+		decoded.clear();
+		decoder.reset();
+		decoder.decode(soft.data(), soft.size(), decoded);
+		decoder.flush(decoded);
+		benchmark::DoNotOptimize(decoded.data());
+	}
+	state.SetItemsProcessed(state.iterations() * bits.size());
+}
+BENCHMARK_CAPTURE(BM_ViterbiDecoder, r1_2_k7_scalar, &ConvolutionCodes::CCSDS_1_2_7, ViterbiKernel::scalar);
+BENCHMARK_CAPTURE(BM_ViterbiDecoder, r1_2_k7_sse4, &ConvolutionCodes::CCSDS_1_2_7, ViterbiKernel::sse4);
+BENCHMARK_CAPTURE(BM_ViterbiDecoder, r1_2_k7_avx2, &ConvolutionCodes::CCSDS_1_2_7, ViterbiKernel::avx2);
+BENCHMARK_CAPTURE(BM_ViterbiDecoder, r3_4_k7, &ConvolutionCodes::CCSDS_3_4_7, ViterbiKernel::automatic);
+BENCHMARK_CAPTURE(BM_ViterbiDecoder, ax5043, &ConvolutionCodes::AX5043, ViterbiKernel::automatic);
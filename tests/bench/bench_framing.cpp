@@ -0,0 +1,124 @@
+/*
+ * Throughput of the deframers.
+ *
+ * The deframers are fed with 4096 bit vectors of a random bitstream.
+ * With argument frames=1 the bitstream contains a 64 byte frame every
+ * few thousand bits, so the decoding paths are included too.
+ */
+#include <benchmark/benchmark.h>
+
+#include <suo.hpp>
+#include <framing/golay_framer.hpp>
+#include <framing/golay_deframer.hpp>
+#include <framing/hdlc_framer.hpp>
+#include <framing/hdlc_deframer.hpp>
+#include <framing/syncword_framer.hpp>
+#include <framing/syncword_deframer.hpp>
+
+#include "../utils.hpp"
+
+using namespace std;
+using namespace suo;
+
+
+static const size_t chunk_len = 4096;
+
+
+/* Random bitstream with optionally embedded frames from the framer */
+template <typename Framer>
+static vector<SymbolVector> bitstream(const typename Framer::Config& conf, bool frames)
+{
+	Framer framer(conf);
+	RandomFrameGenerator frame_gen(64);
+	framer.sourceFrame.connect_member(&frame_gen, &RandomFrameGenerator::source_frame);
+
+	SymbolVector bits, buffer;
+	buffer.reserve(chunk_len);
+	for (unsigned int f = 0; f < 16; f++) {
+		for (unsigned int i = 0; i < 2000; i++)
+			bits.push_back(random_bit());
+
+		if (frames) {
+			SymbolGenerator gen = framer.generateSymbols(0);
+			while (gen.running()) {
+				gen.sourceSymbols(buffer);
+				bits.insert(bits.end(), buffer.begin(), buffer.end());
+			}
+		}
+	}
+
+	vector<SymbolVector> chunks;
+	for (size_t i = 0; i < bits.size(); i += chunk_len) {
+		size_t len = min(chunk_len, bits.size() - i);
+		chunks.emplace_back(bits.begin() + i, bits.begin() + i + len);
+		chunks.back().flags = none;
+	}
+	return chunks;
+}
+
+
+template <typename Deframer>
+static void runDeframer(benchmark::State& state, Deframer& deframer, const vector<SymbolVector>& chunks)
+{
+	size_t bits = 0, frames = 0;
+	deframer.sinkFrame.connect([&](auto& frame, Timestamp now) { frames++; });
+
+	Timestamp now = 0;
+	for (auto _: state) {
+		for (const SymbolVector& chunk: chunks) {
+			deframer.sinkSymbols(chunk, now);
+			now += chunk.size();
+			bits += chunk.size();
+		}
+	}
+	state.SetItemsProcessed(bits);
+	state.counters["frames"] = benchmark::Counter(frames, benchmark::Counter::kAvgIterations);
+}
+
+
+static void BM_GolayDeframer(benchmark::State& state)
+{
+	GolayFramer::Config framer_conf;
+	framer_conf.use_rs = true;
+	framer_conf.use_randomizer = true;
+	framer_conf.use_viterbi = false;
+	vector<SymbolVector> chunks = bitstream<GolayFramer>(framer_conf, state.range(0));
+
+	GolayDeframer::Config conf;
+	conf.use_rs = framer_conf.use_rs;
+	conf.use_randomizer = framer_conf.use_randomizer;
+	conf.use_viterbi = framer_conf.use_viterbi;
+	GolayDeframer deframer(conf);
+	runDeframer(state, deframer, chunks);
+}
+BENCHMARK(BM_GolayDeframer)->ArgName("frames")->Arg(0)->Arg(1);
+
+
+static void BM_HDLCDeframer(benchmark::State& state)
+{
+	HDLCFramer::Config framer_conf;
+	framer_conf.mode = HDLCMode::G3RUH;
+	vector<SymbolVector> chunks = bitstream<HDLCFramer>(framer_conf, state.range(0));
+
+	HDLCDeframer::Config conf;
+	conf.mode = framer_conf.mode;
+	conf.minimum_frame_length = 8;
+	conf.maximum_frame_length = 256;
+	HDLCDeframer deframer(conf);
+	runDeframer(state, deframer, chunks);
+}
+BENCHMARK(BM_HDLCDeframer)->ArgName("frames")->Arg(0)->Arg(1);
+
+
+static void BM_SyncwordDeframer(benchmark::State& state)
+{
+	SyncwordFramer::Config framer_conf;
+	vector<SymbolVector> chunks = bitstream<SyncwordFramer>(framer_conf, state.range(0));
+
+	SyncwordDeframer::Config conf;
+	conf.syncword = framer_conf.syncword;
+	conf.syncword_len = framer_conf.syncword_len;
+	SyncwordDeframer deframer(conf);
+	runDeframer(state, deframer, chunks);
+}
+BENCHMARK(BM_SyncwordDeframer)->ArgName("frames")->Arg(0)->Arg(1);
@@ -0,0 +1,236 @@
+/*
+ * Throughput of the modulators and demodulators.
+ *
+ * Demodulators are fed with a modulated random bitstream in 4096 sample
+ * chunks. Modulators generate complete bursts of random symbols.
+ * Arguments are the sample rate [Hz] and the demodulator's internal
+ * samples per symbol. The symbol rate is 9600 baud in every case.
+ */
+#include <benchmark/benchmark.h>
+
+#include <suo.hpp>
+#include <modem/mod_gmsk.hpp>
+#include <modem/mod_fsk.hpp>
+#include <modem/mod_psk.hpp>
+#include <modem/demod_gmsk.hpp>
+#include <modem/demod_gmsk_cont.hpp>
+#include <modem/demod_fsk_mfilt.hpp>
+#include <modem/demod_psk.hpp>
+#include <modem/channelizer.hpp>
+
+#include "../utils.hpp"
+
+using namespace std;
+using namespace suo;
+
+
+static const float symbol_rate = 9600;
+static const size_t chunk_len = 4096;
+
+
+static SymbolVector randomSymbols(size_t len)
+{
+	SymbolVector symbols(len);
+	for (Symbol& s: symbols)
+		s = random_bit();
+	return symbols;
+}
+
+
+/* Source the whole burst of the modulator. Returns the number of samples. */
+template <typename Modulator>
+static size_t runModulator(Modulator& mod, SampleVector& buffer, SampleVector* signal = nullptr)
+{
+	size_t total = 0;
+	SampleGenerator gen = mod.generateSamples(0);
+	while (gen.running()) {
+		gen.sourceSamples(buffer);
+		total += buffer.size();
+		if (signal)
+			signal->insert(signal->end(), buffer.begin(), buffer.end());
+	}
+	return total;
+}
+
+
+/* Modulated random signal split to chunks */
+template <typename Modulator>
+static vector<SampleVector> modulateRandom(const typename Modulator::Config& conf, size_t num_symbols)
+{
+	SymbolVector symbols = randomSymbols(num_symbols);
+	Modulator mod(conf);
+	mod.generateSymbols.connect([&](Timestamp now) { return generator_from_vector(symbols); });
+
+	SampleVector buffer, signal;
+	buffer.reserve(chunk_len);
+	runModulator(mod, buffer, &signal);
+
+	vector<SampleVector> chunks;
+	for (size_t i = 0; i < signal.size(); i += chunk_len) {
+		size_t len = min(chunk_len, signal.size() - i);
+		chunks.emplace_back(signal.begin() + i, signal.begin() + i + len);
+	}
+	return chunks;
+}
+
+
+template <typename Demodulator>
+static void runDemodulator(benchmark::State& state, Demodulator& demod, const vector<SampleVector>& chunks)
+{
+	size_t samples = 0;
+	Timestamp now = 0;
+	for (auto _: state) {
+		for (const SampleVector& chunk: chunks) {
+			demod.sinkSamples(chunk, now);
+			now += chunk.size();
+			samples += chunk.size();
+		}
+	}
+	state.SetItemsProcessed(samples);
+}
+
+
+#define MODEM_ARGS \
+	->ArgNames({ "rate", "sps" }) \
+	->Args({ 50000, 4 })->Args({ 250000, 4 })->Args({ 1000000, 4 })->Args({ 250000, 8 })
+
+
+static void BM_GMSKContinousDemodulator(benchmark::State& state)
+{
+	GMSKModulator::Config mod_conf;
+	mod_conf.sample_rate = state.range(0);
+	mod_conf.symbol_rate = symbol_rate;
+	mod_conf.center_frequency = 0;
+	vector<SampleVector> chunks = modulateRandom<GMSKModulator>(mod_conf, 2048);
+
+	GMSKContinousDemodulator::Config conf;
+	conf.sample_rate = state.range(0);
+	conf.symbol_rate = symbol_rate;
+	conf.center_frequency = 0;
+	conf.samples_per_symbol = state.range(1);
+	GMSKContinousDemodulator demod(conf);
+	runDemodulator(state, demod, chunks);
+}
+BENCHMARK(BM_GMSKContinousDemodulator) MODEM_ARGS;
+
+
+static void BM_GMSKDemodulator(benchmark::State& state)
+{
+	GMSKModulator::Config mod_conf;
+	mod_conf.sample_rate = state.range(0);
+	mod_conf.symbol_rate = symbol_rate;
+	mod_conf.center_frequency = 0;
+	vector<SampleVector> chunks = modulateRandom<GMSKModulator>(mod_conf, 2048);
+
+	GMSKDemodulator::Config conf;
+	conf.sample_rate = state.range(0);
+	conf.symbol_rate = symbol_rate;
+	conf.center_frequency = 0;
+	conf.samples_per_symbol = state.range(1);
+	GMSKDemodulator demod(conf);
+	runDemodulator(state, demod, chunks);
+}
+BENCHMARK(BM_GMSKDemodulator) MODEM_ARGS;
+
+
+static void BM_FSKMatchedFilterDemodulator(benchmark::State& state)
+{
+	FSKModulator::Config mod_conf;
+	mod_conf.sample_rate = state.range(0);
+	mod_conf.symbol_rate = symbol_rate;
+	mod_conf.center_frequency = 0;
+	mod_conf.modindex = 1.0;
+	vector<SampleVector> chunks = modulateRandom<FSKModulator>(mod_conf, 2048);
+
+	FSKMatchedFilterDemodulator::Config conf;
+	conf.sample_rate = state.range(0);
+	conf.symbol_rate = symbol_rate;
+	conf.center_frequency = 0;
+	conf.modindex = 1.0;
+	conf.samples_per_symbol = state.range(1);
+	FSKMatchedFilterDemodulator demod(conf);
+	runDemodulator(state, demod, chunks);
+}
+BENCHMARK(BM_FSKMatchedFilterDemodulator) MODEM_ARGS;
+
+
+static void BM_PSKDemodulator(benchmark::State& state)
+{
+	PSKModulator::Config mod_conf;
+	mod_conf.sample_rate = state.range(0);
+	mod_conf.symbol_rate = symbol_rate;
+	mod_conf.center_frequency = 0;
+	vector<SampleVector> chunks = modulateRandom<PSKModulator>(mod_conf, 2048);
+
+	PSKDemodulator::Config conf;
+	conf.sample_rate = state.range(0);
+	conf.symbol_rate = symbol_rate;
+	conf.center_frequency = 0;
+	conf.samples_per_symbol = state.range(1);
+	PSKDemodulator demod(conf);
+	runDemodulator(state, demod, chunks);
+}
+BENCHMARK(BM_PSKDemodulator) MODEM_ARGS;
+
+
+/* 16 channel filter bank over a 2 MHz stream with a varying number of channels listened to */
+static void BM_Channelizer(benchmark::State& state)
+{
+	vector<SampleVector> chunks(16, SampleVector(chunk_len));
+	for (SampleVector& chunk: chunks)
+		for (Sample& s: chunk)
+			s = Sample(random_bit() - 0.5f, random_bit() - 0.5f);
+
+	Channelizer::Config conf;
+	conf.sample_rate = 2e6;
+	conf.num_channels = 16;
+	Channelizer channelizer(conf);
+
+	size_t received = 0;
+	for (int k = 0; k < state.range(0); k++)
+		channelizer.outputChannel(k).connect([&](const SampleVector& samples, Timestamp now) { received += samples.size(); });
+
+	runDemodulator(state, channelizer, chunks);
+	benchmark::DoNotOptimize(received);
+}
+BENCHMARK(BM_Channelizer)->ArgName("channels")->Arg(1)->Arg(4)->Arg(16);
+
+
+/* Generate bursts of 1024 random symbols */
+template <typename Modulator>
+static void runModulatorBenchmark(benchmark::State& state, typename Modulator::Config& conf)
+{
+	conf.sample_rate = state.range(0);
+	conf.symbol_rate = symbol_rate;
+	conf.center_frequency = 0;
+	Modulator mod(conf);
+
+	SymbolVector symbols = randomSymbols(1024);
+	mod.generateSymbols.connect([&](Timestamp now) { return generator_from_vector(symbols); });
+
+	SampleVector buffer;
+	buffer.reserve(chunk_len);
+	size_t samples = 0;
+	for (auto _: state)
+		samples += runModulator(mod, buffer);
+	state.SetItemsProcessed(samples);
+}
+
+static void BM_GMSKModulator(benchmark::State& state) {
+	GMSKModulator::Config conf;
+	runModulatorBenchmark<GMSKModulator>(state, conf);
+}
+BENCHMARK(BM_GMSKModulator)->ArgName("rate")->Arg(50000)->Arg(250000)->Arg(1000000);
+
+static void BM_FSKModulator(benchmark::State& state) {
+	FSKModulator::Config conf;
+	conf.modindex = 1.0;
+	runModulatorBenchmark<FSKModulator>(state, conf);
+}
+BENCHMARK(BM_FSKModulator)->ArgName("rate")->Arg(50000)->Arg(250000)->Arg(1000000);
+
+static void BM_PSKModulator(benchmark::State& state) {
+	PSKModulator::Config conf;
+	runModulatorBenchmark<PSKModulator>(state, conf);
+}
+BENCHMARK(BM_PSKModulator)->ArgName("rate")->Arg(50000)->Arg(250000)->Arg(1000000);
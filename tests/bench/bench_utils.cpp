@@ -0,0 +1,116 @@
+/*
+ * Throughput of the frame serialization, Port dispatch and sample format conversions.
+ */
+#include <benchmark/benchmark.h>
+
+#include <suo.hpp>
+#include <signal-io/conversion.hpp>
+
+#include "../utils.hpp"
+
+using namespace std;
+using namespace suo;
+
+
+static Frame testFrame(size_t len)
+{
+	Frame frame(len);
+	frame.id = 1234;
+	frame.timestamp = 1000000;
+	for (size_t i = 0; i < len; i++)
+		frame.data.push_back(random_byte());
+	frame.setMetadata(meta::rssi, -80.5f);
+	frame.setMetadata(meta::cfo, 1200.0f);
+	frame.setMetadata(meta::golay_coded, 1u);
+	frame.setMetadata(meta::sync_utc_timestamp, getCurrentUTCTimestamp());
+	return frame;
+}
+
+
+static void BM_FrameSerializeJSON(benchmark::State& state)
+{
+	Frame frame = testFrame(state.range(0));
+	for (auto _: state) {
+		string json = frame.serialize_to_json();
+		benchmark::DoNotOptimize(json.data());
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FrameSerializeJSON)->ArgName("bytes")->Arg(64)->Arg(256);
+
+
+static void BM_FrameDeserializeJSON(benchmark::State& state)
+{
+	const string json = testFrame(state.range(0)).serialize_to_json();
+	for (auto _: state) {
+		Frame frame = Frame::deserialize_from_json(json);
+		benchmark::DoNotOptimize(frame.data.data());
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FrameDeserializeJSON)->ArgName("bytes")->Arg(64)->Arg(256);
+
+
+class BitSink {
+public:
+	void sinkSymbol(Symbol bit, Timestamp now) {
+		latest_bits = (latest_bits << 1) | bit;
+	}
+	uint32_t latest_bits = 0;
+};
+
+
+static void BM_PortEmit(benchmark::State& state)
+{
+	vector<BitSink> sinks(state.range(0));
+	Port<Symbol, Timestamp> port;
+	for (BitSink& sink: sinks)
+		port.connect_member(&sink, &BitSink::sinkSymbol);
+
+	Timestamp now = 0;
+	for (auto _: state) {
+		port.emit(now & 1, now);
+		now++;
+	}
+	benchmark::DoNotOptimize(sinks[0].latest_bits);
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PortEmit)->ArgName("slots")->Arg(1)->Arg(3);
+
+
+static void BM_ConvertCS16ToCF(benchmark::State& state)
+{
+	const size_t len = 8192;
+	vector<cs16_t> in(len);
+	for (size_t i = 0; i < len; i++) {
+		in[i][0] = (int16_t)(random_byte() << 8);
+		in[i][1] = (int16_t)(random_byte() << 8);
+	}
+	SampleVector out(len);
+	SampleConverter converter((ConversionKernel)state.range(0));
+	for (auto _: state) {
+		converter.cs16_to_cf(in.data(), out.data(), len);
+		benchmark::DoNotOptimize(out.data());
+	}
+	state.SetItemsProcessed(state.iterations() * len);
+	state.SetLabel(SampleConverter::getKernelName(converter.getKernel()));
+}
+BENCHMARK(BM_ConvertCS16ToCF)->ArgName("kernel")->Arg((int)ConversionKernel::scalar)->Arg((int)ConversionKernel::automatic);
+
+
+static void BM_ConvertCFToCS16(benchmark::State& state)
+{
+	const size_t len = 8192;
+	SampleVector in(len);
+	for (size_t i = 0; i < len; i++)
+		in[i] = Sample(random_byte() / 128.0f - 1.0f, random_byte() / 128.0f - 1.0f);
+	vector<cs16_t> out(len);
+	SampleConverter converter((ConversionKernel)state.range(0));
+	for (auto _: state) {
+		converter.cf_to_cs16(in.data(), out.data(), len);
+		benchmark::DoNotOptimize(out.data());
+	}
+	state.SetItemsProcessed(state.iterations() * len);
+	state.SetLabel(SampleConverter::getKernelName(converter.getKernel()));
+}
+BENCHMARK(BM_ConvertCFToCS16)->ArgName("kernel")->Arg((int)ConversionKernel::scalar)->Arg((int)ConversionKernel::automatic);
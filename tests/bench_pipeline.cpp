@@ -0,0 +1,145 @@
+/*
+ * Microbenchmark for the compile-time Pipeline vs. the equivalent Port wiring.
+ *
+ * The chain is the real receiver: GMSKContinousDemodulator feeding a
+ * GolayDeframer. The signal is a GMSK modulated stream of Golay frames.
+ * The same blocks are wired with Ports, both one bit at a time (sinkSymbol)
+ * and batched (sinkSymbols), and with a Pipeline where the deframer runs
+ * as a static stage inside the demodulator's symbol loop.
+ */
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <functional>
+
+#include <suo.hpp>
+#include <pipeline.hpp>
+#include <framing/golay_framer.hpp>
+#include <framing/golay_deframer.hpp>
+#include <modem/mod_gmsk.hpp>
+#include <modem/demod_gmsk_cont.hpp>
+
+#include "utils.hpp"
+
+using namespace std;
+using namespace suo;
+
+
+static const size_t chunk_len = 4096;
+
+
+/* GMSK modulated bursts of random Golay frames split to chunks */
+static vector<SampleVector> modulateFrames(const GolayFramer::Config& framer_conf, const GMSKModulator::Config& mod_conf, unsigned int num_frames)
+{
+	GolayFramer framer(framer_conf);
+	RandomFrameGenerator frame_gen(64);
+	framer.sourceFrame.connect_member(&frame_gen, &RandomFrameGenerator::source_frame);
+
+	GMSKModulator mod(mod_conf);
+	mod.generateSymbols.connect_member(&framer, &GolayFramer::generateSymbols);
+
+	SampleVector buffer, signal;
+	buffer.reserve(chunk_len);
+	for (unsigned int f = 0; f < num_frames; f++) {
+		signal.resize(signal.size() + chunk_len, Sample(0.0f)); // Silence between the bursts
+		SampleGenerator gen = mod.generateSamples(0);
+		while (gen.running()) {
+			gen.sourceSamples(buffer);
+			signal.insert(signal.end(), buffer.begin(), buffer.end());
+		}
+	}
+
+	vector<SampleVector> chunks;
+	for (size_t i = 0; i < signal.size(); i += chunk_len) {
+		size_t len = min(chunk_len, signal.size() - i);
+		chunks.emplace_back(signal.begin() + i, signal.begin() + i + len);
+	}
+	return chunks;
+}
+
+
+/* Cost per sample [ns] */
+double measure_ns(std::function<void(const SampleVector&, Timestamp)> run, const vector<SampleVector>& chunks, size_t rounds)
+{
+	size_t samples = 0;
+	Timestamp now = 0;
+	auto start = chrono::steady_clock::now();
+	for (size_t r = 0; r < rounds; r++) {
+		for (const SampleVector& chunk: chunks) {
+			run(chunk, now);
+			now += chunk.size();
+			samples += chunk.size();
+		}
+	}
+	auto end = chrono::steady_clock::now();
+	return chrono::duration<double, std::nano>(end - start).count() / samples;
+}
+
+
+int main(int argc, char** argv)
+{
+	const size_t rounds = 20;
+
+	GolayFramer::Config framer_conf;
+	framer_conf.use_randomizer = true;
+	framer_conf.use_rs = true;
+
+	GMSKModulator::Config mod_conf;
+	mod_conf.sample_rate = 50e3;
+	mod_conf.symbol_rate = 9600;
+	mod_conf.center_frequency = 0;
+	vector<SampleVector> chunks = modulateFrames(framer_conf, mod_conf, 32);
+
+	GMSKContinousDemodulator::Config demod_conf;
+	demod_conf.sample_rate = mod_conf.sample_rate;
+	demod_conf.symbol_rate = mod_conf.symbol_rate;
+	demod_conf.center_frequency = mod_conf.center_frequency;
+	demod_conf.samples_per_symbol = 4;
+
+	GolayDeframer::Config deframer_conf;
+	deframer_conf.use_randomizer = true;
+	deframer_conf.use_rs = true;
+
+	cout << "GMSKContinousDemodulator -> GolayDeframer" << endl;
+	cout << setw(28) << left << "wiring" << right << setw(16) << "ns/sample" << setw(10) << "frames" << endl;
+	cout << fixed << setprecision(2);
+
+	auto report = [](const char* name, double t, unsigned int frames) {
+		cout << setw(28) << left << name << right << setw(16) << t << setw(10) << frames << endl;
+	};
+
+	{
+		GMSKContinousDemodulator demod(demod_conf);
+		GolayDeframer deframer(deframer_conf);
+		unsigned int frames = 0;
+		demod.sinkSymbol.connect_member(&deframer, &GolayDeframer::sinkSymbol);
+		deframer.syncDetected.connect_member(&demod, &GMSKContinousDemodulator::lockReceiver);
+		deframer.sinkFrame.connect([&](const Frame& frame, Timestamp now) { frames++; });
+		double t = measure_ns([&](const SampleVector& s, Timestamp t) { demod.sinkSamples(s, t); }, chunks, rounds);
+		report("Port, sinkSymbol", t, frames);
+	}
+
+	{
+		GMSKContinousDemodulator demod(demod_conf);
+		GolayDeframer deframer(deframer_conf);
+		unsigned int frames = 0;
+		demod.sinkSymbols.connect_member(&deframer, &GolayDeframer::sinkSymbols);
+		deframer.syncDetected.connect_member(&demod, &GMSKContinousDemodulator::lockReceiver);
+		deframer.sinkFrame.connect([&](const Frame& frame, Timestamp now) { frames++; });
+		double t = measure_ns([&](const SampleVector& s, Timestamp t) { demod.sinkSamples(s, t); }, chunks, rounds);
+		report("Port, sinkSymbols", t, frames);
+	}
+
+	{
+		GMSKContinousDemodulator demod(demod_conf);
+		GolayDeframer deframer(deframer_conf);
+		unsigned int frames = 0;
+		Pipeline<GMSKContinousDemodulator, GolayDeframer> pipeline(demod, deframer);
+		deframer.syncDetected.connect_member(&demod, &GMSKContinousDemodulator::lockReceiver);
+		deframer.sinkFrame.connect([&](const Frame& frame, Timestamp now) { frames++; });
+		double t = measure_ns([&](const SampleVector& s, Timestamp t) { pipeline.sink(s, t); }, chunks, rounds);
+		report("Pipeline", t, frames);
+	}
+
+	return 0;
+}
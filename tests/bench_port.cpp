@@ -0,0 +1,105 @@
+/*
+ * Microbenchmark for Port::emit() dispatch cost.
+ *
+ * Compares the current flat-vector Port against the previous
+ * std::map<int, std::function> based implementation which is kept
+ * here only as a reference point.
+ */
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <map>
+#include <functional>
+
+#include <suo.hpp>
+
+using namespace std;
+using namespace suo;
+
+
+namespace legacy {
+
+// The original map based Port implementation
+template <typename... Args>
+class Port {
+public:
+	int connect(std::function<void(Args...)> const& slot) const {
+		_slots.insert(std::make_pair(++_current_id, slot));
+		return _current_id;
+	}
+
+	template <typename T>
+	int connect_member(T* inst, void (T::* func)(Args...)) {
+		return connect([=](Args... args) {
+			(inst->*func)(args...);
+		});
+	}
+
+	void emit(Args... p) {
+		for (auto const& it : _slots)
+			it.second(p...);
+	}
+
+private:
+	mutable std::map<int, std::function<void(Args...)>> _slots;
+	mutable int _current_id{ 0 };
+};
+
+}; // namespace legacy
+
+
+class BitSink {
+public:
+	BitSink() : latest_bits(0), latest_time(0) { }
+
+	// Mimics the cheap per-bit work of a deframer in sync search state
+	void sinkSymbol(Symbol bit, Timestamp now) {
+		latest_bits = (latest_bits << 1) | bit;
+		latest_time = now;
+	}
+
+	unsigned int latest_bits;
+	Timestamp latest_time;
+};
+
+
+template<typename PortType>
+double measure(PortType& port, size_t iterations)
+{
+	auto start = chrono::steady_clock::now();
+	for (size_t i = 0; i < iterations; i++)
+		port.emit(i & 1, i);
+	auto end = chrono::steady_clock::now();
+	return chrono::duration<double, std::nano>(end - start).count() / iterations;
+}
+
+
+template<typename PortType>
+double run_case(size_t sinks, size_t iterations)
+{
+	PortType port;
+	std::vector<BitSink> sink_objects(sinks);
+	for (BitSink& sink: sink_objects)
+		port.connect_member(&sink, &BitSink::sinkSymbol);
+
+	measure(port, iterations / 10); // Warm-up
+	return measure(port, iterations);
+}
+
+
+int main(int argc, char** argv)
+{
+	const size_t iterations = 50000000;
+
+	cout << "Port::emit() cost per call" << endl;
+	cout << setw(8) << "sinks" << setw(16) << "legacy [ns]" << setw(16) << "current [ns]" << endl;
+	for (size_t sinks: { 1, 2, 4 }) {
+		double t_legacy = run_case<legacy::Port<Symbol, Timestamp>>(sinks, iterations);
+		double t_current = run_case<suo::Port<Symbol, Timestamp>>(sinks, iterations);
+		cout << setw(8) << sinks;
+		cout << fixed << setprecision(2);
+		cout << setw(16) << t_legacy << setw(16) << t_current << endl;
+	}
+
+	return 0;
+}
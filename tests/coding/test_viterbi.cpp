@@ -0,0 +1,165 @@
+#include <iostream>
+#include <random>
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/ui/text/TestRunner.h>
+
+#include "suo.hpp"
+#include "coding/convolutional_encoder.hpp"
+#include "coding/viterbi_decoder.hpp"
+
+
+using namespace std;
+using namespace suo;
+
+
+class ViterbiTest : public CppUnit::TestFixture
+{
+private:
+	mt19937 rng;
+
+	SymbolVector randomBits(size_t len) {
+		SymbolVector bits(len);
+		for (Symbol& bit: bits)
+			bit = rng() & 1;
+		return bits;
+	}
+
+	SymbolVector encode(const ConvolutionalConfig& conf, SymbolVector& bits) {
+		ConvolutionalEncoder encoder(conf);
+		SymbolGenerator input = generator_from_vector(bits);
+		SymbolGenerator gen = encoder.generateSymbols(input);
+
+		SymbolVector coded, block;
+		block.reserve(100);
+		while (gen.running()) {
+			gen.sourceSymbols(block);
+			coded.insert(coded.end(), block.begin(), block.end());
+		}
+		return coded;
+	}
+
+	/* Map the coded bits to soft bits with additive gaussian noise */
+	vector<softbit_t> softBits(const SymbolVector& coded, float noise_std) {
+		normal_distribution<float> noise(0.0f, noise_std);
+		vector<softbit_t> soft(coded.size());
+		for (size_t i = 0; i < coded.size(); i++) {
+			float v = (coded[i] ? 200.0f : 55.0f) + noise(rng);
+			soft[i] = (softbit_t)max(0.0f, min(255.0f, v));
+		}
+		return soft;
+	}
+
+public:
+
+	void setUp() {
+		rng.seed(1234);
+	}
+
+	/* Error free input decodes to the original bits with every code */
+	void test_codes()
+	{
+		for (const ConvolutionalConfig* conf: { &ConvolutionCodes::AX5043, &ConvolutionCodes::TI_CC11xx,
+				&ConvolutionCodes::CCSDS_1_2_7, &ConvolutionCodes::CCSDS_2_3_7, &ConvolutionCodes::CCSDS_3_4_7,
+				&ConvolutionCodes::CCSDS_4_5_7, &ConvolutionCodes::CCSDS_5_6_7, &ConvolutionCodes::CCSDS_1_3_7 })
+		{
+			SymbolVector bits = randomBits(1000 + rng() % 1000);
+			SymbolVector coded = encode(*conf, bits);
+
+			ViterbiDecoder decoder(*conf);
+			SymbolVector decoded;
+			decoder.decodeHard(coded.data(), coded.size(), decoded);
+			decoder.flush(decoded);
+
+			CPPUNIT_ASSERT(decoded == bits);
+		}
+	}
+
+	/* All the kernels make the same decisions on noisy input fed in odd sized blocks */
+	void test_kernels()
+	{
+		for (const ConvolutionalConfig* conf: { &ConvolutionCodes::CCSDS_1_2_7, &ConvolutionCodes::CCSDS_3_4_7, &ConvolutionCodes::CCSDS_1_3_7 })
+		{
+			SymbolVector bits = randomBits(3000);
+			vector<softbit_t> soft = softBits(encode(*conf, bits), 30.0f);
+
+			SymbolVector reference;
+			for (ViterbiKernel kernel: { ViterbiKernel::scalar, ViterbiKernel::sse4, ViterbiKernel::avx2, ViterbiKernel::automatic }) {
+				if (ViterbiDecoder::isSupported(kernel) == false) {
+					CPPUNIT_ASSERT_THROW(ViterbiDecoder(*conf, kernel), SuoError);
+					continue;
+				}
+
+				ViterbiDecoder decoder(*conf, kernel);
+				SymbolVector decoded;
+				size_t i = 0, block = 1;
+				while (i < soft.size()) {
+					size_t n = min(block, soft.size() - i);
+					decoder.decode(&soft[i], n, decoded);
+					i += n;
+					block = 2 * block + 1;
+				}
+				decoder.flush(decoded);
+
+				CPPUNIT_ASSERT(decoded.size() == bits.size());
+				if (kernel == ViterbiKernel::scalar)
+					reference = decoded;
+				else
+					CPPUNIT_ASSERT(decoded == reference);
+			}
+
+			// Moderate noise is fully corrected
+			CPPUNIT_ASSERT(reference == bits);
+		}
+
+		// SIMD kernels are only for k=7
+		if (ViterbiDecoder::isSupported(ViterbiKernel::sse4))
+			CPPUNIT_ASSERT_THROW(ViterbiDecoder(ConvolutionCodes::AX5043, ViterbiKernel::sse4), SuoError);
+		CPPUNIT_ASSERT(ViterbiDecoder(ConvolutionCodes::AX5043).getKernel() == ViterbiKernel::scalar);
+	}
+
+	/* Decoding continues over multiple tracebacks and the decoder can be reused after reset */
+	void test_stream()
+	{
+		const ConvolutionalConfig& conf = ConvolutionCodes::CCSDS_1_2_7;
+		ViterbiDecoder decoder(ConvolutionalConfig{ conf }); // The decoder keeps a copy of a temporary config
+
+		for (int round = 0; round < 2; round++) {
+			SymbolVector bits = randomBits(10 * ViterbiDecoder::block_len + 7);
+			vector<softbit_t> soft = softBits(encode(conf, bits), 20.0f);
+
+			SymbolVector decoded;
+			decoder.reset();
+			decoder.decode(soft.data(), soft.size() / 2, decoded);
+			CPPUNIT_ASSERT(decoded.size() % ViterbiDecoder::block_len == 0);
+			CPPUNIT_ASSERT(decoded.size() + ViterbiDecoder::traceback_len + ViterbiDecoder::block_len >= bits.size() / 2);
+
+			decoder.decode(soft.data() + soft.size() / 2, soft.size() - soft.size() / 2, decoded);
+			decoder.flush(decoded);
+			CPPUNIT_ASSERT(decoded == bits);
+		}
+	}
+
+	static CppUnit::Test* suite()
+	{
+		CppUnit::TestSuite* suite = new CppUnit::TestSuite("ViterbiTest");
+		suite->addTest(new CppUnit::TestCaller<ViterbiTest>("Codes", &ViterbiTest::test_codes));
+		suite->addTest(new CppUnit::TestCaller<ViterbiTest>("Kernels", &ViterbiTest::test_kernels));
+		suite->addTest(new CppUnit::TestCaller<ViterbiTest>("Stream", &ViterbiTest::test_stream));
+		return suite;
+	}
+
+};
+
+
+#ifndef COMBINED_TEST
+int main(int argc, char** argv)
+{
+	CppUnit::TextUi::TestRunner runner;
+	runner.addTest(ViterbiTest::suite());
+	runner.run();
+	return 0;
+}
+#endif
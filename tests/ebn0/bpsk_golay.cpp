@@ -44,6 +44,7 @@ void bpsk_golay_test() {
 	mod_conf.center_frequency = 10e3;
 	mod_conf.ramp_up_duration = 3;
 	mod_conf.ramp_down_duration = 3;
+	mod_conf.differential = true;
 
 	PSKModulator mod(mod_conf);
 	mod.generateSymbols.connect_member(&framer, &GolayFramer::generateSymbols);
@@ -59,7 +60,7 @@ void bpsk_golay_test() {
 
 	GolayDeframer deframer(deframer_conf);
 	Frame received_frame;
-	deframer.sinkFrame.connect([&](Frame& frame, Timestamp now) {
+	deframer.sinkFrame.connect([&](const Frame& frame, Timestamp now) {
 		(void)now;
 		received_frame = frame;
     });
@@ -70,9 +71,10 @@ void bpsk_golay_test() {
 	demod_conf.symbol_rate = mod_conf.symbol_rate + symbol_rate_offset;
 	demod_conf.center_frequency = mod_conf.center_frequency + frequency_offset;
 	demod_conf.samples_per_symbol = 8;
+	demod_conf.differential = true;
 
 	PSKDemodulator demod(demod_conf);
-	demod.sinkSymbol.connect_member(&deframer, &GolayDeframer::sinkSymbol);
+	demod.sinkSymbols.connect_member(&deframer, &GolayDeframer::sinkSymbols);
 	deframer.syncDetected.connect_member(&demod, &PSKDemodulator::lockReceiver);
 
 
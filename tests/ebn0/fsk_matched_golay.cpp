@@ -66,7 +66,7 @@ void fsk_matched_golay_test()
 	deframer_conf.use_rs = framer_conf.use_rs;
 
 	GolayDeframer deframer(deframer_conf);
-	deframer.sinkFrame.connect([&](Frame& frame, Timestamp now) {
+	deframer.sinkFrame.connect([&](const Frame& frame, Timestamp now) {
 		(void)now;
 		received_frame = frame;
 	});
@@ -80,7 +80,7 @@ void fsk_matched_golay_test()
 	demod_conf.bt = mod_conf.bt;
 
 	FSKMatchedFilterDemodulator demod(demod_conf);
-	demod.sinkSymbol.connect_member(&deframer, &GolayDeframer::sinkSymbol);
+	demod.sinkSymbols.connect_member(&deframer, &GolayDeframer::sinkSymbols);
 	deframer.syncDetected.connect_member(&demod, &FSKMatchedFilterDemodulator::lockReceiver);
 
 
@@ -63,7 +63,7 @@ void fsk_matched_golay_test()
 	deframer_conf.minimum_silence = 5;
 
 	HDLCDeframer deframer(deframer_conf);
-	deframer.sinkFrame.connect([&](Frame& frame, Timestamp now) {
+	deframer.sinkFrame.connect([&](const Frame& frame, Timestamp now) {
 		(void)now;
 		received_frame = frame;
 	});
@@ -77,7 +77,7 @@ void fsk_matched_golay_test()
 	demod_conf.bt = mod_conf.bt;
 
 	FSKMatchedFilterDemodulator demod(demod_conf);
-	demod.sinkSymbol.connect_member(&deframer, &HDLCDeframer::sinkSymbol);
+	demod.sinkSymbols.connect_member(&deframer, &HDLCDeframer::sinkSymbols);
 	deframer.syncDetected.connect_member(&demod, &FSKMatchedFilterDemodulator::lockReceiver);
 
 
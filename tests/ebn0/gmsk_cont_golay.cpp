@@ -61,7 +61,7 @@ void gmsk_cont_golay_test() {
 
 	GolayDeframer deframer(deframer_conf);
 	Frame received_frame;
-	deframer.sinkFrame.connect([&](Frame& frame, Timestamp now) { 
+	deframer.sinkFrame.connect([&](const Frame& frame, Timestamp now) { 
 		(void)now;
 		received_frame = frame;
 		//cout << received_frame(Frame::PrintData | Frame::PrintMetadata | Frame::PrintColored);
@@ -76,7 +76,7 @@ void gmsk_cont_golay_test() {
 	demod_conf.samples_per_symbol = 8;
 
 	GMSKContinousDemodulator demod(demod_conf);
-	demod.sinkSymbol.connect_member(&deframer, &GolayDeframer::sinkSymbol);
+	demod.sinkSymbols.connect_member(&deframer, &GolayDeframer::sinkSymbols);
 	deframer.syncDetected.connect_member(&demod, &GMSKContinousDemodulator::lockReceiver);
 #else
 	GMSKDemodulator::Config demod_conf;
@@ -88,7 +88,7 @@ void gmsk_cont_golay_test() {
 	demod_conf.syncword_len = 32;
 
 	GMSKDemodulator demod(demod_conf);
-	demod.sinkSymbol.connect_member(&deframer, &GolayDeframer::sinkSymbol);
+	demod.sinkSymbols.connect_member(&deframer, &GolayDeframer::sinkSymbols);
 	deframer.syncDetected.connect_member(&demod, &GMSKDemodulator::lockReceiver);
 #endif
 
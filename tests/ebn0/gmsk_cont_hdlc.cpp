@@ -57,7 +57,7 @@ void gmsk_cont_hdlc_test() {
 
 	HDLCDeframer deframer(deframer_conf);
 	Frame received_frame;
-	deframer.sinkFrame.connect([&](Frame& frame, Timestamp now) {
+	deframer.sinkFrame.connect([&](const Frame& frame, Timestamp now) {
 		(void)now;
 		received_frame = frame;
 		//cout << received_frame(Frame::PrintData | Frame::PrintMetadata | Frame::PrintColored);
@@ -72,7 +72,7 @@ void gmsk_cont_hdlc_test() {
 	demod_conf.samples_per_symbol = 8;
 
 	GMSKContinousDemodulator demod(demod_conf);
-	demod.sinkSymbol.connect_member(&deframer, &HDLCDeframer::sinkSymbol);
+	demod.sinkSymbols.connect_member(&deframer, &HDLCDeframer::sinkSymbols);
 	deframer.syncDetected.connect_member(&demod, &GMSKContinousDemodulator::lockReceiver);
 #else
 	GMSKDemodulator::Config demod_conf;
@@ -84,7 +84,7 @@ void gmsk_cont_hdlc_test() {
 	demod_conf.syncword_len = 32;
 
 	GMSKDemodulator demod(demod_conf);
-	demod.sinkSymbol.connect_member(&deframer, &HDLCDeframer::sinkSymbol);
+	demod.sinkSymbols.connect_member(&deframer, &HDLCDeframer::sinkSymbols);
 	deframer.syncDetected.connect_member(&demod, &GMSKDemodulator::lockReceiver);
 #endif
 
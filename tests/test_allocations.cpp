@@ -0,0 +1,193 @@
+#include <iostream>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/ui/text/TestRunner.h>
+
+#include <suo.hpp>
+#include <modem/mod_gmsk.hpp>
+#include <modem/demod_gmsk_cont.hpp>
+#include <framing/golay_framer.hpp>
+#include <framing/golay_deframer.hpp>
+
+
+using namespace std;
+using namespace suo;
+
+
+/*
+ * Count every heap allocation of the process
+ */
+static std::atomic<size_t> allocation_count(0);
+
+void* operator new(size_t size) {
+	allocation_count.fetch_add(1, std::memory_order_relaxed);
+	void* ptr = malloc(size ? size : 1);
+	if (ptr == nullptr)
+		throw std::bad_alloc();
+	return ptr;
+}
+
+void* operator new(size_t size, std::align_val_t align) {
+	allocation_count.fetch_add(1, std::memory_order_relaxed);
+	const size_t a = static_cast<size_t>(align);
+	void* ptr = aligned_alloc(a, (size + a - 1) / a * a);
+	if (ptr == nullptr)
+		throw std::bad_alloc();
+	return ptr;
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+void* operator new[](size_t size, std::align_val_t align) { return operator new(size, align); }
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept { free(ptr); }
+void operator delete[](void* ptr) noexcept { free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { free(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { free(ptr); }
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept { free(ptr); }
+
+
+/*
+ * Runs the GMSK + Golay (Reed-Solomon, randomizer) chain in both directions
+ * and counts the heap allocations after a few warm-up bursts.
+ */
+class AllocationTest : public CppUnit::TestFixture
+{
+public:
+
+	static const unsigned int warmup_bursts = 3;
+	static const unsigned int bursts = 10;
+	static const size_t buffer_len = 1024;
+
+	AllocationTest() :
+		transmit_frame(64),
+		received_frames(0)
+	{ }
+
+	void setUp() {
+		transmit_frame.clear();
+		for (size_t i = 0; i < 64; i++)
+			transmit_frame.data.push_back(i * 7);
+		received_frames = 0;
+	}
+
+	void sourceFrame(Frame& frame, Timestamp now) {
+		(void)now;
+		frame = transmit_frame;
+	}
+
+	void sinkFrame(const Frame& frame, Timestamp now) {
+		(void)now;
+		if (frame.data == transmit_frame.data)
+			received_frames++;
+	}
+
+	void test_steady_state() {
+
+		GolayFramer::Config framer_conf;
+		framer_conf.use_randomizer = true;
+		framer_conf.use_rs = true;
+		GolayFramer framer(framer_conf);
+		framer.sourceFrame.connect_member(this, &AllocationTest::sourceFrame);
+
+		GMSKModulator::Config mod_conf;
+		mod_conf.sample_rate = 50e3;
+		mod_conf.symbol_rate = 9600;
+		mod_conf.center_frequency = 0;
+		mod_conf.bt = 0.5;
+		GMSKModulator mod(mod_conf);
+		mod.generateSymbols.connect_member(&framer, &GolayFramer::generateSymbols);
+
+		GolayDeframer::Config deframer_conf;
+		deframer_conf.use_randomizer = true;
+		deframer_conf.use_rs = true;
+		GolayDeframer deframer(deframer_conf);
+		deframer.sinkFrame.connect_member(this, &AllocationTest::sinkFrame);
+
+		GMSKContinousDemodulator::Config demod_conf;
+		demod_conf.sample_rate = mod_conf.sample_rate;
+		demod_conf.symbol_rate = mod_conf.symbol_rate;
+		demod_conf.center_frequency = mod_conf.center_frequency;
+		demod_conf.bt = mod_conf.bt;
+		demod_conf.samples_per_symbol = 4;
+		GMSKContinousDemodulator demod(demod_conf);
+		demod.sinkSymbols.connect_member(&deframer, &GolayDeframer::sinkSymbols);
+		deframer.syncDetected.connect_member(&demod, &GMSKContinousDemodulator::lockReceiver);
+		demod.setMetadata.connect_member(&deframer, &GolayDeframer::setMetadata);
+
+		/* Buffers of the SDR loop */
+		SampleVector signal;
+		signal.reserve(1 << 16);
+		SampleVector rxbuf;
+		rxbuf.reserve(buffer_len);
+
+		size_t tx_allocations = 0, rx_allocations = 0;
+		Timestamp now = 0;
+		for (unsigned int burst = 0; burst < warmup_bursts + bursts; burst++) {
+			const bool measure = burst >= warmup_bursts;
+
+			/* TX: Render the burst in SDR buffer sized chunks */
+			size_t start = allocation_count.load();
+			signal.assign(4 * buffer_len, 0.0f);
+			SampleGenerator gen = mod.generateSamples(now);
+			CPPUNIT_ASSERT(gen.running());
+			while (gen.running()) {
+				const size_t len = signal.size();
+				signal.resize(len + buffer_len);
+				VectorFlags flags = none;
+				size_t n = gen.sourceSamples(SampleSpan{ &signal[len], buffer_len }, flags);
+				signal.resize(len + n);
+				if (flags & end_of_burst)
+					break;
+			}
+			gen = SampleGenerator();
+			signal.resize(signal.size() + 4 * buffer_len, 0.0f);
+			if (measure)
+				tx_allocations += allocation_count.load() - start;
+
+			/* RX: Feed the burst and silence around it to the receiver */
+			start = allocation_count.load();
+			for (size_t pos = 0; pos < signal.size(); pos += buffer_len) {
+				const size_t n = min(buffer_len, signal.size() - pos);
+				rxbuf.assign(signal.begin() + pos, signal.begin() + pos + n);
+				demod.sinkSamples(rxbuf, now);
+				now += (Timestamp)(1e9 * n / mod_conf.sample_rate);
+			}
+			if (measure)
+				rx_allocations += allocation_count.load() - start;
+		}
+
+		cout << "TX allocations: " << tx_allocations << ", RX allocations: " << rx_allocations << endl;
+		CPPUNIT_ASSERT(received_frames == warmup_bursts + bursts);
+		CPPUNIT_ASSERT(tx_allocations == 0);
+		CPPUNIT_ASSERT(rx_allocations == 0);
+	}
+
+	static CppUnit::Test* suite()
+	{
+		CppUnit::TestSuite* suite = new CppUnit::TestSuite("AllocationTest");
+		suite->addTest(new CppUnit::TestCaller<AllocationTest>("SteadyState", &AllocationTest::test_steady_state));
+		return suite;
+	}
+
+private:
+	Frame transmit_frame;
+	unsigned int received_frames;
+};
+
+
+#ifndef COMBINED_TEST
+int main(int argc, char** argv)
+{
+	CppUnit::TextUi::TestRunner runner;
+	runner.addTest(AllocationTest::suite());
+	runner.run();
+	return 0;
+}
+#endif
@@ -58,6 +58,7 @@ public:
 		mod_conf.center_frequency = 0e3;
 		mod_conf.ramp_up_duration = 3;
 		mod_conf.ramp_down_duration = 3;
+		mod_conf.differential = true;
 
 		PSKModulator mod(mod_conf);
 		mod.generateSymbols.connect_member(&framer, &GolayFramer::generateSymbols);
@@ -75,7 +76,7 @@ public:
 		GolayDeframer deframer(deframer_conf);
 
 		Frame received_frame;
-		deframer.sinkFrame.connect([&](Frame& frame, Timestamp now) {
+		deframer.sinkFrame.connect([&](const Frame& frame, Timestamp now) {
 			(void)now;
 			received_frame = frame;
 			cout << frame(Frame::PrintData | Frame::PrintMetadata | Frame::PrintAltColor | Frame::PrintColored);
@@ -93,9 +94,10 @@ public:
 		demod_conf.symbol_rate = mod_conf.symbol_rate;
 		demod_conf.center_frequency = mod_conf.center_frequency + frequency_offset;
 		demod_conf.samples_per_symbol = 8;
+		demod_conf.differential = true;
 
 		PSKDemodulator demod(demod_conf);
-		demod.sinkSymbol.connect_member(&deframer, &GolayDeframer::sinkSymbol);
+		demod.sinkSymbols.connect_member(&deframer, &GolayDeframer::sinkSymbols);
 		deframer.syncDetected.connect_member(&demod, &PSKDemodulator::lockReceiver);
 
 
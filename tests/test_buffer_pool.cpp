@@ -0,0 +1,146 @@
+#include <iostream>
+#include <thread>
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/ui/text/TestRunner.h>
+
+#include <suo.hpp>
+#include <buffer_pool.hpp>
+
+
+using namespace std;
+using namespace suo;
+
+
+class BufferPoolTest: public CppUnit::TestFixture
+{
+public:
+
+	void test_recycling() {
+		BufferPool<SampleVector> pool(4);
+
+		const Sample* first_data;
+		{
+			Pooled<SampleVector> buf = pool.acquire(1000);
+			CPPUNIT_ASSERT(buf->capacity() >= 1000);
+			buf->resize(10);
+			first_data = buf->data();
+		}
+
+		BufferPool<SampleVector>::Statistics stats = pool.getStatistics();
+		CPPUNIT_ASSERT(stats.misses == 1 && stats.hits == 0);
+		CPPUNIT_ASSERT(stats.outstanding == 0 && stats.pooled == 1);
+
+		// The same buffer comes back cleared but with its capacity
+		Pooled<SampleVector> buf = pool.acquire();
+		CPPUNIT_ASSERT(buf->empty());
+		CPPUNIT_ASSERT(buf->capacity() >= 1000);
+		CPPUNIT_ASSERT(buf->data() == first_data);
+
+		stats = pool.getStatistics();
+		CPPUNIT_ASSERT(stats.misses == 1 && stats.hits == 1);
+		CPPUNIT_ASSERT(stats.outstanding == 1 && stats.high_water == 1);
+	}
+
+	void test_refcount() {
+		BufferPool<SymbolVector> pool;
+
+		Pooled<SymbolVector> a = pool.acquire();
+		a->push_back(1);
+		Pooled<SymbolVector> b = a;
+		CPPUNIT_ASSERT(a.use_count() == 2);
+		CPPUNIT_ASSERT(b->size() == 1 && b.get() == a.get());
+
+		a.reset();
+		CPPUNIT_ASSERT(!a && b.use_count() == 1);
+		CPPUNIT_ASSERT(pool.getStatistics().outstanding == 1);
+
+		Pooled<SymbolVector> c = std::move(b);
+		CPPUNIT_ASSERT(!b && c.use_count() == 1);
+
+		c.reset();
+		CPPUNIT_ASSERT(pool.getStatistics().outstanding == 0);
+		CPPUNIT_ASSERT(pool.getStatistics().pooled == 1);
+	}
+
+	void test_high_water() {
+		BufferPool<Frame> pool(2);
+		{
+			std::vector<Pooled<Frame>> frames;
+			for (unsigned int i = 0; i < 5; i++)
+				frames.push_back(pool.acquire());
+		}
+
+		// Only max_pooled buffers are kept
+		BufferPool<Frame>::Statistics stats = pool.getStatistics();
+		CPPUNIT_ASSERT(stats.high_water == 5);
+		CPPUNIT_ASSERT(stats.pooled == 2);
+		CPPUNIT_ASSERT(stats.outstanding == 0);
+	}
+
+	void test_alignment() {
+		for (size_t len: { 1, 3, 17, 1000 }) {
+			SampleVector samples(len);
+			SymbolVector symbols(len);
+			CPPUNIT_ASSERT(reinterpret_cast<uintptr_t>(samples.data()) % buffer_alignment == 0);
+			CPPUNIT_ASSERT(reinterpret_cast<uintptr_t>(symbols.data()) % buffer_alignment == 0);
+		}
+	}
+
+	void test_outlive_pool() {
+		Pooled<SampleVector> buf;
+		{
+			BufferPool<SampleVector> pool;
+			buf = pool.acquire(100);
+		}
+		// Buffer is still valid after the pool is gone
+		buf->resize(100);
+		buf.reset();
+	}
+
+	void test_threads() {
+		BufferPool<SymbolVector> pool(8);
+		std::vector<std::thread> threads;
+		for (unsigned int t = 0; t < 4; t++)
+			threads.emplace_back([&pool]() {
+				for (unsigned int i = 0; i < 10000; i++) {
+					Pooled<SymbolVector> a = pool.acquire(64);
+					Pooled<SymbolVector> b = a;
+					b->push_back(i & 1);
+				}
+			});
+		for (auto& thread: threads)
+			thread.join();
+
+		BufferPool<SymbolVector>::Statistics stats = pool.getStatistics();
+		CPPUNIT_ASSERT(stats.hits + stats.misses == 40000);
+		CPPUNIT_ASSERT(stats.outstanding == 0);
+		CPPUNIT_ASSERT(stats.high_water <= 4);
+	}
+
+	static CppUnit::Test* suite()
+	{
+		CppUnit::TestSuite* suite = new CppUnit::TestSuite("BufferPoolTest");
+		suite->addTest(new CppUnit::TestCaller<BufferPoolTest>("Recycling", &BufferPoolTest::test_recycling));
+		suite->addTest(new CppUnit::TestCaller<BufferPoolTest>("Reference counting", &BufferPoolTest::test_refcount));
+		suite->addTest(new CppUnit::TestCaller<BufferPoolTest>("High water mark", &BufferPoolTest::test_high_water));
+		suite->addTest(new CppUnit::TestCaller<BufferPoolTest>("Alignment", &BufferPoolTest::test_alignment));
+		suite->addTest(new CppUnit::TestCaller<BufferPoolTest>("Buffer outlives pool", &BufferPoolTest::test_outlive_pool));
+		suite->addTest(new CppUnit::TestCaller<BufferPoolTest>("Threads", &BufferPoolTest::test_threads));
+		return suite;
+	}
+
+};
+
+
+#ifndef COMBINED_TEST
+int main(int argc, char** argv)
+{
+	CppUnit::TextUi::TestRunner runner;
+	runner.addTest(BufferPoolTest::suite());
+	runner.run();
+	return 0;
+}
+#endif
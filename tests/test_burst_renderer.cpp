@@ -0,0 +1,350 @@
+#include <iostream>
+#include <thread>
+#include <chrono>
+#include <mutex>
+#include <deque>
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/ui/text/TestRunner.h>
+
+#include <suo.hpp>
+#include <executor.hpp>
+#include <burst_renderer.hpp>
+
+
+using namespace std;
+using namespace suo;
+
+
+/* Generates a given number of bursts where the sample values count up from the burst index.
+ * If sourceFrame is connected, a burst is generated only when a frame is received like in a framer. */
+class BurstSource {
+public:
+	BurstSource(unsigned int bursts, size_t burst_len) : bursts(bursts), burst_len(burst_len), generated(0) { }
+
+	SampleGenerator generateSamples(Timestamp now) {
+		thread_id = std::this_thread::get_id();
+		if (generated >= bursts)
+			return SampleGenerator();
+		if (sourceFrame.has_connections()) {
+			frame.clear();
+			sourceFrame.emit(frame, now);
+			if (frame.empty())
+				return SampleGenerator();
+		}
+		return generator(generated++);
+	}
+
+	SampleGenerator generator(unsigned int index) {
+		for (size_t i = 0; i < burst_len; i += 100) {
+			size_t n = min<size_t>(100, burst_len - i);
+			SampleSpan out = co_yield SampleGenerator::reserve(n);
+			for (size_t j = 0; j < n; j++)
+				out.data[j] = Sample(index, i + j);
+			co_yield SampleGenerator::commit(n);
+		}
+	}
+
+	unsigned int bursts;
+	size_t burst_len;
+	unsigned int generated;
+	std::thread::id thread_id;
+
+	Frame frame;
+	Port<Frame&, Timestamp> sourceFrame;
+};
+
+
+/* Queue of frames to be transmitted, like ZMQSubscriber */
+class PendingFrames {
+public:
+	void push(Timestamp timestamp) {
+		std::lock_guard<std::mutex> lock(mutex);
+		timestamps.push_back(timestamp);
+	}
+
+	void sourceFrame(Frame& frame, Timestamp now) {
+		(void)now;
+		std::lock_guard<std::mutex> lock(mutex);
+		if (timestamps.empty())
+			return;
+		frame.data.assign(32, 0x55);
+		if (timestamps.front() != 0) {
+			frame.flags = Frame::Flags::has_timestamp;
+			frame.timestamp = timestamps.front();
+		}
+		timestamps.pop_front();
+	}
+
+	std::mutex mutex;
+	std::deque<Timestamp> timestamps;
+};
+
+
+/* Transmit loop of SoapySDRIO::execute without the hardware */
+class SDRLoop {
+public:
+	SDRLoop(BurstRenderer& renderer, Timestamp start_time) :
+		renderer(renderer),
+		current_time(start_time),
+		tx_last_end_time(start_time + tx_latency * sample_ns)
+	{ }
+
+	/* Run one iteration of the loop. Returns the start time of a burst if one was started. */
+	bool iterate(Timestamp& burst_start) {
+		current_time += buffer * sample_ns;
+
+		bool started = false;
+		if (tx_active == false)
+			tx_last_end_time = max(tx_last_end_time, current_time + tx_latency * sample_ns);
+
+		Timestamp tx_from_time = tx_last_end_time;
+		if (tx_active == false) {
+			sample_gen = renderer.generateSamples(tx_from_time);
+			if (sample_gen.running()) {
+				tx_active = true;
+				started = true;
+				burst_start = tx_from_time;
+			}
+		}
+
+		if (tx_active) {
+			VectorFlags flags = none;
+			size_t len = sample_gen.sourceSamples(SampleSpan{ txbuf, buffer }, flags);
+			tx_last_end_time = tx_from_time + len * sample_ns;
+			if (sample_gen.running() == false || (flags & end_of_burst) != 0) {
+				sample_gen = SampleGenerator();
+				tx_active = false;
+			}
+		}
+
+		renderer.tick(current_time);
+		return started;
+	}
+
+	static constexpr size_t buffer = 2048;
+	static constexpr size_t tx_latency = 8192;
+	static constexpr Timestamp sample_ns = 1000; // 1 Msps
+
+	BurstRenderer& renderer;
+	Timestamp current_time;
+	Timestamp tx_last_end_time;
+	bool tx_active = false;
+	SampleGenerator sample_gen;
+	Sample txbuf[buffer];
+};
+
+
+class BurstRendererTest: public CppUnit::TestFixture
+{
+public:
+
+	/* Read a burst like SoapySDRIO does and check its contents */
+	static void transmit(BurstRenderer& renderer, unsigned int index, size_t burst_len, Timestamp now = 0) {
+		SampleGenerator gen = renderer.generateSamples(now);
+		CPPUNIT_ASSERT(gen.running());
+
+		Sample buffer[2048];
+		size_t total = 0;
+		bool first = true;
+		while (gen.running()) {
+			VectorFlags flags = none;
+			size_t len = gen.sourceSamples(SampleSpan{ buffer, 2048 }, flags);
+			CPPUNIT_ASSERT(((flags & start_of_burst) != 0) == first);
+			for (size_t i = 0; i < len; i++)
+				CPPUNIT_ASSERT(buffer[i] == Sample(index, total + i));
+			total += len;
+			first = false;
+			if (flags & end_of_burst)
+				break;
+		}
+		CPPUNIT_ASSERT(total == burst_len);
+	}
+
+	void test_process() {
+		BurstRenderer::Config conf;
+		conf.capacity = 2;
+		conf.chunk_size = 1000;
+		BurstRenderer renderer(conf);
+
+		BurstSource source(3, 12345);
+		renderer.generateBurst.connect_member(&source, &BurstSource::generateSamples);
+
+		CPPUNIT_ASSERT(renderer.generateSamples(0).running() == false);
+
+		// Renders until the ring is full
+		CPPUNIT_ASSERT(renderer.process(8) == 2);
+		CPPUNIT_ASSERT(renderer.size() == 2);
+		CPPUNIT_ASSERT(renderer.process(8) == 0);
+
+		transmit(renderer, 0, 12345);
+		CPPUNIT_ASSERT(renderer.process(8) == 1);
+		transmit(renderer, 1, 12345);
+		transmit(renderer, 2, 12345);
+		CPPUNIT_ASSERT(renderer.process(8) == 0);
+		CPPUNIT_ASSERT(renderer.generateSamples(0).running() == false);
+
+		BurstRenderer::Statistics stats = renderer.getStatistics();
+		CPPUNIT_ASSERT(stats.rendered == 3 && stats.transmitted == 3 && stats.truncated == 0);
+	}
+
+	void test_truncate() {
+		BurstRenderer::Config conf;
+		conf.chunk_size = 1000;
+		conf.max_burst_length = 5000;
+		BurstRenderer renderer(conf);
+
+		BurstSource source(1, 12345);
+		renderer.generateBurst.connect_member(&source, &BurstSource::generateSamples);
+		CPPUNIT_ASSERT(renderer.process(8) == 1);
+		transmit(renderer, 0, 5000);
+		CPPUNIT_ASSERT(renderer.getStatistics().truncated == 1);
+
+		/* The last chunk is clamped when the maximum isn't a multiple of the chunk size */
+		conf.max_burst_length = 4550;
+		BurstRenderer clamped(conf);
+		BurstSource source2(1, 12345);
+		clamped.generateBurst.connect_member(&source2, &BurstSource::generateSamples);
+		CPPUNIT_ASSERT(clamped.process(8) == 1);
+		transmit(clamped, 0, 4550);
+		CPPUNIT_ASSERT(clamped.getStatistics().truncated == 1);
+
+		/* Bursts exactly at the maximum are not truncated */
+		conf.max_burst_length = 12345;
+		BurstRenderer exact(conf);
+		BurstSource source3(1, 12345);
+		exact.generateBurst.connect_member(&source3, &BurstSource::generateSamples);
+		CPPUNIT_ASSERT(exact.process(8) == 1);
+		transmit(exact, 0, 12345);
+		CPPUNIT_ASSERT(exact.getStatistics().truncated == 0);
+	}
+
+	void test_timing() {
+		BurstRenderer::Config conf;
+		conf.capacity = 2;
+		BurstRenderer renderer(conf);
+
+		/* Empty bursts are not queued and don't keep the renderer polling */
+		BurstSource empty(1000, 0);
+		renderer.generateBurst.connect_member(&empty, &BurstSource::generateSamples);
+		CPPUNIT_ASSERT(renderer.process(8) == 0);
+		CPPUNIT_ASSERT(empty.generated == 1);
+		CPPUNIT_ASSERT(renderer.size() == 0);
+
+		/* A burst without a TX time is sent immediately and a timestamped one is held until it's due */
+		BurstSource source(2, 1000);
+		PendingFrames queue;
+		source.sourceFrame.connect_member(&renderer, &BurstRenderer::sourceFrame);
+		renderer.sourceUpstreamFrame.connect_member(&queue, &PendingFrames::sourceFrame);
+		renderer.generateBurst.disconnect_all();
+		renderer.generateBurst.connect_member(&source, &BurstSource::generateSamples);
+
+		queue.push(0);
+		queue.push(5000);
+		CPPUNIT_ASSERT(renderer.process(8) == 2);
+		transmit(renderer, 0, 1000, 0);
+		CPPUNIT_ASSERT(renderer.generateSamples(4999).running() == false);
+		CPPUNIT_ASSERT(renderer.size() == 1);
+		transmit(renderer, 1, 1000, 5000);
+		CPPUNIT_ASSERT(renderer.size() == 0);
+	}
+
+	void test_sdr_loop() {
+		BurstRenderer::Config conf;
+		conf.capacity = 2;
+		BurstRenderer renderer(conf);
+
+		BurstSource source(3, 30000);
+		PendingFrames queue;
+		source.sourceFrame.connect_member(&renderer, &BurstRenderer::sourceFrame);
+		renderer.sourceUpstreamFrame.connect_member(&queue, &PendingFrames::sourceFrame);
+		renderer.generateBurst.connect_member(&source, &BurstSource::generateSamples);
+
+		Executor executor;
+		executor.addStage(renderer);
+		executor.start();
+
+		/* The hardware clock is far from zero and runs long past the startup before the first frame */
+		SDRLoop sdr(renderer, 1000000000000ULL);
+		Timestamp burst_start;
+		for (unsigned int i = 0; i < 1000; i++)
+			CPPUNIT_ASSERT(sdr.iterate(burst_start) == false);
+
+		/* Frames without a TX time go out right away */
+		const Timestamp due = sdr.current_time + 1000000000ULL;
+		queue.push(0);
+		queue.push(due);
+		queue.push(0);
+
+		std::vector<Timestamp> starts;
+		auto deadline = chrono::steady_clock::now() + chrono::seconds(5);
+		while (starts.size() < 3 && chrono::steady_clock::now() < deadline) {
+			if (sdr.iterate(burst_start))
+				starts.push_back(burst_start);
+			this_thread::sleep_for(chrono::microseconds(50));
+		}
+		while (sdr.tx_active)
+			sdr.iterate(burst_start);
+
+		executor.stop();
+		CPPUNIT_ASSERT(starts.size() == 3);
+
+		/* The timestamped burst starts at its TX time and holds back the following one */
+		CPPUNIT_ASSERT(starts[0] < due);
+		CPPUNIT_ASSERT(starts[1] >= due && starts[1] < due + SDRLoop::buffer * SDRLoop::sample_ns);
+		CPPUNIT_ASSERT(starts[2] > starts[1]);
+		CPPUNIT_ASSERT(renderer.getStatistics().transmitted == 3);
+	}
+
+	void test_thread() {
+		BurstRenderer::Config conf;
+		conf.capacity = 2;
+		BurstRenderer renderer(conf);
+
+		BurstSource source(10, 30000);
+		renderer.generateBurst.connect_member(&source, &BurstSource::generateSamples);
+
+		Executor executor;
+		executor.addStage(renderer);
+		executor.start();
+
+		// The SDR thread ticks and transmits the bursts when they are ready
+		for (unsigned int i = 0; i < 10; i++) {
+			auto deadline = chrono::steady_clock::now() + chrono::seconds(5);
+			while (renderer.size() == 0 && chrono::steady_clock::now() < deadline) {
+				renderer.tick(i);
+				this_thread::sleep_for(chrono::microseconds(100));
+			}
+			transmit(renderer, i, 30000, i);
+		}
+
+		executor.stop();
+		CPPUNIT_ASSERT(source.thread_id != this_thread::get_id());
+		CPPUNIT_ASSERT(renderer.getStatistics().transmitted == 10);
+	}
+
+	static CppUnit::Test* suite()
+	{
+		CppUnit::TestSuite* suite = new CppUnit::TestSuite("BurstRendererTest");
+		suite->addTest(new CppUnit::TestCaller<BurstRendererTest>("Process", &BurstRendererTest::test_process));
+		suite->addTest(new CppUnit::TestCaller<BurstRendererTest>("Truncate", &BurstRendererTest::test_truncate));
+		suite->addTest(new CppUnit::TestCaller<BurstRendererTest>("Timing", &BurstRendererTest::test_timing));
+		suite->addTest(new CppUnit::TestCaller<BurstRendererTest>("Thread", &BurstRendererTest::test_thread));
+		suite->addTest(new CppUnit::TestCaller<BurstRendererTest>("SDRLoop", &BurstRendererTest::test_sdr_loop));
+		return suite;
+	}
+
+};
+
+
+#ifndef COMBINED_TEST
+int main(int argc, char** argv)
+{
+	CppUnit::TextUi::TestRunner runner;
+	runner.addTest(BurstRendererTest::suite());
+	runner.run();
+	return 0;
+}
+#endif
@@ -0,0 +1,133 @@
+#include <iostream>
+#include <cmath>
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/ui/text/TestRunner.h>
+
+#include <suo.hpp>
+#include <modem/channelizer.hpp>
+
+
+using namespace std;
+using namespace suo;
+
+
+class ChannelizerTest: public CppUnit::TestFixture
+{
+public:
+
+	void test_frequencies() {
+		Channelizer::Config conf;
+		conf.sample_rate = 1e6;
+		conf.num_channels = 8;
+		Channelizer channelizer(conf);
+
+		CPPUNIT_ASSERT_DOUBLES_EQUAL(250e3, channelizer.getChannelRate(), 1e-3);
+		CPPUNIT_ASSERT_DOUBLES_EQUAL(0.0, channelizer.getChannelFrequency(0), 1e-3);
+		CPPUNIT_ASSERT_DOUBLES_EQUAL(125e3, channelizer.getChannelFrequency(1), 1e-3);
+		CPPUNIT_ASSERT_DOUBLES_EQUAL(-500e3, channelizer.getChannelFrequency(4), 1e-3);
+		CPPUNIT_ASSERT_DOUBLES_EQUAL(-125e3, channelizer.getChannelFrequency(7), 1e-3);
+
+		for (unsigned int k = 0; k < conf.num_channels; k++)
+			CPPUNIT_ASSERT(channelizer.getChannelIndex(channelizer.getChannelFrequency(k) + 20e3) == k);
+		CPPUNIT_ASSERT(channelizer.getChannelIndex(-140e3) == 7);
+
+		CPPUNIT_ASSERT_THROW(channelizer.getChannelFrequency(8), SuoError);
+		CPPUNIT_ASSERT_THROW(channelizer.outputChannel(8), SuoError);
+
+		conf.num_channels = 7;
+		CPPUNIT_ASSERT_THROW(Channelizer{conf}, SuoError);
+	}
+
+	void test_timestamps() {
+		Channelizer::Config conf;
+		conf.sample_rate = 1e6;
+		conf.num_channels = 8;
+		Channelizer channelizer(conf);
+		const unsigned int decimation = conf.num_channels / 2;
+		const Timestamp sample_ns = 1000;
+
+		/* Collect one channel and check the timestamp of every block against its sample count */
+		vector<Timestamp> timestamps;
+		vector<size_t> offsets;
+		SampleVector received;
+		channelizer.outputChannel(2).connect([&](const SampleVector& samples, Timestamp now) {
+			timestamps.push_back(now);
+			offsets.push_back(received.size());
+			received.insert(received.end(), samples.begin(), samples.end());
+		});
+
+		const Timestamp t0 = 1000000;
+		const size_t total_len = 1000;
+		size_t i = 0, block_len = 1;
+		while (i < total_len) {
+			size_t n = min(block_len, total_len - i);
+			SampleVector samples(n);
+			for (size_t j = 0; j < n; j++)
+				samples[j] = Sample(i + j, 0.0f);
+			channelizer.sinkSamples(samples, t0 + i * sample_ns);
+			i += n;
+			block_len = (block_len * 5 + 3) % 37;
+		}
+
+		CPPUNIT_ASSERT(received.size() == total_len / decimation);
+		CPPUNIT_ASSERT(timestamps.size() > 1);
+		for (size_t b = 0; b < timestamps.size(); b++)
+			CPPUNIT_ASSERT(timestamps[b] == t0 - channelizer.getDelay() + offsets[b] * decimation * sample_ns);
+	}
+
+	/* An impulse comes out of the channel at its input time */
+	void test_delay() {
+		Channelizer::Config conf;
+		conf.sample_rate = 1e6;
+		conf.num_channels = 8;
+		Channelizer channelizer(conf);
+		const unsigned int decimation = conf.num_channels / 2;
+		const Timestamp sample_ns = 1000;
+		CPPUNIT_ASSERT(channelizer.getDelay() == conf.num_channels * conf.filter_semilength * sample_ns);
+
+		Timestamp peak_time = 0;
+		float peak = 0;
+		channelizer.outputChannel(0).connect([&](const SampleVector& samples, Timestamp now) {
+			for (size_t j = 0; j < samples.size(); j++) {
+				if (abs(samples[j]) > peak) {
+					peak = abs(samples[j]);
+					peak_time = now + j * decimation * sample_ns;
+				}
+			}
+		});
+
+		const Timestamp t0 = 1000000;
+		SampleVector samples(2000);
+		samples[500] = 1.0f;
+		channelizer.sinkSamples(samples, t0);
+
+		const Timestamp impulse_time = t0 + 500 * sample_ns;
+		CPPUNIT_ASSERT(peak > 0);
+		CPPUNIT_ASSERT(peak_time + decimation * sample_ns >= impulse_time);
+		CPPUNIT_ASSERT(peak_time <= impulse_time + decimation * sample_ns);
+	}
+
+	static CppUnit::Test* suite()
+	{
+		CppUnit::TestSuite* suite = new CppUnit::TestSuite("ChannelizerTest");
+		suite->addTest(new CppUnit::TestCaller<ChannelizerTest>("Frequencies", &ChannelizerTest::test_frequencies));
+		suite->addTest(new CppUnit::TestCaller<ChannelizerTest>("Timestamps", &ChannelizerTest::test_timestamps));
+		suite->addTest(new CppUnit::TestCaller<ChannelizerTest>("Delay", &ChannelizerTest::test_delay));
+		return suite;
+	}
+
+};
+
+
+#ifndef COMBINED_TEST
+int main(int argc, char** argv)
+{
+	CppUnit::TextUi::TestRunner runner;
+	runner.addTest(ChannelizerTest::suite());
+	runner.run();
+	return 0;
+}
+#endif
@@ -0,0 +1,155 @@
+#include <iostream>
+#include <cstring>
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/ui/text/TestRunner.h>
+
+#include <suo.hpp>
+#include <signal-io/conversion.hpp>
+
+
+using namespace std;
+using namespace suo;
+
+
+class ConversionTest: public CppUnit::TestFixture
+{
+public:
+
+	static constexpr ConversionKernel kernels[] = {
+		ConversionKernel::scalar,
+		ConversionKernel::sse4,
+		ConversionKernel::avx2,
+		ConversionKernel::neon,
+		ConversionKernel::automatic
+	};
+
+	/* Odd length to exercise the scalar tails */
+	static const size_t len = 1003;
+
+	void test_to_cf() {
+		vector<cs16_t> s16(len);
+		vector<cs8_t> s8(len);
+		vector<cu8_t> u8(len);
+		for (size_t i = 0; i < len; i++) {
+			for (int j = 0; j < 2; j++) {
+				s16[i][j] = (int16_t)(rand() & 0xFFFF);
+				s8[i][j] = (int8_t)(rand() & 0xFF);
+				u8[i][j] = (uint8_t)(rand() & 0xFF);
+			}
+		}
+		s16[0][0] = -32768; s16[0][1] = 32767;
+		s8[0][0] = -128; s8[0][1] = 127;
+
+		const float scale = 1.0f / 2048;
+		SampleVector ref16(len), ref8(len), refu8(len);
+		cs16_to_cf(s16.data(), ref16.data(), len, scale);
+		cs8_to_cf(s8.data(), ref8.data(), len);
+		cu8_to_cf(u8.data(), refu8.data(), len);
+		CPPUNIT_ASSERT(ref16[0] == Sample(-16.0f, 32767.0f / 2048));
+		CPPUNIT_ASSERT(ref8[0] == Sample(-1.0f, 127.0f / 128));
+
+		for (ConversionKernel kernel: kernels) {
+			if (SampleConverter::isSupported(kernel) == false) {
+				CPPUNIT_ASSERT_THROW(SampleConverter c(kernel), SuoError);
+				continue;
+			}
+			SampleConverter converter(kernel);
+
+			SampleVector out(len);
+			CPPUNIT_ASSERT(converter.cs16_to_cf(s16.data(), out.data(), len, scale) == len);
+			CPPUNIT_ASSERT(out == ref16);
+
+			converter.cs8_to_cf(s8.data(), out.data(), len);
+			CPPUNIT_ASSERT(out == ref8);
+
+			converter.cu8_to_cf(u8.data(), out.data(), len);
+			for (size_t i = 0; i < len; i++)
+				CPPUNIT_ASSERT(abs(out[i] - refu8[i]) < 1e-6f);
+		}
+	}
+
+	void test_to_cs16() {
+		SampleVector in(len);
+		for (size_t i = 0; i < len; i++)
+			in[i] = Sample((rand() % 4001 - 2000) / 1000.0f, (rand() % 4001 - 2000) / 1000.0f);
+		in[0] = Sample(1.0f, -1.0f);
+		in[1] = Sample(1e20f, -1e20f);
+		in[2] = Sample(0.5f / 0x8000, 1.5f / 0x8000);
+
+		vector<cs16_t> ref(len);
+		cf_to_cs16(in.data(), ref.data(), len);
+
+		/* Saturation and rounding to nearest even */
+		CPPUNIT_ASSERT(ref[0][0] == 32767 && ref[0][1] == -32768);
+		CPPUNIT_ASSERT(ref[1][0] == 32767 && ref[1][1] == -32768);
+		CPPUNIT_ASSERT(ref[2][0] == 0 && ref[2][1] == 2);
+		for (size_t i = 3; i < len; i++) {
+			for (int j = 0; j < 2; j++) {
+				float x = (j ? in[i].imag() : in[i].real()) * 0x8000;
+				CPPUNIT_ASSERT_DOUBLES_EQUAL(max(min(x, 32767.0f), -32768.0f), ref[i][j], 0.5);
+			}
+		}
+
+		for (ConversionKernel kernel: kernels) {
+			if (SampleConverter::isSupported(kernel) == false)
+				continue;
+			SampleConverter converter(kernel);
+
+			vector<cs16_t> out(len);
+			CPPUNIT_ASSERT(converter.cf_to_cs16(in.data(), out.data(), len) == len);
+			CPPUNIT_ASSERT(memcmp(out.data(), ref.data(), len * sizeof(cs16_t)) == 0);
+		}
+	}
+
+	/* Conversions in one buffer as done by SoapySDRIO */
+	void test_in_place() {
+		vector<cs16_t> s16(len);
+		for (size_t i = 0; i < len; i++) {
+			s16[i][0] = (int16_t)(rand() & 0xFFFF);
+			s16[i][1] = (int16_t)(rand() & 0xFFFF);
+		}
+		SampleVector ref(len);
+		cs16_to_cf(s16.data(), ref.data(), len);
+
+		for (ConversionKernel kernel: kernels) {
+			if (SampleConverter::isSupported(kernel) == false)
+				continue;
+			SampleConverter converter(kernel);
+
+			/* The wire samples are read to the end of the buffer */
+			SampleVector buffer(len);
+			cs16_t* wire = reinterpret_cast<cs16_t*>(buffer.data() + len) - len;
+			memcpy(wire, s16.data(), len * sizeof(cs16_t));
+			converter.cs16_to_cf(wire, buffer.data(), len);
+			CPPUNIT_ASSERT(buffer == ref);
+
+			/* And back to the beginning */
+			converter.cf_to_cs16(buffer.data(), reinterpret_cast<cs16_t*>(buffer.data()), len);
+			CPPUNIT_ASSERT(memcmp(buffer.data(), s16.data(), len * sizeof(cs16_t)) == 0);
+		}
+	}
+
+	static CppUnit::Test* suite()
+	{
+		CppUnit::TestSuite* suite = new CppUnit::TestSuite("ConversionTest");
+		suite->addTest(new CppUnit::TestCaller<ConversionTest>("ToComplexFloat", &ConversionTest::test_to_cf));
+		suite->addTest(new CppUnit::TestCaller<ConversionTest>("ToCS16", &ConversionTest::test_to_cs16));
+		suite->addTest(new CppUnit::TestCaller<ConversionTest>("InPlace", &ConversionTest::test_in_place));
+		return suite;
+	}
+
+};
+
+
+#ifndef COMBINED_TEST
+int main(int argc, char** argv)
+{
+	CppUnit::TextUi::TestRunner runner;
+	runner.addTest(ConversionTest::suite());
+	runner.run();
+	return 0;
+}
+#endif
@@ -0,0 +1,313 @@
+#include <iostream>
+#include <cmath>
+#include <functional>
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/ui/text/TestRunner.h>
+
+#include <liquid/liquid.h>
+
+#include <suo.hpp>
+#include <modem/cpm_waveform.hpp>
+
+
+using namespace std;
+using namespace suo;
+
+
+class CPMWaveformTest: public CppUnit::TestFixture
+{
+public:
+
+	/* Modulate the symbols and return the unwrapped phase of each output sample */
+	static vector<double> unwrappedPhase(CPMWaveform& waveform, const vector<Symbol>& symbols) {
+		vector<Sample> out(waveform.getMaxSamples());
+		vector<double> phase;
+		double prev = 0, acc = 0;
+		for (Symbol symbol: symbols) {
+			unsigned int n = waveform.modulate(symbol, out.data());
+			CPPUNIT_ASSERT(n <= waveform.getMaxSamples());
+			for (unsigned int i = 0; i < n; i++) {
+				double a = arg(out[i]);
+				acc += remainder(a - prev, 2 * M_PI);
+				prev = a;
+				phase.push_back(acc);
+			}
+		}
+		return phase;
+	}
+
+	/* Rectangular pulse phase increments follow the analytic MSK/FSK phase at non-integer samples per symbol */
+	void test_rectangular() {
+		for (unsigned int bits: { 1, 2 }) {
+			CPMWaveform::Config conf;
+			conf.sample_rate = 50e3;
+			conf.symbol_rate = 9600;
+			conf.bits_per_symbol = bits;
+			conf.modindex = 0.7f;
+			conf.pulse = CPMWaveform::Pulse::rectangular;
+			conf.amplitude = 0.5f;
+
+			CPMWaveform waveform(conf);
+			CPPUNIT_ASSERT(waveform.getPulseLength() == 1);
+
+			const int M = 1 << bits;
+			vector<Symbol> symbols(2000);
+			for (Symbol& s: symbols)
+				s = rand() % M;
+
+			vector<Sample> out(waveform.getMaxSamples());
+			const double sps = conf.sample_rate / conf.symbol_rate;
+			auto q = [](double t) { return 0.5 * min(max(t, 0.0), 1.0); };
+			double prev = 0;
+			size_t n = 0;
+			for (size_t k = 0; k < symbols.size(); k++) {
+				unsigned int num = waveform.modulate(symbols[k], out.data());
+				for (unsigned int i = 0; i < num; i++, n++) {
+					CPPUNIT_ASSERT_DOUBLES_EQUAL(0.5, abs(out[i]), 1e-4);
+
+					/* Expected increment over the sample interval. The history before the burst is symbol 0. */
+					const double t = n / sps;
+					double expected = 0;
+					for (int j = (int)k - 2; j <= (int)k; j++) {
+						int a = 2 * (j < 0 ? 0 : symbols[j]) - (M - 1);
+						expected += a * (q(t - j) - q(t - j - 1 / sps));
+					}
+					expected *= 2 * M_PI * conf.modindex;
+
+					double a = arg(out[i]);
+					// Error comes from the quantized timing at the symbol transitions.
+					// The burst starts from zero phase at the first sample.
+					if (n > 0)
+						CPPUNIT_ASSERT_DOUBLES_EQUAL(0.0, remainder(a - prev - expected, 2 * M_PI), 0.04);
+					prev = a;
+				}
+			}
+
+			/* Average samples per symbol matches the rates */
+			CPPUNIT_ASSERT_DOUBLES_EQUAL(sps, (double)n / symbols.size(), 1e-3);
+		}
+	}
+
+	/* A flipped bit changes the final GMSK phase by 2 * pi * h regardless of the pulse shape */
+	void test_gaussian() {
+		for (float bt: { 0.3f, 0.5f }) {
+			CPMWaveform::Config conf;
+			conf.sample_rate = 57600;
+			conf.symbol_rate = 9600;
+			conf.bt = bt;
+
+			CPMWaveform waveform(conf);
+			const unsigned int L = waveform.getPulseLength();
+			CPPUNIT_ASSERT(L >= 3);
+
+			vector<Symbol> symbols(100);
+			for (Symbol& s: symbols)
+				s = rand() % 2;
+			symbols[50] = 0;
+
+			waveform.startBurst(0);
+			vector<double> a = unwrappedPhase(waveform, symbols);
+			symbols[50] = 1;
+			waveform.startBurst(0);
+			vector<double> b = unwrappedPhase(waveform, symbols);
+
+			CPPUNIT_ASSERT(a.size() == b.size());
+			CPPUNIT_ASSERT_DOUBLES_EQUAL(0.0, b[6 * 49] - a[6 * 49], 0.02);
+			CPPUNIT_ASSERT_DOUBLES_EQUAL(M_PI, b[6 * (51 + L)] - a[6 * (51 + L)], 0.02);
+			CPPUNIT_ASSERT_DOUBLES_EQUAL(M_PI, b.back() - a.back(), 0.02);
+
+			/* Constant symbols give a constant frequency of h * symbol_rate / 2 */
+			waveform.startBurst(1000);
+			vector<double> c = unwrappedPhase(waveform, vector<Symbol>(50, 1));
+			const double f = (c[6 * 40] - c[6 * 20]) / (2 * M_PI * 20 * 6) * conf.sample_rate;
+			CPPUNIT_ASSERT_DOUBLES_EQUAL(1000 + 0.25 * conf.symbol_rate, f, 1.0);
+		}
+	}
+
+	/* Ramp windows fade the burst in and out */
+	void test_ramps() {
+		CPMWaveform::Config conf;
+		conf.sample_rate = 96000;
+		conf.symbol_rate = 9600;
+		conf.amplitude = 2.0f;
+		conf.ramp_up_duration = 2;
+		conf.ramp_down_duration = 3;
+		CPMWaveform waveform(conf);
+
+		vector<Sample> out(waveform.getMaxSamples());
+		vector<float> envelope;
+		auto run = [&](size_t num_symbols) {
+			for (size_t k = 0; k < num_symbols; k++) {
+				unsigned int n = waveform.modulate(k % 2, out.data());
+				CPPUNIT_ASSERT(n == 10);
+				for (unsigned int i = 0; i < n; i++)
+					envelope.push_back(abs(out[i]));
+			}
+		};
+
+		waveform.startBurst(0);
+		run(10);
+		waveform.startRampDown();
+		run(5);
+
+		CPPUNIT_ASSERT(envelope[0] < 0.2f);
+		CPPUNIT_ASSERT(envelope[9] < envelope[10]);
+		CPPUNIT_ASSERT_DOUBLES_EQUAL(2.0, envelope[20], 1e-3);
+		CPPUNIT_ASSERT_DOUBLES_EQUAL(2.0, envelope[99], 1e-3);
+		CPPUNIT_ASSERT(envelope[100] > envelope[120]);
+		CPPUNIT_ASSERT(envelope[129] < 0.2f);
+		CPPUNIT_ASSERT(envelope[130] == 0.0f);
+		CPPUNIT_ASSERT(envelope[149] == 0.0f);
+
+		/* A new burst starts from the ramp up */
+		envelope.clear();
+		waveform.startBurst(0);
+		run(3);
+		CPPUNIT_ASSERT(envelope[0] < 0.2f);
+		CPPUNIT_ASSERT_DOUBLES_EQUAL(2.0, envelope[25], 1e-3);
+	}
+
+	/*
+	 * Compare the phase of a long burst at 5.2 samples per symbol against a liquid-dsp
+	 * modulator running at 26 samples per symbol, which hits every 5th output sample.
+	 * The reference sample times are matched by searching the delay, after which the
+	 * phase difference must stay constant over the whole burst.
+	 */
+	static void compareToLiquid(CPMWaveform& waveform, const vector<Symbol>& symbols,
+			std::function<void(Symbol, liquid_float_complex*)> reference) {
+		const unsigned int k = 26, decimation = 5;
+
+		waveform.startBurst(0);
+		vector<double> phase = unwrappedPhase(waveform, symbols);
+		CPPUNIT_ASSERT(phase.size() == symbols.size() * k / decimation);
+
+		vector<double> ref;
+		vector<liquid_float_complex> out(k);
+		double prev = 0, acc = 0;
+		for (Symbol symbol: symbols) {
+			reference(symbol, out.data());
+			for (unsigned int i = 0; i < k; i++) {
+				double a = arg(out[i]);
+				acc += remainder(a - prev, 2 * M_PI);
+				prev = a;
+				ref.push_back(acc);
+			}
+		}
+
+		/* Reference phase at a fractional reference sample index */
+		auto refPhase = [&](double x) {
+			const size_t i = (size_t)x;
+			return ref[i] + (x - i) * (ref[i + 1] - ref[i]);
+		};
+
+		/* Skip the start of the burst where the symbol histories before the burst differ */
+		const size_t skip = 20 * k / decimation, window = 1000;
+		const size_t end = phase.size() - 10 * k / decimation;
+
+		/* Find the delay of the reference in 1/8 reference samples */
+		double best_delay = 0, best_var = INFINITY;
+		for (double delay = -(double)k; delay < 10 * k; delay += 0.125) {
+			double sum = 0, sum2 = 0;
+			for (size_t n = skip; n < skip + window; n++) {
+				const double d = refPhase(decimation * n + delay) - phase[n];
+				sum += d;
+				sum2 += d * d;
+			}
+			const double var = sum2 / window - (sum / window) * (sum / window);
+			if (var < best_var) {
+				best_var = var;
+				best_delay = delay;
+			}
+		}
+
+		vector<double> diff;
+		for (size_t n = skip; n < end; n++)
+			diff.push_back(refPhase(decimation * n + best_delay) - phase[n]);
+
+		auto mean = [](vector<double>::const_iterator begin, vector<double>::const_iterator end) {
+			double sum = 0;
+			for (auto it = begin; it != end; ++it)
+				sum += *it;
+			return sum / (end - begin);
+		};
+		const double offset = mean(diff.begin(), diff.begin() + window);
+
+		double max_dev = 0;
+		for (double d: diff)
+			max_dev = max(max_dev, fabs(d - offset));
+		const double drift = mean(diff.end() - window, diff.end()) - offset;
+
+		cout << "delay " << best_delay << " max deviation " << max_dev << " rad, drift " << drift << " rad" << endl;
+		CPPUNIT_ASSERT(max_dev < 0.05);
+		CPPUNIT_ASSERT(fabs(drift) < 0.01);
+	}
+
+	/* The phase follows liquid-dsp's modulators without drifting over long bursts */
+	void test_liquid() {
+		vector<Symbol> symbols(20000);
+		for (Symbol& s: symbols)
+			s = rand() % 2;
+
+		CPMWaveform::Config conf;
+		conf.sample_rate = 49920; // 5.2 samples per symbol
+		conf.symbol_rate = 9600;
+		conf.bt = 0.5f;
+
+		CPMWaveform gmsk(conf);
+		gmskmod gmsk_ref = gmskmod_create(26, 3, conf.bt);
+		compareToLiquid(gmsk, symbols, [&](Symbol s, liquid_float_complex* y) {
+			gmskmod_modulate(gmsk_ref, s, y);
+		});
+		gmskmod_destroy(gmsk_ref);
+
+		conf.pulse = CPMWaveform::Pulse::rectangular;
+		conf.modindex = 0.7f;
+		CPMWaveform fsk(conf);
+		cpfskmod fsk_ref = cpfskmod_create(1, conf.modindex, 26, 1, 0.5f, LIQUID_CPFSK_SQUARE);
+		compareToLiquid(fsk, symbols, [&](Symbol s, liquid_float_complex* y) {
+			cpfskmod_modulate(fsk_ref, s, y);
+		});
+		cpfskmod_destroy(fsk_ref);
+	}
+
+	void test_config() {
+		CPMWaveform::Config conf;
+		conf.sample_rate = 15000;
+		conf.symbol_rate = 9600;
+		CPPUNIT_ASSERT_THROW(CPMWaveform w(conf), SuoError);
+
+		conf.sample_rate = 50000;
+		conf.bits_per_symbol = 5;
+		CPPUNIT_ASSERT_THROW(CPMWaveform w(conf), SuoError);
+
+		conf.bits_per_symbol = 4;
+		conf.bt = 0.2f;
+		CPPUNIT_ASSERT_THROW(CPMWaveform w(conf), SuoError);
+	}
+
+	static CppUnit::Test* suite()
+	{
+		CppUnit::TestSuite* suite = new CppUnit::TestSuite("CPMWaveformTest");
+		suite->addTest(new CppUnit::TestCaller<CPMWaveformTest>("Rectangular", &CPMWaveformTest::test_rectangular));
+		suite->addTest(new CppUnit::TestCaller<CPMWaveformTest>("Gaussian", &CPMWaveformTest::test_gaussian));
+		suite->addTest(new CppUnit::TestCaller<CPMWaveformTest>("Ramps", &CPMWaveformTest::test_ramps));
+		suite->addTest(new CppUnit::TestCaller<CPMWaveformTest>("Liquid", &CPMWaveformTest::test_liquid));
+		suite->addTest(new CppUnit::TestCaller<CPMWaveformTest>("Config", &CPMWaveformTest::test_config));
+		return suite;
+	}
+
+};
+
+
+#ifndef COMBINED_TEST
+int main(int argc, char** argv)
+{
+	CppUnit::TextUi::TestRunner runner;
+	runner.addTest(CPMWaveformTest::suite());
+	runner.run();
+	return 0;
+}
+#endif
@@ -0,0 +1,111 @@
+#include <iostream>
+#include <cmath>
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/ui/text/TestRunner.h>
+
+#include <suo.hpp>
+#include <modem/decimator.hpp>
+
+
+using namespace std;
+using namespace suo;
+
+
+class DecimatorTest: public CppUnit::TestFixture
+{
+public:
+
+	void test_plan() {
+		Decimator::Config conf;
+		conf.output_rate = 38400;
+		conf.bandwidth = 12000;
+		const float min_rate = max(2.0f * conf.output_rate, 4.0f * conf.bandwidth);
+
+		for (float sample_rate: { 50e3f, 250e3f, 1e6f, 2e6f, 10e6f }) {
+			conf.sample_rate = sample_rate;
+			vector<Decimator::Stage> stages = Decimator::plan(conf);
+
+			unsigned int decimation = 1;
+			for (size_t s = 0; s < stages.size(); s++) {
+				decimation *= stages[s].factor;
+				/* The polyphase FIR stage is always the last one */
+				if (stages[s].halfband == false)
+					CPPUNIT_ASSERT(s + 1 == stages.size());
+				else
+					CPPUNIT_ASSERT(stages[s].factor == 2);
+			}
+
+			/* Output rate stays above the minimum but close to it */
+			const float rate = sample_rate / decimation;
+			CPPUNIT_ASSERT(rate >= min_rate || decimation == 1);
+			CPPUNIT_ASSERT(rate < 2 * min_rate || decimation == 1);
+		}
+
+		/* Nothing to decimate */
+		conf.sample_rate = 50e3;
+		CPPUNIT_ASSERT(Decimator::plan(conf).empty());
+
+		conf.sample_rate = 0;
+		CPPUNIT_ASSERT_THROW(Decimator::plan(conf), SuoError);
+	}
+
+	void test_blocks() {
+		Decimator::Config conf;
+		conf.sample_rate = 2e6;
+		Decimator a(conf), b(conf);
+		CPPUNIT_ASSERT(a.getDecimation() > 1);
+
+		const size_t total_len = 20000;
+		SampleVector samples(total_len);
+		for (size_t i = 0; i < total_len; i++)
+			samples[i] = Sample(cosf(0.001f * i), sinf(0.001f * i));
+
+		/* Whole input at once */
+		SampleVector ref(a.maxOutput(total_len));
+		ref.resize(a.execute(samples.data(), total_len, ref.data()));
+		CPPUNIT_ASSERT(ref.size() == total_len / a.getDecimation());
+
+		/* Varying block sizes in-place */
+		SampleVector out, block;
+		size_t i = 0, block_len = 1;
+		while (i < total_len) {
+			size_t n = min(block_len, total_len - i);
+			block.assign(samples.begin() + i, samples.begin() + i + n);
+			size_t nout = b.execute(block.data(), n, block.data());
+			out.insert(out.end(), block.begin(), block.begin() + nout);
+			i += n;
+			block_len = (block_len * 7 + 3) % 301;
+		}
+
+		CPPUNIT_ASSERT(out.size() == ref.size());
+		for (size_t k = 0; k < ref.size(); k++)
+			CPPUNIT_ASSERT(abs(out[k] - ref[k]) < 1e-5f);
+
+		/* Slow rotation passes through with unity gain after the filters have settled */
+		for (size_t k = ref.size() / 2; k < ref.size(); k++)
+			CPPUNIT_ASSERT_DOUBLES_EQUAL(1.0f, abs(ref[k]), 1e-2);
+	}
+
+	static CppUnit::Test* suite()
+	{
+		CppUnit::TestSuite* suite = new CppUnit::TestSuite("DecimatorTest");
+		suite->addTest(new CppUnit::TestCaller<DecimatorTest>("Plan", &DecimatorTest::test_plan));
+		suite->addTest(new CppUnit::TestCaller<DecimatorTest>("Blocks", &DecimatorTest::test_blocks));
+		return suite;
+	}
+
+};
+
+
+#ifndef COMBINED_TEST
+int main(int argc, char** argv)
+{
+	CppUnit::TextUi::TestRunner runner;
+	runner.addTest(DecimatorTest::suite());
+	runner.run();
+	return 0;
+}
+#endif
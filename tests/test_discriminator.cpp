@@ -0,0 +1,122 @@
+#include <iostream>
+#include <cmath>
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/ui/text/TestRunner.h>
+
+#include <suo.hpp>
+#include <modem/discriminator.hpp>
+
+
+using namespace std;
+using namespace suo;
+
+
+class DiscriminatorTest: public CppUnit::TestFixture
+{
+public:
+
+	static constexpr float max_error = 1.2e-5f;
+
+	void test_atan2() {
+		float worst = 0.0f;
+		for (int i = 0; i < 100000; i++) {
+			float t = -M_PI + 2 * M_PI * i / 100000.0;
+			float r = 0.001f + 10.0f * (i % 7);
+			float x = r * cosf(t), y = r * sinf(t);
+			float err = fabsf(fast_atan2f(y, x) - atan2f(y, x));
+			if (err > M_PI) // Wrap at +-pi
+				err = fabsf(err - pi2f);
+			worst = max(worst, err);
+		}
+		CPPUNIT_ASSERT(worst <= max_error);
+
+		CPPUNIT_ASSERT(fast_atan2f(0.0f, 0.0f) == 0.0f);
+		CPPUNIT_ASSERT(fabsf(fast_atan2f(1.0f, 0.0f) - M_PI / 2) < max_error);
+		CPPUNIT_ASSERT(fabsf(fast_atan2f(0.0f, -1.0f) - M_PI) < max_error);
+	}
+
+	void test_kernels() {
+		/* Random walk in frequency and amplitude */
+		const size_t len = 1003;
+		SampleVector samples(len);
+		float phase = 0.0f, freq = 0.3f;
+		for (size_t i = 0; i < len; i++) {
+			freq += 0.05f * ((rand() % 3) - 1);
+			phase += freq;
+			samples[i] = (0.1f + (rand() % 100) / 10.0f) * exp(Sample(0.0f, phase));
+		}
+
+		const float gain = 2.5f;
+		vector<float> ref(len), out(len);
+		Sample prev = 1.0f;
+		for (size_t i = 0; i < len; i++) {
+			ref[i] = gain * arg(samples[i] * conj(prev));
+			prev = samples[i];
+		}
+
+		for (DiscriminatorKernel kernel: { DiscriminatorKernel::scalar, DiscriminatorKernel::sse4, DiscriminatorKernel::avx2, DiscriminatorKernel::neon, DiscriminatorKernel::automatic }) {
+			if (FrequencyDiscriminator::isSupported(kernel) == false) {
+				CPPUNIT_ASSERT_THROW(FrequencyDiscriminator(gain, kernel), SuoError);
+				continue;
+			}
+
+			/* Feed in odd sized blocks to test the state over calls */
+			FrequencyDiscriminator disc(gain, kernel);
+			disc.step(1.0f);
+			size_t i = 0, block = 1;
+			while (i < len) {
+				size_t n = min(block, len - i);
+				disc.execute(&samples[i], n, &out[i]);
+				i += n;
+				block = 2 * block + 1;
+			}
+
+			for (size_t i = 0; i < len; i++) {
+				float err = fabsf(out[i] - ref[i]);
+				if (err > gain * M_PI)
+					err = fabsf(err - gain * pi2f);
+				CPPUNIT_ASSERT(err <= gain * 2 * max_error);
+			}
+		}
+	}
+
+	void test_step() {
+		FrequencyDiscriminator block_disc(1.0f), step_disc(1.0f);
+		SampleVector samples(64);
+		for (size_t i = 0; i < samples.size(); i++)
+			samples[i] = exp(Sample(0.0f, 0.2f * i * i));
+
+		vector<float> out(samples.size());
+		block_disc.execute(samples.data(), samples.size(), out.data());
+		for (size_t i = 0; i < samples.size(); i++)
+			CPPUNIT_ASSERT_DOUBLES_EQUAL(out[i], step_disc.step(samples[i]), 1e-5);
+
+		block_disc.reset();
+		block_disc.execute(samples.data(), 1, out.data());
+		CPPUNIT_ASSERT(out[0] == 0.0f);
+	}
+
+	static CppUnit::Test* suite()
+	{
+		CppUnit::TestSuite* suite = new CppUnit::TestSuite("DiscriminatorTest");
+		suite->addTest(new CppUnit::TestCaller<DiscriminatorTest>("atan2 approximation", &DiscriminatorTest::test_atan2));
+		suite->addTest(new CppUnit::TestCaller<DiscriminatorTest>("Kernels", &DiscriminatorTest::test_kernels));
+		suite->addTest(new CppUnit::TestCaller<DiscriminatorTest>("Single steps", &DiscriminatorTest::test_step));
+		return suite;
+	}
+
+};
+
+
+#ifndef COMBINED_TEST
+int main(int argc, char** argv)
+{
+	CppUnit::TextUi::TestRunner runner;
+	runner.addTest(DiscriminatorTest::suite());
+	runner.run();
+	return 0;
+}
+#endif
@@ -0,0 +1,253 @@
+#include <iostream>
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/ui/text/TestRunner.h>
+
+#include <suo.hpp>
+#include <executor.hpp>
+
+
+using namespace std;
+using namespace suo;
+
+
+class SymbolCollector {
+public:
+	SymbolCollector() : vectors(0), errors(0), next(0) { }
+
+	void sinkSymbols(const SymbolVector& symbols, Timestamp now) {
+		vectors++;
+		// Every vector should continue the running sequence
+		for (Symbol s: symbols) {
+			if (s != (next & 0xFF))
+				errors++;
+			next++;
+		}
+		if (symbols.timestamp != now)
+			errors++;
+		thread_id = std::this_thread::get_id();
+	}
+
+	unsigned int vectors;
+	unsigned int errors;
+	unsigned int next;
+	std::thread::id thread_id;
+};
+
+
+class ExecutorTest: public CppUnit::TestFixture
+{
+public:
+
+	void test_ring() {
+		SPSCRing<int> ring(5);
+		CPPUNIT_ASSERT(ring.capacity() == 8);
+		CPPUNIT_ASSERT(ring.front() == nullptr);
+
+		// Fill and drain the ring a few times to test the wrap around
+		int value = 0, expected = 0;
+		for (unsigned int round = 0; round < 5; round++) {
+			while (int* slot = ring.acquire()) {
+				*slot = value++;
+				ring.commit();
+			}
+			CPPUNIT_ASSERT(ring.size() == 8);
+
+			for (unsigned int i = 0; i < 5; i++) {
+				int* slot = ring.front();
+				CPPUNIT_ASSERT(slot != nullptr && *slot == expected++);
+				ring.pop();
+			}
+			CPPUNIT_ASSERT(ring.size() == 3);
+		}
+	}
+
+	void test_concurrent_size() {
+		SPSCRing<int> ring(8);
+		std::atomic<bool> done{ false };
+
+		std::thread producer([&]() {
+			for (int i = 0; i < 20000; i++) {
+				int* slot;
+				while ((slot = ring.acquire()) == nullptr)
+					std::this_thread::yield();
+				*slot = i;
+				ring.commit();
+			}
+		});
+		std::thread consumer([&]() {
+			for (int i = 0; i < 20000; i++) {
+				while (ring.front() == nullptr)
+					std::this_thread::yield();
+				ring.pop();
+			}
+			done = true;
+		});
+
+		// Observe the size from a third thread
+		size_t max_size = 0;
+		while (done == false)
+			max_size = max(max_size, ring.size());
+
+		producer.join();
+		consumer.join();
+		CPPUNIT_ASSERT(max_size <= ring.capacity());
+		CPPUNIT_ASSERT(ring.size() == 0);
+	}
+
+	void test_drop_policy() {
+		SymbolQueue::Config conf;
+		conf.capacity = 4;
+		conf.policy = QueuePolicy::Drop;
+		SymbolQueue queue(conf);
+
+		SymbolCollector collector;
+		queue.output.connect_member(&collector, &SymbolCollector::sinkSymbols);
+
+		SymbolVector symbols(1);
+		for (unsigned int i = 0; i < 10; i++) {
+			symbols[0] = i;
+			symbols.timestamp = i;
+			queue.sink(symbols, i);
+		}
+
+		SymbolQueue::Statistics stats = queue.getStatistics();
+		CPPUNIT_ASSERT(stats.pushed == 4);
+		CPPUNIT_ASSERT(stats.dropped == 6);
+		CPPUNIT_ASSERT(stats.high_water == 4);
+
+		// The oldest items are kept
+		CPPUNIT_ASSERT(queue.process(100) == 4);
+		CPPUNIT_ASSERT(collector.vectors == 4 && collector.errors == 0);
+	}
+
+	void test_threaded_pipeline() {
+		SymbolQueue::Config conf;
+		conf.capacity = 8;
+		conf.policy = QueuePolicy::Block;
+		SymbolQueue queue(conf);
+
+		SymbolCollector collector;
+		queue.output.connect_member(&collector, &SymbolCollector::sinkSymbols);
+
+		Executor executor;
+		executor.addStage(queue);
+		executor.start();
+
+		// Produce faster than the consumer to exercise the back-pressure
+		const unsigned int n_vectors = 2000;
+		SymbolVector symbols;
+		unsigned int counter = 0;
+		for (unsigned int i = 0; i < n_vectors; i++) {
+			symbols.clear();
+			symbols.timestamp = i;
+			for (unsigned int j = 0; j < 1 + (i % 50); j++)
+				symbols.push_back(counter++ & 0xFF);
+			queue.sink(symbols, i);
+		}
+
+		executor.stop();
+
+		SymbolQueue::Statistics stats = queue.getStatistics();
+		CPPUNIT_ASSERT(stats.dropped == 0);
+		CPPUNIT_ASSERT(stats.pushed == n_vectors);
+		CPPUNIT_ASSERT(collector.vectors == n_vectors);
+		CPPUNIT_ASSERT(collector.next == counter);
+		CPPUNIT_ASSERT(collector.errors == 0);
+		CPPUNIT_ASSERT(collector.thread_id != std::this_thread::get_id());
+	}
+
+	void test_stage_exception() {
+		SymbolQueue queue;
+		queue.output.connect([](const SymbolVector& symbols, Timestamp now) {
+			(void)symbols;
+			if (now == 3)
+				throw SuoError("Stage failed");
+		});
+
+		Executor executor;
+		executor.addStage(queue);
+		executor.start();
+
+		SymbolVector symbols(1);
+		for (unsigned int i = 0; i < 5; i++)
+			queue.sink(symbols, i);
+		while (executor.failed() == false)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+		// The failed worker doesn't block the producer
+		for (unsigned int i = 0; i < 100; i++)
+			queue.sink(symbols, i);
+		CPPUNIT_ASSERT(queue.getStatistics().dropped > 0);
+
+		// The exception is passed to the caller once
+		CPPUNIT_ASSERT_THROW(executor.stop(), SuoError);
+		CPPUNIT_ASSERT(executor.running() == false);
+		executor.stop();
+	}
+
+	void test_executor_lifetime() {
+		SymbolQueue::Config conf;
+		conf.policy = QueuePolicy::Drop;
+		SymbolQueue queue(conf);
+		{
+			Executor executor;
+			executor.addStage(queue);
+			executor.start();
+		}
+
+		// The queue no longer notifies the destroyed executor and can be assigned again
+		SymbolVector symbols(1);
+		queue.sink(symbols, 0);
+		CPPUNIT_ASSERT(queue.size() == 1);
+
+		Executor executor;
+		executor.addStage(queue);
+		executor.start();
+		executor.stop();
+		CPPUNIT_ASSERT(queue.size() == 0);
+	}
+
+	void test_id_counter() {
+		unsigned int start = rx_id_counter;
+		std::vector<std::thread> threads;
+		for (unsigned int t = 0; t < 4; t++)
+			threads.emplace_back([]() {
+				for (unsigned int i = 0; i < 10000; i++)
+					rx_id_counter++;
+			});
+		for (auto& thread: threads)
+			thread.join();
+		CPPUNIT_ASSERT(rx_id_counter == start + 40000);
+	}
+
+	static CppUnit::Test* suite()
+	{
+		CppUnit::TestSuite* suite = new CppUnit::TestSuite("ExecutorTest");
+		suite->addTest(new CppUnit::TestCaller<ExecutorTest>("SPSC ring", &ExecutorTest::test_ring));
+		suite->addTest(new CppUnit::TestCaller<ExecutorTest>("Concurrent size", &ExecutorTest::test_concurrent_size));
+		suite->addTest(new CppUnit::TestCaller<ExecutorTest>("Drop policy", &ExecutorTest::test_drop_policy));
+		suite->addTest(new CppUnit::TestCaller<ExecutorTest>("Threaded pipeline", &ExecutorTest::test_threaded_pipeline));
+		suite->addTest(new CppUnit::TestCaller<ExecutorTest>("Stage exception", &ExecutorTest::test_stage_exception));
+		suite->addTest(new CppUnit::TestCaller<ExecutorTest>("Executor lifetime", &ExecutorTest::test_executor_lifetime));
+		suite->addTest(new CppUnit::TestCaller<ExecutorTest>("Frame ID counter", &ExecutorTest::test_id_counter));
+		return suite;
+	}
+
+};
+
+
+#ifndef COMBINED_TEST
+int main(int argc, char** argv)
+{
+	CppUnit::TextUi::TestRunner runner;
+	runner.addTest(ExecutorTest::suite());
+	runner.run();
+	return 0;
+}
+#endif
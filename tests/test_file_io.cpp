@@ -0,0 +1,153 @@
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/ui/text/TestRunner.h>
+
+#include <suo.hpp>
+#include <signal-io/file_io.hpp>
+#include <signal-io/mapped_file.hpp>
+#include <unistd.h>
+
+
+using namespace std;
+using namespace suo;
+
+
+class FileIOTest: public CppUnit::TestFixture
+{
+public:
+
+	/* Collects everything FileIO outputs */
+	struct Capture {
+		void sinkSamples(const SampleVector& samples, Timestamp now) {
+			CPPUNIT_ASSERT(samples.timestamp == now);
+			timestamps.push_back(now);
+			lengths.push_back(samples.size());
+			all.insert(all.end(), samples.begin(), samples.end());
+		}
+		vector<Timestamp> timestamps;
+		vector<size_t> lengths;
+		SampleVector all;
+	};
+
+	static const size_t len = 40000;
+
+	static string writeFile(const char* name, const void* data, size_t bytes) {
+		string filename = string("/tmp/suo_test_") + name;
+		ofstream file(filename, ios::binary);
+		file.write(static_cast<const char*>(data), bytes);
+		return filename;
+	}
+
+	static void replay(FileIO::Config conf, Capture& capture) {
+		FileIO io(conf);
+		io.sinkSamples.connect_member(&capture, &Capture::sinkSamples);
+		io.execute();
+	}
+
+	void test_cf32() {
+		SampleVector samples(len);
+		for (size_t i = 0; i < len; i++)
+			samples[i] = Sample(i, -(float)i);
+
+		FileIO::Config conf;
+		conf.input = writeFile("cf32.raw", samples.data(), len * sizeof(Sample));
+		conf.sample_rate = 48000;
+
+		Capture capture;
+		replay(conf, capture);
+		remove(conf.input.c_str());
+
+		CPPUNIT_ASSERT(capture.all == samples);
+		CPPUNIT_ASSERT(capture.lengths.size() == 3);
+		CPPUNIT_ASSERT(capture.lengths[0] == conf.buffer && capture.lengths[2] == len - 2 * conf.buffer);
+
+		/* Timestamps follow the sample index */
+		CPPUNIT_ASSERT(capture.timestamps[0] == 0);
+		CPPUNIT_ASSERT(capture.timestamps[1] == (Timestamp)(1e9 * conf.buffer / conf.sample_rate));
+		CPPUNIT_ASSERT(capture.timestamps[2] == (Timestamp)(1e9 * 2 * conf.buffer / conf.sample_rate));
+	}
+
+	void test_cs16() {
+		vector<cs16_t> raw(len);
+		for (size_t i = 0; i < len; i++) {
+			raw[i][0] = (int16_t)(rand() & 0xFFFF);
+			raw[i][1] = (int16_t)(rand() & 0xFFFF);
+		}
+		SampleVector expected(len);
+		cs16_to_cf(raw.data(), expected.data(), len);
+
+		FileIO::Config conf;
+		conf.format = "CS16";
+		conf.buffer = 1000;
+		conf.input = writeFile("cs16.raw", raw.data(), len * sizeof(cs16_t));
+
+		/* Memory mapped */
+		Capture mapped;
+		replay(conf, mapped);
+		CPPUNIT_ASSERT(mapped.all == expected);
+		CPPUNIT_ASSERT(mapped.lengths.size() == len / 1000);
+
+		/* Read as a stream from standard input */
+		Capture streamed;
+		{
+			ifstream file(conf.input, ios::binary);
+			streambuf* orig = cin.rdbuf(file.rdbuf());
+			conf.input = "-";
+			replay(conf, streamed);
+			cin.rdbuf(orig);
+			cin.clear();
+		}
+		remove(string("/tmp/suo_test_cs16.raw").c_str());
+		CPPUNIT_ASSERT(streamed.all == expected);
+		CPPUNIT_ASSERT(streamed.timestamps == mapped.timestamps);
+	}
+
+	/* Released regions continue from the last released page */
+	void test_mapped_release() {
+		const size_t page = sysconf(_SC_PAGESIZE);
+		vector<char> data(4 * page);
+		for (size_t i = 0; i < data.size(); i++)
+			data[i] = (char)i;
+		const string filename = writeFile("mapped.raw", data.data(), data.size());
+
+		MappedFile mapped;
+		CPPUNIT_ASSERT(mapped.open(filename));
+		size_t released = mapped.release(0, page / 2);
+		CPPUNIT_ASSERT(released == 0); // No whole page yet
+		released = mapped.release(released, page + 100);
+		CPPUNIT_ASSERT(released == page);
+		released = mapped.release(released, 2 * page + 100 - released);
+		CPPUNIT_ASSERT(released == 2 * page);
+
+		/* The released pages are read again from the file */
+		CPPUNIT_ASSERT(vector<char>(mapped.data(), mapped.data() + mapped.size()) == data);
+		mapped.close();
+		remove(filename.c_str());
+	}
+
+	static CppUnit::Test* suite()
+	{
+		CppUnit::TestSuite* suite = new CppUnit::TestSuite("FileIOTest");
+		suite->addTest(new CppUnit::TestCaller<FileIOTest>("CF32", &FileIOTest::test_cf32));
+		suite->addTest(new CppUnit::TestCaller<FileIOTest>("CS16", &FileIOTest::test_cs16));
+		suite->addTest(new CppUnit::TestCaller<FileIOTest>("Mapped release", &FileIOTest::test_mapped_release));
+		return suite;
+	}
+
+};
+
+
+#ifndef COMBINED_TEST
+int main(int argc, char** argv)
+{
+	CppUnit::TextUi::TestRunner runner;
+	runner.addTest(FileIOTest::suite());
+	runner.run();
+	return 0;
+}
+#endif
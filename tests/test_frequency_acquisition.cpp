@@ -0,0 +1,89 @@
+#include <iostream>
+#include <cmath>
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/ui/text/TestRunner.h>
+
+#include <suo.hpp>
+#include <modem/frequency_acquisition.hpp>
+
+
+using namespace std;
+using namespace suo;
+
+
+class FrequencyAcquisitionTest: public CppUnit::TestFixture
+{
+public:
+
+	static float randomFloat() {
+		return (rand() % 2001 - 1000) / 1000.0f;
+	}
+
+	/* Noise with two tones at frequency +- deviation. Zero deviation gives a single tone. */
+	static SampleVector twoTones(float sample_rate, float frequency, float deviation, float amplitude, size_t len) {
+		SampleVector samples(len);
+		for (size_t i = 0; i < len; i++) {
+			float t = i / sample_rate;
+			Sample s(0.1f * randomFloat(), 0.1f * randomFloat());
+			if (deviation == 0.0f)
+				s += amplitude * polar(1.0f, pi2f * frequency * t);
+			else
+				s += 0.5f * amplitude * (polar(1.0f, pi2f * (frequency - deviation) * t) + polar(1.0f, pi2f * (frequency + deviation) * t));
+			samples[i] = s;
+		}
+		return samples;
+	}
+
+	void test_estimate() {
+		FrequencyAcquisition::Config conf;
+		conf.sample_rate = 100e3;
+		conf.fft_length = 256;
+		conf.num_averages = 4;
+		conf.search_range = 20e3;
+		FrequencyAcquisition acq(conf);
+		const size_t len = conf.fft_length * conf.num_averages;
+
+		/* Single tone between bins */
+		SampleVector tone = twoTones(conf.sample_rate, -7.3e3, 0, 1.0f, len);
+		CPPUNIT_ASSERT(acq.execute(tone.data(), 100) == false);
+		CPPUNIT_ASSERT(acq.execute(tone.data() + 100, len - 100) == true);
+		CPPUNIT_ASSERT_DOUBLES_EQUAL(-7.3e3, acq.getFrequency(), 0.5f * acq.getResolution());
+		CPPUNIT_ASSERT(acq.getSNR() > 20.0f);
+
+		/* Symmetric 2FSK spectrum is estimated at the center instead of either of the tones */
+		SampleVector fsk = twoTones(conf.sample_rate, 4.1e3, 4.8e3, 1.0f, len);
+		CPPUNIT_ASSERT(acq.execute(fsk.data(), len) == true);
+		CPPUNIT_ASSERT_DOUBLES_EQUAL(4.1e3, acq.getFrequency(), 0.5f * acq.getResolution());
+
+		/* Noise only or a signal outside the search range */
+		SampleVector noise = twoTones(conf.sample_rate, 0.0f, 0, 0.0f, len);
+		CPPUNIT_ASSERT(acq.execute(noise.data(), len) == false);
+		SampleVector far = twoTones(conf.sample_rate, 35e3, 0, 1.0f, len);
+		CPPUNIT_ASSERT(acq.execute(far.data(), len) == false);
+
+		conf.fft_length = 100;
+		CPPUNIT_ASSERT_THROW(FrequencyAcquisition{conf}, SuoError);
+	}
+
+	static CppUnit::Test* suite()
+	{
+		CppUnit::TestSuite* suite = new CppUnit::TestSuite("FrequencyAcquisitionTest");
+		suite->addTest(new CppUnit::TestCaller<FrequencyAcquisitionTest>("Estimate", &FrequencyAcquisitionTest::test_estimate));
+		return suite;
+	}
+
+};
+
+
+#ifndef COMBINED_TEST
+int main(int argc, char** argv)
+{
+	CppUnit::TextUi::TestRunner runner;
+	runner.addTest(FrequencyAcquisitionTest::suite());
+	runner.run();
+	return 0;
+}
+#endif
@@ -79,7 +79,7 @@ public:
 		HDLCDeframer deframer(deframer_conf);
 
 		Frame received_frame;
-		deframer.sinkFrame.connect([&](Frame& frame, Timestamp now) {
+		deframer.sinkFrame.connect([&](const Frame& frame, Timestamp now) {
 			(void)now;
 			received_frame = frame;
 		});
@@ -99,7 +99,7 @@ public:
 		demod_conf.bt = mod_conf.bt;
 
 		FSKMatchedFilterDemodulator demod(demod_conf);
-		demod.sinkSymbol.connect_member(&deframer, &HDLCDeframer::sinkSymbol);
+		demod.sinkSymbols.connect_member(&deframer, &HDLCDeframer::sinkSymbols);
 		deframer.syncDetected.connect_member(&demod, &FSKMatchedFilterDemodulator::lockReceiver);
 
 
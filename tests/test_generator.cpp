@@ -25,6 +25,73 @@ SymbolGenerator test_counter()
 }
 
 
+SymbolGenerator test_counter_from(int start);
+
+SymbolGenerator test_child(int start, int count)
+{
+	SymbolVector v;
+	for (int i = start; i < start + count; i++)
+		v.push_back(i);
+	co_yield v;
+}
+
+SymbolGenerator test_nested()
+{
+	co_yield 0;
+	co_yield test_child(1, 9);      // Child yielding a vector
+
+	SymbolGenerator child = test_counter_from(10);
+	co_yield child;                 // Child delegating further
+	co_yield 40;
+}
+
+SymbolGenerator test_counter_from(int start)
+{
+	for (int i = start; i < start + 10; i++)
+		co_yield i;
+	co_yield test_child(start + 10, 20);
+}
+
+SymbolGenerator test_throwing_child()
+{
+	co_yield 1;
+	throw SuoError("Child failed");
+}
+
+SymbolGenerator test_throwing_parent()
+{
+	co_yield 0;
+	co_yield test_throwing_child();
+	co_yield 2;
+}
+
+SampleGenerator test_sample_child()
+{
+	SampleVector v(5);
+	for (int i = 0; i < 5; i++)
+		v[i] = Sample(i + 1, 0);
+	co_yield v;
+}
+
+SampleGenerator test_sample_nested()
+{
+	co_yield Sample(0, 0);
+	co_yield test_sample_child();
+	co_yield Sample(6, 0);
+}
+
+/* Renders blocks of 3 samples in place */
+SampleGenerator test_sample_inplace(int blocks)
+{
+	for (int b = 0; b < blocks; b++) {
+		SampleSpan out = co_yield SampleGenerator::reserve(4);
+		for (int i = 0; i < 3; i++)
+			out.data[i] = Sample(3 * b + i, 0);
+		co_yield SampleGenerator::commit(3);
+	}
+}
+
+
 class GeneratorTest: public CppUnit::TestFixture
 {
 public:
@@ -95,6 +162,24 @@ public:
 	}
 
 
+	/* A moved generator doesn't mark the start of the burst again */
+	void test_move_after_start() {
+		SymbolVector symbols;
+		symbols.reserve(10);
+
+		SymbolGenerator symbol_gen = test_counter();
+		symbol_gen.sourceSymbols(symbols);
+		CPPUNIT_ASSERT(symbols.flags & start_of_burst);
+
+		SymbolGenerator moved(std::move(symbol_gen));
+		SymbolVector rest;
+		rest.reserve(10);
+		moved.sourceSymbols(rest);
+		CPPUNIT_ASSERT(rest.size() == 10 && rest[0] == 10);
+		CPPUNIT_ASSERT((rest.flags & start_of_burst) == 0);
+	}
+
+
 	void test_counter_iterating() {
 		SymbolGenerator symbol_gen = test_counter();
 		CPPUNIT_ASSERT(symbol_gen.running() == true);
@@ -105,13 +190,144 @@ public:
 	}
 
 
+	void test_nested_generators() {
+		// Source with different buffer sizes to preempt at different points
+		for (size_t buffer_size: { 1, 3, 7, 64 }) {
+			SymbolVector symbols;
+			symbols.reserve(buffer_size);
+
+			SymbolGenerator symbol_gen = test_nested();
+			std::vector<int> received;
+			while (symbol_gen.running()) {
+				symbol_gen.sourceSymbols(symbols);
+				received.insert(received.end(), symbols.begin(), symbols.end());
+			}
+
+			CPPUNIT_ASSERT(received.size() == 41);
+			for (int i = 0; i < 41; i++)
+				CPPUNIT_ASSERT(received[i] == i);
+			CPPUNIT_ASSERT((symbols.flags & end_of_burst) != 0);
+		}
+	}
+
+	void test_partially_sourced_child() {
+		SymbolVector symbols;
+		symbols.reserve(5);
+
+		// Source part of the child directly before yielding it
+		SymbolGenerator child = test_child(0, 8);
+		child.sourceSymbols(symbols);
+		CPPUNIT_ASSERT(symbols.size() == 5);
+
+		auto parent = [](SymbolGenerator& child) -> SymbolGenerator {
+			co_yield child;
+			co_yield 100;
+		};
+		SymbolGenerator gen = parent(child);
+		symbols.reserve(16);
+		gen.sourceSymbols(symbols);
+		CPPUNIT_ASSERT(symbols.size() == 4);
+		CPPUNIT_ASSERT(symbols[0] == 5 && symbols[2] == 7 && symbols[3] == 100);
+	}
+
+	void test_child_exception() {
+		SymbolVector symbols;
+		symbols.reserve(16);
+		SymbolGenerator gen = test_throwing_parent();
+		bool caught = false;
+		try {
+			gen.sourceSymbols(symbols);
+		}
+		catch (const SuoError& e) {
+			caught = true;
+		}
+		CPPUNIT_ASSERT(caught);
+		CPPUNIT_ASSERT(gen.running() == false);
+	}
+
+	void test_nested_sample_generators() {
+		SampleVector samples;
+		samples.reserve(4);
+		SampleGenerator gen = test_sample_nested();
+		std::vector<float> received;
+		while (gen.running()) {
+			gen.sourceSamples(samples);
+			for (const Sample& s: samples)
+				received.push_back(s.real());
+		}
+		CPPUNIT_ASSERT(received.size() == 7);
+		for (int i = 0; i < 7; i++)
+			CPPUNIT_ASSERT(received[i] == i);
+	}
+
+	void test_lent_buffer() {
+		Sample buffer[8];
+		VectorFlags flags;
+		SampleGenerator gen = test_sample_inplace(4);
+
+		// 2 blocks fit directly, the third one is rendered to scratch and preempted
+		size_t len = gen.sourceSamples(SampleSpan{ buffer, 8 }, flags);
+		CPPUNIT_ASSERT(len == 8);
+		CPPUNIT_ASSERT((flags & start_of_burst) != 0 && (flags & end_of_burst) == 0);
+		for (int i = 0; i < 8; i++)
+			CPPUNIT_ASSERT(buffer[i].real() == i);
+
+		len = gen.sourceSamples(SampleSpan{ buffer, 8 }, flags);
+		CPPUNIT_ASSERT(len == 4);
+		CPPUNIT_ASSERT((flags & start_of_burst) == 0 && (flags & end_of_burst) != 0);
+		for (int i = 0; i < 4; i++)
+			CPPUNIT_ASSERT(buffer[i].real() == 8 + i);
+		CPPUNIT_ASSERT(gen.running() == false);
+
+		// Lent buffer smaller than the reserved region
+		gen = test_sample_inplace(2);
+		std::vector<float> received;
+		while (gen.running()) {
+			len = gen.sourceSamples(SampleSpan{ buffer, 2 }, flags);
+			for (size_t i = 0; i < len; i++)
+				received.push_back(buffer[i].real());
+		}
+		CPPUNIT_ASSERT(received.size() == 6);
+		for (int i = 0; i < 6; i++)
+			CPPUNIT_ASSERT(received[i] == i);
+	}
+
+	void test_frame_reuse() {
+		SymbolVector symbols;
+		symbols.reserve(64);
+
+		// Warm up the free list
+		for (int i = 0; i < 2; i++) {
+			SymbolGenerator gen = test_nested();
+			while (gen.running())
+				gen.sourceSymbols(symbols);
+		}
+
+		detail::CoroutineFrameStatistics before = detail::getCoroutineFrameStatistics();
+		for (int i = 0; i < 100; i++) {
+			SymbolGenerator gen = test_nested();
+			while (gen.running())
+				gen.sourceSymbols(symbols);
+		}
+		detail::CoroutineFrameStatistics after = detail::getCoroutineFrameStatistics();
+		CPPUNIT_ASSERT(after.allocations == before.allocations);
+		CPPUNIT_ASSERT(after.reused >= before.reused + 400);
+	}
+
 	static CppUnit::Test* suite()
 	{
 		CppUnit::TestSuite* suite = new CppUnit::TestSuite("GeneratorTest");
 		suite->addTest(new CppUnit::TestCaller<GeneratorTest>("Counter Sourcing 1", &GeneratorTest::test_counter_sourcing_1));
 		suite->addTest(new CppUnit::TestCaller<GeneratorTest>("Counter Sourcing 2", &GeneratorTest::test_counter_sourcing_2));
 		suite->addTest(new CppUnit::TestCaller<GeneratorTest>("Counter Sourcing 3", &GeneratorTest::test_counter_sourcing_3));
+		suite->addTest(new CppUnit::TestCaller<GeneratorTest>("Move after start", &GeneratorTest::test_move_after_start));
 		suite->addTest(new CppUnit::TestCaller<GeneratorTest>("Counter Iterating", &GeneratorTest::test_counter_iterating));
+		suite->addTest(new CppUnit::TestCaller<GeneratorTest>("Nested generators", &GeneratorTest::test_nested_generators));
+		suite->addTest(new CppUnit::TestCaller<GeneratorTest>("Partially sourced child", &GeneratorTest::test_partially_sourced_child));
+		suite->addTest(new CppUnit::TestCaller<GeneratorTest>("Child exception", &GeneratorTest::test_child_exception));
+		suite->addTest(new CppUnit::TestCaller<GeneratorTest>("Nested sample generators", &GeneratorTest::test_nested_sample_generators));
+		suite->addTest(new CppUnit::TestCaller<GeneratorTest>("Lent buffer", &GeneratorTest::test_lent_buffer));
+		suite->addTest(new CppUnit::TestCaller<GeneratorTest>("Frame reuse", &GeneratorTest::test_frame_reuse));
 		return suite;
 	}
 
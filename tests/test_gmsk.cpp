@@ -76,7 +76,7 @@ public:
 
 		GolayDeframer deframer(deframer_conf);
 		Frame received_frame;
-		deframer.sinkFrame.connect([&](Frame& frame, Timestamp now) {
+		deframer.sinkFrame.connect([&](const Frame& frame, Timestamp now) {
 			(void)now;
 			received_frame = frame;
 			cout << frame(Frame::PrintData | Frame::PrintMetadata | Frame::PrintAltColor | Frame::PrintColored);
@@ -98,7 +98,7 @@ public:
 		demod_conf.bt = mod_conf.bt;
 
 		FSKMatchedFilterDemodulator demod(demod_conf);
-		demod.sinkSymbol.connect_member(&deframer, &GolayDeframer::sinkSymbol);
+		demod.sinkSymbols.connect_member(&deframer, &GolayDeframer::sinkSymbols);
 		deframer.syncDetected.connect_member(&demod, &FSKMatchedFilterDemodulator::lockReceiver);
 		demod.setMetadata.connect_member(&deframer, &GolayDeframer::setMetadata);
 #elif 1
@@ -110,7 +110,7 @@ public:
 		demod_conf.samples_per_symbol = 4;
 
 		GMSKContinousDemodulator demod(demod_conf);
-		demod.sinkSymbol.connect_member(&deframer, &GolayDeframer::sinkSymbol);
+		demod.sinkSymbols.connect_member(&deframer, &GolayDeframer::sinkSymbols);
 		deframer.syncDetected.connect_member(&demod, &GMSKContinousDemodulator::lockReceiver);
 		demod.setMetadata.connect_member(&deframer, &GolayDeframer::setMetadata);
 #else
@@ -122,7 +122,7 @@ public:
 		demod_conf.syncword_len = framer_conf.syncword_len;
 
 		GMSKDemodulator demod(demod_conf);
-		demod.sinkSymbol.connect_member(&deframer, &GolayDeframer::sinkSymbol);
+		demod.sinkSymbols.connect_member(&deframer, &GolayDeframer::sinkSymbols);
 		deframer.syncDetected.connect_member(&demod, &GMSKContinousDemodulator::lockReceiver);
 		demod.setMetadata.connect_member(&deframer, &GolayDeframer::setMetadata);
 #endif
@@ -181,10 +181,131 @@ public:
 
 
 
+	/* A batch tap on sinkSymbols doesn't starve the per-symbol deframer */
+	void test_both_outputs()
+	{
+		GolayFramer::Config framer_conf;
+		GolayFramer framer(framer_conf);
+		RandomFrameGenerator frame_generator(28);
+		framer.sourceFrame.connect_member(&frame_generator, &RandomFrameGenerator::source_frame);
+
+		GMSKModulator::Config mod_conf;
+		mod_conf.sample_rate = 50e3;
+		mod_conf.symbol_rate = 9600;
+		mod_conf.center_frequency = 0;
+		GMSKModulator mod(mod_conf);
+		mod.generateSymbols.connect_member(&framer, &GolayFramer::generateSymbols);
+
+		GolayDeframer::Config deframer_conf;
+		deframer_conf.use_randomizer = framer_conf.use_randomizer;
+		deframer_conf.use_rs = framer_conf.use_rs;
+		GolayDeframer deframer(deframer_conf);
+		Frame received_frame;
+		deframer.sinkFrame.connect([&](const Frame& frame, Timestamp now) {
+			(void)now;
+			received_frame = frame;
+		});
+
+		GMSKContinousDemodulator::Config demod_conf;
+		demod_conf.sample_rate = mod_conf.sample_rate;
+		demod_conf.symbol_rate = mod_conf.symbol_rate;
+		demod_conf.center_frequency = mod_conf.center_frequency;
+		demod_conf.samples_per_symbol = 4;
+		GMSKContinousDemodulator demod(demod_conf);
+		demod.sinkSymbol.connect_member(&deframer, &GolayDeframer::sinkSymbol);
+		deframer.syncDetected.connect_member(&demod, &GMSKContinousDemodulator::lockReceiver);
+
+		size_t single = 0, batched = 0;
+		demod.sinkSymbol.connect([&](Symbol s, Timestamp now) { single++; });
+		demod.sinkSymbols.connect([&](const SymbolVector& symbols, Timestamp now) { batched += symbols.size(); });
+
+		SampleVector samples;
+		generate_noise(samples, 0.01f, 500);
+		demod.sinkSamples(samples, now);
+
+		samples.clear();
+		SampleGenerator sample_gen = mod.generateSamples(now);
+		sample_gen.sourceSamples(samples);
+		demod.sinkSamples(samples, now);
+
+		generate_noise(samples, 0.01f, 500);
+		demod.sinkSamples(samples, now);
+
+		CPPUNIT_ASSERT(single > 0);
+		CPPUNIT_ASSERT(single == batched);
+		CPPUNIT_ASSERT(received_frame.data == frame_generator.latest_frame().data);
+	}
+
+
+	/* Two bursts in one sample block are both received by the burst demodulator in batch mode */
+	void test_two_bursts()
+	{
+		GolayFramer::Config framer_conf;
+		GolayFramer framer(framer_conf);
+		RandomFrameGenerator frame_generator(28);
+		framer.sourceFrame.connect_member(&frame_generator, &RandomFrameGenerator::source_frame);
+
+		GMSKModulator::Config mod_conf;
+		mod_conf.sample_rate = 50e3;
+		mod_conf.symbol_rate = 9600;
+		mod_conf.center_frequency = 0;
+		mod_conf.ramp_up_duration = 8;
+		mod_conf.ramp_down_duration = 8;
+		GMSKModulator mod(mod_conf);
+		mod.generateSymbols.connect_member(&framer, &GolayFramer::generateSymbols);
+
+		GolayDeframer::Config deframer_conf;
+		deframer_conf.use_randomizer = framer_conf.use_randomizer;
+		deframer_conf.use_rs = framer_conf.use_rs;
+		GolayDeframer deframer(deframer_conf);
+		vector<ByteVector> received;
+		deframer.sinkFrame.connect([&](const Frame& frame, Timestamp now) {
+			(void)now;
+			received.push_back(frame.data);
+		});
+
+		GMSKDemodulator::Config demod_conf;
+		demod_conf.sample_rate = mod_conf.sample_rate;
+		demod_conf.symbol_rate = mod_conf.symbol_rate;
+		demod_conf.center_frequency = mod_conf.center_frequency;
+		demod_conf.syncword = framer_conf.syncword;
+		demod_conf.syncword_len = framer_conf.syncword_len;
+		GMSKDemodulator demod(demod_conf);
+		demod.sinkSymbols.connect_member(&deframer, &GolayDeframer::sinkSymbols);
+		deframer.syncDetected.connect_member(&demod, &GMSKDemodulator::lockReceiver);
+		demod.setMetadata.connect_member(&deframer, &GolayDeframer::setMetadata);
+
+		/* Noise, burst, a short gap, burst and noise in a single block */
+		const float noise_std = 0.01f;
+		SampleVector block, part;
+		vector<ByteVector> transmitted;
+		for (unsigned int burst = 0; burst < 2; burst++) {
+			generate_noise(part, noise_std, burst == 0 ? 2000 : 200);
+			block.insert(block.end(), part.begin(), part.end());
+
+			part.clear();
+			SampleGenerator sample_gen = mod.generateSamples(now);
+			sample_gen.sourceSamples(part);
+			add_noise(part, noise_std);
+			block.insert(block.end(), part.begin(), part.end());
+			transmitted.push_back(frame_generator.latest_frame().data);
+		}
+		generate_noise(part, noise_std, 2000);
+		block.insert(block.end(), part.begin(), part.end());
+
+		demod.sinkSamples(block, now);
+
+		CPPUNIT_ASSERT(received.size() == 2);
+		CPPUNIT_ASSERT(received[0] == transmitted[0]);
+		CPPUNIT_ASSERT(received[1] == transmitted[1]);
+	}
+
 	static CppUnit::Test* suite()
 	{
 		CppUnit::TestSuite* suite = new CppUnit::TestSuite("GMSKTest");
 		suite->addTest(new CppUnit::TestCaller<GMSKTest>("Basic test", &GMSKTest::runTest));
+		suite->addTest(new CppUnit::TestCaller<GMSKTest>("Both outputs", &GMSKTest::test_both_outputs));
+		suite->addTest(new CppUnit::TestCaller<GMSKTest>("Two bursts", &GMSKTest::test_two_bursts));
 		return suite;
 	}
 
@@ -40,7 +40,7 @@ public:
 		unsynced = false;
 	}
 
-	void dummy_frame_sink(Frame &frame, Timestamp _now) {
+	void dummy_frame_sink(const Frame &frame, Timestamp _now) {
 		(void)_now;
 		//cout << "dummy_frame_sink" << endl;
 		received_frame = frame;
@@ -92,7 +92,8 @@ public:
 		
 		/* Encode frame to bits */
 		symbols.clear();
-		framer.sourceSymbols(symbols, now);
+		SymbolGenerator gen = framer.generateSymbols(now);
+		gen.sourceSymbols(symbols);
 		cout << "Output symbols: " << symbols.size() << endl;
 		CPPUNIT_ASSERT(symbols.size() == total_symbols);
 
@@ -166,6 +167,140 @@ public:
 
 	}
 
+	void batchedTest()
+	{
+		size_t payload_len = 1 + (rand() % 255);
+
+		GolayFramer::Config framer_conf;
+		framer_conf.preamble_len = 64;
+		framer_conf.syncword = 0xdeadbeef;
+		framer_conf.syncword_len = 32;
+		framer_conf.use_viterbi = false;
+		framer_conf.use_randomizer = true;
+		framer_conf.use_rs = false;
+
+		GolayFramer framer(framer_conf);
+		framer.sourceFrame.connect_member(this, &GolayFramingTest::dummy_frame_source);
+
+		transmit_frame.clear();
+		transmit_frame.data.resize(payload_len);
+		for (size_t i = 0; i < payload_len; i++)
+			transmit_frame.data[i] = random_byte();
+
+		symbols.clear();
+		SymbolGenerator gen = framer.generateSymbols(now);
+		gen.sourceSymbols(symbols);
+
+		/* Surround the frame with random bits */
+		SymbolVector stream;
+		unsigned int l = 50 + rand() % 50;
+		for (size_t i = 0; i < l; i++)
+			stream.push_back(random_bit());
+		stream.insert(stream.end(), symbols.begin(), symbols.end());
+		for (size_t i = 0; i < 100; i++)
+			stream.push_back(random_bit());
+
+		GolayDeframer::Config deframer_conf;
+		deframer_conf.syncword = framer_conf.syncword;
+		deframer_conf.syncword_len = framer_conf.syncword_len;
+		deframer_conf.use_randomizer = true;
+
+		GolayDeframer deframer(deframer_conf);
+		deframer.sinkFrame.connect_member(this, &GolayFramingTest::dummy_frame_sink);
+		deframer.syncDetected.connect_member(this, &GolayFramingTest::dummy_sync_detected);
+
+		received_frame.clear();
+
+		/*
+		 * Feed the stream in randomly sized batches so that the
+		 * state transitions land in the middle of the vectors.
+		 */
+		const Timestamp symbol_period = 104167;
+		SymbolVector batch;
+		size_t i = 0;
+		while (i < stream.size()) {
+			size_t n = std::min<size_t>(1 + rand() % 100, stream.size() - i);
+			batch.clear();
+			batch.flags = has_timestamp;
+			batch.timestamp = now + i * symbol_period;
+			batch.symbol_period = symbol_period;
+			batch.insert(batch.end(), stream.begin() + i, stream.begin() + i + n);
+			deframer.sinkSymbols(batch, 0);
+			i += n;
+		}
+
+		CPPUNIT_ASSERT(synced == true);
+		CPPUNIT_ASSERT(unsynced == true);
+		CPPUNIT_ASSERT(transmit_frame.data == received_frame.data);
+
+		/* Sync timestamp points to the last bit of the syncword */
+		Timestamp sync_time = now + (l + framer_conf.preamble_len + framer_conf.syncword_len - 1) * symbol_period;
+		CPPUNIT_ASSERT(received_frame.timestamp == sync_time);
+		CPPUNIT_ASSERT(std::get<Timestamp>(received_frame.metadata["sync_timestamp"]) == sync_time);
+	}
+
+	void viterbiFramerTest()
+	{
+		size_t payload_len = 1 + (rand() % 255);
+
+		GolayFramer::Config framer_conf;
+		framer_conf.preamble_len = 64;
+		framer_conf.use_viterbi = true;
+		framer_conf.use_randomizer = false;
+		framer_conf.use_rs = false;
+
+		GolayFramer framer(framer_conf);
+		framer.sourceFrame.connect_member(this, &GolayFramingTest::dummy_frame_source);
+
+		transmit_frame.clear();
+		transmit_frame.data.resize(payload_len);
+		for (size_t i = 0; i < payload_len; i++)
+			transmit_frame.data[i] = random_byte();
+
+		/* Source in small pieces so the encoder gets preempted */
+		SymbolVector output;
+		symbols.clear();
+		symbols.reserve(37);
+		SymbolGenerator gen = framer.generateSymbols(now);
+		while (gen.running()) {
+			gen.sourceSymbols(symbols);
+			output.insert(output.end(), symbols.begin(), symbols.end());
+		}
+
+		const size_t header_len = framer_conf.preamble_len + framer_conf.syncword_len + 24;
+		CPPUNIT_ASSERT(output.size() == header_len + 2 * 8 * payload_len);
+
+		/* Reference CCSDS r=1/2 k=7 encoder */
+		uint32_t shift_register = 0;
+		size_t k = header_len;
+		for (Byte byte: transmit_frame.data) {
+			for (int b = 7; b >= 0; b--) {
+				shift_register = (shift_register << 1) | ((byte >> b) & 1);
+				CPPUNIT_ASSERT(output[k++] == (__builtin_popcount(shift_register & 79) & 1));
+				CPPUNIT_ASSERT(output[k++] == !(__builtin_popcount(shift_register & 109) & 1));
+			}
+		}
+
+		/* Scattered bit errors in the coded payload are corrected by the Viterbi decoder */
+		for (size_t i = header_len + 20; i < output.size(); i += 37)
+			output[i] ^= 1;
+
+		GolayDeframer::Config deframer_conf;
+		deframer_conf.use_viterbi = true;
+		deframer_conf.use_randomizer = false;
+		deframer_conf.use_rs = false;
+
+		GolayDeframer deframer(deframer_conf);
+		deframer.sinkFrame.connect_member(this, &GolayFramingTest::dummy_frame_sink);
+
+		received_frame.clear();
+		output.flags = has_timestamp;
+		output.timestamp = now;
+		deframer.sinkSymbols(output, now);
+
+		CPPUNIT_ASSERT(transmit_frame.data == received_frame.data);
+	}
+
 	void testGenerator()
 	{
 		// Source tavuja pienissä palasissa
@@ -176,6 +311,8 @@ public:
 	{
 		CppUnit::TestSuite* suite = new CppUnit::TestSuite("GolayFramingTest");
 		suite->addTest(new CppUnit::TestCaller<GolayFramingTest>("basicTest", &GolayFramingTest::basicTest));
+		suite->addTest(new CppUnit::TestCaller<GolayFramingTest>("batchedTest", &GolayFramingTest::batchedTest));
+		suite->addTest(new CppUnit::TestCaller<GolayFramingTest>("viterbiFramerTest", &GolayFramingTest::viterbiFramerTest));
 		return suite;
 	}
 
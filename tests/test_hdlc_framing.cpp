@@ -74,7 +74,7 @@ public:
 		HDLCDeframer deframer(deframer_conf);
 
 		Frame received_frame;
-		deframer.sinkFrame.connect([&](Frame& frame, Timestamp now) {
+		deframer.sinkFrame.connect([&](const Frame& frame, Timestamp now) {
 			(void) now;
 			received_frame = frame;
 		});
@@ -158,7 +158,7 @@ public:
 		HDLCDeframer deframer(deframer_conf);
 
 		Frame received_frame;
-		deframer.sinkFrame.connect([&](Frame& frame, Timestamp now) {
+		deframer.sinkFrame.connect([&](const Frame& frame, Timestamp now) {
 			received_frame = frame;
 		});
 
@@ -241,7 +241,7 @@ public:
 		HDLCDeframer deframer(deframer_conf);
 
 		Frame received_frame;
-		deframer.sinkFrame.connect([&](Frame& frame, Timestamp now) {
+		deframer.sinkFrame.connect([&](const Frame& frame, Timestamp now) {
 			received_frame = frame;
 		});
 
@@ -0,0 +1,233 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/ui/text/TestRunner.h>
+
+#include <suo.hpp>
+#include <executor.hpp>
+#include <signal-io/iq_recorder.hpp>
+
+
+using namespace std;
+using namespace suo;
+
+
+class IQRecorderTest: public CppUnit::TestFixture
+{
+public:
+
+	static SampleVector testBuffer(size_t index, size_t len) {
+		SampleVector buffer(len);
+		for (size_t i = 0; i < len; i++)
+			buffer[i] = Sample(0.001f * (index % 1000), -0.0001f * i);
+		return buffer;
+	}
+
+	static string readFile(const string& filename) {
+		ifstream file(filename, ios::binary);
+		stringstream ss;
+		ss << file.rdbuf();
+		return ss.str();
+	}
+
+	static size_t count(const string& s, const string& what) {
+		size_t n = 0;
+		for (size_t pos = s.find(what); pos != string::npos; pos = s.find(what, pos + 1))
+			n++;
+		return n;
+	}
+
+	static void cleanup(const string& filename) {
+		remove((filename + ".sigmf-data").c_str());
+		remove((filename + ".sigmf-meta").c_str());
+	}
+
+	void test_record() {
+		const string filename = "/tmp/suo_test_recording";
+		const size_t buffer_len = 1000;
+
+		for (string format: { "CF32", "CS16" }) {
+			IQRecorder::Config conf;
+			conf.filename = filename;
+			conf.format = format;
+			conf.sample_rate = 1e6;
+			conf.center_frequency = 437e6;
+			conf.capacity = 8;
+			conf.write_size = 4096; // Many flushes and a short tail
+			IQRecorder recorder(conf);
+
+			SampleVector reference;
+			for (size_t i = 0; i < 100; i++) {
+				SampleVector buffer = testBuffer(i, buffer_len);
+				recorder.sinkSamples(buffer, 5000000000ULL + i * buffer_len * 1000);
+				reference.insert(reference.end(), buffer.begin(), buffer.end());
+				recorder.process(2);
+			}
+			recorder.close();
+
+			IQRecorder::Statistics stats = recorder.getStatistics();
+			CPPUNIT_ASSERT(stats.buffers == 100);
+			CPPUNIT_ASSERT(stats.samples == 100 * buffer_len);
+			CPPUNIT_ASSERT(stats.dropped_buffers == 0);
+			CPPUNIT_ASSERT(stats.captures == 1);
+			CPPUNIT_ASSERT(stats.write_error == false);
+
+			const string data = readFile(filename + ".sigmf-data");
+			if (format == "CF32") {
+				CPPUNIT_ASSERT(data.size() == reference.size() * sizeof(Sample));
+				CPPUNIT_ASSERT(memcmp(data.data(), reference.data(), data.size()) == 0);
+			}
+			else {
+				vector<cs16_t> expected(reference.size());
+				cf_to_cs16(reference.data(), expected.data(), reference.size());
+				CPPUNIT_ASSERT(data.size() == expected.size() * sizeof(cs16_t));
+				CPPUNIT_ASSERT(memcmp(data.data(), expected.data(), data.size()) == 0);
+			}
+
+			const string meta = readFile(filename + ".sigmf-meta");
+			CPPUNIT_ASSERT(meta.find(format == "CF32" ? "\"cf32_le\"" : "\"ci16_le\"") != string::npos);
+			CPPUNIT_ASSERT(meta.find("\"core:frequency\": 437000000.0") != string::npos);
+			CPPUNIT_ASSERT(meta.find("\"suo:timestamp\": 5000000000") != string::npos);
+			CPPUNIT_ASSERT(count(meta, "core:sample_start") == 1);
+			cleanup(filename);
+		}
+	}
+
+	void test_drops() {
+		const string filename = "/tmp/suo_test_recording_drops";
+		const size_t buffer_len = 100;
+
+		IQRecorder::Config conf;
+		conf.filename = filename;
+		conf.sample_rate = 1e6;
+		conf.capacity = 4;
+		IQRecorder recorder(conf);
+
+		/* The writer is stalled so the queue fills up and the rest are dropped */
+		size_t index = 0;
+		for (; index < 10; index++)
+			recorder.sinkSamples(testBuffer(index, buffer_len), index * buffer_len * 1000);
+		CPPUNIT_ASSERT(recorder.size() == 4);
+		CPPUNIT_ASSERT(recorder.getStatistics().dropped_buffers == 6);
+		recorder.process(100);
+
+		/* Continues with a new capture segment after the gap */
+		for (; index < 12; index++)
+			recorder.sinkSamples(testBuffer(index, buffer_len), index * buffer_len * 1000);
+
+		/* Timestamp jump without drops also starts a new segment */
+		recorder.sinkSamples(testBuffer(index, buffer_len), 1000000000);
+		recorder.close();
+
+		IQRecorder::Statistics stats = recorder.getStatistics();
+		CPPUNIT_ASSERT(stats.buffers == 7);
+		CPPUNIT_ASSERT(stats.dropped_buffers == 6);
+		CPPUNIT_ASSERT(stats.dropped_samples == 6 * buffer_len);
+		CPPUNIT_ASSERT(stats.captures == 3);
+		CPPUNIT_ASSERT(stats.bytes_written == 7 * buffer_len * sizeof(Sample));
+
+		const string meta = readFile(filename + ".sigmf-meta");
+		CPPUNIT_ASSERT(count(meta, "core:sample_start") == 3);
+		CPPUNIT_ASSERT(meta.find("\"core:sample_start\": 400") != string::npos);
+		CPPUNIT_ASSERT(meta.find("\"suo:timestamp\": 1000000000") != string::npos);
+		CPPUNIT_ASSERT(meta.find("\"core:sample_start\": 600") != string::npos);
+		CPPUNIT_ASSERT(meta.find("\"suo:dropped_buffers\": 6") != string::npos);
+		cleanup(filename);
+	}
+
+	void test_split() {
+		const string filename = "/tmp/suo_test_recording_split";
+
+		IQRecorder::Config conf;
+		conf.filename = filename;
+		conf.sample_rate = 1e6;
+		conf.capacity = 4;
+		conf.max_buffer = 256;
+		IQRecorder recorder(conf);
+
+		/* Larger buffers than the slots are split, and the rest is dropped if the queue fills up */
+		SampleVector reference = testBuffer(0, 1000);
+		recorder.sinkSamples(reference, 0);
+		CPPUNIT_ASSERT(recorder.size() == 4);
+		recorder.process(100);
+		recorder.sinkSamples(testBuffer(1, 1200), 1000000);
+		CPPUNIT_ASSERT(recorder.size() == 4);
+		recorder.process(100);
+
+		/* The dropped tail starts a new capture segment */
+		recorder.sinkSamples(testBuffer(2, 100), 2200000);
+		recorder.close();
+
+		IQRecorder::Statistics stats = recorder.getStatistics();
+		CPPUNIT_ASSERT(stats.buffers == 9);
+		CPPUNIT_ASSERT(stats.samples == 1000 + 4 * 256 + 100);
+		CPPUNIT_ASSERT(stats.dropped_buffers == 1);
+		CPPUNIT_ASSERT(stats.dropped_samples == 1200 - 4 * 256);
+		CPPUNIT_ASSERT(stats.captures == 2);
+
+		const string data = readFile(filename + ".sigmf-data");
+		CPPUNIT_ASSERT(data.size() == stats.samples * sizeof(Sample));
+		CPPUNIT_ASSERT(memcmp(data.data(), reference.data(), reference.size() * sizeof(Sample)) == 0);
+
+		const string meta = readFile(filename + ".sigmf-meta");
+		CPPUNIT_ASSERT(meta.find("\"core:sample_start\": 2024") != string::npos);
+		cleanup(filename);
+	}
+
+	void test_executor() {
+		const string filename = "/tmp/suo_test_recording_thread";
+		const size_t buffer_len = 4096;
+
+		IQRecorder::Config conf;
+		conf.filename = filename;
+		conf.format = "CS16";
+		conf.capacity = 1024;
+		IQRecorder recorder(conf);
+
+		Executor executor;
+		executor.addStage(recorder);
+		executor.start();
+		for (size_t i = 0; i < 1000; i++)
+			recorder.sinkSamples(testBuffer(i, buffer_len), i * buffer_len * 1000);
+		executor.stop();
+		recorder.close();
+
+		IQRecorder::Statistics stats = recorder.getStatistics();
+		CPPUNIT_ASSERT(stats.buffers + stats.dropped_buffers == 1000);
+		CPPUNIT_ASSERT(stats.bytes_written == stats.samples * sizeof(cs16_t));
+		if (stats.dropped_buffers == 0)
+			CPPUNIT_ASSERT(stats.captures == 1);
+		CPPUNIT_ASSERT(readFile(filename + ".sigmf-data").size() == stats.bytes_written);
+		cleanup(filename);
+
+		conf.format = "CU8";
+		CPPUNIT_ASSERT_THROW(IQRecorder bad(conf), SuoError);
+	}
+
+	static CppUnit::Test* suite()
+	{
+		CppUnit::TestSuite* suite = new CppUnit::TestSuite("IQRecorderTest");
+		suite->addTest(new CppUnit::TestCaller<IQRecorderTest>("Record", &IQRecorderTest::test_record));
+		suite->addTest(new CppUnit::TestCaller<IQRecorderTest>("Drops", &IQRecorderTest::test_drops));
+		suite->addTest(new CppUnit::TestCaller<IQRecorderTest>("Split", &IQRecorderTest::test_split));
+		suite->addTest(new CppUnit::TestCaller<IQRecorderTest>("Executor", &IQRecorderTest::test_executor));
+		return suite;
+	}
+
+};
+
+
+#ifndef COMBINED_TEST
+int main(int argc, char** argv)
+{
+	CppUnit::TextUi::TestRunner runner;
+	runner.addTest(IQRecorderTest::suite());
+	runner.run();
+	return 0;
+}
+#endif
@@ -0,0 +1,124 @@
+#include <iostream>
+#include <cmath>
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/ui/text/TestRunner.h>
+
+#include <suo.hpp>
+#include <modem/matched_filter_bank.hpp>
+
+
+using namespace std;
+using namespace suo;
+
+
+class MatchedFilterBankTest: public CppUnit::TestFixture
+{
+public:
+
+	static Sample randomSample() {
+		return Sample((rand() % 2001 - 1000) / 1000.0f, (rand() % 2001 - 1000) / 1000.0f);
+	}
+
+	void test_reference(unsigned int num_filters, unsigned int len) {
+		vector<vector<Sample>> filters(num_filters, vector<Sample>(len));
+		for (auto& filter: filters)
+			for (Sample& tap: filter)
+				tap = randomSample();
+
+		const size_t total_len = 1000;
+		SampleVector samples(total_len);
+		for (Sample& s: samples)
+			s = randomSample();
+
+		/* Straightforward reference */
+		vector<float> ref(total_len);
+		float ref_power = 0.0f;
+		for (size_t n = 0; n < total_len; n++) {
+			float demod = 0.0f, total = 0.0f;
+			for (unsigned int m = 0; m < num_filters; m++) {
+				Sample y = 0.0f;
+				for (size_t k = 0; k < len && k <= n; k++)
+					y += filters[m][k] * samples[n - k];
+				float power = norm(y);
+				demod += (2.0f * m - num_filters + 1.0f) * power * power;
+				total += power;
+			}
+			ref[n] = demod / total;
+			ref_power += total;
+		}
+
+		/* Feed in varying block sizes to test the history over calls */
+		MatchedFilterBank bank;
+		bank.setFilters(filters);
+		CPPUNIT_ASSERT(bank.getNumFilters() == num_filters);
+		CPPUNIT_ASSERT(bank.getLength() == len);
+
+		vector<float> out(total_len);
+		float power = 0.0f;
+		size_t i = 0, block = 1;
+		while (i < total_len) {
+			size_t n = min(block, total_len - i);
+			power += bank.execute(&samples[i], n, &out[i]);
+			i += n;
+			block = (block * 3 + 5) % 97;
+		}
+
+		for (size_t n = 0; n < total_len; n++)
+			CPPUNIT_ASSERT_DOUBLES_EQUAL(ref[n], out[n], 1e-3 * (num_filters - 1));
+		CPPUNIT_ASSERT_DOUBLES_EQUAL(ref_power, power, 1e-3 * ref_power);
+	}
+
+	void test_bank() {
+		test_reference(2, 4);
+		test_reference(2, 8);
+		test_reference(4, 4);
+		test_reference(4, 1);
+	}
+
+	void test_reset() {
+		MatchedFilterBank bank;
+		bank.setFilters({ { 1.0f, 1.0f }, { 1.0f, -1.0f } });
+
+		/* Zero input doesn't produce NaNs */
+		SampleVector zeros(16, 0.0f);
+		vector<float> out(16);
+		CPPUNIT_ASSERT(bank.execute(zeros.data(), zeros.size(), out.data()) == 0.0f);
+		for (float f: out)
+			CPPUNIT_ASSERT(f == 0.0f);
+
+		/* Constant input matches only the first filter: demod = -p0 = -|1 + 1|^2 */
+		SampleVector ones(16, 1.0f);
+		bank.execute(ones.data(), ones.size(), out.data());
+		CPPUNIT_ASSERT_DOUBLES_EQUAL(-4.0f, out[15], 1e-6);
+
+		/* After reset, the first output sees only one sample: both filters have equal power */
+		bank.reset();
+		bank.execute(ones.data(), 1, out.data());
+		CPPUNIT_ASSERT_DOUBLES_EQUAL(0.0f, out[0], 1e-6);
+
+		CPPUNIT_ASSERT_THROW(bank.setFilters({ { 1.0f }, { 1.0f, 2.0f } }), SuoError);
+	}
+
+	static CppUnit::Test* suite()
+	{
+		CppUnit::TestSuite* suite = new CppUnit::TestSuite("MatchedFilterBankTest");
+		suite->addTest(new CppUnit::TestCaller<MatchedFilterBankTest>("Reference", &MatchedFilterBankTest::test_bank));
+		suite->addTest(new CppUnit::TestCaller<MatchedFilterBankTest>("Reset", &MatchedFilterBankTest::test_reset));
+		return suite;
+	}
+
+};
+
+
+#ifndef COMBINED_TEST
+int main(int argc, char** argv)
+{
+	CppUnit::TextUi::TestRunner runner;
+	runner.addTest(MatchedFilterBankTest::suite());
+	runner.run();
+	return 0;
+}
+#endif
@@ -0,0 +1,222 @@
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/ui/text/TestRunner.h>
+
+#include <suo.hpp>
+#include <offline_decoder.hpp>
+
+
+using namespace std;
+using namespace suo;
+
+
+/*
+ * Toy receiver: A frame is a sync sample (1000) followed by the length and the data bytes
+ * in the real parts of the samples. Like a real demodulator, it needs to settle after the start.
+ * With false_locks, it decodes frames already while settling but corrupts them.
+ */
+class ToyReceiver: public OfflineDecoder::Receiver {
+public:
+	static constexpr double sample_rate = 100e3;
+	static const size_t settling = 500;
+
+	void sinkSamples(const SampleVector& samples, Timestamp now) {
+		for (size_t i = 0; i < samples.size(); i++, received++) {
+			const int value = (int)samples[i].real();
+			if (received < settling && false_locks == false)
+				continue;
+			if (state == 0) {
+				if (value == 1000)
+					state = 1;
+			}
+			else if (state == 1) {
+				length = value;
+				frame.data.clear();
+				state = 2;
+			}
+			else {
+				frame.data.push_back(received < settling ? value ^ 0xFF : value);
+				if (frame.data.size() == length) {
+					sinkFrame.emit(frame, now + (Timestamp)(1e9 * i / sample_rate));
+					state = 0;
+				}
+			}
+		}
+	}
+
+	bool false_locks = false;
+	size_t received = 0;
+	int state = 0;
+	size_t length = 0;
+	Frame frame;
+};
+
+
+class OfflineDecoderTest: public CppUnit::TestFixture
+{
+public:
+
+	struct Decoded {
+		ByteVector data;
+		Timestamp now;
+		bool operator==(const Decoded& other) const { return data == other.data && now == other.now; }
+	};
+
+	static SampleVector testSignal(size_t len) {
+		SampleVector signal(len);
+		for (size_t i = 0; i < len; i++)
+			signal[i] = Sample(rand() % 256, 0);
+
+		ByteVector repeated(50);
+		for (Byte& b: repeated)
+			b = rand() % 256;
+
+		size_t i = 1000, n = 0;
+		while (i + 300 < len) {
+			/* Every tenth frame has the same contents */
+			size_t frame_len = (n % 10 == 0) ? repeated.size() : 10 + rand() % 190;
+			signal[i++] = 1000;
+			signal[i++] = frame_len;
+			for (size_t j = 0; j < frame_len; j++)
+				signal[i++] = (n % 10 == 0) ? repeated[j] : rand() % 256;
+			i += rand() % 3000;
+			n++;
+		}
+		return signal;
+	}
+
+	void test_decode() {
+		const SampleVector signal = testSignal(2000000);
+
+		OfflineDecoder::Config conf;
+		conf.sample_rate = ToyReceiver::sample_rate;
+		conf.buffer = 1000;
+
+		/* Sequential reference */
+		vector<Decoded> reference;
+		{
+			ToyReceiver receiver;
+			receiver.sinkFrame.connect([&](const Frame& frame, Timestamp now) { reference.push_back({ frame.data, now }); });
+			for (size_t i = 0; i < signal.size(); i += conf.buffer) {
+				SampleVector buffer(signal.begin() + i, signal.begin() + min(signal.size(), i + conf.buffer));
+				Timestamp now = (Timestamp)(1e9 * i / conf.sample_rate);
+				buffer.timestamp = now;
+				receiver.sinkSamples(buffer, now);
+			}
+		}
+		CPPUNIT_ASSERT(reference.size() > 1000);
+
+		for (unsigned int threads: { 1, 4 }) {
+			conf.threads = threads;
+			conf.chunk_duration = 0.5; // 50000 samples
+			conf.overlap = 0.03;       // Settling and the longest frame
+			OfflineDecoder decoder(conf, []() { return std::make_unique<ToyReceiver>(); });
+
+			vector<Decoded> decoded;
+			decoder.sinkFrame.connect([&](const Frame& frame, Timestamp now) { decoded.push_back({ frame.data, now }); });
+			decoder.decode(signal.data(), signal.size() * sizeof(Sample));
+
+			CPPUNIT_ASSERT(decoded == reference);
+			OfflineDecoder::Statistics stats = decoder.getStatistics();
+			CPPUNIT_ASSERT(stats.chunks == 40);
+			CPPUNIT_ASSERT(stats.frames == reference.size());
+			CPPUNIT_ASSERT(stats.duplicates == 0); // The overlap frames are taken from the earlier chunk only
+		}
+	}
+
+	/* A burst only in the overlap is taken from the settled receiver of the earlier chunk */
+	void test_overlap_burst() {
+		SampleVector signal(100000);
+		for (size_t i = 0; i < signal.size(); i++)
+			signal[i] = Sample(rand() % 256, 0);
+
+		// The second chunk starts at 47000 and settles at 47500
+		ByteVector data(50);
+		size_t i = 47100;
+		signal[i++] = 1000;
+		signal[i++] = data.size();
+		for (Byte& b: data)
+			signal[i++] = b = rand() % 256;
+
+		OfflineDecoder::Config conf;
+		conf.sample_rate = ToyReceiver::sample_rate;
+		conf.chunk_duration = 0.5;
+		conf.overlap = 0.03;
+		conf.buffer = 1000;
+		conf.threads = 2;
+		OfflineDecoder decoder(conf, []() {
+			auto receiver = std::make_unique<ToyReceiver>();
+			receiver->false_locks = true;
+			return receiver;
+		});
+
+		vector<ByteVector> decoded;
+		decoder.sinkFrame.connect([&](const Frame& frame, Timestamp now) { decoded.push_back(frame.data); });
+		decoder.decode(signal.data(), signal.size() * sizeof(Sample));
+
+		CPPUNIT_ASSERT(decoded.size() == 1);
+		CPPUNIT_ASSERT(decoded[0] == data);
+	}
+
+	void test_file() {
+		const SampleVector signal = testSignal(300000);
+		const string filename = "/tmp/suo_test_offline.cf32";
+		{
+			ofstream file(filename, ios::binary);
+			file.write(reinterpret_cast<const char*>(signal.data()), signal.size() * sizeof(Sample));
+		}
+
+		OfflineDecoder::Config conf;
+		conf.sample_rate = ToyReceiver::sample_rate;
+		conf.chunk_duration = 0.2;
+		conf.overlap = 0.03;
+		conf.buffer = 1000;
+		OfflineDecoder decoder(conf, []() { return std::make_unique<ToyReceiver>(); });
+		Timestamp prev = 0;
+		decoder.sinkFrame.connect([&](const Frame& frame, Timestamp now) {
+			(void)frame;
+			CPPUNIT_ASSERT(now >= prev);
+			prev = now;
+		});
+		decoder.decode(filename);
+		remove(filename.c_str());
+		CPPUNIT_ASSERT(decoder.getStatistics().chunks == 15);
+		CPPUNIT_ASSERT(decoder.getStatistics().frames > 100);
+
+		CPPUNIT_ASSERT_THROW(decoder.decode(filename), SuoError);
+
+		/* An exception from the frame sink stops the workers and is passed on */
+		decoder.sinkFrame.disconnect_all();
+		decoder.sinkFrame.connect([&](const Frame& frame, Timestamp now) { throw SuoError("Sink failed"); });
+		CPPUNIT_ASSERT_THROW(decoder.decode(signal.data(), signal.size() * sizeof(Sample)), SuoError);
+
+		conf.overlap = 0.2;
+		CPPUNIT_ASSERT_THROW(OfflineDecoder(conf, []() { return std::make_unique<ToyReceiver>(); }), SuoError);
+	}
+
+	static CppUnit::Test* suite()
+	{
+		CppUnit::TestSuite* suite = new CppUnit::TestSuite("OfflineDecoderTest");
+		suite->addTest(new CppUnit::TestCaller<OfflineDecoderTest>("Decode", &OfflineDecoderTest::test_decode));
+		suite->addTest(new CppUnit::TestCaller<OfflineDecoderTest>("Overlap burst", &OfflineDecoderTest::test_overlap_burst));
+		suite->addTest(new CppUnit::TestCaller<OfflineDecoderTest>("File", &OfflineDecoderTest::test_file));
+		return suite;
+	}
+
+};
+
+
+#ifndef COMBINED_TEST
+int main(int argc, char** argv)
+{
+	CppUnit::TextUi::TestRunner runner;
+	runner.addTest(OfflineDecoderTest::suite());
+	runner.run();
+	return 0;
+}
+#endif
@@ -0,0 +1,235 @@
+#include <iostream>
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/ui/text/TestRunner.h>
+
+#include <suo.hpp>
+#include <pipeline.hpp>
+#include <framing/golay_framer.hpp>
+#include <framing/golay_deframer.hpp>
+
+
+using namespace std;
+using namespace suo;
+
+
+/* Static stage: Hard decision slicer for BPSK samples */
+struct Slicer {
+	template <typename Next>
+	void process(const SampleVector& samples, Timestamp now, Next&& next) {
+		for (size_t i = 0; i < samples.size(); i++)
+			next((Symbol)(samples[i].real() > 0), now + i);
+	}
+};
+
+/* Static stage: Pack bits to bytes */
+struct BytePacker {
+	BytePacker() : byte(0), bits(0) { }
+
+	template <typename Next>
+	void process(Symbol bit, Timestamp now, Next&& next) {
+		byte = (byte << 1) | bit;
+		if (++bits == 8) {
+			next(byte, now);
+			byte = 0;
+			bits = 0;
+		}
+	}
+
+	Byte byte;
+	unsigned int bits;
+};
+
+/* Regular block with an input method and no outputs */
+class ByteCollector : public Block {
+public:
+	void sinkSymbol(Symbol byte, Timestamp now) {
+		bytes.push_back(byte);
+		latest = now;
+	}
+	ByteVector bytes;
+	Timestamp latest = 0;
+};
+
+/* Regular block with an output Port */
+class Inverter : public Block {
+public:
+	void sinkSymbol(Symbol bit, Timestamp now) {
+		sinkSymbols_out++;
+		sinkSymbol_port.emit(bit ^ 1, now);
+	}
+	Port<Symbol, Timestamp> sinkSymbol_port; // Not named after an input, must not be wired
+	unsigned int sinkSymbols_out = 0;
+};
+
+/* Regular block emitting the same bits from all of its symbol outputs */
+class BitSource : public Block {
+public:
+	void sinkSamples(const SampleVector& samples, Timestamp now) {
+		SymbolVector bits;
+		for (size_t i = 0; i < samples.size(); i++) {
+			bits.push_back(samples[i].real() > 0);
+			sinkSymbol.emit(bits.back(), now + i);
+			sinkSoftSymbol.emit(samples[i].real(), now + i);
+		}
+		sinkSymbols.emit(bits, now);
+	}
+	Port<Symbol, Timestamp> sinkSymbol;
+	Port<const SymbolVector&, Timestamp> sinkSymbols;
+	Port<SoftSymbol, Timestamp> sinkSoftSymbol;
+};
+
+/* Regular block counting the received bits. Soft symbols go to Block's throwing default. */
+class BitCounter : public Block {
+public:
+	void sinkSymbol(Symbol bit, Timestamp now) {
+		single++;
+	}
+	void sinkSymbols(const SymbolVector& bits, Timestamp now) {
+		batched += bits.size();
+	}
+	unsigned int single = 0, batched = 0;
+};
+
+class FrameCollector : public Block {
+public:
+	void sinkFrame(const Frame& frame, Timestamp now) {
+		frames.push_back(frame);
+	}
+	std::vector<Frame> frames;
+};
+
+
+class PipelineTest: public CppUnit::TestFixture
+{
+public:
+
+	void test_static_stages() {
+		Slicer slicer;
+		BytePacker packer;
+		ByteCollector collector;
+		Pipeline<Slicer, BytePacker, ByteCollector> pipeline(slicer, packer, collector);
+
+		// 0xA5 0x0F
+		SampleVector samples;
+		for (unsigned int byte: { 0xA5, 0x0F })
+			for (int i = 7; i >= 0; i--)
+				samples.push_back(((byte >> i) & 1) ? 1.0f : -1.0f);
+
+		pipeline.sink(samples, 1000);
+		CPPUNIT_ASSERT(collector.bytes.size() == 2);
+		CPPUNIT_ASSERT(collector.bytes[0] == 0xA5 && collector.bytes[1] == 0x0F);
+		CPPUNIT_ASSERT(collector.latest == 1015);
+		CPPUNIT_ASSERT(&pipeline.stage<2>() == &collector);
+	}
+
+	void test_block_stages() {
+		/* Generate a frame */
+		GolayFramer::Config framer_conf;
+		framer_conf.use_viterbi = false;
+		framer_conf.use_randomizer = true;
+		framer_conf.use_rs = true;
+		GolayFramer framer(framer_conf);
+
+		Frame transmit_frame;
+		for (size_t i = 0; i < 40; i++)
+			transmit_frame.data.push_back(i * 3);
+		framer.sourceFrame.connect([&](Frame& frame, Timestamp now) { frame = transmit_frame; });
+
+		SymbolVector symbols;
+		symbols.reserve(2048);
+		SymbolGenerator gen = framer.generateSymbols(0);
+		gen.sourceSymbols(symbols);
+
+		/* Deframer is a static stage passing the frame directly to the collector */
+		GolayDeframer::Config deframer_conf;
+		deframer_conf.use_viterbi = false;
+		deframer_conf.use_randomizer = true;
+		deframer_conf.use_rs = true;
+		GolayDeframer deframer(deframer_conf);
+		FrameCollector collector;
+		Pipeline<GolayDeframer, FrameCollector> pipeline(deframer, collector);
+
+		symbols.timestamp = 100;
+		symbols.flags |= has_timestamp;
+		pipeline.sink(symbols, 100);
+		CPPUNIT_ASSERT(collector.frames.size() == 1);
+		CPPUNIT_ASSERT(collector.frames[0].data == transmit_frame.data);
+
+		/* Same symbols bit by bit */
+		for (size_t i = 0; i < symbols.size(); i++)
+			pipeline.sink(symbols[i], 200 + i);
+		CPPUNIT_ASSERT(collector.frames.size() == 2);
+		CPPUNIT_ASSERT(collector.frames[1].data == transmit_frame.data);
+		CPPUNIT_ASSERT(deframer.sinkFrame.has_connections() == false);
+
+		/* As the last stage the deframer emits from its sinkFrame port */
+		Pipeline<GolayDeframer> last(deframer);
+		deframer.sinkFrame.connect_member(&collector, &FrameCollector::sinkFrame);
+		last.sink(symbols, 100);
+		CPPUNIT_ASSERT(collector.frames.size() == 3);
+		CPPUNIT_ASSERT(collector.frames[2].data == transmit_frame.data);
+	}
+
+	void test_one_port() {
+		SampleVector samples;
+		for (size_t i = 0; i < 10; i++)
+			samples.push_back((i % 3) ? 1.0f : -1.0f);
+
+		/* Only the batched output is wired */
+		BitSource source;
+		BitCounter counter;
+		Pipeline<BitSource, BitCounter> pipeline(source, counter);
+		pipeline.sink(samples, 0);
+		CPPUNIT_ASSERT(counter.batched == 10);
+		CPPUNIT_ASSERT(counter.single == 0);
+		CPPUNIT_ASSERT(source.sinkSymbol.has_connections() == false);
+		CPPUNIT_ASSERT(source.sinkSoftSymbol.has_connections() == false);
+
+		/* Falls back to the single symbols if the next stage doesn't take batches */
+		BitSource source2;
+		BytePacker packer;
+		ByteCollector collector;
+		Pipeline<BitSource, BytePacker, ByteCollector> pipeline2(source2, packer, collector);
+		samples.resize(16, 1.0f);
+		pipeline2.sink(samples, 0);
+		CPPUNIT_ASSERT(collector.bytes.size() == 2);
+		CPPUNIT_ASSERT(collector.bytes[0] == 0x6D && collector.bytes[1] == 0xBF);
+		CPPUNIT_ASSERT(source2.sinkSymbols.has_connections() == false);
+		CPPUNIT_ASSERT(source2.sinkSoftSymbol.has_connections() == false);
+	}
+
+	void test_unwired_port() {
+		Inverter inverter;
+		ByteCollector collector;
+		Pipeline<Inverter, ByteCollector> pipeline(inverter, collector);
+		pipeline.sink((Symbol)1, 0);
+		CPPUNIT_ASSERT(inverter.sinkSymbols_out == 1);
+		CPPUNIT_ASSERT(collector.bytes.empty());
+		CPPUNIT_ASSERT(inverter.sinkSymbol_port.has_connections() == false);
+	}
+
+	static CppUnit::Test* suite()
+	{
+		CppUnit::TestSuite* suite = new CppUnit::TestSuite("PipelineTest");
+		suite->addTest(new CppUnit::TestCaller<PipelineTest>("Static stages", &PipelineTest::test_static_stages));
+		suite->addTest(new CppUnit::TestCaller<PipelineTest>("Block stages", &PipelineTest::test_block_stages));
+		suite->addTest(new CppUnit::TestCaller<PipelineTest>("One port", &PipelineTest::test_one_port));
+		suite->addTest(new CppUnit::TestCaller<PipelineTest>("Unwired port", &PipelineTest::test_unwired_port));
+		return suite;
+	}
+
+};
+
+
+#ifndef COMBINED_TEST
+int main(int argc, char** argv)
+{
+	CppUnit::TextUi::TestRunner runner;
+	runner.addTest(PipelineTest::suite());
+	runner.run();
+	return 0;
+}
+#endif
@@ -0,0 +1,219 @@
+#include <iostream>
+#include <memory>
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/ui/text/TestRunner.h>
+
+#include <suo.hpp>
+
+
+using namespace std;
+using namespace suo;
+
+
+class Counter {
+public:
+	Counter() : calls(0), sum(0) { }
+
+	void sink(Symbol sym, Timestamp now) {
+		calls++;
+		sum += sym;
+		latest = now;
+	}
+
+	void const_sink(Symbol sym, Timestamp now) const {
+		const_calls++;
+	}
+
+	SymbolGenerator source(Timestamp now) {
+		calls++;
+		return SymbolGenerator();
+	}
+
+	unsigned int calls;
+	unsigned int sum;
+	Timestamp latest;
+	mutable unsigned int const_calls = 0;
+};
+
+
+class PortTest: public CppUnit::TestFixture
+{
+public:
+
+	void test_member_connection() {
+		Port<Symbol, Timestamp> port;
+		Counter a, b;
+
+		CPPUNIT_ASSERT(port.has_connections() == false);
+		port.emit(1, 0); // No slots, nothing happens
+
+		int id_a = port.connect_member(&a, &Counter::sink);
+		CPPUNIT_ASSERT(port.has_connections() == true);
+		port.emit(1, 100);
+		CPPUNIT_ASSERT(a.calls == 1 && a.sum == 1 && a.latest == 100);
+
+		int id_b = port.connect_member(&b, &Counter::sink);
+		CPPUNIT_ASSERT(id_a != id_b);
+		port.emit(2, 200);
+		CPPUNIT_ASSERT(a.calls == 2 && a.sum == 3);
+		CPPUNIT_ASSERT(b.calls == 1 && b.sum == 2 && b.latest == 200);
+
+		port.connect_member(&a, &Counter::const_sink);
+		port.emit(1, 300);
+		CPPUNIT_ASSERT(a.const_calls == 1);
+
+		port.disconnect(id_a);
+		port.emit(1, 400);
+		CPPUNIT_ASSERT(a.calls == 3); // Not called anymore
+		CPPUNIT_ASSERT(b.calls == 3);
+		CPPUNIT_ASSERT(a.const_calls == 2);
+
+		port.disconnect_all();
+		CPPUNIT_ASSERT(port.has_connections() == false);
+	}
+
+	void test_emit_order_and_targets() {
+		Port<int> port;
+		std::vector<int> order;
+
+		int id_1 = port.connect([&](int x) { order.push_back(1); });
+		int id_2 = port.connect([&](int x) { order.push_back(2); });
+		int id_3 = port.connect([&](int x) { order.push_back(3); });
+
+		port.emit(0);
+		CPPUNIT_ASSERT((order == std::vector<int>{ 1, 2, 3 }));
+
+		order.clear();
+		port.emit_for(id_2, 0);
+		CPPUNIT_ASSERT((order == std::vector<int>{ 2 }));
+
+		order.clear();
+		port.emit_for_all_but_one(id_1, 0);
+		CPPUNIT_ASSERT((order == std::vector<int>{ 2, 3 }));
+
+		order.clear();
+		port.disconnect(id_2);
+		port.disconnect(id_2); // Unknown IDs are ignored
+		port.emit(0);
+		CPPUNIT_ASSERT((order == std::vector<int>{ 1, 3 }));
+
+		order.clear();
+		port.emit_for(id_3, 0);
+		port.emit_for(id_2, 0);
+		CPPUNIT_ASSERT((order == std::vector<int>{ 3 }));
+	}
+
+	void test_copy_and_move() {
+		Port<Symbol, Timestamp> port;
+		Counter a;
+		port.connect_member(&a, &Counter::sink);
+
+		// Copying creates a new unconnected port
+		Port<Symbol, Timestamp> copy(port);
+		CPPUNIT_ASSERT(copy.has_connections() == false);
+
+		// Moving carries the connections
+		Port<Symbol, Timestamp> moved(std::move(port));
+		CPPUNIT_ASSERT(moved.has_connections() == true);
+		moved.emit(1, 0);
+		CPPUNIT_ASSERT(a.calls == 1);
+	}
+
+	void test_function_slots() {
+		// Member slots don't carry a std::function
+		typedef detail::PortSlot<void, Symbol, Timestamp> Slot;
+		CPPUNIT_ASSERT(sizeof(Slot) <= 3 * sizeof(void*) + detail::member_function_size);
+
+		// The slot owns the std::function of a generic callable
+		std::shared_ptr<int> calls = std::make_shared<int>(0);
+		{
+			Port<Symbol, Timestamp> port;
+			int id = port.connect([calls](Symbol sym, Timestamp now) { (*calls)++; });
+			CPPUNIT_ASSERT(calls.use_count() == 2);
+			port.emit(1, 0);
+			port.disconnect(id);
+			CPPUNIT_ASSERT(calls.use_count() == 1);
+
+			// Moving the port keeps the callables alive
+			for (int i = 0; i < 10; i++)
+				port.connect([calls](Symbol sym, Timestamp now) { (*calls)++; });
+			Port<Symbol, Timestamp> moved(std::move(port));
+			moved.emit(1, 0);
+			CPPUNIT_ASSERT(calls.use_count() == 11);
+		}
+		CPPUNIT_ASSERT(*calls == 11);
+		CPPUNIT_ASSERT(calls.use_count() == 1);
+	}
+
+	void test_source_port() {
+		SourcePort<int, int> port;
+		CPPUNIT_ASSERT(port.emit(0) == 0);
+
+		port.connect([](int x) { return 0; });
+		int id = port.connect([](int x) { return x + 1; });
+		port.connect([](int x) { return 1000; });
+		CPPUNIT_ASSERT(port.emit(1) == 2); // First non-empty value wins
+		CPPUNIT_ASSERT(port.emit_for(id, 5) == 6);
+		CPPUNIT_ASSERT(port.emit_for(1234, 5) == 0);
+
+		SourcePort<SymbolGenerator, Timestamp> gen_port;
+		Counter a;
+		gen_port.connect_member(&a, &Counter::source);
+		SymbolGenerator gen = gen_port.emit(0);
+		CPPUNIT_ASSERT(gen.running() == false);
+		CPPUNIT_ASSERT(a.calls == 1);
+	}
+
+	void test_connect_during_emit() {
+		Port<Symbol, Timestamp> port;
+		Counter a;
+		int calls = 0, self_id = 0;
+
+		// Connecting many slots from a callback must not invalidate the running one
+		self_id = port.connect([&](Symbol sym, Timestamp now) {
+			calls++;
+			for (int i = 0; i < 100; i++)
+				port.connect_member(&a, &Counter::sink);
+			port.disconnect(self_id);
+		});
+		port.emit(1, 0);
+		CPPUNIT_ASSERT(calls == 1);
+		CPPUNIT_ASSERT(a.calls == 0); // Takes effect after the emit
+
+		port.emit(1, 0);
+		CPPUNIT_ASSERT(calls == 1);
+		CPPUNIT_ASSERT(a.calls == 100);
+
+		// Disconnecting everything from a callback
+		port.connect([&](Symbol sym, Timestamp now) { port.disconnect_all(); });
+		port.emit(1, 0);
+		CPPUNIT_ASSERT(port.has_connections() == false);
+	}
+
+	static CppUnit::Test* suite()
+	{
+		CppUnit::TestSuite* suite = new CppUnit::TestSuite("PortTest");
+		suite->addTest(new CppUnit::TestCaller<PortTest>("Member connection", &PortTest::test_member_connection));
+		suite->addTest(new CppUnit::TestCaller<PortTest>("Emit order and targets", &PortTest::test_emit_order_and_targets));
+		suite->addTest(new CppUnit::TestCaller<PortTest>("Copy and move", &PortTest::test_copy_and_move));
+		suite->addTest(new CppUnit::TestCaller<PortTest>("Function slots", &PortTest::test_function_slots));
+		suite->addTest(new CppUnit::TestCaller<PortTest>("Source port", &PortTest::test_source_port));
+		suite->addTest(new CppUnit::TestCaller<PortTest>("Connect during emit", &PortTest::test_connect_during_emit));
+		return suite;
+	}
+
+};
+
+
+#ifndef COMBINED_TEST
+int main(int argc, char** argv)
+{
+	CppUnit::TextUi::TestRunner runner;
+	runner.addTest(PortTest::suite());
+	runner.run();
+	return 0;
+}
+#endif
@@ -0,0 +1,94 @@
+#include <iostream>
+#include <cmath>
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/ui/text/TestRunner.h>
+
+#include <suo.hpp>
+#include <modem/preamble_correlator.hpp>
+
+
+using namespace std;
+using namespace suo;
+
+
+class PreambleCorrelatorTest: public CppUnit::TestFixture
+{
+public:
+
+	static float randomFloat() {
+		return (rand() % 2001 - 1000) / 1000.0f;
+	}
+
+	static SampleVector noise(size_t len, float amplitude) {
+		SampleVector samples(len);
+		for (Sample& s: samples)
+			s = amplitude * Sample(randomFloat(), randomFloat());
+		return samples;
+	}
+
+	void test_detection() {
+		const size_t preamble_len = 64, position = 1000;
+
+		vector<Sample> preamble(preamble_len);
+		for (Sample& s: preamble)
+			s = Sample((rand() & 1) ? 1.0f : -1.0f, (rand() & 1) ? 1.0f : -1.0f);
+
+		PreambleCorrelator correlator;
+		correlator.setPreamble(preamble);
+		CPPUNIT_ASSERT(correlator.getBlockLength() >= correlator.getFFTLength() * 3 / 4);
+
+		/* Preamble with a carrier offset and gain in noise */
+		const float dphi = 0.02f, gain = 0.5f;
+		SampleVector samples = noise(3000, 0.1f);
+		for (size_t k = 0; k < preamble_len; k++)
+			samples[position + k] += gain * preamble[k] * polar(1.0f, dphi * k + 1.0f);
+
+		PreambleCorrelator::Detection det;
+		size_t searched = 0;
+		CPPUNIT_ASSERT(correlator.search(samples.data(), samples.size(), det, searched) == true);
+		CPPUNIT_ASSERT(det.offset == position);
+		CPPUNIT_ASSERT(searched == position);
+		CPPUNIT_ASSERT_DOUBLES_EQUAL(dphi, det.dphi, 2e-3);
+		CPPUNIT_ASSERT_DOUBLES_EQUAL(gain, det.gamma, 0.1);
+		CPPUNIT_ASSERT(det.rho > 0.5f && det.rho <= 1.0f);
+		CPPUNIT_ASSERT(abs(det.tau) < 0.5f);
+
+		/* Search in pieces the way a receiver consumes its buffer */
+		size_t start = 0, end = 0;
+		bool found = false;
+		while (end < samples.size() && found == false) {
+			end = min(end + 100, samples.size());
+			found = correlator.search(&samples[start], end - start, det, searched);
+			start += found ? det.offset : searched;
+		}
+		CPPUNIT_ASSERT(found == true);
+		CPPUNIT_ASSERT(start == position);
+
+		/* Plain noise */
+		SampleVector empty = noise(3000, 0.1f);
+		CPPUNIT_ASSERT(correlator.search(empty.data(), empty.size(), det, searched) == false);
+		CPPUNIT_ASSERT(searched > 0 && searched <= empty.size());
+	}
+
+	static CppUnit::Test* suite()
+	{
+		CppUnit::TestSuite* suite = new CppUnit::TestSuite("PreambleCorrelatorTest");
+		suite->addTest(new CppUnit::TestCaller<PreambleCorrelatorTest>("Detection", &PreambleCorrelatorTest::test_detection));
+		return suite;
+	}
+
+};
+
+
+#ifndef COMBINED_TEST
+int main(int argc, char** argv)
+{
+	CppUnit::TextUi::TestRunner runner;
+	runner.addTest(PreambleCorrelatorTest::suite());
+	runner.run();
+	return 0;
+}
+#endif
@@ -0,0 +1,137 @@
+#include <iostream>
+#include <thread>
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/TestAssert.h>
+#include <cppunit/TestCaller.h>
+#include <cppunit/ui/text/TestRunner.h>
+
+#include <suo.hpp>
+#include <profiling.hpp>
+
+
+using namespace std;
+using namespace suo;
+
+
+class ProfilingTest: public CppUnit::TestFixture
+{
+public:
+
+	/* Find the profile of a point by entry name */
+	static bool findProfile(const string& entry, ProfileStatistics& stats) {
+		for (const ProfileStatistics& s: getProfile()) {
+			if (s.entry == entry) {
+				stats = s;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	static void busyWait(unsigned int us) {
+		auto end = chrono::steady_clock::now() + chrono::microseconds(us);
+		while (chrono::steady_clock::now() < end);
+	}
+
+	void test_counters() {
+		ProfilePoint point("TestBlock", "counters");
+		for (int i = 0; i < 10; i++) {
+			ProfileScope scope(point, 100);
+			busyWait(50);
+		}
+		point.drop(3);
+
+		ProfileStatistics stats;
+		CPPUNIT_ASSERT(findProfile("counters", stats));
+		CPPUNIT_ASSERT(stats.block.rfind("TestBlock#", 0) == 0);
+		CPPUNIT_ASSERT(stats.calls == 10);
+		CPPUNIT_ASSERT(stats.items == 1000);
+		CPPUNIT_ASSERT(stats.drops == 3);
+		CPPUNIT_ASSERT(stats.total_ns >= 10 * 50000);
+		CPPUNIT_ASSERT(stats.self_ns == stats.total_ns);
+		CPPUNIT_ASSERT(stats.max_ns >= 50000 && stats.max_ns <= stats.total_ns);
+		CPPUNIT_ASSERT(stats.item_rate > 0);
+	}
+
+	void test_nested() {
+		ProfilePoint outer("TestBlock", "outer");
+		ProfilePoint inner("TestBlock", "inner");
+		{
+			ProfileScope scope(outer, 1);
+			busyWait(100);
+			{
+				ProfileScope scope(inner, 1);
+				busyWait(500);
+			}
+		}
+
+		ProfileStatistics outer_stats, inner_stats;
+		CPPUNIT_ASSERT(findProfile("outer", outer_stats));
+		CPPUNIT_ASSERT(findProfile("inner", inner_stats));
+		CPPUNIT_ASSERT(outer_stats.total_ns >= outer_stats.self_ns + inner_stats.total_ns);
+		CPPUNIT_ASSERT(outer_stats.self_ns < inner_stats.self_ns);
+	}
+
+	void test_threads() {
+		ProfilePoint point("TestBlock", "threads");
+		vector<thread> threads;
+		for (int t = 0; t < 4; t++)
+			threads.emplace_back([&point]() {
+				for (int i = 0; i < 1000; i++) {
+					ProfileScope scope(point, 2);
+				}
+			});
+
+		// Snapshot while counting
+		ProfileStatistics stats;
+		CPPUNIT_ASSERT(findProfile("threads", stats));
+		CPPUNIT_ASSERT(stats.calls <= 4000);
+
+		// Counts of the exited threads are kept
+		for (thread& t: threads)
+			t.join();
+		CPPUNIT_ASSERT(findProfile("threads", stats));
+		CPPUNIT_ASSERT(stats.calls == 4000);
+		CPPUNIT_ASSERT(stats.items == 8000);
+	}
+
+	void test_lifetime() {
+		{
+			ProfilePoint point("TestBlock", "lifetime");
+			ProfileScope scope(point, 1);
+		}
+		ProfileStatistics stats;
+		CPPUNIT_ASSERT(findProfile("lifetime", stats) == false);
+
+		// Reused point doesn't inherit old counts
+		ProfilePoint point("TestBlock", "reused");
+		CPPUNIT_ASSERT(findProfile("reused", stats));
+		CPPUNIT_ASSERT(stats.calls == 0);
+
+		string json = getProfileJSON();
+		CPPUNIT_ASSERT(json.find("\"reused\"") != string::npos);
+	}
+
+	static CppUnit::Test* suite()
+	{
+		CppUnit::TestSuite* suite = new CppUnit::TestSuite("ProfilingTest");
+		suite->addTest(new CppUnit::TestCaller<ProfilingTest>("Counters", &ProfilingTest::test_counters));
+		suite->addTest(new CppUnit::TestCaller<ProfilingTest>("Nested scopes", &ProfilingTest::test_nested));
+		suite->addTest(new CppUnit::TestCaller<ProfilingTest>("Threads", &ProfilingTest::test_threads));
+		suite->addTest(new CppUnit::TestCaller<ProfilingTest>("Lifetime", &ProfilingTest::test_lifetime));
+		return suite;
+	}
+
+};
+
+
+#ifndef COMBINED_TEST
+int main(int argc, char** argv)
+{
+	CppUnit::TextUi::TestRunner runner;
+	runner.addTest(ProfilingTest::suite());
+	runner.run();
+	return 0;
+}
+#endif
@@ -58,6 +58,51 @@ public:
 
 	}
 
+	void testMetadataStore() {
+
+		Frame frame;
+		frame.setMetadata(meta::sync_errors, 2u);
+		frame.setMetadata("sync_errors", 3u); // Same field by name
+		frame.setMetadata(meta::sync_utc_timestamp, UTCTimestamp{ 1700000000123456789LL });
+		CPPUNIT_ASSERT(frame.metadata.size() == 2);
+		CPPUNIT_ASSERT(std::get<unsigned int>(frame.metadata.at(meta::sync_errors)) == 3);
+		CPPUNIT_ASSERT(MetadataKey("sync_errors") == meta::sync_errors);
+		CPPUNIT_ASSERT(meta::rssi.name() == "rssi");
+		CPPUNIT_ASSERT(frame.metadata.contains(meta::cfo) == false);
+
+		// More fields than fit inline
+		for (unsigned int i = 0; i < 2 * FrameMetadata::inline_capacity; i++)
+			frame.setMetadata("custom_" + to_string(i), (int)i);
+		CPPUNIT_ASSERT(frame.metadata.size() == 2 + 2 * FrameMetadata::inline_capacity);
+
+		Frame copy = frame;
+		CPPUNIT_ASSERT(copy.metadata.size() == frame.metadata.size());
+		CPPUNIT_ASSERT(std::get<int>(copy.metadata.at("custom_20")) == 20);
+
+		// UTC timestamp is formatted only in the JSON output
+		std::string json = frame.serialize_to_json();
+		CPPUNIT_ASSERT(json.find("\"sync_utc_timestamp\":\"2023-11-14T22:13:20.123Z\"") != string::npos);
+
+		Frame parsed = Frame::deserialize_from_json(json);
+		CPPUNIT_ASSERT(parsed.metadata.size() == frame.metadata.size());
+		CPPUNIT_ASSERT(std::get<std::string>(parsed.metadata.at(meta::sync_utc_timestamp)) == "2023-11-14T22:13:20.123Z");
+
+		frame.clear();
+		CPPUNIT_ASSERT(frame.metadata.empty());
+		CPPUNIT_ASSERT(frame.metadata.begin() == frame.metadata.end());
+
+		// A peer sending endless new names can't fill the key table
+		for (unsigned int i = 0; i < 2 * MetadataKey::max_external_keys; i++) {
+			Frame received = Frame::deserialize_from_json("{ \"metadata\": { \"rssi\": 1.0, \"remote_" + to_string(i) + "\": 1 } }");
+			CPPUNIT_ASSERT(received.metadata.contains(meta::rssi));
+		}
+		MetadataKey key;
+		CPPUNIT_ASSERT(MetadataKey::fromExternal("remote_" + to_string(2 * MetadataKey::max_external_keys), key) == false);
+		CPPUNIT_ASSERT(MetadataKey::fromExternal("custom_20", key) && key == MetadataKey("custom_20"));
+		MetadataKey("local_name"); // Names from the code are still registered
+	}
+
+
 	void json_parsing_test() {
 
 		try {
@@ -238,6 +283,7 @@ public:
 	{
 		CppUnit::TestSuite* suite = new CppUnit::TestSuite("FrameTest");
 		suite->addTest(new CppUnit::TestCaller<FrameTest>("Metadata", &FrameTest::testMetadata));
+		suite->addTest(new CppUnit::TestCaller<FrameTest>("Metadata store", &FrameTest::testMetadataStore));
 		suite->addTest(new CppUnit::TestCaller<FrameTest>("JSON parsing", &FrameTest::json_parsing_test));
 		//suite->addTest(new CppUnit::TestCaller<FrameTest>("Bit operations", &FrameTest::test_bit_operations));
 		suite->addTest(new CppUnit::TestCaller<FrameTest>("Bit Parity Test", &FrameTest::test_bit_parity));